@@ -30,14 +30,22 @@ foreach(fname
 "../thirdparty/ocornut-imgui/ocornut-imgui/imgui_demo.cpp"
 "../thirdparty/ocornut-imgui/ocornut-imgui/imgui_draw.cpp"
 "Main.cpp"
+"algs/Parallel.cpp"
 "algs/Partition_Tracker.cpp"
 "algs/Pod_Chunk.cpp"
 "app/Game.cpp"
+"app/Profiler_Panel.cpp"
 "debug/Debug_Assert_Lua_Balance.cpp"
+"debug/Jit_Diag.cpp"
+"debug/Lua_Profiler.cpp"
+"debug/Perf_Counters.cpp"
+"debug/Profiler.cpp"
+"debug/Trace.cpp"
 "engine/App_State.cpp"
 "engine/App_State_Machine.cpp"
 "engine/Engine.cpp"
 "except/Except.cpp"
+"gensys/Cache.cpp"
 "gensys/Compiler.cpp"
 "gensys/Entity_Collection.cpp"
 "gensys/Entity_Events.cpp"
@@ -45,17 +53,24 @@ foreach(fname
 "gensys/Events.cpp"
 "gensys/Gensys.cpp"
 "gensys/Interm_Types.cpp"
+"gensys/Interned_Strings.cpp"
 "gensys/Lua_Interf_Runtime.cpp"
 "gensys/Lua_Interf_Setup.cpp"
+"gensys/Memory.cpp"
+"gensys/Rollback.cpp"
 "gensys/Runtime.cpp"
+"gensys/Snapshot.cpp"
 "gensys/Util.cpp"
+"gensys/World.cpp"
 "logger/Logger.cpp"
 "render/Shaders.cpp"
 "resource/Json_Util.cpp"
 "resource/Oid.cpp"
 "resource/Resources.cpp"
+"resource/Watcher.cpp"
 "scheduler/Lua_Interf.cpp"
 "scheduler/Sched.cpp"
+"script/Gc_Scheduler.cpp"
 "script/Lua_Interf_Util.cpp"
 "script/Script.cpp"
 "script/Script_Resource.cpp"
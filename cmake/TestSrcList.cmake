@@ -30,14 +30,26 @@ foreach(fname
 "../thirdparty/ocornut-imgui/ocornut-imgui/imgui_demo.cpp"
 "../thirdparty/ocornut-imgui/ocornut-imgui/imgui_draw.cpp"
 "Test.cpp"
+"algs/Parallel.cpp"
 "algs/Partition_Tracker.cpp"
 "algs/Pod_Chunk.cpp"
 "app/Game.cpp"
+"app/Profiler_Panel.cpp"
+"bench/Compare.cpp"
+"bench/Gensys_Cases.cpp"
+"bench/Lua_Interf.cpp"
+"bench/Runner.cpp"
 "debug/Debug_Assert_Lua_Balance.cpp"
+"debug/Jit_Diag.cpp"
+"debug/Lua_Profiler.cpp"
+"debug/Perf_Counters.cpp"
+"debug/Profiler.cpp"
+"debug/Trace.cpp"
 "engine/App_State.cpp"
 "engine/App_State_Machine.cpp"
 "engine/Engine.cpp"
 "except/Except.cpp"
+"gensys/Cache.cpp"
 "gensys/Compiler.cpp"
 "gensys/Entity_Collection.cpp"
 "gensys/Entity_Events.cpp"
@@ -45,23 +57,31 @@ foreach(fname
 "gensys/Events.cpp"
 "gensys/Gensys.cpp"
 "gensys/Interm_Types.cpp"
+"gensys/Interned_Strings.cpp"
 "gensys/Lua_Interf_Runtime.cpp"
 "gensys/Lua_Interf_Setup.cpp"
+"gensys/Memory.cpp"
+"gensys/Rollback.cpp"
 "gensys/Runtime.cpp"
+"gensys/Snapshot.cpp"
 "gensys/Util.cpp"
+"gensys/World.cpp"
 "logger/Logger.cpp"
 "render/Shaders.cpp"
 "resource/Json_Util.cpp"
 "resource/Oid.cpp"
 "resource/Resources.cpp"
+"resource/Watcher.cpp"
 "scheduler/Lua_Interf.cpp"
 "scheduler/Sched.cpp"
+"script/Gc_Scheduler.cpp"
 "script/Lua_Interf_Util.cpp"
 "script/Script.cpp"
 "script/Script_Resource.cpp"
 "script/Script_Util.cpp"
 "test/Algs_Test.cpp"
 "test/App_State_Machine_Test.cpp"
+"test/Bench_Test.cpp"
 "test/Debug_Test.cpp"
 "test/Flag_Test.cpp"
 "test/Gensys_Intermediate_Test.cpp"
@@ -70,6 +90,7 @@ foreach(fname
 "test/Initialization_Sanity_Test.cpp"
 "test/Lua_As_Lambda_Test.cpp"
 "test/Memory_Test.cpp"
+"test/Partition_Tracker_Test.cpp"
 "test/Pod_Chunk_Test.cpp"
 "test/QIFU_Test.cpp"
 "test/Resources_Test.cpp"
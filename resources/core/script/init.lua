@@ -51,7 +51,8 @@ pegr.add_component('circle.c', {
 print('added circle.c')
 
 pegr.add_component('dog:edible.c', {
-  food_value = {'f32', 0},
+  -- Same for every entity of an archetype, so store it only once
+  food_value = {'f32', 0, 'shared'},
   on_eaten = {'func', function(self) end},
 })
 print('added edible.c')
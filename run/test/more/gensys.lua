@@ -1,6 +1,4 @@
-return function(sample_size)
-
-sample_size = sample_size or 100000
+return function()
 
 pegr.add_component('position.c', {
   x = {'f64', 315},
@@ -21,32 +19,26 @@ local arche = pegr.find_archetype('simplex.at')
 
 local ent = pegr.new_entity(arche)
 
--------------------------------------------------------------------------------
+local results = {}
 
-print('sample size: ', sample_size)
+-------------------------------------------------------------------------------
 
-do
-  ent.position.x = 0
-  pegr.debug_collect_garbage()
-  pegr.debug_timer_start()
-  for i=1,sample_size,1 do
+ent.position.x = 0
+results[#results + 1] = pegr.bench('Simple member increment', function(n)
+  for i=1,n,1 do
     ent.position.x = ent.position.x + 1
   end
-  pegr.debug_timer_end('Simple member increment', sample_size, 'ns')
-end
+end)
 
 -------------------------------------------------------------------------------
 
-do
-  local cached = ent.position
-  cached.x = 0
-  pegr.debug_collect_garbage()
-  pegr.debug_timer_start()
-  for i=1,sample_size,1 do
+local cached = ent.position
+cached.x = 0
+results[#results + 1] = pegr.bench('Cached member increment', function(n)
+  for i=1,n,1 do
     cached.x = cached.x + 1
   end
-  pegr.debug_timer_end('Cached member increment', sample_size, 'ns')
-end
+end)
 
 -------------------------------------------------------------------------------
 
@@ -58,12 +50,12 @@ do
     __newindex = function(t, k, v) x = v end
   })
   fake_ent.x = 0
-  pegr.debug_collect_garbage()
-  pegr.debug_timer_start()
-  for i=1,sample_size,1 do
-    fake_ent.x = fake_ent.x + 1
-  end
-  pegr.debug_timer_end('Lua metatable-powered increment', sample_size, 'ns')
+  results[#results + 1] = pegr.bench('Lua metatable-powered increment', 
+    function(n)
+      for i=1,n,1 do
+        fake_ent.x = fake_ent.x + 1
+      end
+    end)
 end
 
 -------------------------------------------------------------------------------
@@ -71,26 +63,30 @@ end
 do
   local fake_ent = {}
   fake_ent.x = 0
-  pegr.debug_collect_garbage()
-  pegr.debug_timer_start()
-  for i=1,sample_size,1 do
-    fake_ent.x = fake_ent.x + 1
-  end
-  pegr.debug_timer_end('Lua table member increment', sample_size, 'ns')
+  results[#results + 1] = pegr.bench('Lua table member increment', 
+    function(n)
+      for i=1,n,1 do
+        fake_ent.x = fake_ent.x + 1
+      end
+    end)
 end
 
 -------------------------------------------------------------------------------
 
 do
   local x = 0
-  pegr.debug_collect_garbage()
-  pegr.debug_timer_start()
-  for i=1,sample_size,1 do
-    x = x + 1
-  end
-  pegr.debug_timer_end('Lua table member increment', sample_size, 'ns')
+  results[#results + 1] = pegr.bench('Lua local increment', function(n)
+    for i=1,n,1 do
+      x = x + 1
+    end
+  end)
 end
 
 -------------------------------------------------------------------------------
 
-end
\ No newline at end of file
+print('name', 'median ns', 'p99 ns', 'bytes')
+for _, result in ipairs(results) do
+  print(result.name, result.median, result.p99, result.allocated)
+end
+
+end
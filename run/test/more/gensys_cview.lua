@@ -1,6 +1,4 @@
-return function(sample_size)
-
-sample_size = sample_size or 100000
+return function()
 
 pegr.add_component('position.c', {
   x = {'f64', 315},
@@ -23,17 +21,13 @@ local ent = pegr.new_entity(arche)
 
 -------------------------------------------------------------------------------
 
-print('sample size: ', sample_size)
-
-do
-  ent.position.x = 0
-  pegr.debug_collect_garbage()
-  pegr.debug_timer_start()
-  for i=1,sample_size,1 do
+ent.position.x = 0
+local result = pegr.bench('Accessing cview', function(n)
+  for i=1,n,1 do
     local x = ent.position
   end
-  pegr.debug_timer_end('Accessing cview', sample_size, 'ns')
-end
+end)
+print(result.name, result.median, result.p99, result.allocated)
 
 -------------------------------------------------------------------------------
 
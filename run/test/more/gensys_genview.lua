@@ -1,6 +1,5 @@
-return function(sample_size)
+return function()
 
-sample_size = sample_size or 100000
 pegr.add_component('position.cp', {
   x = {'f64', 17},
   y = {'f64', 19},
@@ -58,30 +57,32 @@ local ent = pegr.new_entity(arche)
 
 -------------------------------------------------------------------------------
 
-print('sample size: ', sample_size)
+local results = {}
 
 do
   local gview = genre(ent)
   assert(gview)
   gview.pos_x = 0
-  pegr.debug_collect_garbage()
-  pegr.debug_timer_start()
-  for i=1,sample_size,1 do
-    gview.pos_x = gview.pos_x + 1
-  end
-  pegr.debug_timer_end('Increment member, gview', sample_size, 'ns')
+  results[#results + 1] = pegr.bench('Increment member, gview', function(n)
+    for i=1,n,1 do
+      gview.pos_x = gview.pos_x + 1
+    end
+  end)
 end
 
 do
   local cview = comp(ent)
   assert(cview)
   cview.x = 0
-  pegr.debug_collect_garbage()
-  pegr.debug_timer_start()
-  for i=1,sample_size,1 do
-    cview.x = cview.x + 1
-  end
-  pegr.debug_timer_end('Increment member, cview', sample_size, 'ns')
+  results[#results + 1] = pegr.bench('Increment member, cview', function(n)
+    for i=1,n,1 do
+      cview.x = cview.x + 1
+    end
+  end)
+end
+
+for _, result in ipairs(results) do
+  print(result.name, result.median, result.p99, result.allocated)
 end
 
 -------------------------------------------------------------------------------
@@ -0,0 +1,47 @@
+return function(num_members, num_comps)
+
+num_members = tonumber(num_members) or 1000
+num_comps = tonumber(num_comps) or 10
+
+-------------------------------------------------------------------------------
+
+-- Mixed sizes, so that packing has to fill around larger members
+local types = {'i32', 'f64', 'f32', 'i64', 'entity'}
+for c=1,num_comps,1 do
+  local members = {}
+  for m=1,num_members,1 do
+    local ty = types[(m + c) % #types + 1]
+    if ty == 'entity' then
+      members['m' .. m] = {ty, nil}
+    else
+      members['m' .. m] = {ty, m}
+    end
+  end
+  pegr.add_component('wide' .. c .. '.c', members)
+end
+
+local implements = {}
+for c=1,num_comps,1 do
+  implements['wide' .. c] = {
+    __is = 'wide' .. c .. '.c',
+  }
+end
+pegr.add_archetype('wide.at', implements)
+
+print('members per component: ', num_members)
+print('components: ', num_comps)
+
+-------------------------------------------------------------------------------
+
+-- Definitions are consumed by compiling, so this can only run once
+local result = pegr.bench('Compile wide components', function(n)
+  pegr.debug_stage_compile()
+end, {warmup = 0, samples = 1, iterations = 1})
+print(result.name, result.median / 1e6, 'ms', result.allocated, 'bytes')
+
+-------------------------------------------------------------------------------
+
+local ent = pegr.new_entity(pegr.find_archetype('wide.at'))
+assert(ent.wide1.m2 == 2)
+
+end
@@ -0,0 +1,31 @@
+--@Name Lua micro-benchmarks
+print('calibrates and reports statistics')
+local calls = 0
+local result = pegr.bench('table insert', function(n)
+  calls = calls + 1
+  local t = {}
+  for i = 1, n do
+    t[i] = {}
+  end
+end, {warmup = 2, samples = 5, min_time = 0.0001})
+assert(result.name == 'table insert')
+assert(result.samples == 5)
+assert(result.iterations >= 1)
+assert(result.min <= result.median)
+assert(result.median <= result.p99)
+assert(result.p99 <= result.max)
+
+print('measures memory allocated per iteration')
+assert(result.allocated > 0)
+
+print('fixed iterations skip calibration')
+calls = 0
+result = pegr.bench('fixed', function(n)
+  calls = calls + n
+end, {warmup = 1, samples = 3, iterations = 10})
+assert(result.iterations == 10)
+assert(calls == 40)
+
+print('errors are passed on')
+assert(not pcall(pegr.bench, 'error', function(n) error('oops') end))
+assert(not pcall(pegr.bench, 'bad', 'not a function'))
@@ -0,0 +1,79 @@
+--@Name Gensys compiled definitions cache
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+  name = {'str', 'nobody'},
+  species = {'str', 'human', 'shared'},
+  heal = {'func', function(hp) return hp + math.floor(hp / 2) end},
+})
+
+pegr.add_component('position.c', {
+  x = {'f64', 0},
+})
+
+pegr.add_archetype('person.at', {
+  stats = {
+    __is = 'stats.c',
+    name = {'str', 'alice'},
+  },
+  pos = {
+    __is = 'position.c',
+    x = {'f64', 3.5},
+  },
+})
+
+pegr.add_genre('living.gn', {
+  interface = {
+    health = {'i32', nil},
+  },
+  patterns = {
+    {
+      matching = {
+        stats = 'stats.c',
+      },
+      aliases = {
+        health = 'stats.hp',
+      },
+    },
+  },
+})
+
+pegr.debug_stage_compile()
+
+print('save')
+pegr.debug_save_compiled(1234)
+
+print('a different key is a miss')
+assert(not pegr.debug_load_compiled(4321, _G))
+
+print('load')
+assert(pegr.debug_load_compiled(1234, _G))
+local person_at = pegr.find_archetype('person.at')
+local stats_c = pegr.find_component('stats.c')
+local living_gn = pegr.find_genre('living.gn')
+local ent = pegr.new_entity(person_at)
+pegr.spawn_entity(ent)
+assert(ent.stats.hp == 10)
+assert(ent.stats.name == 'alice')
+assert(ent.stats.species == 'human')
+assert(ent.pos.x == 3.5)
+assert(stats_c(ent).name == 'alice')
+assert(living_gn(ent).health == 10)
+
+print('cached functions still work')
+assert(ent.stats.heal(10) == 15)
+living_gn(ent).health = 4
+assert(ent.stats.hp == 4)
+
+print('functions with upvalues cannot be cached')
+pegr.debug_load_compiled(4321, _G)
+local bonus = 5
+pegr.add_component('bonus.c', {
+  heal = {'func', function(hp) return hp + bonus end},
+})
+pegr.add_archetype('bonus.at', {
+  bonus = {
+    __is = 'bonus.c',
+  },
+})
+pegr.debug_stage_compile()
+assert(not pcall(pegr.debug_save_compiled, 1234))
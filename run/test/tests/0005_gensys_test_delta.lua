@@ -0,0 +1,84 @@
+--@Name Gensys delta snapshots
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+  speed = {'f64', 1.5},
+  name = {'str', 'nobody'},
+  friend = {'entity', nil},
+})
+
+pegr.add_archetype('person.at', {
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.debug_stage_compile()
+
+local person_at = pegr.find_archetype('person.at')
+
+local alice = pegr.new_entity(person_at)
+local bob = pegr.new_entity(person_at)
+local carol = pegr.new_entity(person_at)
+pegr.spawn_entity(alice)
+pegr.spawn_entity(bob)
+pegr.spawn_entity(carol)
+alice.stats.name = 'alice'
+carol.stats.friend = bob
+
+pegr.debug_delta_tracking(true)
+
+print('unchanged state gives an empty delta')
+local _, empty_size = pegr.debug_take_delta()
+
+print('modify, create and delete')
+alice.stats.hp = 7
+alice.stats.name = 'changed'
+bob.stats.speed = 3.25
+bob.stats.speed = 1.5 -- Written, but not changed
+local dave = pegr.new_entity(person_at)
+pegr.spawn_entity(dave)
+dave.stats.hp = 42
+dave.stats.friend = alice
+pegr.kill_entity(carol)
+assert(not carol.__exists)
+
+local delta, delta_size = pegr.debug_take_delta()
+assert(delta_size > empty_size)
+
+print('undo')
+pegr.debug_apply_delta(delta, true)
+assert(alice.stats.hp == 10)
+assert(alice.stats.name == 'alice')
+assert(bob.stats.speed == 1.5)
+assert(not dave.__exists)
+assert(carol.__exists)
+assert(carol.__alive)
+assert(carol.stats.friend.__id == bob.__id)
+
+print('redo')
+pegr.debug_apply_delta(delta, false)
+assert(alice.stats.hp == 7)
+assert(alice.stats.name == 'changed')
+assert(dave.__exists)
+assert(dave.stats.hp == 42)
+assert(dave.stats.friend.__id == alice.__id)
+assert(not carol.__exists)
+
+print('applying twice is an error')
+assert(not pcall(pegr.debug_apply_delta, delta, false))
+assert(alice.stats.hp == 7)
+
+print('applying a delta is itself recorded')
+pegr.debug_take_delta()
+pegr.debug_apply_delta(delta, true)
+local undo = pegr.debug_take_delta()
+pegr.debug_apply_delta(undo, true)
+assert(alice.stats.hp == 7)
+assert(dave.__exists)
+assert(not carol.__exists)
+
+print('new entities do not reuse handles')
+local newcomer = pegr.new_entity(person_at)
+assert(newcomer.__id > dave.__id)
+
+pegr.debug_delta_tracking(false)
@@ -0,0 +1,83 @@
+--@Name Gensys entity references
+pegr.add_component('targeting.c', {
+  target = {'entity', nil},
+  range = {'f64', 5},
+})
+
+pegr.add_component('health.c', {
+  hp = {'i32', 10},
+})
+
+pegr.add_archetype('archer.at', {
+  aim = {
+    __is = 'targeting.c',
+  },
+  life = {
+    __is = 'health.c',
+  },
+})
+
+pegr.add_archetype('dummy.at', {
+  life = {
+    __is = 'health.c',
+  },
+})
+
+pegr.debug_stage_compile()
+
+local archer_at = pegr.find_archetype('archer.at')
+local dummy_at = pegr.find_archetype('dummy.at')
+
+local archer = pegr.new_entity(archer_at)
+local dummy_a = pegr.new_entity(dummy_at)
+local dummy_b = pegr.new_entity(dummy_at)
+pegr.spawn_entity(dummy_a)
+pegr.spawn_entity(dummy_b)
+
+print('references are null by default')
+assert(archer.aim.target == nil)
+assert(archer.aim.range == 5)
+
+print('references resolve to entities')
+archer.aim.target = dummy_a
+assert(archer.aim.target.__id == dummy_a.__id)
+assert(archer.aim.target.life.hp == 10)
+archer.aim.target.life.hp = 7
+assert(dummy_a.life.hp == 7)
+assert(archer.aim.range == 5)
+
+print('references can be cleared')
+archer.aim.target = nil
+assert(archer.aim.target == nil)
+
+print('only entities can be referenced')
+assert(not pcall(function() archer.aim.target = 5 end))
+assert(not pcall(function() archer.aim.target = archer.aim end))
+
+print('lua-owned entities cannot be referenced')
+local unspawned = pegr.new_entity(dummy_at)
+assert(not pcall(function() archer.aim.target = unspawned end))
+
+print('references to deleted entities resolve to nil')
+archer.aim.target = dummy_a
+pegr.kill_entity(dummy_a)
+assert(archer.aim.target == nil)
+
+print('back-reference index')
+assert(pegr.debug_entity_backrefs(true) == 0)
+archer.aim.target = dummy_b
+assert(pegr.debug_entity_backrefs() == 1)
+archer.aim.target = dummy_b
+assert(pegr.debug_entity_backrefs() == 1)
+pegr.kill_entity(dummy_b)
+assert(pegr.debug_entity_backrefs() == 0)
+assert(archer.aim.target == nil)
+
+print('deleting the referrer drops its back-references')
+local dummy_c = pegr.new_entity(dummy_at)
+pegr.spawn_entity(dummy_c)
+archer.aim.target = dummy_c
+assert(pegr.debug_entity_backrefs() == 1)
+pegr.delete_entity(archer)
+assert(pegr.debug_entity_backrefs() == 0)
+pegr.debug_entity_backrefs(false)
@@ -0,0 +1,108 @@
+--@Name Gensys world forks
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+  name = {'str', 'nobody'},
+  friend = {'entity', nil},
+  kind = {'str', 'person', 'shared'},
+})
+
+pegr.add_archetype('person.at', {
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.debug_stage_compile()
+
+local person_at = pegr.find_archetype('person.at')
+
+local alice = pegr.new_entity(person_at)
+local bob = pegr.new_entity(person_at)
+pegr.spawn_entity(alice)
+pegr.spawn_entity(bob)
+alice.stats.name = 'alice'
+alice.stats.friend = bob
+local carol = pegr.new_entity(person_at)
+pegr.spawn_entity(carol)
+local scratch = pegr.new_entity(person_at)
+
+print('a fork copies entities only as they are used')
+local fork = pegr.debug_world_fork(0)
+assert(pegr.debug_world_stored(fork) == 0)
+local fork_alice = pegr.debug_world_translate(alice, fork)
+local fork_bob = pegr.debug_world_translate(bob, fork)
+local fork_carol = pegr.debug_world_translate(carol, fork)
+assert(fork_alice.__id ~= alice.__id)
+assert(fork_alice.__exists)
+assert(pegr.debug_world_stored(fork) == 1)
+assert(fork_alice.__alive)
+assert(fork_alice.stats.hp == 10)
+assert(fork_alice.stats.name == 'alice')
+
+print('Lua-owned entities are not copied')
+assert(not pegr.debug_world_translate(scratch, fork).__exists)
+assert(pegr.debug_world_stored(fork) == 1)
+
+print('references point to the copies')
+assert(fork_alice.stats.friend.__id == fork_bob.__id)
+assert(alice.stats.friend.__id == bob.__id)
+
+print('writing in the parent does not change the fork')
+bob.stats.hp = 2
+assert(fork_bob.stats.hp == 10)
+pegr.kill_entity(carol)
+assert(not carol.__exists)
+assert(fork_carol.__exists)
+assert(fork_carol.__alive)
+
+print('entities made in the parent later are not in the fork')
+local dave = pegr.new_entity(person_at)
+pegr.spawn_entity(dave)
+assert(not pegr.debug_world_translate(dave, fork).__exists)
+
+print('writing in the fork copies only that chunk')
+assert(pegr.debug_world_shared(fork) == 1)
+assert(pegr.debug_world_shared(0) == 1)
+assert(pegr.debug_world_stored(fork) == 3)
+fork_alice.stats.hp = 1
+assert(fork_alice.stats.hp == 1)
+assert(alice.stats.hp == 10)
+assert(pegr.debug_world_shared(fork) == 0)
+assert(pegr.debug_world_shared(0) == 0)
+
+print('shared members cannot be written through the fork')
+assert(not pcall(function() fork_alice.stats.kind = 'ghost' end))
+assert(fork_alice.stats.kind == 'person')
+assert(alice.stats.kind == 'person')
+
+print('creating and deleting in the fork')
+pegr.debug_world_enter(fork)
+local newcomer = pegr.new_entity(person_at)
+pegr.spawn_entity(newcomer)
+assert(newcomer.__id > fork_bob.__id)
+pegr.debug_world_enter(0)
+pegr.kill_entity(fork_bob)
+assert(not fork_bob.__exists)
+assert(fork_alice.stats.friend == nil)
+assert(bob.__exists)
+assert(alice.stats.friend.__id == bob.__id)
+
+print('discarding the fork')
+pegr.debug_world_delete(fork)
+assert(not fork_alice.__exists)
+assert(not newcomer.__exists)
+assert(alice.stats.hp == 10)
+assert(bob.stats.hp == 2)
+assert(alice.stats.name == 'alice')
+
+print('members read before the first write after forking see the write')
+fork = pegr.debug_world_fork(0)
+fork_alice = pegr.debug_world_translate(alice, fork)
+fork_bob = pegr.debug_world_translate(bob, fork)
+assert(fork_alice.__exists and fork_bob.__exists)
+assert(pegr.debug_world_shared(0) == 2)
+assert(pegr.debug_cview_read_across_write(alice.stats, 'hp', 8) == 8)
+assert(fork_alice.stats.hp == 10)
+assert(pegr.debug_cview_read_across_write(fork_bob.stats, 'hp', 7) == 7)
+assert(bob.stats.hp == 2)
+pegr.debug_world_delete(fork)
@@ -0,0 +1,94 @@
+--@Name Gensys LuaJIT trace diagnostics
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+})
+
+pegr.add_archetype('person.at', {
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.debug_stage_compile()
+
+local person = pegr.new_entity(pegr.find_archetype('person.at'))
+
+if not pegr.debug_jit_diag(true) then
+  print('no JIT to inspect')
+  return
+end
+
+print('aborted loops are blacklisted')
+local function make_closures()
+  local t = {}
+  for i = 1, 1000 do
+    t[1] = function() return i end
+  end
+end
+for i = 1, 100 do
+  make_closures()
+end
+
+print('reading components does not abort')
+local function read_cview()
+  local total = 0
+  for i = 1, 1000 do
+    total = total + person.stats.hp
+  end
+  return total
+end
+for i = 1, 100 do
+  read_cview()
+end
+
+print('C functions that cannot be compiled are stitched around')
+local function call_c()
+  local total = 0
+  for i = 1, 1000 do
+    total = total + os.time()
+  end
+  return total
+end
+for i = 1, 100 do
+  call_c()
+end
+
+pegr.debug_jit_diag(false)
+local summary = pegr.debug_jit_diag_summary()
+assert(summary.started > 0)
+assert(summary.completed > 0)
+assert(summary.aborted > 0)
+
+local function is_line(loc, line)
+  return string.sub(loc, -string.len(line) - 1) == ':' .. line
+end
+
+local closure_aborts = 0
+for _, site in ipairs(summary.aborts) do
+  assert(site.count > 0)
+  if is_line(site.at, '25') then
+    assert(string.find(site.reason, 'NYI', 1, true))
+    closure_aborts = closure_aborts + site.count
+  end
+  assert(not is_line(site.start, '35'))
+end
+assert(closure_aborts > 0)
+
+local blacklisted = false
+for _, loc in ipairs(summary.blacklisted) do
+  blacklisted = blacklisted or is_line(loc, '24')
+end
+assert(blacklisted)
+
+-- Only LuaJIT 2.1 stitches
+if jit.version_num >= 20100 then
+  local stitched = false
+  for loc, count in pairs(summary.stitches) do
+    stitched = stitched or (is_line(loc, '48') and count > 0)
+  end
+  assert(stitched)
+end
+
+print('disabled diagnostics collect nothing')
+call_c()
+assert(pegr.debug_jit_diag_summary().started == summary.started)
@@ -0,0 +1,62 @@
+--@Name Gensys Lua sampling profiler
+local function spin(n)
+  local x = 0
+  for i = 1, n do
+    x = x + i % 7
+  end
+  return x
+end
+
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+  think = {'func', function(n) return spin(n) + 0 end},
+})
+
+pegr.add_archetype('person.at', {
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.add_archetype('boss.at', {
+  stats = {
+    __is = 'stats.c',
+    think = {'func', function(n) return spin(n) + 1 end},
+  },
+})
+
+pegr.debug_stage_compile()
+
+local person = pegr.new_entity(pegr.find_archetype('person.at'))
+local boss = pegr.new_entity(pegr.find_archetype('boss.at'))
+
+local function profile(ent)
+  pegr.debug_lua_profile_start(0.001)
+  local stop_at = os.clock() + 0.1
+  repeat
+    ent.stats.think(10000)
+  until os.clock() > stop_at
+  return pegr.debug_lua_profile_stop()
+end
+
+local function count_matching(stacks, pattern)
+  local count = 0
+  for stack, num in pairs(stacks) do
+    if string.find(stack, pattern, 1, true) then
+      count = count + num
+    end
+  end
+  return count
+end
+
+print('samples are attributed to component members')
+local stacks, samples = profile(person)
+assert(samples > 0)
+assert(count_matching(stacks, 'stats.c.think') > 0)
+assert(count_matching(stacks, 'boss.at/') == 0)
+
+print('archetype overrides are named after the archetype')
+stacks, samples = profile(boss)
+assert(samples > 0)
+assert(count_matching(stacks, 'boss.at/:stats.c.think') > 0)
+
@@ -0,0 +1,81 @@
+--@Name Gensys memory accounting
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+  mass = {'f64', 1},
+  name = {'str', 'nobody'},
+})
+
+pegr.add_archetype('person.at', {
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.add_archetype('rock.at', {})
+
+pegr.debug_stage_compile()
+
+local person_at = pegr.find_archetype('person.at')
+local stats_c = pegr.find_component('stats.c')
+
+local function find_arche(memory, name)
+  for key, arche in pairs(memory.archetypes) do
+    if key:sub(-#name) == name then
+      return arche
+    end
+  end
+end
+
+local people = {}
+for i = 1, 3 do
+  people[i] = pegr.new_entity(person_at)
+  pegr.spawn_entity(people[i])
+end
+
+print('every archetype is listed')
+local memory = pegr.debug_memory()
+local person = find_arche(memory, 'person.at')
+local rock = find_arche(memory, 'rock.at')
+assert(person.entities == 3)
+assert(rock.entities == 0)
+assert(rock.total_bytes == 0)
+
+print('pod chunks include padding')
+assert(person.pod_bytes > 0)
+assert(person.pod_bytes % 8 == 0)
+assert(person.padding_bytes % 3 == 0)
+assert(person.padding_bytes < person.pod_bytes)
+assert(memory.entities == 3)
+assert(memory.pod_bytes == person.pod_bytes)
+
+print('only overridden strings are counted')
+assert(person.strings == 0)
+people[1].stats.name = 'short'
+local long = ''
+for i = 1, 100 do
+  long = long .. 'long'
+end
+people[2].stats.name = long
+memory = pegr.debug_memory()
+person = find_arche(memory, 'person.at')
+assert(person.strings == 2)
+assert(person.string_inline_bytes == 5)
+assert(person.string_heap_bytes > 400)
+assert(memory.interned_heap_bytes > 800)
+
+print('Lua tables and cached cviews')
+assert(person.tables == 0)
+assert(person.weak_tables == 2)
+assert(person.cached_cviews == 2)
+local stats = people[3].stats
+local also_stats = stats_c(people[1])
+memory = pegr.debug_memory()
+person = find_arche(memory, 'person.at')
+assert(person.weak_tables == 3)
+assert(person.weak_table_entries == 4)
+assert(person.cached_cviews == 4)
+assert(person.table_bytes > 0)
+assert(memory.cview_userdata >= 4)
+assert(memory.lua_bytes > 0)
+assert(memory.total_bytes == memory.pod_bytes + memory.string_heap_bytes
+    + memory.table_bytes)
@@ -0,0 +1,127 @@
+--@Name Gensys incremental recompilation
+local function define(opts)
+  local stats = {
+    hp = {'i32', opts.hp},
+    name = {'str', 'nobody'},
+    friend = {'entity', nil},
+  }
+  if opts.mana then
+    stats.mana = {'f64', 7}
+  end
+  pegr.add_component('stats.c', stats)
+  pegr.add_component('position.c', {
+    x = {'f64', 0},
+    y = {'f64', 0},
+  })
+  pegr.add_archetype('person.at', {
+    stats = {
+      __is = 'stats.c',
+    },
+    pos = {
+      __is = 'position.c',
+    },
+  })
+  if opts.rock then
+    pegr.add_archetype('rock.at', {
+      pos = {
+        __is = 'position.c',
+        x = {'f64', 1},
+      },
+    })
+  end
+  pegr.add_genre('placed.gn', {
+    interface = {
+      x = {'f64', nil},
+    },
+    patterns = {
+      {
+        matching = {
+          pos = 'position.c',
+        },
+        aliases = {
+          x = 'pos.x',
+        },
+      },
+    },
+  })
+  pegr.debug_stage_compile()
+end
+
+define({hp = 10, rock = true})
+local rebuilt, kept, removed, migrated = pegr.debug_compile_stats()
+assert(rebuilt == 5 and kept == 0 and removed == 0 and migrated == 0)
+
+local person_at = pegr.find_archetype('person.at')
+local rock_at = pegr.find_archetype('rock.at')
+local placed_gn = pegr.find_genre('placed.gn')
+local alice = pegr.new_entity(person_at)
+local bob = pegr.new_entity(person_at)
+local rock = pegr.new_entity(rock_at)
+pegr.spawn_entity(alice)
+pegr.spawn_entity(bob)
+pegr.spawn_entity(rock)
+alice.stats.hp = 3
+alice.stats.name = 'alice'
+alice.stats.friend = bob
+alice.pos.x = 5
+rock.pos.y = 2
+
+print('compiling the same definitions changes nothing')
+pegr.debug_reopen()
+define({hp = 10, rock = true})
+rebuilt, kept, removed, migrated = pegr.debug_compile_stats()
+assert(rebuilt == 0 and kept == 5 and removed == 0 and migrated == 0)
+assert(alice.stats.hp == 3)
+
+print('changing a component migrates only its archetypes')
+pegr.debug_reopen()
+define({hp = 20, mana = true, rock = true})
+rebuilt, kept, removed, migrated = pegr.debug_compile_stats()
+assert(rebuilt == 2 and kept == 3 and removed == 0 and migrated == 2)
+assert(pegr.find_archetype('person.at') == person_at)
+
+print('migrated entities keep their handles and values')
+assert(alice.__exists)
+assert(alice.__alive)
+assert(alice.stats.hp == 3)
+assert(alice.stats.name == 'alice')
+assert(alice.stats.friend.__id == bob.__id)
+assert(alice.pos.x == 5)
+assert(placed_gn(alice).x == 5)
+assert(bob.stats.hp == 10)
+assert(bob.stats.name == 'nobody')
+
+print('new members get their defaults')
+assert(alice.stats.mana == 7)
+assert(pegr.new_entity(person_at).stats.hp == 20)
+
+print('unchanged archetypes are untouched')
+assert(rock.pos.x == 1)
+assert(rock.pos.y == 2)
+
+print('removing an archetype erases its entities')
+pegr.debug_reopen()
+define({hp = 20, mana = true, rock = false})
+rebuilt, kept, removed, migrated = pegr.debug_compile_stats()
+assert(rebuilt == 0 and kept == 4 and removed == 1 and migrated == 0)
+assert(not rock.__exists)
+assert(alice.__exists)
+assert(alice.stats.mana == 7)
+
+print('views from before recompiling are stale')
+local old_stats = alice.stats
+local old_placed = placed_gn(alice)
+assert(old_stats.hp == 3)
+assert(old_placed.x == 5)
+pegr.debug_reopen()
+define({hp = 30, mana = true, rock = false})
+rebuilt, kept, removed, migrated = pegr.debug_compile_stats()
+assert(rebuilt == 2 and removed == 0)
+assert(old_stats.hp == nil)
+assert(old_placed.x == nil)
+assert(not pcall(function() old_stats.hp = 1 end))
+assert(not pcall(function() old_placed.x = 1 end))
+assert(alice.stats.hp == 3)
+assert(placed_gn(alice).x == 5)
+alice.stats.hp = 4
+assert(alice.stats.hp == 4)
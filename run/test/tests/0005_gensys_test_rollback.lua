@@ -0,0 +1,92 @@
+--@Name Gensys rollback buffer
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+  name = {'str', 'nobody'},
+})
+
+pegr.add_archetype('player.at', {
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.add_archetype('tree.at', {
+  stats = {
+    __is = 'stats.c',
+    hp = {'i32', 500},
+  },
+})
+
+pegr.debug_stage_compile()
+
+local player_at = pegr.find_archetype('player.at')
+local tree_at = pegr.find_archetype('tree.at')
+
+local player = pegr.new_entity(player_at)
+local tree = pegr.new_entity(tree_at)
+pegr.spawn_entity(player)
+pegr.spawn_entity(tree)
+
+pegr.debug_rollback_begin(4)
+
+print('first save copies everything')
+assert(pegr.debug_rollback_save(1) == 2)
+
+print('unchanged archetypes are shared')
+player.stats.hp = 9
+player.stats.name = 'moved'
+assert(pegr.debug_rollback_save(2) == 3)
+
+local function simulate(tick)
+  player.stats.hp = player.stats.hp - 1
+  if tick == 3 then
+    local bullet = pegr.new_entity(player_at)
+    bullet.stats.name = 'bullet'
+    pegr.spawn_entity(bullet)
+  end
+  if tick == 4 then
+    pegr.kill_entity(tree)
+  end
+end
+
+simulate(3)
+pegr.debug_rollback_save(3)
+simulate(4)
+pegr.debug_rollback_save(4)
+assert(not tree.__exists)
+local spawns, spawns_once = pegr.debug_spawn_counts()
+assert(spawns == 1 and spawns_once == 1)
+
+print('restore')
+pegr.debug_rollback_restore(2)
+assert(player.stats.hp == 9)
+assert(player.stats.name == 'moved')
+assert(tree.__exists)
+assert(tree.__alive)
+assert(tree.stats.hp == 500)
+
+print('restore an older tick')
+pegr.debug_rollback_restore(1)
+assert(player.stats.hp == 10)
+assert(player.stats.name == 'nobody')
+
+print('replay skips listeners that are not replayable')
+pegr.debug_rollback_replay(2, 4, simulate)
+assert(player.stats.hp == 7)
+assert(not tree.__exists)
+spawns, spawns_once = pegr.debug_spawn_counts()
+assert(spawns == 2 and spawns_once == 1)
+
+print('replayed ticks can be restored')
+pegr.debug_rollback_restore(3)
+assert(player.stats.hp == 8)
+assert(tree.__exists)
+
+print('old ticks are evicted')
+pegr.debug_rollback_save(4)
+pegr.debug_rollback_save(5)
+assert(not pcall(pegr.debug_rollback_restore, 1))
+pegr.debug_rollback_restore(2)
+assert(player.stats.hp == 9)
+
+pegr.debug_rollback_end()
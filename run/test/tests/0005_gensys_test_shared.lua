@@ -0,0 +1,46 @@
+--@Name Gensys shared members
+pegr.add_component('edible.c', {
+  food_value = {'f64', 10, 'shared'},
+  kind = {'str', 'snack', 'shared'},
+  bites_left = {'i32', 3},
+})
+
+pegr.add_archetype('cookie.at', {
+  edible = {
+    __is = 'edible.c',
+    food_value = {'f64', 15},
+    kind = {'str', 'dessert'},
+  },
+})
+
+pegr.add_archetype('bread.at', {
+  edible = {
+    __is = 'edible.c',
+  },
+})
+
+pegr.debug_stage_compile()
+
+local cookie_at = pegr.find_archetype('cookie.at')
+local cookie_a = pegr.new_entity(cookie_at)
+local cookie_b = pegr.new_entity(cookie_at)
+local bread = pegr.new_entity(pegr.find_archetype('bread.at'))
+
+print('shared default check')
+assert(cookie_a.edible.food_value == 15)
+assert(cookie_a.edible.kind == 'dessert')
+assert(bread.edible.food_value == 10)
+assert(bread.edible.kind == 'snack')
+
+print('instance members are still per-entity')
+cookie_a.edible.bites_left = 1
+assert(cookie_a.edible.bites_left == 1)
+assert(cookie_b.edible.bites_left == 3)
+
+print('shared members are read-only')
+assert(not pcall(function() cookie_b.edible.food_value = 20 end))
+assert(not pcall(function() cookie_b.edible.kind = 'treat' end))
+assert(cookie_a.edible.food_value == 15)
+assert(cookie_a.edible.kind == 'dessert')
+assert(bread.edible.food_value == 10)
+assert(bread.edible.kind == 'snack')
@@ -0,0 +1,109 @@
+--@Name Gensys snapshot save and load
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+  speed = {'f64', 1.5},
+  name = {'str', 'nobody'},
+  title = {'str', 'none'},
+  friend = {'entity', nil},
+  kind = {'str', 'person', 'shared'},
+})
+
+pegr.add_archetype('person.at', {
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.add_archetype('boss.at', {
+  stats = {
+    __is = 'stats.c',
+    hp = {'i32', 100},
+  },
+})
+
+pegr.debug_stage_compile()
+
+local person_at = pegr.find_archetype('person.at')
+local boss_at = pegr.find_archetype('boss.at')
+
+local alice = pegr.new_entity(person_at)
+local bob = pegr.new_entity(person_at)
+local boss = pegr.new_entity(boss_at)
+pegr.spawn_entity(alice)
+pegr.spawn_entity(bob)
+pegr.spawn_entity(boss)
+
+alice.stats.hp = 7
+alice.stats.name = 'alice'
+bob.stats.speed = 3.25
+bob.stats.friend = alice
+boss.stats.title = 'the terrible'
+
+local unspawned = pegr.new_entity(person_at)
+
+pegr.debug_save_snapshot()
+
+print('modify everything after saving')
+alice.stats.hp = 1
+alice.stats.name = 'changed'
+bob.stats.friend = nil
+bob.stats.speed = 0
+boss.stats.title = 'none'
+pegr.kill_entity(boss)
+assert(not boss.__exists)
+
+pegr.debug_load_snapshot()
+
+print('handles are valid again')
+assert(alice.__exists)
+assert(bob.__exists)
+assert(boss.__exists)
+assert(boss.__alive)
+
+print('pod data restored')
+assert(alice.stats.hp == 7)
+assert(bob.stats.hp == 10)
+assert(bob.stats.speed == 3.25)
+assert(boss.stats.hp == 100)
+
+print('strings restored')
+assert(alice.stats.name == 'alice')
+assert(bob.stats.name == 'nobody')
+assert(boss.stats.title == 'the terrible')
+assert(alice.stats.kind == 'person')
+
+print('entity references restored')
+assert(bob.stats.friend.__id == alice.__id)
+
+print('lua-owned entities are not saved')
+assert(not unspawned.__exists)
+
+print('new entities do not reuse handles')
+local newcomer = pegr.new_entity(person_at)
+assert(newcomer.__id > unspawned.__id)
+
+print('handles issued after saving are not reused after loading')
+pegr.debug_save_snapshot()
+local late = pegr.new_entity(person_at)
+pegr.spawn_entity(late)
+pegr.debug_load_snapshot()
+assert(not late.__exists)
+local later = pegr.new_entity(person_at)
+assert(later.__id > late.__id)
+assert(not late.__exists)
+
+print('loading does not trigger kill events')
+pegr.debug_save_snapshot()
+pegr.debug_count_kills(true)
+pegr.debug_load_snapshot()
+assert(pegr.debug_count_kills(false) == 0)
+
+print('a bad snapshot leaves the world unchanged')
+pegr.debug_save_snapshot()
+alice.stats.hp = 3
+assert(not pcall(pegr.debug_load_truncated_snapshot, 1))
+assert(alice.__exists and bob.__exists and boss.__exists)
+assert(alice.stats.hp == 3)
+assert(bob.stats.friend.__id == alice.__id)
+pegr.debug_load_snapshot()
+assert(alice.stats.hp == 7)
@@ -44,3 +44,17 @@ assert(tas.flavor == 'salty')
 print('string modification check')
 tas.flavor = 'sour'
 assert(tas.flavor == 'sour')
+
+print('string copy-on-write check')
+local other = pegr.new_entity(arche)
+assert(other.taste.flavor == 'salty')
+other.taste.flavor = 'bitter'
+assert(other.taste.flavor == 'bitter')
+assert(tas.flavor == 'sour')
+
+print('string reset to default check')
+other.taste.flavor = 'salty'
+assert(other.taste.flavor == 'salty')
+other.taste.flavor = 'umami'
+assert(other.taste.flavor == 'umami')
+assert(tas.flavor == 'sour')
@@ -0,0 +1,64 @@
+--@Name Gensys tag components
+pegr.add_component('position.c', {
+  x = {'f64', 17},
+  y = {'f64', 19},
+})
+
+pegr.add_component('is_enemy.c', {})
+
+pegr.add_archetype('goblin.at', {
+  location = {
+    __is = 'position.c',
+  },
+  enemy = {
+    __is = 'is_enemy.c',
+  },
+})
+
+pegr.add_archetype('villager.at', {
+  location = {
+    __is = 'position.c',
+  },
+})
+
+pegr.add_genre('hostile.gn', {
+  interface = {
+    pos_x = {'f64', nil},
+  },
+  
+  patterns = {
+    {
+      matching = {
+        position = 'position.c',
+        enemy = 'is_enemy.c',
+      },
+      
+      aliases = {
+        pos_x = 'position.x',
+      },
+    },
+  },
+})
+
+pegr.debug_stage_compile()
+
+local tag = pegr.find_component('is_enemy.c')
+local genre = pegr.find_genre('hostile.gn')
+local goblin = pegr.new_entity(pegr.find_archetype('goblin.at'))
+local villager = pegr.new_entity(pegr.find_archetype('villager.at'))
+
+print('tag component matching')
+assert(tag(goblin), 'Tag did not match')
+assert(not tag(villager), 'Tag matched without being implemented')
+assert(goblin.enemy == tag(goblin), 'Unequal cviews!')
+
+print('tag does not disturb other members')
+assert(goblin.location.x == 17)
+goblin.location.x = 23
+assert(goblin.location.x == 23)
+
+print('tag genre matching')
+local gview = genre(goblin)
+assert(gview, 'Genre did not match')
+assert(gview.pos_x == 23)
+assert(not genre(villager), 'Genre matched without tag')
@@ -0,0 +1,62 @@
+--@Name Gensys multiple worlds
+pegr.add_component('stats.c', {
+  hp = {'i32', 10},
+  friend = {'entity', nil},
+})
+
+pegr.add_archetype('person.at', {
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.debug_stage_compile()
+
+local person_at = pegr.find_archetype('person.at')
+
+local home = pegr.new_entity(person_at)
+pegr.spawn_entity(home)
+
+print('entities are created in the current world')
+local world = pegr.debug_world_new()
+pegr.debug_world_enter(world)
+local away = pegr.new_entity(person_at)
+local away_friend = pegr.new_entity(person_at)
+pegr.spawn_entity(away)
+pegr.spawn_entity(away_friend)
+assert(away.__id ~= home.__id)
+assert(away.__id >= 2^40)
+
+print('handles work from any world')
+away.stats.friend = away_friend
+pegr.debug_world_enter(0)
+assert(away.__exists)
+assert(away.stats.friend.__id == away_friend.__id)
+away.stats.hp = 5
+assert(away.stats.hp == 5)
+assert(home.stats.hp == 10)
+
+print('references between worlds are null')
+home.stats.friend = away
+assert(home.stats.friend == nil)
+
+print('worlds can be ticked on separate threads')
+local world2 = pegr.debug_world_new()
+local spawned, remaining = pegr.debug_world_threads('person.at', 1000)
+assert(spawned == 2000)
+assert(remaining == 2 + 1000)
+
+print('deleting a world deletes its entities')
+pegr.debug_world_delete(world)
+pegr.debug_world_delete(world2)
+assert(not away.__exists)
+assert(home.__exists)
+
+print('a new world does not reuse handles')
+local world3 = pegr.debug_world_new()
+pegr.debug_world_enter(world3)
+local later = pegr.new_entity(person_at)
+assert(later.__id > away_friend.__id)
+pegr.debug_world_enter(0)
+pegr.debug_world_delete(world3)
+assert(not later.__exists)
@@ -0,0 +1,188 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include "pegr/bench/Compare.hpp"
+#include "pegr/bench/Gensys_Cases.hpp"
+#include "pegr/bench/Runner.hpp"
+#include "pegr/debug/Perf_Counters.hpp"
+#include "pegr/engine/Engine.hpp"
+#include "pegr/except/Except.hpp"
+#include "pegr/logger/Logger.hpp"
+#include "pegr/resource/Json_Util.hpp"
+
+using namespace pegr;
+
+const char* const USAGE = 
+        "Usage: pegrBench [options]\n"
+        "  --filter TEXT   Only run cases whose id contains TEXT\n"
+        "  --samples N     Samples per case (default 31)\n"
+        "  --warmup N      Discarded samples per case (default 5)\n"
+        "  --out FILE      Write results as JSON to FILE instead of stdout\n"
+        "  --label TEXT    Stored in the results, such as a commit hash\n"
+        "  --list          Print the id of every case and exit\n"
+        "  --counters      Also count cycles, cache misses, etc.\n"
+        "  --baseline FILE Compare against earlier results and exit with 2 if\n"
+        "                  any case became significantly slower\n"
+        "  --current FILE  With --baseline, compare FILE instead of running\n"
+        "  --threshold PCT Smallest slowdown that fails (default 5)\n"
+        "  --alpha P       Significance level (default 0.01)\n";
+
+const int EXIT_REGRESSED = 2;
+
+/**
+ * @return The exit status
+ */
+int compare(const std::string& baseline_file, 
+        const std::vector<Bench::Result>& current, 
+        const Bench::Compare_Settings& settings) {
+    std::vector<Bench::Result> base = Bench::results_from_json(
+            Resour::Json_Util::read(baseline_file));
+    std::vector<Bench::Comparison> comparisons = 
+            Bench::compare_results(base, current, settings);
+    Bench::print_comparisons(std::cerr, comparisons);
+    std::size_t num_regressions = Bench::count_regressions(comparisons);
+    if (num_regressions > 0) {
+        std::cerr << num_regressions << " case(s) regressed\n";
+        return EXIT_REGRESSED;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Bench::Settings settings;
+    std::string out_file;
+    std::string label;
+    std::string baseline_file;
+    std::string current_file;
+    Bench::Compare_Settings compare_settings;
+    bool list_only = false;
+    for (int idx = 1; idx < argc; ++idx) {
+        std::string arg = argv[idx];
+        bool has_value = idx + 1 < argc;
+        if (arg == "--list") {
+            list_only = true;
+        } else if (arg == "--counters") {
+            settings.m_counters = true;
+        } else if (arg == "--filter" && has_value) {
+            settings.m_filter = argv[++idx];
+        } else if (arg == "--samples" && has_value) {
+            settings.m_num_samples = std::strtoul(argv[++idx], nullptr, 10);
+        } else if (arg == "--warmup" && has_value) {
+            settings.m_num_warmup = std::strtoul(argv[++idx], nullptr, 10);
+        } else if (arg == "--out" && has_value) {
+            out_file = argv[++idx];
+        } else if (arg == "--label" && has_value) {
+            label = argv[++idx];
+        } else if (arg == "--baseline" && has_value) {
+            baseline_file = argv[++idx];
+        } else if (arg == "--current" && has_value) {
+            current_file = argv[++idx];
+        } else if (arg == "--threshold" && has_value) {
+            compare_settings.m_min_change = 
+                    std::strtod(argv[++idx], nullptr) / 100;
+        } else if (arg == "--alpha" && has_value) {
+            compare_settings.m_alpha = std::strtod(argv[++idx], nullptr);
+        } else {
+            std::cerr << USAGE;
+            return 1;
+        }
+    }
+    if (settings.m_num_samples == 0) {
+        std::cerr << "Need at least one sample\n";
+        return 1;
+    }
+    if (!current_file.empty() && baseline_file.empty()) {
+        std::cerr << "--current needs --baseline\n";
+        return 1;
+    }
+    
+    // Comparing two existing files does not need the engine at all
+    if (!current_file.empty()) {
+        try {
+            return compare(baseline_file, 
+                    Bench::results_from_json(
+                            Resour::Json_Util::read(current_file)), 
+                    compare_settings);
+        }
+        catch (Except::Runtime& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+    
+    // No window, renderer or resources; just the simulation
+    Engine::initialize(Engine::INIT_FLAG_GENSYS | Engine::INIT_FLAG_SCHEDU);
+    
+    // Compiling logs every definition, which would drown out the results
+    el::Loggers::reconfigureAllLoggers(el::Level::Info, 
+            el::ConfigurationType::Enabled, "false");
+    el::Loggers::reconfigureAllLoggers(el::Level::Debug, 
+            el::ConfigurationType::Enabled, "false");
+    
+    if (settings.m_counters && !Debug::Perf_Counters().is_available()) {
+        std::cerr << "Hardware counters are unavailable, continuing without\n";
+        settings.m_counters = false;
+    }
+    
+    std::vector<Bench::Case> cases = Bench::get_gensys_cases();
+    if (list_only) {
+        for (const Bench::Case& bench_case : cases) {
+            std::cout << bench_case.get_id() << '\n';
+        }
+        Engine::cleanup();
+        return 0;
+    }
+    
+    int status = 0;
+    try {
+        std::vector<Bench::Result> results = Bench::run_cases(cases, settings,
+                [](const Bench::Result& result) {
+                    std::cerr << result.m_id
+                              << ": median " << result.m_stats.m_median 
+                              << " ns, p99 " << result.m_stats.m_p99 
+                              << " ns";
+                    for (const auto& counter : result.m_counters) {
+                        std::cerr << ", " << counter.first << ' ' 
+                                  << counter.second;
+                    }
+                    std::cerr << '\n';
+                });
+        Json::Value json = Bench::results_to_json(results, label, settings);
+        if (out_file.empty()) {
+            Json::StyledStreamWriter writer;
+            writer.write(std::cout, json);
+        } else {
+            Resour::Json_Util::write(out_file, json);
+        }
+        if (!baseline_file.empty()) {
+            status = compare(baseline_file, results, compare_settings);
+        }
+    }
+    catch (Except::Runtime& e) {
+        std::cerr << e.what() << '\n';
+        status = 1;
+    }
+    
+    Engine::cleanup();
+    return status;
+}
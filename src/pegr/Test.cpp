@@ -15,17 +15,36 @@
  */
 
 #include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <ratio>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "pegr/bench/Lua_Interf.hpp"
 #include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/debug/Jit_Diag.hpp"
+#include "pegr/debug/Lua_Profiler.hpp"
+#include "pegr/debug/Trace.hpp"
 #include "pegr/engine/Engine.hpp"
 #include "pegr/except/Except.hpp"
+#include "pegr/gensys/Cache.hpp"
+#include "pegr/gensys/Compiler.hpp"
+#include "pegr/gensys/Events.hpp"
 #include "pegr/gensys/Gensys.hpp"
 #include "pegr/gensys/Lua_Interf.hpp"
+#include "pegr/gensys/Rollback.hpp"
+#include "pegr/gensys/Runtime.hpp"
+#include "pegr/gensys/Snapshot.hpp"
+#include "pegr/gensys/World.hpp"
 #include "pegr/logger/Logger.hpp"
 #include "pegr/scheduler/Lua_Interf.hpp"
+#include "pegr/script/Gc_Scheduler.hpp"
 #include "pegr/script/Script.hpp"
 #include "pegr/script/Script_Util.hpp"
 #include "pegr/test/Tests.hpp"
@@ -47,11 +66,451 @@ int li_debug_stage_compile(lua_State* l) {
     return 0;
 }
 
+int li_debug_reopen(lua_State* l) {
+    Gensys::reopen();
+    return 0;
+}
+
+int li_debug_compile_stats(lua_State* l) {
+    const Gensys::Compiler::Compile_Stats& stats = 
+            Gensys::Compiler::get_compile_stats();
+    lua_pushnumber(l, stats.m_num_rebuilt);
+    lua_pushnumber(l, stats.m_num_kept);
+    lua_pushnumber(l, stats.m_num_removed);
+    lua_pushnumber(l, stats.m_num_migrated);
+    return 4;
+}
+
 int li_debug_collect_garbage(lua_State* l) {
-    lua_gc(Script::get_lua_state(), LUA_GCCOLLECT, 0);
+    Script::Gc_Scheduler::collect();
+    return 0;
+}
+
+int li_debug_entity_backrefs(lua_State* l) {
+    Gensys::Runtime::Entity_Collection& ents = Gensys::Runtime::get_entities();
+    if (!lua_isnone(l, 1)) {
+        ents.set_backrefs_enabled(lua_toboolean(l, 1));
+    }
+    lua_pushnumber(l, ents.get_num_backrefs());
+    return 1;
+}
+
+boost::filesystem::path get_debug_snapshot_path() {
+    return boost::filesystem::temp_directory_path() / "pegr_test_snapshot.bin";
+}
+
+int li_debug_save_snapshot(lua_State* l) {
+    Gensys::Snapshot::save_snapshot(get_debug_snapshot_path());
+    return 0;
+}
+
+int li_debug_load_snapshot(lua_State* l) {
+    Gensys::Snapshot::load_snapshot(get_debug_snapshot_path());
+    boost::filesystem::remove(get_debug_snapshot_path());
+    return 0;
+}
+
+// Loads the saved snapshot with the last few bytes missing, which must fail
+int li_debug_load_truncated_snapshot(lua_State* l) {
+    std::size_t num_missing = luaL_checknumber(l, 1);
+    std::ifstream is(get_debug_snapshot_path().string().c_str(), 
+            std::ios::in | std::ios::binary);
+    std::vector<char> buffer((std::istreambuf_iterator<char>(is)), 
+            std::istreambuf_iterator<char>());
+    luaL_argcheck(l, num_missing <= buffer.size(), 1, "Snapshot too small");
+    Gensys::Snapshot::read_snapshot(buffer.data(), 
+            buffer.size() - num_missing);
+    return 0;
+}
+
+Gensys::Event::Listener_Handle n_debug_on_kill = 
+        Gensys::Event::EMPTY_HANDLE;
+int n_debug_num_kills = 0;
+
+// Starts or stops counting kill events, returning the count so far
+int li_debug_count_kills(lua_State* l) {
+    Gensys::Event::Entity_Killed_Event* killed = 
+            Gensys::Event::get_entity_killed_event();
+    bool enable = lua_toboolean(l, 1);
+    if (enable && n_debug_on_kill == Gensys::Event::EMPTY_HANDLE) {
+        n_debug_num_kills = 0;
+        n_debug_on_kill = killed->hook(Gensys::Event::Entity_Listener(
+                [](Gensys::Runtime::Entity* ent) {
+                    ++n_debug_num_kills;
+                }));
+    } else if (!enable && n_debug_on_kill != Gensys::Event::EMPTY_HANDLE) {
+        killed->unhook(n_debug_on_kill);
+        n_debug_on_kill = Gensys::Event::EMPTY_HANDLE;
+    }
+    lua_pushnumber(l, n_debug_num_kills);
+    return 1;
+}
+
+boost::filesystem::path get_debug_cache_path() {
+    return boost::filesystem::temp_directory_path() / "pegr_test_cache.bin";
+}
+
+int li_debug_save_compiled(lua_State* l) {
+    std::uint64_t key = luaL_checknumber(l, 1);
+    Gensys::Cache::save_cache(get_debug_cache_path(), key);
     return 0;
 }
 
+int li_debug_load_compiled(lua_State* l) {
+    const int ARG_ENV = 2;
+    std::uint64_t key = luaL_checknumber(l, 1);
+    luaL_checktype(l, ARG_ENV, LUA_TTABLE);
+    lua_pushvalue(l, ARG_ENV);
+    Script::Unique_Regref env = Script::grab_unique_reference();
+    
+    // Throw away everything that was compiled normally
+    Gensys::cleanup();
+    Gensys::initialize();
+    bool success = 
+            Gensys::compile_cached(get_debug_cache_path(), key, env.get());
+    if (success) {
+        boost::filesystem::remove(get_debug_cache_path());
+    }
+    lua_pushboolean(l, success);
+    return 1;
+}
+
+std::vector<Gensys::Snapshot::Delta> n_debug_deltas;
+
+int li_debug_delta_tracking(lua_State* l) {
+    Gensys::Snapshot::set_delta_tracking_enabled(lua_toboolean(l, 1));
+    n_debug_deltas.clear();
+    return 0;
+}
+
+int li_debug_take_delta(lua_State* l) {
+    // Always round-trip through serialization
+    std::vector<char> buffer = 
+            Gensys::Snapshot::write_delta(Gensys::Snapshot::take_delta());
+    n_debug_deltas.push_back(
+            Gensys::Snapshot::read_delta(buffer.data(), buffer.size()));
+    lua_pushnumber(l, n_debug_deltas.size());
+    lua_pushnumber(l, buffer.size());
+    return 2;
+}
+
+int li_debug_apply_delta(lua_State* l) {
+    std::size_t idx = luaL_checknumber(l, 1);
+    luaL_argcheck(l, idx >= 1 && idx <= n_debug_deltas.size(), 1, 
+            "No such delta");
+    Gensys::Snapshot::apply_delta(n_debug_deltas[idx - 1], 
+            lua_toboolean(l, 2));
+    return 0;
+}
+
+std::unique_ptr<Gensys::Rollback::Rollback_Buffer> n_debug_rollback;
+Gensys::Event::Listener_Handle n_debug_on_spawn_replayable;
+Gensys::Event::Listener_Handle n_debug_on_spawn_once;
+int n_debug_num_spawns_replayable = 0;
+int n_debug_num_spawns_once = 0;
+
+int li_debug_rollback_begin(lua_State* l) {
+    std::size_t depth = luaL_checknumber(l, 1);
+    luaL_argcheck(l, depth > 0, 1, "Depth must be > 0");
+    n_debug_rollback.reset(new Gensys::Rollback::Rollback_Buffer(depth));
+    
+    n_debug_num_spawns_replayable = 0;
+    n_debug_num_spawns_once = 0;
+    Gensys::Event::Entity_Spawned_Event* spawned = 
+            Gensys::Event::get_entity_spawned_event();
+    n_debug_on_spawn_replayable = spawned->hook(Gensys::Event::Entity_Listener(
+            [](Gensys::Runtime::Entity* ent) {
+                ++n_debug_num_spawns_replayable;
+            }));
+    n_debug_on_spawn_once = spawned->hook(Gensys::Event::Entity_Listener(
+            [](Gensys::Runtime::Entity* ent) {
+                ++n_debug_num_spawns_once;
+            }, false));
+    return 0;
+}
+
+int li_debug_rollback_end(lua_State* l) {
+    Gensys::Event::Entity_Spawned_Event* spawned = 
+            Gensys::Event::get_entity_spawned_event();
+    spawned->unhook(n_debug_on_spawn_replayable);
+    spawned->unhook(n_debug_on_spawn_once);
+    n_debug_rollback.reset();
+    return 0;
+}
+
+int li_debug_rollback_save(lua_State* l) {
+    n_debug_rollback->save(luaL_checknumber(l, 1));
+    lua_pushnumber(l, n_debug_rollback->get_num_tables_copied());
+    return 1;
+}
+
+int li_debug_rollback_restore(lua_State* l) {
+    n_debug_rollback->restore(luaL_checknumber(l, 1));
+    return 0;
+}
+
+int li_debug_rollback_replay(lua_State* l) {
+    const int ARG_SIMULATE = 3;
+    std::uint64_t tick_id = luaL_checknumber(l, 1);
+    std::uint64_t last_tick_id = luaL_checknumber(l, 2);
+    luaL_checktype(l, ARG_SIMULATE, LUA_TFUNCTION);
+    n_debug_rollback->replay(tick_id, last_tick_id, 
+            [l](std::uint64_t tick) {
+                lua_pushvalue(l, ARG_SIMULATE);
+                lua_pushnumber(l, tick);
+                if (lua_pcall(l, 1, 0, 0) != 0) {
+                    std::string msg = lua_tostring(l, -1);
+                    lua_pop(l, 1);
+                    throw Except::Runtime(msg);
+                }
+            });
+    return 0;
+}
+
+int li_debug_spawn_counts(lua_State* l) {
+    lua_pushnumber(l, n_debug_num_spawns_replayable);
+    lua_pushnumber(l, n_debug_num_spawns_once);
+    return 2;
+}
+
+std::map<std::size_t, std::unique_ptr<Gensys::Runtime::World> > n_debug_worlds;
+
+int li_debug_world_new(lua_State* l) {
+    std::unique_ptr<Gensys::Runtime::World> world = 
+            std::make_unique<Gensys::Runtime::World>();
+    std::size_t index = world->get_index();
+    n_debug_worlds[index] = std::move(world);
+    lua_pushnumber(l, index);
+    return 1;
+}
+
+Gensys::Runtime::World* arg_require_debug_world(lua_State* l, int idx) {
+    std::size_t index = luaL_checknumber(l, idx);
+    if (index == 0) {
+        return &Gensys::Runtime::get_default_world();
+    }
+    auto iter = n_debug_worlds.find(index);
+    luaL_argcheck(l, iter != n_debug_worlds.end(), idx, "No such world");
+    return iter->second.get();
+}
+
+int li_debug_world_enter(lua_State* l) {
+    Gensys::Runtime::set_current_world(arg_require_debug_world(l, 1));
+    return 0;
+}
+
+int li_debug_world_delete(lua_State* l) {
+    std::size_t index = luaL_checknumber(l, 1);
+    n_debug_worlds.erase(index);
+    return 0;
+}
+
+int li_debug_world_fork(lua_State* l) {
+    std::unique_ptr<Gensys::Runtime::World> world = 
+            arg_require_debug_world(l, 1)->fork();
+    std::size_t index = world->get_index();
+    n_debug_worlds[index] = std::move(world);
+    lua_pushnumber(l, index);
+    return 1;
+}
+
+int li_debug_world_translate(lua_State* l) {
+    Gensys::Runtime::Entity_Handle ent = 
+            *(Gensys::LI::arg_require_entity(l, 1));
+    Gensys::LI::push_gensys_obj(l, 
+            arg_require_debug_world(l, 2)->translate_handle(ent));
+    return 1;
+}
+
+int li_debug_world_shared(lua_State* l) {
+    int num_shared = 0;
+    arg_require_debug_world(l, 1)->get_entities().for_each(
+            [&num_shared](Gensys::Runtime::Entity* ent) {
+                if (ent->is_chunk_shared()) {
+                    ++num_shared;
+                }
+            });
+    lua_pushnumber(l, num_shared);
+    return 1;
+}
+
+int li_debug_world_stored(lua_State* l) {
+    lua_pushnumber(l, 
+            arg_require_debug_world(l, 1)->get_entities().get_num_stored());
+    return 1;
+}
+
+int li_debug_cview_read_across_write(lua_State* l) {
+    Gensys::Runtime::Cview* cview = Gensys::LI::arg_require_cview(l, 1);
+    Gensys::Runtime::Symbol member(luaL_checkstring(l, 2));
+    double value = luaL_checknumber(l, 3);
+    
+    // The read pointer is taken before the write, which may move the chunk
+    Gensys::Runtime::Member_Ptr read_ptr = cview->get_member_ptr(member);
+    Gensys::Runtime::Member_Ptr write_ptr = cview->get_member_ptr(member);
+    luaL_argcheck(l, !read_ptr.is_nullptr(), 2, "No such member");
+    write_ptr.set_value_any_number(value);
+    lua_pushnumber(l, read_ptr.get_value_any_number());
+    return 1;
+}
+
+int li_debug_world_threads(lua_State* l) {
+    Gensys::Runtime::Arche* arche = 
+            Gensys::Runtime::find_arche(luaL_checkstring(l, 1));
+    int count = luaL_checknumber(l, 2);
+    luaL_argcheck(l, arche, 1, "No such archetype");
+    
+    /* Every debug world creates, spawns and deletes entities on its own
+     * thread. Entities are only touched from C++.
+     */
+    std::vector<std::thread> threads;
+    std::vector<int> num_spawned(n_debug_worlds.size(), 0);
+    std::vector<int> num_remaining(n_debug_worlds.size(), 0);
+    std::size_t thread_idx = 0;
+    for (auto& world_entry : n_debug_worlds) {
+        Gensys::Runtime::World* world = world_entry.second.get();
+        int* spawned = &num_spawned[thread_idx];
+        int* remaining = &num_remaining[thread_idx];
+        threads.emplace_back([world, arche, count, spawned, remaining]() {
+            Gensys::Runtime::World::Scope scope(world);
+            Gensys::Event::Listener_Handle on_spawn = 
+                    world->get_spawned_event()->hook(
+                        Gensys::Event::Entity_Listener(
+                            [spawned](Gensys::Runtime::Entity* ent) {
+                                ++(*spawned);
+                            }));
+            Gensys::Runtime::Entity_Collection& ents = world->get_entities();
+            for (int idx = 0; idx < count; ++idx) {
+                Gensys::Runtime::Entity_Handle ent = ents.new_entity(arche);
+                ent->spawn();
+                if (idx % 2 == 0) {
+                    ents.delete_entity(ent);
+                }
+            }
+            ents.for_each([remaining](Gensys::Runtime::Entity* ent) {
+                ++(*remaining);
+            });
+            world->get_spawned_event()->unhook(on_spawn);
+        });
+        ++thread_idx;
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    
+    // Returns the totals for all worlds
+    int total_spawned = 0;
+    int total_remaining = 0;
+    for (std::size_t idx = 0; idx < num_spawned.size(); ++idx) {
+        total_spawned += num_spawned[idx];
+        total_remaining += num_remaining[idx];
+    }
+    lua_pushnumber(l, total_spawned);
+    lua_pushnumber(l, total_remaining);
+    return 2;
+}
+
+int li_debug_trace(lua_State* l) {
+    Debug::Trace::set_enabled(lua_toboolean(l, 1));
+    if (!lua_toboolean(l, 1)) {
+        Debug::Trace::clear();
+    }
+    return 0;
+}
+
+int li_debug_trace_dump(lua_State* l) {
+    const char* file = luaL_checkstring(l, 1);
+    try {
+        lua_pushnumber(l, Debug::Trace::dump(file));
+    } catch (Except::Runtime& e) {
+        luaL_error(l, e.what());
+    }
+    return 1;
+}
+
+int li_debug_lua_profile_start(lua_State* l) {
+    double interval = luaL_optnumber(l, 1, 1e-3);
+    Debug::Lua_Profiler::clear();
+    Debug::Lua_Profiler::start(interval);
+    return 0;
+}
+
+int li_debug_lua_profile_stop(lua_State* l) {
+    Debug::Lua_Profiler::stop();
+    const auto& stacks = Debug::Lua_Profiler::get_folded_stacks();
+    lua_createtable(l, 0, stacks.size());
+    for (const auto& pair : stacks) {
+        lua_pushlstring(l, pair.first.c_str(), pair.first.size());
+        lua_pushnumber(l, pair.second);
+        lua_rawset(l, -3);
+    }
+    lua_pushnumber(l, Debug::Lua_Profiler::get_num_samples());
+    return 2;
+}
+
+int li_debug_lua_profile_dump(lua_State* l) {
+    const char* file = luaL_checkstring(l, 1);
+    try {
+        lua_pushnumber(l, Debug::Lua_Profiler::dump_folded(file));
+    } catch (Except::Runtime& e) {
+        luaL_error(l, e.what());
+    }
+    return 1;
+}
+
+int li_debug_jit_diag(lua_State* l) {
+    bool enable = lua_toboolean(l, 1);
+    if (enable) {
+        Debug::Jit_Diag::clear();
+    }
+    lua_pushboolean(l, Debug::Jit_Diag::set_enabled(enable));
+    return 1;
+}
+
+int li_debug_jit_diag_summary(lua_State* l) {
+    Debug::Jit_Diag::Summary summary = Debug::Jit_Diag::get_summary();
+    lua_newtable(l);
+    lua_pushnumber(l, summary.m_num_started);
+    lua_setfield(l, -2, "started");
+    lua_pushnumber(l, summary.m_num_completed);
+    lua_setfield(l, -2, "completed");
+    lua_pushnumber(l, summary.m_num_aborted);
+    lua_setfield(l, -2, "aborted");
+    lua_pushnumber(l, summary.m_num_flushes);
+    lua_setfield(l, -2, "flushes");
+    
+    lua_createtable(l, summary.m_aborts.size(), 0);
+    for (std::size_t idx = 0; idx < summary.m_aborts.size(); ++idx) {
+        const Debug::Jit_Diag::Abort_Site& site = summary.m_aborts[idx];
+        lua_createtable(l, 0, 4);
+        lua_pushstring(l, site.m_start_loc.c_str());
+        lua_setfield(l, -2, "start");
+        lua_pushstring(l, site.m_abort_loc.c_str());
+        lua_setfield(l, -2, "at");
+        lua_pushstring(l, site.m_reason.c_str());
+        lua_setfield(l, -2, "reason");
+        lua_pushnumber(l, site.m_count);
+        lua_setfield(l, -2, "count");
+        lua_rawseti(l, -2, idx + 1);
+    }
+    lua_setfield(l, -2, "aborts");
+    
+    lua_createtable(l, summary.m_blacklisted.size(), 0);
+    for (std::size_t idx = 0; idx < summary.m_blacklisted.size(); ++idx) {
+        lua_pushstring(l, summary.m_blacklisted[idx].c_str());
+        lua_rawseti(l, -2, idx + 1);
+    }
+    lua_setfield(l, -2, "blacklisted");
+    
+    lua_createtable(l, 0, summary.m_stitches.size());
+    for (const auto& entry : summary.m_stitches) {
+        lua_pushnumber(l, entry.second);
+        lua_setfield(l, -2, entry.first.c_str());
+    }
+    lua_setfield(l, -2, "stitches");
+    return 1;
+}
+
 int li_debug_timer_start(lua_State* l) {
     n_start_time = std::chrono::high_resolution_clock::now();
     n_timer_set = true;
@@ -97,7 +556,41 @@ int li_debug_timer_end(lua_State* l) {
 void setup() {
     const luaL_Reg test_api[] = {
         {"debug_stage_compile", li_debug_stage_compile},
+        {"debug_reopen", li_debug_reopen},
+        {"debug_compile_stats", li_debug_compile_stats},
         {"debug_collect_garbage", li_debug_collect_garbage},
+        {"debug_entity_backrefs", li_debug_entity_backrefs},
+        {"debug_save_snapshot", li_debug_save_snapshot},
+        {"debug_load_snapshot", li_debug_load_snapshot},
+        {"debug_load_truncated_snapshot", li_debug_load_truncated_snapshot},
+        {"debug_count_kills", li_debug_count_kills},
+        {"debug_save_compiled", li_debug_save_compiled},
+        {"debug_load_compiled", li_debug_load_compiled},
+        {"debug_delta_tracking", li_debug_delta_tracking},
+        {"debug_take_delta", li_debug_take_delta},
+        {"debug_apply_delta", li_debug_apply_delta},
+        {"debug_rollback_begin", li_debug_rollback_begin},
+        {"debug_rollback_end", li_debug_rollback_end},
+        {"debug_rollback_save", li_debug_rollback_save},
+        {"debug_rollback_restore", li_debug_rollback_restore},
+        {"debug_rollback_replay", li_debug_rollback_replay},
+        {"debug_spawn_counts", li_debug_spawn_counts},
+        {"debug_world_new", li_debug_world_new},
+        {"debug_world_enter", li_debug_world_enter},
+        {"debug_world_delete", li_debug_world_delete},
+        {"debug_world_fork", li_debug_world_fork},
+        {"debug_world_translate", li_debug_world_translate},
+        {"debug_world_shared", li_debug_world_shared},
+        {"debug_world_stored", li_debug_world_stored},
+        {"debug_cview_read_across_write", li_debug_cview_read_across_write},
+        {"debug_world_threads", li_debug_world_threads},
+        {"debug_trace", li_debug_trace},
+        {"debug_trace_dump", li_debug_trace_dump},
+        {"debug_lua_profile_start", li_debug_lua_profile_start},
+        {"debug_lua_profile_stop", li_debug_lua_profile_stop},
+        {"debug_lua_profile_dump", li_debug_lua_profile_dump},
+        {"debug_jit_diag", li_debug_jit_diag},
+        {"debug_jit_diag_summary", li_debug_jit_diag_summary},
         {"debug_timer_start", li_debug_timer_start},
         {"debug_timer_end", li_debug_timer_end},
         
@@ -105,6 +598,7 @@ void setup() {
         {nullptr, nullptr}
     };
     Script::multi_expose_c_functions(test_api);
+    Bench::LI::initialize();
 }
 
 void log_header(const char* name, char divider = '.') {
@@ -19,6 +19,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -101,6 +103,24 @@ bool is_subset_of(
             sorted(superset));
 }
 
+/**
+ * @brief 64-bit FNV-1a hash of some bytes. Hashes can be chained by passing
+ * the previous result as the starting value.
+ * @param data The bytes
+ * @param size Number of bytes
+ * @param hash Starting value
+ * @return The hash
+ */
+inline std::uint64_t hash_bytes(const void* data, std::size_t size,
+        std::uint64_t hash = 0xcbf29ce484222325) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        hash ^= bytes[idx];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
 } // namespace Util
 } // namespace pegr
 
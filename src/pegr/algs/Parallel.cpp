@@ -0,0 +1,82 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/algs/Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pegr {
+namespace Algs {
+
+std::size_t get_num_workers() {
+    // Zero if it cannot be determined
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallel_for(std::size_t count, 
+        const std::function<void(std::size_t)>& func) {
+    std::size_t num_threads = std::min(get_num_workers(), count);
+    if (num_threads <= 1) {
+        for (std::size_t idx = 0; idx < count; ++idx) {
+            func(idx);
+        }
+        return;
+    }
+    
+    // Indices are taken one at a time, since objects vary a lot in cost
+    std::atomic<std::size_t> next_idx(0);
+    std::atomic<bool> failed(false);
+    std::mutex error_mutex;
+    std::exception_ptr first_error;
+    auto work = [&]() {
+        while (!failed) {
+            std::size_t idx = next_idx++;
+            if (idx >= count) {
+                return;
+            }
+            try {
+                func(idx);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!first_error) {
+                    first_error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+    
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (std::size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (first_error) {
+        std::rethrow_exception(first_error);
+    }
+}
+
+} // namespace Algs
+} // namespace pegr
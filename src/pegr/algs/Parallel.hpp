@@ -0,0 +1,46 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_ALGS_PARALLEL_HPP
+#define PEGR_ALGS_PARALLEL_HPP
+
+#include <cstddef>
+#include <functional>
+
+namespace pegr {
+namespace Algs {
+
+/**
+ * @return How many threads parallel_for() uses at most
+ */
+std::size_t get_num_workers();
+
+/**
+ * @brief Calls the function once for every index in [0, count), spread across
+ * get_num_workers() threads, including the calling one. Returns once every
+ * call is done. The function must not touch Lua or anything else that is not
+ * thread-safe. If a call throws, the indices not yet started are skipped, and
+ * the first exception is rethrown on the calling thread.
+ * @param count Number of indices
+ * @param func Called with each index
+ */
+void parallel_for(std::size_t count, 
+        const std::function<void(std::size_t)>& func);
+
+} // namespace Algs
+} // namespace pegr
+
+#endif // PEGR_ALGS_PARALLEL_HPP
@@ -17,38 +17,138 @@
 #include "pegr/algs/Partition_Tracker.hpp"
 
 #include <algorithm>
+#include <cassert>
 
 namespace pegr {
 namespace Algs {
 
+const std::size_t WORD_BITS = 64;
+
+/**
+ * @return A word with every bit whose index is a multiple of the alignment set
+ */
+std::uint64_t aligned_bits(std::size_t alignment) {
+    switch (alignment) {
+        case 1: return ~std::uint64_t(0);
+        case 2: return 0x5555555555555555ull;
+        case 4: return 0x1111111111111111ull;
+        case 8: return 0x0101010101010101ull;
+        case 16: return 0x0001000100010001ull;
+        case 32: return 0x0000000100000001ull;
+        case 64: return 0x0000000000000001ull;
+        default: {
+            assert(false && "Alignment must be a power of two up to 64");
+            return 0;
+        }
+    }
+}
+
+/**
+ * @return Index of the lowest set bit, which must exist
+ */
+std::size_t lowest_bit(std::uint64_t word) {
+    assert(word != 0);
+    std::size_t idx = 0;
+    while ((word & 0xFF) == 0) {
+        word >>= 8;
+        idx += 8;
+    }
+    while ((word & 1) == 0) {
+        word >>= 1;
+        ++idx;
+    }
+    return idx;
+}
+
+bool Partition_Tracker::is_occupied(std::size_t byte) const {
+    std::size_t word_idx = byte / WORD_BITS;
+    if (word_idx >= m_words.size()) {
+        return false;
+    }
+    return (m_words[word_idx] >> (byte % WORD_BITS)) & 1;
+}
+
 void Partition_Tracker::occupy(std::size_t offset, std::size_t size) {
+    if (size == 0) {
+        return;
+    }
     std::size_t end_range = offset + size;
-    if (end_range > m_data.size()) {
-        m_data.resize(end_range, 0);
+    std::size_t num_words = (end_range + WORD_BITS - 1) / WORD_BITS;
+    if (num_words > m_words.size()) {
+        m_words.resize(num_words, 0);
     }
-    std::fill(m_data.begin() + offset, m_data.begin() + end_range, 1);
+    for (std::size_t byte = offset; byte < end_range; ) {
+        std::size_t bit = byte % WORD_BITS;
+        std::size_t count = std::min(WORD_BITS - bit, end_range - byte);
+        std::uint64_t mask = count == WORD_BITS ? 
+                ~std::uint64_t(0) : ((std::uint64_t(1) << count) - 1) << bit;
+        m_words[byte / WORD_BITS] |= mask;
+        byte += count;
+    }
+    m_minimum_size = std::max(m_minimum_size, end_range);
 }
 
-bool Partition_Tracker::can_occupy(std::size_t offset, std::size_t size) {
-    std::size_t end_range = offset + size;
-    if (offset > m_data.size()) {
-        return true;
-    }
-    auto end_iter = 
-            end_range > m_data.size() ? 
-                    m_data.end() : 
-                    m_data.begin() + end_range;
-    return std::find(m_data.begin() + offset, end_iter, 1) == end_iter;
+bool Partition_Tracker::can_occupy(std::size_t offset, std::size_t size) 
+        const {
+    std::size_t end_range = std::min(offset + size, m_minimum_size);
+    for (std::size_t byte = offset; byte < end_range; ) {
+        std::size_t bit = byte % WORD_BITS;
+        std::size_t count = std::min(WORD_BITS - bit, end_range - byte);
+        std::uint64_t mask = count == WORD_BITS ? 
+                ~std::uint64_t(0) : ((std::uint64_t(1) << count) - 1) << bit;
+        if (m_words[byte / WORD_BITS] & mask) {
+            return false;
+        }
+        byte += count;
+    }
+    return true;
 }
 
-std::size_t Partition_Tracker::get_minimum_size() {
-    // Finds the index of the last occupied byte
-    auto last_occupied = 
-            std::find(m_data.rbegin(), m_data.rend(), 1).base();
-    return std::distance(m_data.begin(), last_occupied + 1);
+std::size_t Partition_Tracker::find_first_fit(std::size_t size, 
+        std::size_t alignment) {
+    std::uint64_t aligned = aligned_bits(alignment);
+    std::size_t& hint = m_fit_hints[std::make_pair(size, alignment)];
+    
+    // Members wider than a word are rare, so just try every aligned offset
+    if (size > WORD_BITS) {
+        while (!can_occupy(hint, size)) {
+            hint += alignment;
+        }
+        return hint;
+    }
+    
+    // Every bit that begins a run of "size" free bits, found by shifting the
+    // free bits of this word and the next one over each other. Everything 
+    // past the end is free.
+    for (std::size_t word_idx = hint / WORD_BITS; ; ++word_idx) {
+        if (word_idx >= m_words.size()) {
+            hint = std::max(hint, m_words.size() * WORD_BITS);
+            return hint;
+        }
+        std::uint64_t free_lo = ~m_words[word_idx];
+        std::uint64_t free_hi = word_idx + 1 < m_words.size() ?
+                ~m_words[word_idx + 1] : ~std::uint64_t(0);
+        std::uint64_t starts = free_lo & aligned;
+        for (std::size_t shift = 1; shift < size && starts; ++shift) {
+            starts &= (free_lo >> shift) | (free_hi << (WORD_BITS - shift));
+        }
+        
+        // Skip anything before the hint
+        std::size_t word_start = word_idx * WORD_BITS;
+        if (hint > word_start) {
+            starts &= ~std::uint64_t(0) << (hint - word_start);
+        }
+        
+        if (starts) {
+            hint = word_start + lowest_bit(starts);
+            return hint;
+        }
+    }
 }
 
+std::size_t Partition_Tracker::get_minimum_size() const {
+    return m_minimum_size;
+}
 
 } // namespace Algs
 } // namespace pegr
-
@@ -17,20 +17,51 @@
 #ifndef PEGR_ALGS_PARTITIONTRACKER_HPP
 #define PEGR_ALGS_PARTITIONTRACKER_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
 #include <vector>
 
 namespace pegr {
 namespace Algs {
 
+/**
+ * @class Partition_Tracker
+ * @brief Tracks which bytes of a growing buffer are occupied, for packing
+ * members into pod chunks. One bit is stored per byte, and free space is
+ * searched for a whole 64-bit word at a time.
+ */
 class Partition_Tracker {
 public:
     void occupy(std::size_t offset, std::size_t size);
     
-    bool can_occupy(std::size_t offset, std::size_t size);
+    bool can_occupy(std::size_t offset, std::size_t size) const;
+    
+    /**
+     * @brief Finds the lowest offset that is a multiple of the alignment and
+     * can be occupied. Since bytes are never freed, the result for each size
+     * and alignment only ever increases, and so each search resumes where the
+     * last one for the same size and alignment ended. Packing largest first
+     * with this leaves no gaps for power-of-two sizes.
+     * @param size Number of bytes to fit
+     * @param alignment Power of two, at most 64
+     * @return The offset
+     */
+    std::size_t find_first_fit(std::size_t size, std::size_t alignment);
     
-    std::size_t get_minimum_size();
+    /**
+     * @return One past the last occupied byte, or zero if there are none
+     */
+    std::size_t get_minimum_size() const;
 private:
-    std::vector<char> m_data;
+    bool is_occupied(std::size_t byte) const;
+    
+    std::vector<std::uint64_t> m_words;
+    std::size_t m_minimum_size = 0;
+    
+    // Lower bound on the next result of find_first_fit(), by size & alignment
+    std::map<std::pair<std::size_t, std::size_t>, std::size_t> m_fit_hints;
 };
 
 } // namespace Algs
@@ -17,11 +17,34 @@
 #include "pegr/algs/Pod_Chunk.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 
 namespace pegr {
 namespace Algs {
 
+#ifdef PEGR_TRACING
+// Chunks are made and deleted by worker threads too
+std::atomic<std::size_t> n_num_live_podcs(0);
+std::atomic<std::size_t> n_live_podc_bytes(0);
+std::atomic<std::size_t> n_num_allocated_podcs(0);
+#endif
+
+void count_new_podc(std::size_t size) {
+#ifdef PEGR_TRACING
+    n_num_live_podcs.fetch_add(1, std::memory_order_relaxed);
+    n_live_podc_bytes.fetch_add(size, std::memory_order_relaxed);
+    n_num_allocated_podcs.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+void count_deleted_podc(std::size_t size) {
+#ifdef PEGR_TRACING
+    n_num_live_podcs.fetch_sub(1, std::memory_order_relaxed);
+    n_live_podc_bytes.fetch_sub(size, std::memory_order_relaxed);
+#endif
+}
+
 Podc_Ptr::Podc_Ptr()
 : m_voidptr(nullptr)
 , m_size(0) {}
@@ -33,6 +56,7 @@ Podc_Ptr Podc_Ptr::new_podc(std::size_t req_size) {
      */
     if (req_size == 0) {
         int64_t* chunk = new int64_t[1];
+        count_new_podc(0);
         return Podc_Ptr(chunk, 0);
     }
     
@@ -41,11 +65,13 @@ Podc_Ptr Podc_Ptr::new_podc(std::size_t req_size) {
     // Fewest number of int64's that can hold the requested number of bytes
     std::size_t num_64s = (req_size / 8) + (req_size % 8 == 0 ? 0 : 1);
     int64_t* chunk = new int64_t[num_64s];
+    count_new_podc(num_64s * 8);
     return Podc_Ptr(chunk, num_64s * 8);
 }
 
 void Podc_Ptr::delete_podc(Podc_Ptr ptr) {
     if (ptr.is_nullptr()) return;
+    count_deleted_podc(ptr.get_size());
     delete[] static_cast<int64_t*>(ptr.get_raw());
 }
 
@@ -125,5 +151,24 @@ void Chunk_Ptr_Deleter::operator ()(pointer ptr) const {
     Podc_Ptr::delete_podc(ptr);
 }
 
+bool are_podc_stats_counted() {
+#ifdef PEGR_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+Podc_Stats get_podc_stats() {
+    Podc_Stats stats;
+#ifdef PEGR_TRACING
+    stats.m_num_live = n_num_live_podcs.load(std::memory_order_relaxed);
+    stats.m_live_bytes = n_live_podc_bytes.load(std::memory_order_relaxed);
+    stats.m_num_allocated = 
+            n_num_allocated_podcs.load(std::memory_order_relaxed);
+#endif
+    return stats;
+}
+
 } // namespace Algs
 } // namespace pegr
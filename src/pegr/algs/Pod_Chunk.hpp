@@ -175,6 +175,31 @@ struct Chunk_Ptr_Deleter {
 
 typedef std::unique_ptr<Podc_Ptr, Chunk_Ptr_Deleter> Unique_Chunk_Ptr;
 
+/**
+ * @class Podc_Stats
+ * @brief Totals over every chunk made by Podc_Ptr::new_podc()
+ */
+struct Podc_Stats {
+    // Chunks not yet deleted
+    std::size_t m_num_live = 0;
+    std::size_t m_live_bytes = 0;
+    
+    // Ever made
+    std::size_t m_num_allocated = 0;
+};
+
+/**
+ * @return If chunks are counted at all. Counting costs three atomic 
+ * operations per chunk made or deleted, so it only happens in builds with
+ * PGLOCAL_TRACING.
+ */
+bool are_podc_stats_counted();
+
+/**
+ * @return Totals so far, all zero if not are_podc_stats_counted()
+ */
+Podc_Stats get_podc_stats();
+
 } // namespace Algs
 } // namespace pegr
 
@@ -18,19 +18,27 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <vector>
 
 #include <bexam/01-cubes/cubes.hpp>
 #include <bgfx/bgfx.h>
+#include <boost/filesystem.hpp>
 #include <ocornut-imgui/imgui.h>
 
+#include "pegr/debug/Perf_Counters.hpp"
 #include "pegr/engine/App_State.hpp"
 #include "pegr/engine/Engine.hpp"
 #include "pegr/except/Except.hpp"
+#include "pegr/gensys/Cache.hpp"
+#include "pegr/gensys/Compiler.hpp"
 #include "pegr/gensys/Gensys.hpp"
 #include "pegr/gensys/Lua_Interf.hpp"
+#include "pegr/gensys/Memory.hpp"
 #include "pegr/logger/Logger.hpp"
 #include "pegr/render/Shaders.hpp"
+#include "pegr/resource/Resources.hpp"
+#include "pegr/resource/Watcher.hpp"
 #include "pegr/script/Script.hpp"
 #include "pegr/script/Script_Resource.hpp"
 #include "pegr/script/Script_Util.hpp"
@@ -38,6 +46,22 @@
 
 namespace pegr {
 namespace App {
+
+const boost::filesystem::path n_cache_file("cache/gensys.cache");
+
+// How often to log memory accounting
+const std::uint64_t MEMORY_LOG_PERIOD_TICKS = 600;
+
+void save_definitions_cache(std::uint64_t cache_key) {
+    try {
+        boost::filesystem::create_directories(n_cache_file.parent_path());
+        Gensys::Cache::save_cache(n_cache_file, cache_key);
+    } catch (Except::Runtime& e) {
+        Logger::log()->warn(e.what());
+    } catch (boost::filesystem::filesystem_error& e) {
+        Logger::log()->warn(e.what());
+    }
+}
     
 Game_State::Game_State()
 : Engine::App_State("Main")
@@ -70,13 +94,34 @@ void Game_State::initialize() {
         Logger::log()->warn(e.what());
     }
     
+    // Skip running init.lua if its results are already cached. If the
+    // scripts cannot even be hashed, compile them normally (without caching)
+    // so that the usual errors are reported.
+    std::uint64_t cache_key = 0;
+    bool have_cache_key = false;
+    bool used_cache = false;
     try {
-        Script::Util::run_simple_function(init_fun.get(), 0);
+        cache_key = Resour::hash_scripts_and_packages();
+        have_cache_key = true;
+        used_cache = Gensys::compile_cached(
+                n_cache_file, cache_key, sandbox.get());
     } catch (Except::Runtime& e) {
         Logger::log()->warn(e.what());
     }
-    Gensys::LI::stage_all();
-    Gensys::compile();
+    if (used_cache) {
+        Logger::log()->info("Loaded compiled definitions from cache");
+    } else {
+        try {
+            Script::Util::run_simple_function(init_fun.get(), 0);
+        } catch (Except::Runtime& e) {
+            Logger::log()->warn(e.what());
+        }
+        Gensys::LI::stage_all();
+        Gensys::compile();
+        if (have_cache_key) {
+            save_definitions_cache(cache_key);
+        }
+    }
     try {
         Script::Util::run_simple_function(postinit_fun.get(), 0);
     } catch (Except::Runtime& e) {
@@ -106,11 +151,73 @@ void Game_State::initialize() {
             [&](Gensys::Runtime::Entity* ent) {
                 ++m_calls;
             }));
+    
+    m_on_change = Resour::Watcher::add_listener(
+            [this](const std::vector<Resour::Watcher::Change>& changes) {
+                on_resources_changed(changes);
+            });
+}
+
+void Game_State::on_resources_changed(
+        const std::vector<Resour::Watcher::Change>& changes) {
+    bool scripts_changed = false;
+    bool shaders_changed = false;
+    for (const Resour::Watcher::Change& change : changes) {
+        if (change.m_type == Resour::Object::Type::SCRIPT) {
+            scripts_changed = true;
+        } else if (change.m_type == Resour::Object::Type::SHADER) {
+            Render::forget_shader(change.m_oid);
+            shaders_changed = true;
+        }
+    }
+    if (shaders_changed) {
+        m_program = Render::make_program(
+                Render::find_shader("basic_color.vs"), 
+                Render::find_shader("basic_color.fs"));
+    }
+    if (scripts_changed) {
+        reload_definitions();
+    }
+}
+
+void Game_State::reload_definitions() {
+    Logger::log()->info("Reloading definitions");
+    
+    // Rerun init.lua and recompile only what it changed. Existing entities
+    // are migrated to the new archetypes. postinit.lua is not rerun, since it
+    // may do more than define things.
+    Gensys::reopen();
+    Script::Unique_Regref sandbox = Script::new_sandbox();
+    try {
+        Script::Unique_Regref init_fun = 
+                Script::find_script("init.lua", sandbox.get());
+        Script::Util::run_simple_function(init_fun.get(), 0);
+    } catch (Except::Runtime& e) {
+        Logger::log()->warn(e.what());
+    }
+    Gensys::LI::stage_all();
+    Gensys::compile();
+    
+    const Gensys::Compiler::Compile_Stats& stats = 
+            Gensys::Compiler::get_compile_stats();
+    Logger::log()->info("\t%v rebuilt, %v kept, %v removed, %v migrated", 
+            stats.m_num_rebuilt, stats.m_num_kept, stats.m_num_removed, 
+            stats.m_num_migrated);
+    
+    try {
+        save_definitions_cache(Resour::hash_scripts_and_packages());
+    } catch (Except::Runtime& e) {
+        Logger::log()->warn(e.what());
+    }
 }
 
 void Game_State::do_tick() {
     m_time += 0.1;
     m_ete->trigger();
+    if (Engine::get_tick_id() % MEMORY_LOG_PERIOD_TICKS == 0) {
+        Gensys::Runtime::log_memory_stats(
+                Gensys::Runtime::get_memory_stats());
+    }
 }
 void Game_State::do_frame() {
     bgfx::dbgTextClear();
@@ -120,6 +227,40 @@ void Game_State::do_frame() {
             Winput::get_window_width(),
             Winput::get_window_height(), m_program.get());
     ImGui::ShowTestWindow();
+    show_tick_counters();
+    m_profiler.show();
+}
+
+void Game_State::show_tick_counters() {
+    ImGui::Begin("Tick counters");
+    bool enabled = Engine::are_tick_counters_enabled();
+    if (ImGui::Checkbox("Count hardware events", &enabled)) {
+        Engine::set_tick_counters_enabled(enabled);
+    }
+    bool profiler_open = m_profiler.is_open();
+    if (ImGui::Checkbox("Show profiler", &profiler_open)) {
+        m_profiler.set_open(profiler_open);
+    }
+    const Debug::Counter_Values& counters = Engine::get_tick_counters();
+    for (std::size_t idx = 0; idx < Debug::NUM_COUNTERS; ++idx) {
+        const char* name = 
+                Debug::counter_to_string(static_cast<Debug::Counter>(idx));
+        if (counters.m_valid[idx]) {
+            ImGui::Text("%s: %llu", name, 
+                    static_cast<unsigned long long>(counters.m_values[idx]));
+        } else {
+            ImGui::Text("%s: n/a", name);
+        }
+    }
+    if (counters.is_valid(Debug::Counter::CYCLES) 
+            && counters.is_valid(Debug::Counter::INSTRUCTIONS)
+            && counters.get(Debug::Counter::CYCLES) > 0) {
+        ImGui::Text("instructions per cycle: %.2f", 
+                static_cast<double>(
+                        counters.get(Debug::Counter::INSTRUCTIONS)) 
+                / counters.get(Debug::Counter::CYCLES));
+    }
+    ImGui::End();
 }
 
 void Game_State::on_window_resize(int32_t width, int32_t height) {
@@ -127,6 +268,8 @@ void Game_State::on_window_resize(int32_t width, int32_t height) {
 }
 
 void Game_State::cleanup() {
+    m_profiler.set_open(false);
+    Resour::Watcher::remove_listener(m_on_change);
     Gensys::Event::get_entity_spawned_event()->unhook(m_on_spawn);
     Gensys::Event::get_entity_killed_event()->unhook(m_on_kill);
     Logger::log()->info("cookie ticks: %v", m_calls);
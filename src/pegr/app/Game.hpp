@@ -19,9 +19,11 @@
 
 #include <bgfx/bgfx.h>
 
+#include "pegr/app/Profiler_Panel.hpp"
 #include "pegr/engine/App_State.hpp"
 #include "pegr/gensys/Events.hpp"
 #include "pegr/render/Handles.hpp"
+#include "pegr/resource/Watcher.hpp"
 
 namespace pegr {
 namespace App {
@@ -39,6 +41,16 @@ public:
     virtual void cleanup() override;
     
 private:
+    /**
+     * @brief Debug overlay window with the hardware events of the last tick,
+     * which also opens the profiler
+     */
+    void show_tick_counters();
+    
+    void on_resources_changed(
+            const std::vector<Resour::Watcher::Change>& changes);
+    void reload_definitions();
+    
     Render::Unique_Vertex_Buffer m_vert_buff;
     Render::Unique_Index_Buffer m_index_buff;
     Render::Unique_Program m_program;
@@ -48,6 +60,10 @@ private:
     Gensys::Event::Listener_Handle m_on_spawn = Gensys::Event::EMPTY_HANDLE;
     Gensys::Event::Listener_Handle m_on_kill = Gensys::Event::EMPTY_HANDLE;
     
+    Resour::Watcher::Listener_Handle m_on_change;
+    
+    Profiler_Panel m_profiler;
+    
     double m_time;
     int m_calls;
 };
@@ -0,0 +1,446 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "pegr/app/Profiler_Panel.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ocornut-imgui/imgui.h>
+
+#include "pegr/algs/Pod_Chunk.hpp"
+#include "pegr/debug/Jit_Diag.hpp"
+#include "pegr/debug/Lua_Profiler.hpp"
+#include "pegr/debug/Profiler.hpp"
+#include "pegr/except/Except.hpp"
+#include "pegr/gensys/Memory.hpp"
+#include "pegr/logger/Logger.hpp"
+#include "pegr/script/Gc_Scheduler.hpp"
+
+namespace pegr {
+namespace App {
+
+// How many ticks (or frames) to plot
+const std::size_t HISTORY_LENGTH = 240;
+
+const char* TICK_SPAN_NAME = "Engine::async_tick";
+const char* FRAME_SPAN_NAME = "Engine::async_render";
+
+// Where "Write folded stacks" puts the Lua samples
+const char* LUA_PROFILE_FILE = "lua_profile.folded";
+
+// How many of the most sampled Lua stacks to list
+const std::size_t MAX_LUA_STACKS_SHOWN = 20;
+
+// How many of the most frequent JIT aborts and stitches to list
+const std::size_t MAX_JIT_SITES_SHOWN = 20;
+
+// Range of the GC budget slider
+const int MAX_GC_BUDGET_US = 5000;
+
+double ns_to_ms(std::uint64_t ns) {
+    return ns / 1e6;
+}
+
+/**
+ * @brief Spans with the same name are always drawn the same color
+ */
+ImU32 get_span_color(const char* name) {
+    std::size_t hash = std::hash<std::string>()(name);
+    float red, green, blue;
+    ImGui::ColorConvertHSVtoRGB((hash % 360) / 360.f, 0.5f, 0.7f, 
+            red, green, blue);
+    return ImGui::GetColorU32(ImVec4(red, green, blue, 1.f));
+}
+
+/**
+ * @return The span's name, with the argument if it has one
+ */
+std::string get_span_label(const char* name, std::uint64_t arg) {
+    if (arg == Debug::Trace::NO_ARG) {
+        return name;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), " %llx", 
+            static_cast<unsigned long long>(arg));
+    return std::string(name) + buffer;
+}
+
+void Profiler_Panel::set_open(bool open) {
+    if (open == m_open) {
+        return;
+    }
+    m_open = open;
+    Debug::Trace::set_enabled(open);
+    if (!open) {
+        Debug::Lua_Profiler::stop();
+        Debug::Jit_Diag::set_enabled(false);
+        Debug::Trace::clear();
+        m_threads.clear();
+        m_periods.clear();
+        m_gc_history.clear();
+        m_paused = false;
+    }
+}
+
+bool Profiler_Panel::is_open() const {
+    return m_open;
+}
+
+void Profiler_Panel::show() {
+    if (!m_open) {
+        return;
+    }
+    
+    if (!m_paused) {
+        m_threads = Debug::Trace::snapshot();
+        m_periods = Debug::Profiler::find_spans(m_threads, 
+                m_show_frames ? FRAME_SPAN_NAME : TICK_SPAN_NAME);
+        m_selected = m_periods.empty() ? 0 : m_periods.size() - 1;
+        
+        m_gc_history.push_back(ns_to_ms(Script::Gc_Scheduler
+                ::get_last_frame_stats().get_total_ns()));
+        if (m_gc_history.size() > HISTORY_LENGTH) {
+            m_gc_history.erase(m_gc_history.begin());
+        }
+    }
+    
+    bool open = true;
+    ImGui::SetNextWindowSize(ImVec2(640, 480), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Profiler", &open);
+#ifndef PEGR_TRACING
+    ImGui::TextWrapped("Built without PGLOCAL_TRACING, so nothing is "
+            "traced.");
+#endif
+    ImGui::Checkbox("Pause", &m_paused);
+    ImGui::SameLine();
+    if (ImGui::RadioButton("Ticks", !m_show_frames)) {
+        m_show_frames = false;
+        m_paused = false;
+    }
+    ImGui::SameLine();
+    if (ImGui::RadioButton("Frames", m_show_frames)) {
+        m_show_frames = true;
+        m_paused = false;
+    }
+    
+    show_history();
+    if (ImGui::CollapsingHeader("Timeline", ImGuiTreeNodeFlags_DefaultOpen)) {
+        show_timeline();
+    }
+    if (ImGui::CollapsingHeader("Span totals", 
+            ImGuiTreeNodeFlags_DefaultOpen)) {
+        show_span_totals();
+    }
+    if (ImGui::CollapsingHeader("Gensys and memory")) {
+        show_gensys_stats();
+    }
+    if (ImGui::CollapsingHeader("Lua garbage collection")) {
+        show_gc_stats();
+    }
+    if (ImGui::CollapsingHeader("Lua sampling")) {
+        show_lua_profiler();
+    }
+    if (ImGui::CollapsingHeader("JIT diagnostics")) {
+        show_jit_diag();
+    }
+    ImGui::End();
+    
+    if (!open) {
+        set_open(false);
+    }
+}
+
+void Profiler_Panel::show_history() {
+    if (m_periods.empty()) {
+        ImGui::Text("Nothing recorded yet");
+        return;
+    }
+    std::size_t first = 
+            m_periods.size() - std::min(m_periods.size(), HISTORY_LENGTH);
+    std::vector<float> durations;
+    durations.reserve(m_periods.size() - first);
+    for (std::size_t idx = first; idx < m_periods.size(); ++idx) {
+        durations.push_back(ns_to_ms(
+                m_periods[idx].m_end_ns - m_periods[idx].m_begin_ns));
+    }
+    const Debug::Trace::Span& selected = m_periods[m_selected];
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "selected: %.3f ms", 
+            ns_to_ms(selected.m_end_ns - selected.m_begin_ns));
+    ImGui::PlotHistogram("##history", durations.data(), durations.size(), 
+            0, overlay, 0.f, FLT_MAX, 
+            ImVec2(ImGui::GetContentRegionAvailWidth(), 80));
+    
+    // Only paused history can be inspected, since it does not scroll away
+    if (m_paused) {
+        int selected_idx = m_selected - first;
+        if (ImGui::SliderInt("Inspect", &selected_idx, 0, 
+                durations.size() - 1)) {
+            m_selected = first + selected_idx;
+        }
+    }
+}
+
+void Profiler_Panel::show_timeline() {
+    if (m_periods.empty()) {
+        return;
+    }
+    const Debug::Trace::Span& period = m_periods[m_selected];
+    std::uint64_t begin_ns = period.m_begin_ns;
+    std::uint64_t end_ns = std::max(period.m_end_ns, begin_ns + 1);
+    
+    float width = ImGui::GetContentRegionAvailWidth();
+    float row_height = ImGui::GetTextLineHeightWithSpacing();
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    for (const Debug::Trace::Thread_Spans& thread : m_threads) {
+        std::vector<Debug::Profiler::Placed_Span> placed = 
+                Debug::Profiler::lay_out_spans(thread.m_spans, 
+                        begin_ns, end_ns);
+        if (placed.empty()) {
+            continue;
+        }
+        if (thread.m_thread_name.empty()) {
+            ImGui::Text("Thread %u", thread.m_tid);
+        } else {
+            ImGui::Text("%s", thread.m_thread_name.c_str());
+        }
+        
+        std::size_t max_depth = 0;
+        for (const Debug::Profiler::Placed_Span& entry : placed) {
+            max_depth = std::max(max_depth, entry.m_depth);
+        }
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImVec2 size(width, (max_depth + 1) * row_height);
+        draw_list->PushClipRect(origin, 
+                ImVec2(origin.x + size.x, origin.y + size.y), true);
+        for (const Debug::Profiler::Placed_Span& entry : placed) {
+            const Debug::Trace::Span& span = entry.m_span;
+            std::uint64_t span_begin = std::max(span.m_begin_ns, begin_ns);
+            std::uint64_t span_end = std::min(span.m_end_ns, end_ns);
+            ImVec2 top_left(
+                    origin.x + width * (span_begin - begin_ns) 
+                            / (end_ns - begin_ns), 
+                    origin.y + entry.m_depth * row_height);
+            ImVec2 bottom_right(
+                    std::max(top_left.x + 1.f, origin.x + width 
+                            * (span_end - begin_ns) / (end_ns - begin_ns)), 
+                    top_left.y + row_height - 1.f);
+            draw_list->AddRectFilled(top_left, bottom_right, 
+                    get_span_color(span.m_name));
+            
+            std::string label = get_span_label(span.m_name, span.m_arg);
+            draw_list->PushClipRect(top_left, bottom_right, true);
+            draw_list->AddText(ImVec2(top_left.x + 2.f, top_left.y), 
+                    IM_COL32_WHITE, label.c_str());
+            draw_list->PopClipRect();
+            if (ImGui::IsMouseHoveringRect(top_left, bottom_right)) {
+                ImGui::SetTooltip("%s\n%s\n%.3f ms", label.c_str(), 
+                        span.m_category, 
+                        ns_to_ms(span.m_end_ns - span.m_begin_ns));
+            }
+        }
+        draw_list->PopClipRect();
+        ImGui::Dummy(size);
+    }
+}
+
+void Profiler_Panel::show_span_totals() {
+    if (m_periods.empty()) {
+        return;
+    }
+    const Debug::Trace::Span& period = m_periods[m_selected];
+    std::vector<Debug::Profiler::Span_Total> totals = 
+            Debug::Profiler::total_spans(m_threads, 
+                    period.m_begin_ns, period.m_end_ns);
+    ImGui::Columns(4, "span_totals");
+    ImGui::Text("Span");
+    ImGui::NextColumn();
+    ImGui::Text("Count");
+    ImGui::NextColumn();
+    ImGui::Text("Total ms");
+    ImGui::NextColumn();
+    ImGui::Text("Max ms");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (const Debug::Profiler::Span_Total& total : totals) {
+        ImGui::Text("%s", 
+                get_span_label(total.m_name, total.m_arg).c_str());
+        ImGui::NextColumn();
+        ImGui::Text("%zu", total.m_count);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", ns_to_ms(total.m_total_ns));
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", ns_to_ms(total.m_max_ns));
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void Profiler_Panel::show_gensys_stats() {
+    // Walks every entity, so only while this section is open
+    Gensys::Runtime::Memory_Stats stats = 
+            Gensys::Runtime::get_memory_stats();
+    for (const auto& entry : stats.m_arches) {
+        ImGui::BulletText("%s: %zu entities, %zu KB", 
+                entry.first.get_repr().c_str(), entry.second.m_num_entities, 
+                entry.second.get_total_bytes() / 1024);
+    }
+    ImGui::Separator();
+    
+    ImGui::Text("Lua memory: %zu KB", stats.m_lua_bytes / 1024);
+    ImGui::Text("Cview userdata: %zu", stats.m_num_cview_userdata);
+    
+    if (Algs::are_podc_stats_counted()) {
+        Algs::Podc_Stats podc_stats = Algs::get_podc_stats();
+        ImGui::Text("Pod chunks: %zu live, %zu KB, %zu allocated ever", 
+                podc_stats.m_num_live, podc_stats.m_live_bytes / 1024, 
+                podc_stats.m_num_allocated);
+    }
+    ImGui::Text("Interned strings: %zu, %zu KB on the heap", 
+            stats.m_num_interned_strings, 
+            stats.m_interned_heap_bytes / 1024);
+}
+
+void Profiler_Panel::show_gc_stats() {
+    bool scheduled = Script::Gc_Scheduler::is_enabled();
+    if (ImGui::Checkbox("Step after frames", &scheduled)) {
+        Script::Gc_Scheduler::set_enabled(scheduled);
+    }
+    if (!scheduled) {
+        ImGui::TextWrapped("Lua collects garbage whenever it allocates.");
+        return;
+    }
+    int budget_us = Script::Gc_Scheduler::get_budget_us();
+    if (ImGui::SliderInt("Budget (us)", &budget_us, 0, MAX_GC_BUDGET_US)) {
+        Script::Gc_Scheduler::set_budget_us(budget_us);
+    }
+    
+    const Script::Gc_Scheduler::Frame_Stats& stats = 
+            Script::Gc_Scheduler::get_last_frame_stats();
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "last frame: %.3f ms", 
+            ns_to_ms(stats.get_total_ns()));
+    ImGui::PlotHistogram("##gc_history", m_gc_history.data(), 
+            m_gc_history.size(), 0, overlay, 0.f, FLT_MAX, 
+            ImVec2(ImGui::GetContentRegionAvailWidth(), 60));
+    ImGui::Text("Steps: %zu budgeted (%.3f ms), %zu emergency (%.3f ms)", 
+            stats.m_num_steps, ns_to_ms(stats.m_step_ns), 
+            stats.m_num_emergency_steps, ns_to_ms(stats.m_emergency_ns));
+    ImGui::Text("Lua memory: %zu KB, next cycle at %zu KB, "
+            "emergency at %zu KB", stats.m_lua_kb, 
+            Script::Gc_Scheduler::get_pause_threshold_kb(), 
+            Script::Gc_Scheduler::get_emergency_threshold_kb());
+}
+
+void Profiler_Panel::show_lua_profiler() {
+    if (Debug::Lua_Profiler::is_running()) {
+        if (ImGui::Button("Stop")) {
+            Debug::Lua_Profiler::stop();
+        }
+    } else if (ImGui::Button("Start")) {
+        Debug::Lua_Profiler::clear();
+        Debug::Lua_Profiler::start();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Write folded stacks")) {
+        try {
+            Debug::Lua_Profiler::dump_folded(LUA_PROFILE_FILE);
+            Logger::log()->info("Wrote Lua samples to %v", LUA_PROFILE_FILE);
+        } catch (Except::Runtime& e) {
+            Logger::log()->warn("Cannot write Lua samples: %v", e.what());
+        }
+    }
+    std::size_t num_samples = Debug::Lua_Profiler::get_num_samples();
+    ImGui::Text("%zu samples", num_samples);
+    if (num_samples == 0) {
+        return;
+    }
+    
+    // Stacks that took the most samples
+    typedef std::pair<std::size_t, const std::string*> Count_Stack;
+    std::vector<Count_Stack> stacks;
+    for (const auto& entry : Debug::Lua_Profiler::get_folded_stacks()) {
+        stacks.emplace_back(entry.second, &entry.first);
+    }
+    std::size_t num_shown = std::min(stacks.size(), MAX_LUA_STACKS_SHOWN);
+    std::partial_sort(stacks.begin(), stacks.begin() + num_shown, 
+            stacks.end(), [](const Count_Stack& a, const Count_Stack& b) {
+                return a.first > b.first;
+            });
+    for (std::size_t idx = 0; idx < num_shown; ++idx) {
+        ImGui::TextWrapped("%5.1f%% %s", 
+                100.0 * stacks[idx].first / num_samples, 
+                stacks[idx].second->c_str());
+    }
+}
+
+void Profiler_Panel::show_jit_diag() {
+    if (!Debug::Jit_Diag::is_available()) {
+        ImGui::TextWrapped("The Lua state is not LuaJIT.");
+        return;
+    }
+    bool enabled = Debug::Jit_Diag::is_enabled();
+    if (ImGui::Checkbox("Collect", &enabled)) {
+        if (enabled) {
+            Debug::Jit_Diag::clear();
+        }
+        Debug::Jit_Diag::set_enabled(enabled);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Log summary")) {
+        Debug::Jit_Diag::log_summary();
+    }
+    
+    Debug::Jit_Diag::Summary summary = Debug::Jit_Diag::get_summary();
+    ImGui::Text("Traces: %zu started, %zu completed, %zu aborted, "
+            "%zu flushes", summary.m_num_started, summary.m_num_completed,
+            summary.m_num_aborted, summary.m_num_flushes);
+    std::size_t num_shown = 
+            std::min(summary.m_aborts.size(), MAX_JIT_SITES_SHOWN);
+    for (std::size_t idx = 0; idx < num_shown; ++idx) {
+        const Debug::Jit_Diag::Abort_Site& site = summary.m_aborts[idx];
+        ImGui::BulletText("%zux at %s (from %s): %s", site.m_count, 
+                site.m_abort_loc.c_str(), site.m_start_loc.c_str(), 
+                site.m_reason.c_str());
+    }
+    if (!summary.m_blacklisted.empty()) {
+        ImGui::Separator();
+        ImGui::Text("Blacklisted:");
+        for (const std::string& loc : summary.m_blacklisted) {
+            ImGui::BulletText("%s", loc.c_str());
+        }
+    }
+    if (!summary.m_stitches.empty()) {
+        ImGui::Separator();
+        ImGui::Text("Stitched after C calls:");
+        num_shown = std::min(summary.m_stitches.size(), MAX_JIT_SITES_SHOWN);
+        for (std::size_t idx = 0; idx < num_shown; ++idx) {
+            ImGui::BulletText("%zux at %s", summary.m_stitches[idx].second, 
+                    summary.m_stitches[idx].first.c_str());
+        }
+    }
+}
+
+} // namespace App
+} // namespace pegr
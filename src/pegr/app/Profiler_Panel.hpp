@@ -0,0 +1,83 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PEGR_APP_PROFILERPANEL_HPP
+#define PEGR_APP_PROFILERPANEL_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "pegr/debug/Trace.hpp"
+
+namespace pegr {
+namespace App {
+
+/**
+ * @class Profiler_Panel
+ * @brief Debug overlay window showing recent ticks and frames from the
+ * tracing buffers. Tracing is only enabled while the panel is open, so a
+ * closed panel costs nothing. Needs a build with PGLOCAL_TRACING to show any
+ * spans.
+ */
+class Profiler_Panel {
+public:
+    /**
+     * @brief Opening starts tracing, closing stops it and throws away what
+     * was recorded. Closing also stops Lua sampling and JIT diagnostics.
+     */
+    void set_open(bool open);
+    bool is_open() const;
+    
+    /**
+     * @brief Draws the window if open. Call between Dbgui::new_frame() and 
+     * Dbgui::render().
+     */
+    void show();
+    
+private:
+    void show_history();
+    void show_timeline();
+    void show_span_totals();
+    void show_gensys_stats();
+    void show_gc_stats();
+    void show_lua_profiler();
+    void show_jit_diag();
+    
+    bool m_open = false;
+    
+    // While paused, the last snapshot is kept so it can be inspected
+    bool m_paused = false;
+    
+    // Whether to look at ticks or frames
+    bool m_show_frames = false;
+    
+    std::vector<Debug::Trace::Thread_Spans> m_threads;
+    
+    // Every tick (or frame) span in m_threads, earliest first
+    std::vector<Debug::Trace::Span> m_periods;
+    
+    // Index into m_periods. When not paused, always the latest one.
+    std::size_t m_selected = 0;
+    
+    // Milliseconds spent collecting Lua garbage in recent frames
+    std::vector<float> m_gc_history;
+};
+
+} // namespace App
+} // namespace pegr
+
+#endif // PEGR_APP_PROFILERPANEL_HPP
@@ -0,0 +1,170 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/bench/Compare.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <utility>
+
+namespace pegr {
+namespace Bench {
+
+double mann_whitney_p_value(const std::vector<double>& first, 
+        const std::vector<double>& second) {
+    if (first.empty() || second.empty()) {
+        return 1;
+    }
+    
+    // Pairs of the sample and whether it came from the first set
+    std::vector<std::pair<double, bool> > pooled;
+    pooled.reserve(first.size() + second.size());
+    for (double sample : first) {
+        pooled.emplace_back(sample, true);
+    }
+    for (double sample : second) {
+        pooled.emplace_back(sample, false);
+    }
+    std::sort(pooled.begin(), pooled.end());
+    
+    // Tied samples are all given the average of their ranks
+    double first_rank_sum = 0;
+    double tie_term = 0;
+    std::size_t begin = 0;
+    while (begin < pooled.size()) {
+        std::size_t end = begin + 1;
+        while (end < pooled.size() 
+                && pooled[end].first == pooled[begin].first) {
+            ++end;
+        }
+        double num_tied = end - begin;
+        double rank = (begin + 1 + end) / 2.0;
+        for (std::size_t idx = begin; idx < end; ++idx) {
+            if (pooled[idx].second) {
+                first_rank_sum += rank;
+            }
+        }
+        tie_term += num_tied * num_tied * num_tied - num_tied;
+        begin = end;
+    }
+    
+    double n1 = first.size();
+    double n2 = second.size();
+    double n = n1 + n2;
+    double u = first_rank_sum - n1 * (n1 + 1) / 2;
+    double mean = n1 * n2 / 2;
+    double variance = n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1)));
+    if (variance <= 0) {
+        return 1;
+    }
+    
+    // With continuity correction
+    double z = std::max(0.0, std::abs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+std::vector<Comparison> compare_results(const std::vector<Result>& base,
+        const std::vector<Result>& current, const Compare_Settings& settings) {
+    std::map<std::string, const Result*> base_by_id;
+    for (const Result& result : base) {
+        base_by_id[result.m_id] = &result;
+    }
+    
+    std::vector<Comparison> comparisons;
+    for (const Result& result : current) {
+        Comparison comp;
+        comp.m_id = result.m_id;
+        comp.m_current_median = result.m_stats.m_median;
+        auto iter = base_by_id.find(result.m_id);
+        if (iter == base_by_id.end()) {
+            comp.m_verdict = Comparison::Verdict::ADDED;
+            comparisons.push_back(comp);
+            continue;
+        }
+        const Result& old_result = *iter->second;
+        base_by_id.erase(iter);
+        
+        comp.m_base_median = old_result.m_stats.m_median;
+        if (comp.m_base_median > 0) {
+            comp.m_ratio = comp.m_current_median / comp.m_base_median;
+        }
+        comp.m_p_value = 
+                mann_whitney_p_value(old_result.m_samples, result.m_samples);
+        if (comp.m_p_value <= settings.m_alpha) {
+            if (comp.m_ratio > 1 + settings.m_min_change) {
+                comp.m_verdict = Comparison::Verdict::SLOWER;
+            } else if (comp.m_ratio < 1 - settings.m_min_change) {
+                comp.m_verdict = Comparison::Verdict::FASTER;
+            }
+        }
+        comparisons.push_back(comp);
+    }
+    
+    // Keep the order that they were run in
+    for (const Result& result : base) {
+        if (base_by_id.find(result.m_id) != base_by_id.end()) {
+            Comparison comp;
+            comp.m_id = result.m_id;
+            comp.m_base_median = result.m_stats.m_median;
+            comp.m_verdict = Comparison::Verdict::REMOVED;
+            comparisons.push_back(comp);
+        }
+    }
+    return comparisons;
+}
+
+std::size_t count_regressions(const std::vector<Comparison>& comparisons) {
+    return std::count_if(comparisons.begin(), comparisons.end(), 
+            [](const Comparison& comp) {
+                return comp.m_verdict == Comparison::Verdict::SLOWER;
+            });
+}
+
+const char* verdict_to_string(Comparison::Verdict verdict) {
+    switch (verdict) {
+        case Comparison::Verdict::SAME: return "same";
+        case Comparison::Verdict::FASTER: return "faster";
+        case Comparison::Verdict::SLOWER: return "SLOWER";
+        case Comparison::Verdict::REMOVED: return "removed";
+        case Comparison::Verdict::ADDED: return "added";
+        default: return "???";
+    }
+}
+
+void print_comparisons(std::ostream& out, 
+        const std::vector<Comparison>& comparisons) {
+    std::size_t id_width = 4;
+    for (const Comparison& comp : comparisons) {
+        id_width = std::max(id_width, comp.m_id.size());
+    }
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-*s  %14s  %14s  %8s  %8s  %s\n", 
+            static_cast<int>(id_width), "case", "base (ns)", "current (ns)", 
+            "change", "p", "verdict");
+    out << line;
+    for (const Comparison& comp : comparisons) {
+        std::snprintf(line, sizeof(line), "%14.1f  %14.1f  %+7.1f%%  %8.4f  ",
+                comp.m_base_median, comp.m_current_median, 
+                (comp.m_ratio - 1) * 100, comp.m_p_value);
+        out << comp.m_id << std::string(id_width - comp.m_id.size() + 2, ' ')
+            << line << verdict_to_string(comp.m_verdict) << '\n';
+    }
+}
+
+} // namespace Bench
+} // namespace pegr
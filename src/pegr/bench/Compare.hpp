@@ -0,0 +1,96 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_BENCH_COMPARE_HPP
+#define PEGR_BENCH_COMPARE_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "pegr/bench/Runner.hpp"
+
+namespace pegr {
+namespace Bench {
+
+struct Compare_Settings {
+    // Largest p-value at which a difference is believed
+    double m_alpha = 0.01;
+    
+    // Smallest relative change in the median worth reporting, since tiny
+    // differences can be significant but are not worth failing over
+    double m_min_change = 0.05;
+};
+
+struct Comparison {
+    enum struct Verdict {
+        SAME,
+        FASTER,
+        SLOWER,
+        
+        // Only in the baseline or only in the current results
+        REMOVED,
+        ADDED
+    };
+    
+    std::string m_id;
+    double m_base_median = 0;
+    double m_current_median = 0;
+    
+    // Current median divided by the baseline median
+    double m_ratio = 1;
+    
+    // Two-sided p-value that both sets of samples come from the same
+    // distribution
+    double m_p_value = 1;
+    
+    Verdict m_verdict = Verdict::SAME;
+};
+
+/**
+ * @brief Two-sided Mann-Whitney U test, using the normal approximation with a
+ * correction for ties. Does not assume that timings are normally distributed,
+ * which they are not (there is a long tail of slow samples).
+ * @return The p-value, or 1 if either is empty
+ */
+double mann_whitney_p_value(const std::vector<double>& first, 
+        const std::vector<double>& second);
+
+/**
+ * @brief Matches cases by id
+ * @return One comparison per case in either, in the order of current then
+ * the removed ones
+ */
+std::vector<Comparison> compare_results(const std::vector<Result>& base,
+        const std::vector<Result>& current, const Compare_Settings& settings);
+
+/**
+ * @return The number of comparisons with the verdict SLOWER
+ */
+std::size_t count_regressions(const std::vector<Comparison>& comparisons);
+
+/**
+ * @brief Writes one row per comparison, with the medians, the change and the
+ * verdict
+ */
+void print_comparisons(std::ostream& out, 
+        const std::vector<Comparison>& comparisons);
+
+} // namespace Bench
+} // namespace pegr
+
+#endif // PEGR_BENCH_COMPARE_HPP
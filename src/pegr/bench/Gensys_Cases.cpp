@@ -0,0 +1,418 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/bench/Gensys_Cases.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "pegr/except/Except.hpp"
+#include "pegr/gensys/Events.hpp"
+#include "pegr/gensys/Gensys.hpp"
+#include "pegr/gensys/Lua_Interf.hpp"
+#include "pegr/gensys/Runtime.hpp"
+#include "pegr/gensys/Snapshot.hpp"
+#include "pegr/script/Script.hpp"
+#include "pegr/script/Script_Util.hpp"
+
+namespace pegr {
+namespace Bench {
+
+// Results are added to this so that the compiler cannot remove the reads
+volatile double n_sink;
+
+const char* const DEFINITIONS = R"lua(
+pegr.add_component('position.c', {
+  x = {'f64', 0},
+  y = {'f64', 0},
+})
+
+pegr.add_component('stats.c', {
+  hp = {'f64', 10},
+  name = {'str', 'nobody'},
+})
+
+pegr.add_archetype('mover.at', {
+  position = {
+    __is = 'position.c',
+  },
+  stats = {
+    __is = 'stats.c',
+  },
+})
+
+pegr.add_archetype('rock.at', {
+  position = {
+    __is = 'position.c',
+  },
+})
+
+pegr.add_genre('living.gn', {
+  interface = {
+    hp = {'f64', nil},
+  },
+  patterns = {
+    {
+      matching = {
+        stats = 'stats.c',
+      },
+      aliases = {
+        hp = 'stats.hp',
+      },
+    },
+  },
+})
+)lua";
+
+const char* const LUA_MEMBER_READ = R"lua(
+return function(ent, count)
+  local sum = 0
+  for i = 1, count do
+    sum = sum + ent.stats.hp
+  end
+  return sum
+end
+)lua";
+
+// Only indexes the cview, without looking up the component every time
+const char* const LUA_CVIEW_READ = R"lua(
+return function(ent, count)
+  local stats = ent.stats
+  local sum = 0
+  for i = 1, count do
+    sum = sum + stats.hp
+  end
+  return sum
+end
+)lua";
+
+const char* const LUA_MEMBER_WRITE = R"lua(
+return function(ent, count)
+  for i = 1, count do
+    ent.stats.hp = i
+  end
+end
+)lua";
+
+/**
+ * @brief Compiles the Lua source in a new sandbox and runs it
+ * @param nresults Number of values to leave on the stack
+ */
+void run_source(const char* source, int nresults) {
+    lua_State* l = Script::get_lua_state();
+    if (luaL_loadstring(l, source) != 0) {
+        std::string error = lua_tostring(l, -1);
+        lua_pop(l, 1);
+        throw Except::Runtime(error);
+    }
+    Script::Unique_Regref sandbox(Script::new_sandbox());
+    Script::push_reference(sandbox.get());
+    lua_setfenv(l, -2);
+    Script::Unique_Regref func(Script::grab_unique_reference());
+    Script::Util::run_simple_function(func.get(), nresults);
+}
+
+/**
+ * @brief Throws away every entity and definition
+ */
+void reset_gensys() {
+    Gensys::cleanup();
+    Gensys::initialize();
+    Gensys::LI::clear();
+    lua_gc(Script::get_lua_state(), LUA_GCCOLLECT, 0);
+}
+
+void define_and_compile(const char* source) {
+    reset_gensys();
+    run_source(source, 0);
+    Gensys::LI::stage_all();
+    Gensys::compile();
+}
+
+Gensys::Runtime::Arche* require_arche(const char* id) {
+    Gensys::Runtime::Arche* arche = Gensys::Runtime::find_arche(id);
+    if (!arche) {
+        std::stringstream sss;
+        sss << "No archetype " << id;
+        throw Except::Runtime(sss.str());
+    }
+    return arche;
+}
+
+Gensys::Runtime::Member_Key get_member_key(Gensys::Runtime::Arche* arche,
+        const Gensys::Runtime::Symbol& comp_symb, 
+        const Gensys::Runtime::Symbol& member_symb) {
+    Gensys::Runtime::Comp* comp = arche->m_components.at(comp_symb);
+    return Gensys::Runtime::Member_Key(arche->m_comp_offsets.at(comp), 
+            comp->m_member_offsets.at(member_symb));
+}
+
+/**
+ * @brief Spawns entities alternating between movers and rocks
+ */
+std::vector<Gensys::Runtime::Entity_Handle> spawn_population(
+        std::size_t count) {
+    Gensys::Runtime::Arche* mover = require_arche("mover.at");
+    Gensys::Runtime::Arche* rock = require_arche("rock.at");
+    Gensys::Runtime::Entity_Collection& ents = 
+            Gensys::Runtime::get_entities();
+    std::vector<Gensys::Runtime::Entity_Handle> handles;
+    handles.reserve(count);
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        Gensys::Runtime::Entity_Handle handle = 
+                ents.new_entity(idx % 2 == 0 ? mover : rock);
+        handle->spawn();
+        handles.push_back(handle);
+    }
+    return handles;
+}
+
+Case make_entity_churn(std::size_t population) {
+    Case bench_case;
+    bench_case.m_name = "entity_churn";
+    bench_case.m_params["entities"] = population;
+    bench_case.m_setup = [population]() {
+        define_and_compile(DEFINITIONS);
+        spawn_population(population);
+    };
+    bench_case.m_teardown = reset_gensys;
+    bench_case.m_body = [](std::size_t iterations) {
+        Gensys::Runtime::Arche* mover = require_arche("mover.at");
+        Gensys::Runtime::Entity_Collection& ents = 
+                Gensys::Runtime::get_entities();
+        for (std::size_t idx = 0; idx < iterations; ++idx) {
+            Gensys::Runtime::Entity_Handle handle = ents.new_entity(mover);
+            handle->spawn();
+            ents.delete_entity(handle);
+        }
+    };
+    return bench_case;
+}
+
+Case make_member_cpp(bool write) {
+    Case bench_case;
+    bench_case.m_name = write ? "member_write_cpp" : "member_read_cpp";
+    auto handle = std::make_shared<Gensys::Runtime::Entity_Handle>();
+    bench_case.m_setup = [handle]() {
+        define_and_compile(DEFINITIONS);
+        *handle = spawn_population(1).front();
+    };
+    bench_case.m_teardown = reset_gensys;
+    bench_case.m_body = [handle, write](std::size_t iterations) {
+        Gensys::Runtime::Member_Key key = 
+                get_member_key(require_arche("mover.at"), "stats", "hp");
+        double sum = 0;
+        for (std::size_t idx = 0; idx < iterations; ++idx) {
+            Gensys::Runtime::Member_Ptr member = (*handle)->get_member(key);
+            if (write) {
+                member.set_value_f64(idx);
+            } else {
+                sum += member.get_value_f64();
+            }
+        }
+        n_sink = sum;
+    };
+    return bench_case;
+}
+
+/**
+ * @param source Returns a function which is given an entity and the number of
+ * iterations to run
+ */
+Case make_member_lua(const char* name, const char* source) {
+    Case bench_case;
+    bench_case.m_name = name;
+    auto handle = std::make_shared<Gensys::Runtime::Entity_Handle>();
+    auto func = std::make_shared<Script::Unique_Regref>();
+    bench_case.m_setup = [handle, func, source]() {
+        define_and_compile(DEFINITIONS);
+        *handle = spawn_population(1).front();
+        run_source(source, 1);
+        *func = Script::grab_unique_reference();
+    };
+    bench_case.m_teardown = [func]() {
+        func->reset();
+        reset_gensys();
+    };
+    bench_case.m_body = [handle, func](std::size_t iterations) {
+        lua_State* l = Script::get_lua_state();
+        Script::push_reference(func->get());
+        Gensys::LI::push_gensys_obj(l, *handle);
+        lua_pushnumber(l, iterations);
+        Script::run_function(2, 0);
+    };
+    return bench_case;
+}
+
+Case make_genre_match() {
+    Case bench_case;
+    bench_case.m_name = "genre_match";
+    auto handles = std::make_shared<
+            std::vector<Gensys::Runtime::Entity_Handle> >();
+    bench_case.m_setup = [handles]() {
+        define_and_compile(DEFINITIONS);
+        
+        // One of each, so both the matching and failing paths are timed
+        *handles = spawn_population(2);
+    };
+    bench_case.m_teardown = reset_gensys;
+    bench_case.m_body = [handles](std::size_t iterations) {
+        Gensys::Runtime::Genre* genre = 
+                Gensys::Runtime::find_genre("living.gn");
+        std::size_t num_matches = 0;
+        for (std::size_t idx = 0; idx < iterations; ++idx) {
+            Gensys::Runtime::Entity* ent = 
+                    (*handles)[idx % 2].get_volatile_entity_ptr();
+            if (genre->match(ent)) {
+                ++num_matches;
+            }
+        }
+        n_sink = num_matches;
+    };
+    return bench_case;
+}
+
+Case make_tick_dispatch(std::size_t num_listeners, std::size_t population) {
+    Case bench_case;
+    bench_case.m_name = "tick_dispatch";
+    bench_case.m_params["entities"] = population;
+    bench_case.m_params["listeners"] = num_listeners;
+    auto hooks = std::make_shared<
+            std::vector<Gensys::Event::Listener_Handle> >();
+    bench_case.m_setup = [hooks, num_listeners, population]() {
+        define_and_compile(DEFINITIONS);
+        spawn_population(population);
+        Gensys::Runtime::Arche* mover = require_arche("mover.at");
+        Gensys::Runtime::Member_Key key = 
+                get_member_key(mover, "stats", "hp");
+        for (std::size_t idx = 0; idx < num_listeners; ++idx) {
+            hooks->push_back(Gensys::Event::get_entity_tick_event()->hook(
+                    Gensys::Event::Arche_Entity_Listener(mover, 
+                    [key](Gensys::Runtime::Entity* ent) {
+                        Gensys::Runtime::Member_Ptr hp = ent->get_member(key);
+                        hp.set_value_f64(hp.get_value_f64() + 1);
+                    })));
+        }
+    };
+    bench_case.m_teardown = [hooks]() {
+        for (Gensys::Event::Listener_Handle hook : *hooks) {
+            Gensys::Event::get_entity_tick_event()->unhook(hook);
+        }
+        hooks->clear();
+        reset_gensys();
+    };
+    bench_case.m_body = [](std::size_t iterations) {
+        for (std::size_t idx = 0; idx < iterations; ++idx) {
+            Gensys::Event::get_entity_tick_event()->trigger();
+        }
+    };
+    return bench_case;
+}
+
+/**
+ * @return Definitions for the given number of components, all used by a
+ * single archetype
+ */
+std::string make_wide_definitions(std::size_t num_comps) {
+    std::stringstream sss;
+    for (std::size_t idx = 0; idx < num_comps; ++idx) {
+        sss << "pegr.add_component('c" << idx << ".c', {\n"
+            << "  x = {'f64', " << idx << "},\n"
+            << "  y = {'i32', 0},\n"
+            << "  name = {'str', 'c" << idx << "'},\n"
+            << "})\n";
+    }
+    sss << "pegr.add_archetype('wide.at', {\n";
+    for (std::size_t idx = 0; idx < num_comps; ++idx) {
+        sss << "  c" << idx << " = { __is = 'c" << idx << ".c' },\n";
+    }
+    sss << "})\n";
+    return sss.str();
+}
+
+Case make_compile(std::size_t num_comps) {
+    Case bench_case;
+    bench_case.m_name = "compile";
+    bench_case.m_params["components"] = num_comps;
+    auto source = std::make_shared<std::string>(
+            make_wide_definitions(num_comps));
+    bench_case.m_teardown = reset_gensys;
+    
+    // Includes running the definitions, since they are consumed by compiling
+    bench_case.m_body = [source](std::size_t iterations) {
+        for (std::size_t idx = 0; idx < iterations; ++idx) {
+            define_and_compile(source->c_str());
+        }
+    };
+    return bench_case;
+}
+
+Case make_snapshot(bool load, std::size_t population) {
+    Case bench_case;
+    bench_case.m_name = load ? "snapshot_load" : "snapshot_save";
+    bench_case.m_params["entities"] = population;
+    auto data = std::make_shared<std::vector<char> >();
+    bench_case.m_setup = [data, population]() {
+        define_and_compile(DEFINITIONS);
+        spawn_population(population);
+        *data = Gensys::Snapshot::write_snapshot();
+    };
+    bench_case.m_teardown = [data]() {
+        data->clear();
+        reset_gensys();
+    };
+    bench_case.m_body = [data, load](std::size_t iterations) {
+        for (std::size_t idx = 0; idx < iterations; ++idx) {
+            if (load) {
+                Gensys::Snapshot::read_snapshot(data->data(), data->size());
+            } else {
+                n_sink = Gensys::Snapshot::write_snapshot().size();
+            }
+        }
+    };
+    return bench_case;
+}
+
+std::vector<Case> get_gensys_cases() {
+    std::vector<Case> cases;
+    for (std::size_t population : {100, 10000}) {
+        cases.push_back(make_entity_churn(population));
+    }
+    cases.push_back(make_member_cpp(false));
+    cases.push_back(make_member_cpp(true));
+    cases.push_back(make_member_lua("member_read_lua", LUA_MEMBER_READ));
+    cases.push_back(make_member_lua("member_write_lua", LUA_MEMBER_WRITE));
+    cases.push_back(make_member_lua("cview_read_lua", LUA_CVIEW_READ));
+    cases.push_back(make_genre_match());
+    for (std::size_t num_listeners : {1, 10}) {
+        for (std::size_t population : {100, 10000}) {
+            cases.push_back(make_tick_dispatch(num_listeners, population));
+        }
+    }
+    for (std::size_t num_comps : {10, 100}) {
+        cases.push_back(make_compile(num_comps));
+    }
+    for (std::size_t population : {100, 10000}) {
+        cases.push_back(make_snapshot(false, population));
+        cases.push_back(make_snapshot(true, population));
+    }
+    return cases;
+}
+
+} // namespace Bench
+} // namespace pegr
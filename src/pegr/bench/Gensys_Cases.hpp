@@ -0,0 +1,37 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_BENCH_GENSYSCASES_HPP
+#define PEGR_BENCH_GENSYSCASES_HPP
+
+#include <vector>
+
+#include "pegr/bench/Runner.hpp"
+
+namespace pegr {
+namespace Bench {
+
+/**
+ * @brief Cases for the entity runtime and the compiler. Every case resets the
+ * gensys in its setup and teardown, so they can run in any order.
+ * Gensys and scheduler must be initialized.
+ */
+std::vector<Case> get_gensys_cases();
+
+} // namespace Bench
+} // namespace pegr
+
+#endif // PEGR_BENCH_GENSYSCASES_HPP
@@ -0,0 +1,143 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/bench/Lua_Interf.hpp"
+
+#include <cassert>
+#include <cstddef>
+
+#include "pegr/bench/Runner.hpp"
+#include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/except/Except.hpp"
+#include "pegr/logger/Logger.hpp"
+#include "pegr/script/Gc_Scheduler.hpp"
+
+namespace pegr {
+namespace Bench {
+namespace LI {
+
+const luaL_Reg n_api_safe[] = {
+    {"bench", li_bench},
+    
+    // End of the list
+    {nullptr, nullptr}
+};
+
+void initialize() {
+    assert(Script::is_initialized());
+    assert_balance(0);
+    Script::multi_expose_c_functions(n_api_safe);
+}
+
+/**
+ * @brief Reads an optional positive number from the settings table
+ */
+void get_setting(lua_State* l, int table_idx, const char* key, 
+        double& value) {
+    lua_getfield(l, table_idx, key);
+    Script::Pop_Guard pg(1);
+    if (lua_isnil(l, -1)) {
+        return;
+    }
+    if (!lua_isnumber(l, -1) || lua_tonumber(l, -1) < 0) {
+        luaL_error(l, "Setting %s must be a positive number", key);
+    }
+    value = lua_tonumber(l, -1);
+}
+
+void set_field(lua_State* l, const char* key, double value) {
+    lua_pushnumber(l, value);
+    lua_setfield(l, -2, key);
+}
+
+int li_bench(lua_State* l) {
+    const int ARG_NAME = 1;
+    const int ARG_FUNC = 2;
+    const int ARG_SETTINGS = 3;
+    
+    Case bench_case;
+    bench_case.m_name = luaL_checkstring(l, ARG_NAME);
+    luaL_checktype(l, ARG_FUNC, LUA_TFUNCTION);
+    
+    Settings settings;
+    if (!lua_isnoneornil(l, ARG_SETTINGS)) {
+        luaL_checktype(l, ARG_SETTINGS, LUA_TTABLE);
+        double warmup = settings.m_num_warmup;
+        double samples = settings.m_num_samples;
+        double iterations = settings.m_fixed_iterations;
+        get_setting(l, ARG_SETTINGS, "warmup", warmup);
+        get_setting(l, ARG_SETTINGS, "samples", samples);
+        get_setting(l, ARG_SETTINGS, "iterations", iterations);
+        get_setting(l, ARG_SETTINGS, "min_time", 
+                settings.m_min_sample_seconds);
+        settings.m_num_warmup = warmup;
+        settings.m_num_samples = samples;
+        settings.m_fixed_iterations = iterations;
+    }
+    luaL_argcheck(l, settings.m_num_samples > 0, ARG_SETTINGS, 
+            "Need at least one sample");
+    
+    lua_pushvalue(l, ARG_FUNC);
+    Script::Unique_Regref func = Script::grab_unique_reference();
+    Script::Regref func_ref = func.get();
+    
+    lua_State* main_l = Script::get_lua_state();
+    bench_case.m_body = [main_l, func_ref](std::size_t iterations) {
+        Script::push_reference(func_ref);
+        lua_pushnumber(main_l, iterations);
+        Script::run_function(1, 0);
+    };
+    bench_case.m_before_sample = [main_l]() {
+        lua_gc(main_l, LUA_GCRESTART, 0);
+        lua_gc(main_l, LUA_GCCOLLECT, 0);
+        lua_gc(main_l, LUA_GCSTOP, 0);
+    };
+    bench_case.m_get_allocated = [main_l]() {
+        return lua_gc(main_l, LUA_GCCOUNT, 0) * 1024.0 
+                + lua_gc(main_l, LUA_GCCOUNTB, 0);
+    };
+    bench_case.m_teardown = []() {
+        Script::Gc_Scheduler::reapply();
+    };
+    
+    Result result;
+    try {
+        result = run_case(bench_case, settings);
+    } catch (Except::Runtime& e) {
+        luaL_error(l, "%s", e.what());
+    }
+    
+    Logger::log()->info("%v: median %v ns, p99 %v ns, %v bytes (%v x %v)", 
+            result.m_name, result.m_stats.m_median, result.m_stats.m_p99,
+            result.m_allocated, result.m_samples.size(), result.m_iterations);
+    
+    lua_newtable(l);
+    lua_pushstring(l, result.m_name.c_str());
+    lua_setfield(l, -2, "name");
+    set_field(l, "iterations", result.m_iterations);
+    set_field(l, "samples", result.m_samples.size());
+    set_field(l, "min", result.m_stats.m_min);
+    set_field(l, "median", result.m_stats.m_median);
+    set_field(l, "p99", result.m_stats.m_p99);
+    set_field(l, "max", result.m_stats.m_max);
+    set_field(l, "mean", result.m_stats.m_mean);
+    set_field(l, "allocated", result.m_allocated);
+    return 1;
+}
+
+} // namespace LI
+} // namespace Bench
+} // namespace pegr
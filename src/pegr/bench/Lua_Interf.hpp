@@ -0,0 +1,55 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_BENCH_LUAINTERF_HPP
+#define PEGR_BENCH_LUAINTERF_HPP
+
+#include "pegr/script/Script.hpp"
+
+namespace pegr {
+namespace Bench {
+namespace LI {
+
+/**
+ * @brief Exposes pegr.bench(). Intended for debugging only, not game scripts.
+ */
+void initialize();
+
+/**
+ * @brief Measures a Lua function, logs a summary and returns it as a table.
+ * 
+ * Arg 1 is the name
+ * Arg 2 is the function, which is given the number of iterations to run and
+ * should loop that many times itself (calling it once per iteration from C
+ * would mostly measure the call)
+ * Arg 3 is an optional table of settings: warmup (samples thrown away),
+ * samples, min_time (seconds per sample when calibrating) and iterations
+ * (fixed iterations per sample, skipping calibration)
+ * 
+ * Garbage is collected before every sample and the collector is stopped
+ * during it, so that the memory allocated can be measured.
+ * 
+ * Returns a table with the name, iterations, samples, and min, median, p99,
+ * max and mean in nanoseconds per iteration, plus allocated (median bytes
+ * per iteration)
+ */
+int li_bench(lua_State* l);
+
+} // namespace LI
+} // namespace Bench
+} // namespace pegr
+
+#endif // PEGR_BENCH_LUAINTERF_HPP
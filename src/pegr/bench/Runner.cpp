@@ -0,0 +1,289 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/bench/Runner.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <sstream>
+
+#include "pegr/debug/Perf_Counters.hpp"
+#include "pegr/except/Except.hpp"
+
+namespace pegr {
+namespace Bench {
+
+const int JSON_FORMAT_VERSION = 1;
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    assert(!sorted.empty());
+    std::size_t rank = static_cast<std::size_t>(
+            std::ceil(fraction * sorted.size()));
+    if (rank > 0) {
+        --rank;
+    }
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+Stats compute_stats(std::vector<double> samples) {
+    Stats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    stats.m_min = samples.front();
+    stats.m_max = samples.back();
+    std::size_t mid = samples.size() / 2;
+    if (samples.size() % 2 == 0) {
+        stats.m_median = (samples[mid - 1] + samples[mid]) / 2;
+    } else {
+        stats.m_median = samples[mid];
+    }
+    stats.m_p99 = percentile(samples, 0.99);
+    stats.m_mean = std::accumulate(samples.begin(), samples.end(), 0.0) 
+            / samples.size();
+    return stats;
+}
+
+std::string Case::get_id() const {
+    std::stringstream sss;
+    sss << m_name;
+    for (const auto& param : m_params) {
+        sss << '/' << param.first << '=' << param.second;
+    }
+    return sss.str();
+}
+
+/**
+ * @param allocated If not null, set to the bytes allocated by the body
+ * @return Seconds taken to run the body the given number of times
+ */
+double time_body(const Case& bench_case, std::size_t iterations, 
+        double* allocated = nullptr) {
+    if (bench_case.m_before_sample) {
+        bench_case.m_before_sample();
+    }
+    double allocated_before = 0;
+    if (allocated && bench_case.m_get_allocated) {
+        allocated_before = bench_case.m_get_allocated();
+    }
+    auto start = std::chrono::steady_clock::now();
+    bench_case.m_body(iterations);
+    auto end = std::chrono::steady_clock::now();
+    if (allocated && bench_case.m_get_allocated) {
+        *allocated = bench_case.m_get_allocated() - allocated_before;
+    }
+    std::chrono::duration<double> diff = end - start;
+    return diff.count();
+}
+
+/**
+ * @brief Everything between setup and teardown
+ */
+Result measure_case(const Case& bench_case, const Settings& settings) {
+    Result result;
+    result.m_id = bench_case.get_id();
+    result.m_name = bench_case.m_name;
+    result.m_params = bench_case.m_params;
+    
+    // Calibrate, which also warms up a little
+    std::size_t iterations = settings.m_fixed_iterations;
+    if (iterations == 0) {
+        iterations = 1;
+        while (time_body(bench_case, iterations) 
+                        < settings.m_min_sample_seconds
+                && iterations < (std::size_t(1) << 30)) {
+            iterations *= 2;
+        }
+    }
+    result.m_iterations = iterations;
+    
+    for (std::size_t idx = 0; idx < settings.m_num_warmup; ++idx) {
+        time_body(bench_case, iterations);
+    }
+    
+    // Opening the counters is slow, so that is done outside of the samples
+    std::unique_ptr<Debug::Perf_Counters> counters;
+    Debug::Counter_Values counted;
+    if (settings.m_counters) {
+        counters = std::make_unique<Debug::Perf_Counters>();
+    }
+    
+    std::vector<double> allocated;
+    result.m_samples.reserve(settings.m_num_samples);
+    for (std::size_t idx = 0; idx < settings.m_num_samples; ++idx) {
+        if (counters) {
+            counters->start();
+        }
+        double sample_allocated = 0;
+        double seconds = 
+                time_body(bench_case, iterations, &sample_allocated);
+        if (counters) {
+            counted += counters->stop();
+        }
+        result.m_samples.push_back(seconds * 1e9 / iterations);
+        allocated.push_back(sample_allocated / iterations);
+    }
+    if (bench_case.m_get_allocated) {
+        result.m_measured_allocated = true;
+        result.m_allocated = compute_stats(allocated).m_median;
+    }
+    double total_iterations = 
+            static_cast<double>(iterations) * settings.m_num_samples;
+    for (std::size_t idx = 0; idx < Debug::NUM_COUNTERS; ++idx) {
+        if (counted.m_valid[idx] && total_iterations > 0) {
+            result.m_counters[Debug::counter_to_string(
+                    static_cast<Debug::Counter>(idx))] = 
+                    counted.m_values[idx] / total_iterations;
+        }
+    }
+    result.m_stats = compute_stats(result.m_samples);
+    return result;
+}
+
+Result run_case(const Case& bench_case, const Settings& settings) {
+    if (bench_case.m_setup) {
+        bench_case.m_setup();
+    }
+    Result result;
+    try {
+        result = measure_case(bench_case, settings);
+    }
+    catch (...) {
+        if (bench_case.m_teardown) {
+            bench_case.m_teardown();
+        }
+        throw;
+    }
+    if (bench_case.m_teardown) {
+        bench_case.m_teardown();
+    }
+    return result;
+}
+
+std::vector<Result> run_cases(const std::vector<Case>& cases, 
+        const Settings& settings, 
+        std::function<void(const Result&)> on_result) {
+    std::vector<Result> results;
+    for (const Case& bench_case : cases) {
+        if (bench_case.get_id().find(settings.m_filter) == std::string::npos) {
+            continue;
+        }
+        results.emplace_back(run_case(bench_case, settings));
+        if (on_result) {
+            on_result(results.back());
+        }
+    }
+    return results;
+}
+
+Json::Value results_to_json(const std::vector<Result>& results, 
+        const std::string& label, const Settings& settings) {
+    Json::Value json(Json::objectValue);
+    json["format"] = "pegrBench";
+    json["version"] = JSON_FORMAT_VERSION;
+    json["label"] = label;
+    json["unit"] = "ns";
+    
+    Json::Value& json_settings = json["settings"];
+    json_settings["warmup"] = Json::UInt64(settings.m_num_warmup);
+    json_settings["samples"] = Json::UInt64(settings.m_num_samples);
+    json_settings["min_sample_seconds"] = settings.m_min_sample_seconds;
+    json_settings["fixed_iterations"] = 
+            Json::UInt64(settings.m_fixed_iterations);
+    json_settings["counters"] = settings.m_counters;
+    
+    Json::Value& json_cases = json["cases"];
+    json_cases = Json::Value(Json::arrayValue);
+    for (const Result& result : results) {
+        Json::Value json_case(Json::objectValue);
+        json_case["id"] = result.m_id;
+        json_case["name"] = result.m_name;
+        Json::Value& params = json_case["params"];
+        params = Json::Value(Json::objectValue);
+        for (const auto& param : result.m_params) {
+            params[param.first] = param.second;
+        }
+        json_case["iterations"] = Json::UInt64(result.m_iterations);
+        json_case["min"] = result.m_stats.m_min;
+        json_case["median"] = result.m_stats.m_median;
+        json_case["p99"] = result.m_stats.m_p99;
+        json_case["max"] = result.m_stats.m_max;
+        json_case["mean"] = result.m_stats.m_mean;
+        if (result.m_measured_allocated) {
+            json_case["allocated"] = result.m_allocated;
+        }
+        if (!result.m_counters.empty()) {
+            Json::Value& counters = json_case["counters"];
+            for (const auto& counter : result.m_counters) {
+                counters[counter.first] = counter.second;
+            }
+        }
+        Json::Value& samples = json_case["samples"];
+        samples = Json::Value(Json::arrayValue);
+        for (double sample : result.m_samples) {
+            samples.append(sample);
+        }
+        json_cases.append(json_case);
+    }
+    return json;
+}
+
+std::vector<Result> results_from_json(const Json::Value& json) {
+    if (!json.isObject() || json["format"].asString() != "pegrBench") {
+        throw Except::Runtime("Not a pegrBench results file");
+    }
+    if (json["version"].asInt() != JSON_FORMAT_VERSION) {
+        std::stringstream sss;
+        sss << "Unsupported pegrBench results version "
+            << json["version"].asInt();
+        throw Except::Runtime(sss.str());
+    }
+    std::vector<Result> results;
+    for (const Json::Value& json_case : json["cases"]) {
+        Result result;
+        result.m_id = json_case["id"].asString();
+        result.m_name = json_case["name"].asString();
+        const Json::Value& params = json_case["params"];
+        for (const std::string& key : params.getMemberNames()) {
+            result.m_params[key] = params[key].asDouble();
+        }
+        result.m_iterations = json_case["iterations"].asUInt64();
+        if (json_case.isMember("allocated")) {
+            result.m_measured_allocated = true;
+            result.m_allocated = json_case["allocated"].asDouble();
+        }
+        const Json::Value& counters = json_case["counters"];
+        if (counters.isObject()) {
+            for (const std::string& key : counters.getMemberNames()) {
+                result.m_counters[key] = counters[key].asDouble();
+            }
+        }
+        for (const Json::Value& sample : json_case["samples"]) {
+            result.m_samples.push_back(sample.asDouble());
+        }
+        result.m_stats = compute_stats(result.m_samples);
+        results.emplace_back(std::move(result));
+    }
+    return results;
+}
+
+} // namespace Bench
+} // namespace pegr
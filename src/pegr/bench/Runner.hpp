@@ -0,0 +1,160 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_BENCH_RUNNER_HPP
+#define PEGR_BENCH_RUNNER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+namespace pegr {
+namespace Bench {
+
+struct Settings {
+    // Samples that are run but thrown away, to warm caches and the JIT
+    std::size_t m_num_warmup = 5;
+    
+    std::size_t m_num_samples = 31;
+    
+    // Iterations per sample are doubled until a sample takes this long, so
+    // that the clock's resolution does not matter
+    double m_min_sample_seconds = 0.002;
+    
+    // If not zero, every sample runs exactly this many iterations instead of
+    // calibrating, such as for operations that can only run once
+    std::size_t m_fixed_iterations = 0;
+    
+    // Only cases whose id contains this are run
+    std::string m_filter;
+    
+    // Count hardware events during the samples (see Debug::Perf_Counters)
+    bool m_counters = false;
+};
+
+/**
+ * @brief Summary of the time per iteration, in nanoseconds
+ */
+struct Stats {
+    double m_min = 0;
+    double m_median = 0;
+    double m_p99 = 0;
+    double m_max = 0;
+    double m_mean = 0;
+};
+
+/**
+ * @param samples Need not be sorted
+ * @return Statistics, all zero if there are no samples
+ */
+Stats compute_stats(std::vector<double> samples);
+
+/**
+ * @param sorted Sorted samples, not empty
+ * @param fraction Between 0 and 1
+ * @return The nearest-rank percentile
+ */
+double percentile(const std::vector<double>& sorted, double fraction);
+
+struct Case {
+    std::string m_name;
+    
+    // What this instance of a parameterized case was run with
+    std::map<std::string, double> m_params;
+    
+    // Called before warmup and after the last sample, outside of timing
+    std::function<void()> m_setup;
+    std::function<void()> m_teardown;
+    
+    // Runs the measured operation the given number of times
+    std::function<void(std::size_t)> m_body;
+    
+    // Optional, called before every run of the body outside of timing, such
+    // as to collect garbage
+    std::function<void()> m_before_sample;
+    
+    // Optional, returns the total number of bytes allocated so far, for
+    // cases that can track their allocations
+    std::function<double()> m_get_allocated;
+    
+    /**
+     * @return The name followed by every parameter, such as
+     * "tick_dispatch/entities=100/listeners=10"
+     */
+    std::string get_id() const;
+};
+
+struct Result {
+    std::string m_id;
+    std::string m_name;
+    std::map<std::string, double> m_params;
+    
+    // Iterations per sample
+    std::size_t m_iterations = 0;
+    
+    // Nanoseconds per iteration, in the order they were taken
+    std::vector<double> m_samples;
+    
+    Stats m_stats;
+    
+    // Median bytes allocated per iteration, if the case could measure it
+    bool m_measured_allocated = false;
+    double m_allocated = 0;
+    
+    // Average hardware events per iteration over all of the samples, keyed
+    // by Debug::counter_to_string(). Empty if counting was disabled or
+    // unavailable.
+    std::map<std::string, double> m_counters;
+};
+
+/**
+ * @brief Runs warmup, calibration and every sample of one case.
+ * Can throw runtime errors from the case itself, after calling its teardown.
+ */
+Result run_case(const Case& bench_case, const Settings& settings);
+
+/**
+ * @brief Runs every case that matches the filter, in order
+ * @param cases
+ * @param settings
+ * @param on_result Called after each case finishes, such as to show progress
+ */
+std::vector<Result> run_cases(const std::vector<Case>& cases, 
+        const Settings& settings, 
+        std::function<void(const Result&)> on_result = nullptr);
+
+/**
+ * @brief Results in the format read by results_from_json()
+ * @param results
+ * @param label Identifies this run, such as a commit hash
+ * @param settings
+ */
+Json::Value results_to_json(const std::vector<Result>& results, 
+        const std::string& label, const Settings& settings);
+
+/**
+ * @brief Can throw runtime errors if the JSON is not in the right format
+ */
+std::vector<Result> results_from_json(const Json::Value& json);
+
+} // namespace Bench
+} // namespace pegr
+
+#endif // PEGR_BENCH_RUNNER_HPP
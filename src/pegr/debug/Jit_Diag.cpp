@@ -0,0 +1,422 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/debug/Jit_Diag.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+#include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/logger/Logger.hpp"
+#include "pegr/script/Script.hpp"
+
+namespace pegr {
+namespace Debug {
+namespace Jit_Diag {
+
+// Messages for LuaJIT 2.1's trace error numbers (lj_traceerr.h), since
+// jit.vmdef is usually not installed. "%d" and "%s" stand for the extra info
+// that comes with the error.
+const char* const TRACE_ERRORS[] = {
+    "error thrown or hook called during recording",
+    "trace too short",
+    "trace too long",
+    "trace too deep",
+    "too many snapshots",
+    "blacklisted",
+    "retry recording",
+    "NYI: bytecode %d",
+    "leaving loop in root trace",
+    "inner loop in root trace",
+    "loop unroll limit reached",
+    "bad argument type",
+    "JIT compilation disabled for function",
+    "call unroll limit reached",
+    "down-recursion, restarting",
+    "NYI: unsupported variant of FastFunc %s",
+    "NYI: return to lower frame",
+    "store with nil or NaN key",
+    "missing metamethod",
+    "looping index lookup",
+    "NYI: mixed sparse/dense table",
+    "symbol not in cache",
+    "NYI: unsupported C type conversion",
+    "NYI: unsupported C function type",
+    "guard would always fail",
+    "too many PHIs",
+    "persistent type instability",
+    "failed to allocate mcode memory",
+    "machine code too long",
+    "hit mcode limit (retrying)",
+    "too many spill slots",
+    "inconsistent register allocation",
+    "NYI: cannot assemble IR instruction %d",
+    "NYI: PHI shuffling too complex",
+    "NYI: register coalescing too complex",
+};
+const int NUM_TRACE_ERRORS = sizeof(TRACE_ERRORS) / sizeof(TRACE_ERRORS[0]);
+
+// Used to find the opcodes that LuaJIT's bytecode numbering puts the loop 
+// instructions at
+const char* const OPCODE_PROBE = "return function() for i = 1, 2 do end end";
+
+bool n_enabled = false;
+Script::Regref n_callback;
+
+// Opcodes that loops and functions are patched to when blacklisted
+std::vector<int> n_blacklisted_opcodes;
+
+std::size_t n_num_started = 0;
+std::size_t n_num_completed = 0;
+std::size_t n_num_aborted = 0;
+std::size_t n_num_flushes = 0;
+
+// Key: start location, abort location, reason
+std::map<std::tuple<std::string, std::string, std::string>, std::size_t> 
+        n_aborts;
+std::set<std::string> n_blacklisted;
+std::map<std::string, std::size_t> n_stitches;
+
+// About the trace being recorded
+std::string n_start_loc;
+int n_start_pc = 0;
+bool n_start_is_root = false;
+
+// Registry key for the function that the trace being recorded started in
+// (PIL 28.5 encourages using lightuserdata as keys)
+char n_start_func_key;
+
+/**
+ * @brief Pushes a field of require("jit.util"), or nil. LuaJIT only
+ * preloads jit.util, so it has to be required.
+ * [+1]
+ */
+void push_jit_util_func(lua_State* l, const char* name) {
+    lua_getglobal(l, "require"); // +1
+    lua_pushstring(l, "jit.util"); // +1
+    if (lua_pcall(l, 1, 1, 0) != 0 || !lua_istable(l, -1)) { // -2 +1
+        lua_pop(l, 1); // -1
+        lua_pushnil(l); // +1
+        return;
+    }
+    lua_getfield(l, -1, name); // +1
+    lua_remove(l, -2); // -1
+}
+
+/**
+ * @brief Pushes jit.attach, or nil
+ * [+1]
+ */
+void push_jit_attach(lua_State* l) {
+    lua_getglobal(l, "jit"); // +1
+    if (!lua_istable(l, -1)) {
+        return;
+    }
+    lua_getfield(l, -1, "attach"); // +1
+    lua_remove(l, -2); // -1
+}
+
+/**
+ * @brief Describes a position in a function, using jit.util.funcinfo()
+ * @param func_idx Stack index of the function
+ * @param pc_idx Stack index of the bytecode position, or zero for none
+ */
+std::string get_location(lua_State* l, int func_idx, int pc_idx) {
+    assert_balance(0);
+    func_idx = Script::absolute_idx(func_idx);
+    pc_idx = pc_idx ? Script::absolute_idx(pc_idx) : 0;
+    if (!lua_isfunction(l, func_idx)) {
+        return "?";
+    }
+    push_jit_util_func(l, "funcinfo"); // +1
+    lua_pushvalue(l, func_idx); // +1
+    if (pc_idx) {
+        lua_pushvalue(l, pc_idx); // +1
+    } else {
+        lua_pushnil(l); // +1
+    }
+    if (lua_pcall(l, 2, 1, 0) != 0 || !lua_istable(l, -1)) { // -3 +1
+        lua_pop(l, 1); // -1
+        return "?";
+    }
+    std::string location = "[C]";
+    lua_getfield(l, -1, "loc"); // +1
+    lua_getfield(l, -2, "ffid"); // +1
+    if (lua_isstring(l, -2)) {
+        location = lua_tostring(l, -2);
+    } else if (lua_isnumber(l, -1)) {
+        std::stringstream sss;
+        sss << "[builtin#" << lua_tointeger(l, -1) << ']';
+        location = sss.str();
+    }
+    lua_pop(l, 3); // -3
+    return location;
+}
+
+/**
+ * @brief Turns an error number and its info into a message
+ */
+std::string get_reason(lua_State* l, int err_idx, int info_idx) {
+    if (lua_type(l, err_idx) != LUA_TNUMBER) {
+        const char* str = lua_tostring(l, err_idx);
+        return str ? str : "?";
+    }
+    int err = lua_tointeger(l, err_idx);
+    if (err < 0 || err >= NUM_TRACE_ERRORS) {
+        std::stringstream sss;
+        sss << "trace error #" << err;
+        return sss.str();
+    }
+    std::string reason = TRACE_ERRORS[err];
+    std::string info;
+    if (lua_isfunction(l, info_idx)) {
+        info = get_location(l, info_idx, 0);
+    } else if (lua_isnumber(l, info_idx)) {
+        std::stringstream sss;
+        sss << lua_tointeger(l, info_idx);
+        info = sss.str();
+    } else if (lua_isstring(l, info_idx)) {
+        info = lua_tostring(l, info_idx);
+    }
+    for (const char* spec : {"%d", "%s"}) {
+        std::size_t pos = reason.find(spec);
+        if (pos != std::string::npos) {
+            reason.replace(pos, 2, info);
+        }
+    }
+    return reason;
+}
+
+/**
+ * @brief Gets the opcode of the instruction at the start of the trace being
+ * recorded, or -1
+ */
+int get_start_opcode(lua_State* l) {
+    assert_balance(0);
+    push_jit_util_func(l, "funcbc"); // +1
+    lua_pushlightuserdata(l, &n_start_func_key); // +1
+    lua_rawget(l, LUA_REGISTRYINDEX); // -1 +1
+    lua_pushinteger(l, n_start_pc); // +1
+    if (lua_pcall(l, 2, 1, 0) != 0 || !lua_isnumber(l, -1)) { // -3 +1
+        lua_pop(l, 1); // -1
+        return -1;
+    }
+    int opcode = static_cast<int>(lua_tonumber(l, -1)) & 0xff;
+    lua_pop(l, 1); // -1
+    return opcode;
+}
+
+/**
+ * @brief Callback for jit.attach(). Arguments depend on the event:
+ * "start", trace number, function, pc, parent trace, parent exit
+ * "stop", trace number, function
+ * "abort", trace number, function, pc, error number, error info
+ * "flush"
+ */
+int li_trace_event(lua_State* l) {
+    const char* what = lua_tostring(l, 1);
+    if (!what) {
+        return 0;
+    }
+    if (std::strcmp(what, "start") == 0) {
+        ++n_num_started;
+        n_start_loc = get_location(l, 3, 4);
+        n_start_pc = lua_tointeger(l, 4);
+        n_start_is_root = lua_isnoneornil(l, 5);
+        lua_pushlightuserdata(l, &n_start_func_key);
+        lua_pushvalue(l, 3);
+        lua_rawset(l, LUA_REGISTRYINDEX);
+        
+        // Side traces made by stitching have -1 for the parent exit
+        if (!n_start_is_root && lua_tonumber(l, 6) == -1) {
+            ++n_stitches[n_start_loc];
+        }
+    } else if (std::strcmp(what, "stop") == 0) {
+        ++n_num_completed;
+    } else if (std::strcmp(what, "abort") == 0) {
+        ++n_num_aborted;
+        ++n_aborts[std::make_tuple(n_start_loc, get_location(l, 3, 4), 
+                get_reason(l, 5, 6))];
+        
+        // LuaJIT patches the starting instruction before sending this event
+        if (n_start_is_root) {
+            int opcode = get_start_opcode(l);
+            if (std::find(n_blacklisted_opcodes.begin(), 
+                    n_blacklisted_opcodes.end(), opcode) 
+                    != n_blacklisted_opcodes.end()) {
+                n_blacklisted.insert(n_start_loc);
+            }
+        }
+    } else if (std::strcmp(what, "flush") == 0) {
+        ++n_num_flushes;
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the opcodes of blacklisted loops and functions. LuaJIT 
+ * always numbers them right after the normal versions: FORL, IFORL, JFORL,
+ * ITERL, IITERL, JITERL, LOOP, ILOOP, JLOOP, JMP, FUNCF, IFUNCF, JFUNCF, 
+ * FUNCV, IFUNCV, JFUNCV
+ */
+void find_blacklisted_opcodes(lua_State* l) {
+    assert_balance(0);
+    n_blacklisted_opcodes.clear();
+    if (luaL_loadstring(l, OPCODE_PROBE) != 0 
+            || lua_pcall(l, 0, 1, 0) != 0) { // +1
+        lua_pop(l, 1); // -1
+        return;
+    }
+    
+    // The probe ends with FORL, RET0
+    int opcodes[2] = {-1, -1};
+    int funcf = -1;
+    for (int pc = 0; /* Until funcbc returns nothing */; ++pc) {
+        push_jit_util_func(l, "funcbc"); // +1
+        lua_pushvalue(l, -2); // +1
+        lua_pushinteger(l, pc); // +1
+        if (lua_pcall(l, 2, 1, 0) != 0 || !lua_isnumber(l, -1)) { // -3 +1
+            lua_pop(l, 1); // -1
+            break;
+        }
+        int opcode = static_cast<int>(lua_tonumber(l, -1)) & 0xff;
+        lua_pop(l, 1); // -1
+        if (pc == 0) {
+            funcf = opcode;
+        } else {
+            opcodes[0] = opcodes[1];
+            opcodes[1] = opcode;
+        }
+    }
+    lua_pop(l, 1); // -1
+    
+    int forl = opcodes[0];
+    if (forl < 0 || funcf < 0) {
+        Logger::log()->warn("Cannot find LuaJIT loop opcodes");
+        return;
+    }
+    n_blacklisted_opcodes = {forl + 1, forl + 4, forl + 7, funcf + 1, 
+            funcf + 4};
+}
+
+bool is_available() {
+    assert_balance(0);
+    lua_State* l = Script::get_lua_state();
+    push_jit_attach(l); // +1
+    push_jit_util_func(l, "funcinfo"); // +1
+    bool available = lua_isfunction(l, -1) && lua_isfunction(l, -2);
+    lua_pop(l, 2); // -2
+    return available;
+}
+
+bool set_enabled(bool enabled) {
+    assert_balance(0);
+    if (enabled == n_enabled) {
+        return n_enabled;
+    }
+    lua_State* l = Script::get_lua_state();
+    if (enabled) {
+        if (!is_available()) {
+            return false;
+        }
+        if (n_blacklisted_opcodes.empty()) {
+            find_blacklisted_opcodes(l);
+        }
+        lua_pushcfunction(l, li_trace_event); // +1
+        n_callback = Script::grab_reference(); // -1
+        push_jit_attach(l); // +1
+        Script::push_reference(n_callback); // +1
+        lua_pushstring(l, "trace"); // +1
+        Script::run_function(2, 0); // -3
+    } else {
+        // Attaching without an event detaches
+        push_jit_attach(l); // +1
+        Script::push_reference(n_callback); // +1
+        Script::run_function(1, 0); // -2
+        Script::drop_reference(n_callback);
+        lua_pushlightuserdata(l, &n_start_func_key); // +1
+        lua_pushnil(l); // +1
+        lua_rawset(l, LUA_REGISTRYINDEX); // -2
+    }
+    n_enabled = enabled;
+    return n_enabled;
+}
+
+bool is_enabled() {
+    return n_enabled;
+}
+
+void clear() {
+    n_num_started = 0;
+    n_num_completed = 0;
+    n_num_aborted = 0;
+    n_num_flushes = 0;
+    n_aborts.clear();
+    n_blacklisted.clear();
+    n_stitches.clear();
+}
+
+Summary get_summary() {
+    Summary summary;
+    summary.m_num_started = n_num_started;
+    summary.m_num_completed = n_num_completed;
+    summary.m_num_aborted = n_num_aborted;
+    summary.m_num_flushes = n_num_flushes;
+    for (const auto& entry : n_aborts) {
+        summary.m_aborts.push_back({std::get<0>(entry.first), 
+                std::get<1>(entry.first), std::get<2>(entry.first), 
+                entry.second});
+    }
+    std::stable_sort(summary.m_aborts.begin(), summary.m_aborts.end(), 
+            [](const Abort_Site& a, const Abort_Site& b) {
+                return a.m_count > b.m_count;
+            });
+    summary.m_blacklisted.assign(n_blacklisted.begin(), n_blacklisted.end());
+    summary.m_stitches.assign(n_stitches.begin(), n_stitches.end());
+    std::stable_sort(summary.m_stitches.begin(), summary.m_stitches.end(), 
+            [](const std::pair<std::string, std::size_t>& a, 
+                    const std::pair<std::string, std::size_t>& b) {
+                return a.second > b.second;
+            });
+    return summary;
+}
+
+void log_summary() {
+    Summary summary = get_summary();
+    Logger::log()->info("JIT traces: %v started, %v completed, %v aborted, "
+            "%v flushes", summary.m_num_started, summary.m_num_completed, 
+            summary.m_num_aborted, summary.m_num_flushes);
+    for (const Abort_Site& site : summary.m_aborts) {
+        Logger::log()->info("\t%vx abort at %v (trace from %v): %v", 
+                site.m_count, site.m_abort_loc, site.m_start_loc, 
+                site.m_reason);
+    }
+    for (const std::string& loc : summary.m_blacklisted) {
+        Logger::log()->info("\tBlacklisted: %v", loc);
+    }
+    for (const auto& entry : summary.m_stitches) {
+        Logger::log()->info("\t%vx stitched at %v", entry.second, 
+                entry.first);
+    }
+}
+
+} // namespace Jit_Diag
+} // namespace Debug
+} // namespace pegr
@@ -0,0 +1,97 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_DEBUG_JITDIAG_HPP
+#define PEGR_DEBUG_JITDIAG_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Opt-in LuaJIT trace diagnostics, collected through jit.attach() and 
+ * jit.util. Shows which loops and functions the JIT gives up on, why, and 
+ * where, e.g. when a loop calls into an engine API function that cannot be
+ * compiled. Does nothing when the main Lua state is not LuaJIT.
+ */
+
+namespace pegr {
+namespace Debug {
+namespace Jit_Diag {
+
+/**
+ * @brief Trace aborts that happened in the same way
+ */
+struct Abort_Site {
+    // Where the trace started recording, as "chunkname:line"
+    std::string m_start_loc;
+    
+    // Where recording stopped
+    std::string m_abort_loc;
+    
+    std::string m_reason;
+    std::size_t m_count;
+};
+
+struct Summary {
+    std::size_t m_num_started = 0;
+    std::size_t m_num_completed = 0;
+    std::size_t m_num_aborted = 0;
+    std::size_t m_num_flushes = 0;
+    
+    // Most frequent first
+    std::vector<Abort_Site> m_aborts;
+    
+    // Locations of loops and functions that LuaJIT stopped trying to 
+    // compile after aborting too often
+    std::vector<std::string> m_blacklisted;
+    
+    // Locations where a trace was continued after calling a C function that
+    // cannot be compiled (LuaJIT 2.1 "trace stitching"), and how often
+    std::vector<std::pair<std::string, std::size_t> > m_stitches;
+};
+
+/**
+ * @return If the JIT compiler can be inspected
+ */
+bool is_available();
+
+/**
+ * @brief Starts or stops collecting. Collected events are kept until clear().
+ * [BALANCED]
+ * @return Whether diagnostics are now enabled. Always false if not 
+ * is_available()
+ */
+bool set_enabled(bool enabled);
+bool is_enabled();
+
+/**
+ * @brief Throws away everything collected
+ */
+void clear();
+
+Summary get_summary();
+
+/**
+ * @brief Logs the summary, with the most frequent aborts first
+ */
+void log_summary();
+
+} // namespace Jit_Diag
+} // namespace Debug
+} // namespace pegr
+
+#endif // PEGR_DEBUG_JITDIAG_HPP
@@ -0,0 +1,239 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "pegr/debug/Lua_Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/except/Except.hpp"
+
+namespace pegr {
+namespace Debug {
+namespace Lua_Profiler {
+
+// Deeper frames are left out
+const int MAX_DEPTH = 64;
+
+// How often the count hook checks the clock
+const int HOOK_INSTRUCTIONS = 500;
+
+// Key: source and line where the function is defined
+std::unordered_map<std::string, std::string> n_labels;
+
+std::map<std::string, std::size_t> n_folded_stacks;
+std::size_t n_num_samples = 0;
+bool n_running = false;
+
+// Only used by the count hook
+std::chrono::steady_clock::duration n_interval;
+std::chrono::steady_clock::time_point n_next_sample;
+
+std::string get_label_key(const char* source, int linedefined) {
+    std::stringstream sss;
+    sss << source << ':' << linedefined;
+    return sss.str();
+}
+
+void set_function_label(Script::Regref func, const std::string& label) {
+    assert_balance(0);
+    lua_State* l = Script::get_lua_state();
+    Script::push_reference(func); // +1
+    if (!lua_isfunction(l, -1)) {
+        lua_pop(l, 1); // -1
+        return;
+    }
+    lua_Debug ar;
+    lua_getinfo(l, ">S", &ar); // -1
+    if (ar.what[0] == 'C') {
+        return;
+    }
+    n_labels[get_label_key(ar.source, ar.linedefined)] = label;
+}
+
+void clear_function_labels() {
+    n_labels.clear();
+}
+
+/**
+ * @brief Frame names cannot contain the separators of the folded format
+ */
+void append_frame_name(std::string& stack, const std::string& name) {
+    if (!stack.empty()) {
+        stack.push_back(';');
+    }
+    for (char c : name) {
+        stack.push_back(c == ';' || c == '\n' || c == '\r' ? ',' : c);
+    }
+}
+
+std::string get_frame_name(const lua_Debug& ar) {
+    std::stringstream sss;
+    if (ar.what[0] == 'C') {
+        sss << "[C]";
+        if (ar.name) {
+            sss << ' ' << ar.name;
+        }
+        return sss.str();
+    }
+    auto iter = n_labels.find(get_label_key(ar.source, ar.linedefined));
+    if (iter != n_labels.end()) {
+        sss << iter->second << ' ';
+    }
+    sss << ar.short_src << ':' << ar.linedefined;
+    return sss.str();
+}
+
+/**
+ * @brief Records the stack of the running Lua code
+ * @param l The state (or coroutine) that is running
+ * @param weight How many samples to count this as
+ * @param vm_state LuaJIT's VM state, or zero if unknown
+ */
+void take_sample(lua_State* l, std::size_t weight, int vm_state) {
+    std::vector<lua_Debug> frames;
+    lua_Debug ar;
+    for (int level = 0; level < MAX_DEPTH && lua_getstack(l, level, &ar); 
+            ++level) {
+        lua_getinfo(l, "Sln", &ar);
+        frames.push_back(ar);
+    }
+    
+    // Outermost first
+    std::string stack;
+    for (auto iter = frames.rbegin(); iter != frames.rend(); ++iter) {
+        append_frame_name(stack, get_frame_name(*iter));
+    }
+    if (!frames.empty() && frames.front().what[0] != 'C' 
+            && frames.front().currentline > 0) {
+        std::stringstream sss;
+        sss << frames.front().short_src << ':' 
+            << frames.front().currentline;
+        append_frame_name(stack, sss.str());
+    }
+    if (vm_state == 'G') {
+        append_frame_name(stack, "[GC]");
+    } else if (vm_state == 'J') {
+        append_frame_name(stack, "[JIT compiler]");
+    }
+    if (stack.empty()) {
+        stack = "[no Lua]";
+    }
+    n_folded_stacks[stack] += weight;
+    n_num_samples += weight;
+}
+
+#if defined(LUAJIT_VERSION_NUM) && LUAJIT_VERSION_NUM >= 20100
+
+void profile_callback(void* data, lua_State* l, int samples, int vm_state) {
+    take_sample(l, samples, vm_state);
+}
+
+void start_sampling(lua_State* l, double interval_seconds) {
+    // Interval in whole milliseconds
+    int interval_ms = std::max(1, 
+            static_cast<int>(std::lround(interval_seconds * 1e3)));
+    std::stringstream mode;
+    mode << "li" << interval_ms;
+    luaJIT_profile_start(l, mode.str().c_str(), profile_callback, nullptr);
+}
+
+void stop_sampling(lua_State* l) {
+    luaJIT_profile_stop(l);
+}
+
+#else
+
+void count_hook(lua_State* l, lua_Debug* ar) {
+    std::chrono::steady_clock::time_point now = 
+            std::chrono::steady_clock::now();
+    if (now < n_next_sample) {
+        return;
+    }
+    n_next_sample = now + n_interval;
+    take_sample(l, 1, 0);
+}
+
+void start_sampling(lua_State* l, double interval_seconds) {
+    n_interval = std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(interval_seconds));
+    n_next_sample = std::chrono::steady_clock::now() + n_interval;
+    lua_sethook(l, count_hook, LUA_MASKCOUNT, HOOK_INSTRUCTIONS);
+}
+
+void stop_sampling(lua_State* l) {
+    lua_sethook(l, nullptr, 0, 0);
+}
+
+#endif
+
+void start(double interval_seconds) {
+    if (n_running) {
+        return;
+    }
+    start_sampling(Script::get_lua_state(), interval_seconds);
+    n_running = true;
+}
+
+void stop() {
+    if (!n_running) {
+        return;
+    }
+    stop_sampling(Script::get_lua_state());
+    n_running = false;
+}
+
+bool is_running() {
+    return n_running;
+}
+
+void clear() {
+    n_folded_stacks.clear();
+    n_num_samples = 0;
+}
+
+std::size_t get_num_samples() {
+    return n_num_samples;
+}
+
+const std::map<std::string, std::size_t>& get_folded_stacks() {
+    return n_folded_stacks;
+}
+
+std::size_t dump_folded(const boost::filesystem::path& file) {
+    std::ofstream fs(file.string().c_str());
+    if (!fs) {
+        std::stringstream ess;
+        ess << "Cannot open " << file << " for writing";
+        throw Except::Runtime(ess.str());
+    }
+    for (const auto& entry : n_folded_stacks) {
+        fs << entry.first << ' ' << entry.second << '\n';
+    }
+    return n_folded_stacks.size();
+}
+
+} // namespace Lua_Profiler
+} // namespace Debug
+} // namespace pegr
@@ -0,0 +1,96 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PEGR_DEBUG_LUAPROFILER_HPP
+#define PEGR_DEBUG_LUAPROFILER_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "pegr/script/Script.hpp"
+
+/* Sampling profiler for the main Lua state. Every sample records the Lua
+ * call stack, which is kept in the "folded" format read by flamegraph.pl and
+ * speedscope: one line per unique stack, frames separated by semicolons,
+ * followed by the number of samples.
+ * 
+ * Lua functions are named by where they are defined, and by the gensys
+ * member that they were compiled into, if any (see set_function_label()).
+ * The innermost Lua frame is followed by the line that was running.
+ */
+
+namespace pegr {
+namespace Debug {
+namespace Lua_Profiler {
+
+/**
+ * @brief Names a Lua function in samples, e.g. after the component member
+ * that holds it. Functions are identified by where they are defined, so 
+ * this also names every other closure made from the same source.
+ * [BALANCED]
+ * @param func Reference to the function. Does nothing for C functions.
+ * @param label Name, such as "stats.c.on_eaten"
+ */
+void set_function_label(Script::Regref func, const std::string& label);
+void clear_function_labels();
+
+/**
+ * @brief Starts taking samples. With LuaJIT 2.1, its built-in profiler is
+ * used, which also samples JIT-compiled code. Otherwise, a count hook 
+ * checks the clock every few hundred instructions, which only sees
+ * interpreted code.
+ * @param interval_seconds Time between samples (LuaJIT rounds this to
+ * whole milliseconds)
+ */
+void start(double interval_seconds = 1e-3);
+
+/**
+ * @brief Stops taking samples. Samples taken are kept until clear().
+ */
+void stop();
+
+bool is_running();
+
+/**
+ * @brief Throws away all samples
+ */
+void clear();
+
+/**
+ * @return Number of samples taken since the last clear()
+ */
+std::size_t get_num_samples();
+
+/**
+ * @return Number of samples of each unique stack (in the folded format)
+ */
+const std::map<std::string, std::size_t>& get_folded_stacks();
+
+/**
+ * @brief Writes the folded stacks to a file. Can throw runtime errors.
+ * @return Number of lines written
+ */
+std::size_t dump_folded(const boost::filesystem::path& file);
+
+} // namespace Lua_Profiler
+} // namespace Debug
+} // namespace pegr
+
+#endif // PEGR_DEBUG_LUAPROFILER_HPP
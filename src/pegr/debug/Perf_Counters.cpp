@@ -0,0 +1,206 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/debug/Perf_Counters.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cassert>
+#include <cstring>
+
+#include "pegr/logger/Logger.hpp"
+
+namespace pegr {
+namespace Debug {
+
+const char* counter_to_string(Counter counter) {
+    switch (counter) {
+        case Counter::CYCLES: return "cycles";
+        case Counter::INSTRUCTIONS: return "instructions";
+        case Counter::L1D_MISSES: return "l1d_misses";
+        case Counter::LLC_MISSES: return "llc_misses";
+        case Counter::BRANCH_MISSES: return "branch_misses";
+        default: return "???";
+    }
+}
+
+std::uint64_t Counter_Values::get(Counter counter) const {
+    return m_values[static_cast<std::size_t>(counter)];
+}
+bool Counter_Values::is_valid(Counter counter) const {
+    return m_valid[static_cast<std::size_t>(counter)];
+}
+
+Counter_Values& Counter_Values::operator +=(const Counter_Values& rhs) {
+    for (std::size_t idx = 0; idx < NUM_COUNTERS; ++idx) {
+        m_values[idx] += rhs.m_values[idx];
+        m_valid[idx] = m_valid[idx] || rhs.m_valid[idx];
+    }
+    return *this;
+}
+
+#ifdef __linux__
+
+void set_event_config(Counter counter, perf_event_attr& attr) {
+    switch (counter) {
+        case Counter::CYCLES: {
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        }
+        case Counter::INSTRUCTIONS: {
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        }
+        case Counter::L1D_MISSES: {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D 
+                    | (PERF_COUNT_HW_CACHE_OP_READ << 8) 
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        }
+        case Counter::LLC_MISSES: {
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        }
+        case Counter::BRANCH_MISSES: {
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        }
+        default: {
+            assert(false && "Invalid counter");
+        }
+    }
+}
+
+int open_counter(Counter counter) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    set_event_config(counter, attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED 
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    
+    // This thread only, on any CPU
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+Perf_Counters::Perf_Counters() {
+    bool any_failed = false;
+    for (std::size_t idx = 0; idx < NUM_COUNTERS; ++idx) {
+        m_fds[idx] = open_counter(static_cast<Counter>(idx));
+        any_failed = any_failed || m_fds[idx] < 0;
+    }
+    if (any_failed) {
+        Logger::log()->verbose(1, "Some hardware counters are unavailable");
+    }
+}
+
+Perf_Counters::~Perf_Counters() {
+    for (int fd : m_fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool Perf_Counters::is_available() const {
+    for (int fd : m_fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Perf_Counters::start() {
+    for (int fd : m_fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+Counter_Values Perf_Counters::stop() {
+    Counter_Values retval;
+    for (int fd : m_fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (std::size_t idx = 0; idx < NUM_COUNTERS; ++idx) {
+        if (m_fds[idx] < 0) {
+            continue;
+        }
+        
+        // Value, time enabled, time running
+        std::uint64_t data[3];
+        if (read(m_fds[idx], data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+        if (data[2] == 0) {
+            // Never got a turn on the hardware
+            continue;
+        }
+        if (data[2] < data[1]) {
+            data[0] = static_cast<std::uint64_t>(
+                    static_cast<double>(data[0]) * data[1] / data[2]);
+        }
+        retval.m_values[idx] = data[0];
+        retval.m_valid[idx] = true;
+    }
+    return retval;
+}
+
+#else
+
+// perf_event_open() is Linux-only, so elsewhere no counter is ever available
+
+Perf_Counters::Perf_Counters() {
+    for (std::size_t idx = 0; idx < NUM_COUNTERS; ++idx) {
+        m_fds[idx] = -1;
+    }
+    Logger::log()->verbose(1, "Hardware counters need Linux");
+}
+
+Perf_Counters::~Perf_Counters() {}
+
+bool Perf_Counters::is_available() const {
+    return false;
+}
+
+void Perf_Counters::start() {}
+
+Counter_Values Perf_Counters::stop() {
+    return Counter_Values();
+}
+
+#endif // __linux__
+
+} // namespace Debug
+} // namespace pegr
@@ -0,0 +1,99 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_DEBUG_PERFCOUNTERS_HPP
+#define PEGR_DEBUG_PERFCOUNTERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pegr {
+namespace Debug {
+
+/**
+ * @brief Hardware events counted by Perf_Counters
+ */
+enum struct Counter {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    
+    ENUM_SIZE /*Number of valid enum values*/
+};
+
+const std::size_t NUM_COUNTERS = static_cast<std::size_t>(Counter::ENUM_SIZE);
+
+/**
+ * @return A short lowercase name, such as "llc_misses", used in JSON output
+ */
+const char* counter_to_string(Counter counter);
+
+struct Counter_Values {
+    std::uint64_t m_values[NUM_COUNTERS] = {};
+    
+    // False if that counter could not be opened
+    bool m_valid[NUM_COUNTERS] = {};
+    
+    std::uint64_t get(Counter counter) const;
+    bool is_valid(Counter counter) const;
+    
+    Counter_Values& operator +=(const Counter_Values& rhs);
+};
+
+/**
+ * @class Perf_Counters
+ * @brief Counts hardware events on the calling thread using 
+ * perf_event_open(), excluding time spent in the kernel. Counters that the
+ * machine or its permissions (/proc/sys/kernel/perf_event_paranoid) do not
+ * allow are skipped; if none are allowed, start() and stop() do nothing and
+ * every value is invalid. The same goes for every counter on platforms other
+ * than Linux.
+ */
+class Perf_Counters {
+public:
+    Perf_Counters();
+    ~Perf_Counters();
+    
+    Perf_Counters(const Perf_Counters& rhs) = delete;
+    Perf_Counters& operator =(const Perf_Counters& rhs) = delete;
+    
+    /**
+     * @return If at least one counter could be opened
+     */
+    bool is_available() const;
+    
+    /**
+     * @brief Resets and then starts every counter
+     */
+    void start();
+    
+    /**
+     * @brief Stops every counter
+     * @return Events since start(), scaled up if the kernel had to share the
+     * hardware with other counters
+     */
+    Counter_Values stop();
+    
+private:
+    int m_fds[NUM_COUNTERS];
+};
+
+} // namespace Debug
+} // namespace pegr
+
+#endif // PEGR_DEBUG_PERFCOUNTERS_HPP
@@ -0,0 +1,118 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "pegr/debug/Profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace pegr {
+namespace Debug {
+namespace Profiler {
+
+/**
+ * @brief Names are usually string literals, but the same literal in two
+ * translation units is not guaranteed to have the same address
+ */
+bool same_name(const char* a, const char* b) {
+    return a == b || std::strcmp(a, b) == 0;
+}
+
+std::vector<Span_Total> total_spans(
+        const std::vector<Trace::Thread_Spans>& threads, 
+        std::uint64_t begin_ns, std::uint64_t end_ns) {
+    std::vector<Span_Total> totals;
+    for (const Trace::Thread_Spans& thread : threads) {
+        for (const Trace::Span& span : thread.m_spans) {
+            if (span.m_begin_ns < begin_ns || span.m_begin_ns >= end_ns) {
+                continue;
+            }
+            auto iter = std::find_if(totals.begin(), totals.end(), 
+                    [&](const Span_Total& total) {
+                        return total.m_arg == span.m_arg
+                                && same_name(total.m_name, span.m_name);
+                    });
+            if (iter == totals.end()) {
+                totals.push_back({span.m_category, span.m_name, span.m_arg, 
+                        0, 0, 0});
+                iter = totals.end() - 1;
+            }
+            std::uint64_t duration = span.m_end_ns - span.m_begin_ns;
+            ++iter->m_count;
+            iter->m_total_ns += duration;
+            iter->m_max_ns = std::max(iter->m_max_ns, duration);
+        }
+    }
+    std::stable_sort(totals.begin(), totals.end(), 
+            [](const Span_Total& lhs, const Span_Total& rhs) {
+                return lhs.m_total_ns > rhs.m_total_ns;
+            });
+    return totals;
+}
+
+std::vector<Trace::Span> find_spans(
+        const std::vector<Trace::Thread_Spans>& threads, const char* name) {
+    std::vector<Trace::Span> found;
+    for (const Trace::Thread_Spans& thread : threads) {
+        for (const Trace::Span& span : thread.m_spans) {
+            if (same_name(span.m_name, name)) {
+                found.push_back(span);
+            }
+        }
+    }
+    std::stable_sort(found.begin(), found.end(), 
+            [](const Trace::Span& lhs, const Trace::Span& rhs) {
+                return lhs.m_begin_ns < rhs.m_begin_ns;
+            });
+    return found;
+}
+
+std::vector<Placed_Span> lay_out_spans(const std::vector<Trace::Span>& spans,
+        std::uint64_t begin_ns, std::uint64_t end_ns) {
+    std::vector<Placed_Span> placed;
+    for (const Trace::Span& span : spans) {
+        if (span.m_end_ns > begin_ns && span.m_begin_ns < end_ns) {
+            placed.push_back({span, 0});
+        }
+    }
+    
+    // Enclosing spans end after the ones inside them, so they are recorded 
+    // later. Put them first.
+    std::stable_sort(placed.begin(), placed.end(), 
+            [](const Placed_Span& lhs, const Placed_Span& rhs) {
+                if (lhs.m_span.m_begin_ns != rhs.m_span.m_begin_ns) {
+                    return lhs.m_span.m_begin_ns < rhs.m_span.m_begin_ns;
+                }
+                return lhs.m_span.m_end_ns > rhs.m_span.m_end_ns;
+            });
+    
+    // End times of the spans enclosing the current one
+    std::vector<std::uint64_t> open_ends;
+    for (Placed_Span& entry : placed) {
+        while (!open_ends.empty() 
+                && open_ends.back() <= entry.m_span.m_begin_ns) {
+            open_ends.pop_back();
+        }
+        entry.m_depth = open_ends.size();
+        open_ends.push_back(entry.m_span.m_end_ns);
+    }
+    return placed;
+}
+
+} // namespace Profiler
+} // namespace Debug
+} // namespace pegr
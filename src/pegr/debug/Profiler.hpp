@@ -0,0 +1,93 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PEGR_DEBUG_PROFILER_HPP
+#define PEGR_DEBUG_PROFILER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pegr/debug/Trace.hpp"
+
+/* Summaries of what the trace buffers hold, for the profiler panel. Nothing
+ * here records anything, so it costs nothing unless something is looking.
+ */
+
+namespace pegr {
+namespace Debug {
+namespace Profiler {
+
+/**
+ * @class Span_Total
+ * @brief Every span with the same name and argument, added together
+ */
+struct Span_Total {
+    const char* m_category;
+    const char* m_name;
+    std::uint64_t m_arg;
+    
+    std::size_t m_count;
+    std::uint64_t m_total_ns;
+    std::uint64_t m_max_ns;
+};
+
+/**
+ * @class Placed_Span
+ * @brief Where to draw a span on a timeline
+ */
+struct Placed_Span {
+    Trace::Span m_span;
+    
+    // Number of spans on the same thread that enclose this one
+    std::size_t m_depth;
+};
+
+/**
+ * @param threads From Trace::snapshot()
+ * @param begin_ns Start of the time window
+ * @param end_ns End of the time window
+ * @return Totals of the spans on any thread that begin within the window,
+ * most total time first
+ */
+std::vector<Span_Total> total_spans(
+        const std::vector<Trace::Thread_Spans>& threads, 
+        std::uint64_t begin_ns, std::uint64_t end_ns);
+
+/**
+ * @param threads From Trace::snapshot()
+ * @param name Span name
+ * @return Every span with that name on any thread, earliest first
+ */
+std::vector<Trace::Span> find_spans(
+        const std::vector<Trace::Thread_Spans>& threads, const char* name);
+
+/**
+ * @param spans All from the same thread
+ * @param begin_ns Start of the time window
+ * @param end_ns End of the time window
+ * @return The spans that overlap the window with their nesting depths,
+ * earliest first
+ */
+std::vector<Placed_Span> lay_out_spans(const std::vector<Trace::Span>& spans,
+        std::uint64_t begin_ns, std::uint64_t end_ns);
+
+} // namespace Profiler
+} // namespace Debug
+} // namespace pegr
+
+#endif // PEGR_DEBUG_PROFILER_HPP
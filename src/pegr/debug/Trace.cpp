@@ -0,0 +1,309 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/debug/Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pegr/except/Except.hpp"
+#include "pegr/logger/Logger.hpp"
+#include "pegr/resource/Json_Util.hpp"
+
+namespace pegr {
+namespace Debug {
+namespace Trace {
+
+const std::uint64_t NO_ARG = ~std::uint64_t(0);
+
+const std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+struct Buffer {
+    // Only contended while dumping or clearing
+    std::mutex m_mutex;
+    
+    std::vector<Span> m_spans;
+    std::size_t m_capacity = DEFAULT_CAPACITY;
+    
+    // Where the next span goes once the buffer is full
+    std::size_t m_next = 0;
+    
+    std::uint32_t m_tid;
+    std::string m_thread_name;
+    
+    // Buffers of threads that have exited are given to new threads, since
+    // worker threads come and go (see Algs::parallel_for())
+    bool m_in_use = false;
+};
+
+struct Registry {
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Buffer> > m_buffers;
+    std::size_t m_capacity = DEFAULT_CAPACITY;
+};
+
+/**
+ * @brief Never destroyed, since threads can still exit after static objects
+ * are destroyed
+ */
+Registry& get_registry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+struct Thread_Slot {
+    Buffer* m_buffer = nullptr;
+    
+    ~Thread_Slot() {
+        if (m_buffer) {
+            Registry& registry = get_registry();
+            std::lock_guard<std::mutex> lock(registry.m_mutex);
+            m_buffer->m_in_use = false;
+        }
+    }
+};
+
+thread_local Thread_Slot n_thread_slot;
+
+std::atomic<bool> n_enabled(false);
+
+std::atomic<bool> n_trigger_armed(false);
+std::atomic<bool> n_trigger_fired(false);
+std::mutex n_trigger_mutex;
+std::string n_trigger_name;
+std::uint64_t n_trigger_min_ns = 0;
+boost::filesystem::path n_trigger_file;
+
+Buffer* get_thread_buffer() {
+    if (n_thread_slot.m_buffer) {
+        return n_thread_slot.m_buffer;
+    }
+    Registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+    for (std::unique_ptr<Buffer>& buffer : registry.m_buffers) {
+        if (!buffer->m_in_use) {
+            buffer->m_in_use = true;
+            n_thread_slot.m_buffer = buffer.get();
+            return buffer.get();
+        }
+    }
+    std::unique_ptr<Buffer> buffer = std::make_unique<Buffer>();
+    buffer->m_tid = registry.m_buffers.size() + 1;
+    buffer->m_capacity = registry.m_capacity;
+    buffer->m_in_use = true;
+    n_thread_slot.m_buffer = buffer.get();
+    registry.m_buffers.emplace_back(std::move(buffer));
+    return n_thread_slot.m_buffer;
+}
+
+void set_enabled(bool enabled) {
+    n_enabled = enabled;
+}
+bool is_enabled() {
+    return n_enabled;
+}
+
+void set_buffer_capacity(std::size_t capacity) {
+    Registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+    registry.m_capacity = std::max<std::size_t>(capacity, 1);
+    for (std::unique_ptr<Buffer>& buffer : registry.m_buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->m_mutex);
+        buffer->m_spans.clear();
+        buffer->m_spans.shrink_to_fit();
+        buffer->m_next = 0;
+        buffer->m_capacity = registry.m_capacity;
+    }
+}
+
+void clear() {
+    Registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+    for (std::unique_ptr<Buffer>& buffer : registry.m_buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->m_mutex);
+        buffer->m_spans.clear();
+        buffer->m_next = 0;
+    }
+}
+
+std::uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void check_trigger(const Span& span) {
+    boost::filesystem::path file;
+    {
+        std::lock_guard<std::mutex> lock(n_trigger_mutex);
+        if (!n_trigger_armed 
+                || span.m_end_ns - span.m_begin_ns < n_trigger_min_ns
+                || n_trigger_name != span.m_name) {
+            return;
+        }
+        n_trigger_armed = false;
+        file = n_trigger_file;
+    }
+    try {
+        std::size_t num_spans = dump(file);
+        Logger::log()->warn("Span %v took %vms, dumped %v spans to %v", 
+                span.m_name, (span.m_end_ns - span.m_begin_ns) / 1e6, 
+                num_spans, file);
+    } catch (Except::Runtime& e) {
+        Logger::log()->warn("Could not dump trace: %v", e.what());
+    }
+    n_trigger_fired = true;
+}
+
+void record(const Span& span) {
+    if (!n_enabled) {
+        return;
+    }
+    Buffer* buffer = get_thread_buffer();
+    {
+        std::lock_guard<std::mutex> lock(buffer->m_mutex);
+        if (buffer->m_spans.size() < buffer->m_capacity) {
+            buffer->m_spans.push_back(span);
+        } else {
+            buffer->m_spans[buffer->m_next] = span;
+            buffer->m_next = (buffer->m_next + 1) % buffer->m_capacity;
+        }
+    }
+    if (n_trigger_armed) {
+        check_trigger(span);
+    }
+}
+
+void set_thread_name(const char* name) {
+    Buffer* buffer = get_thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer->m_mutex);
+    buffer->m_thread_name = name;
+}
+
+std::vector<Thread_Spans> snapshot() {
+    std::vector<Thread_Spans> threads;
+    Registry& registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+    for (std::unique_ptr<Buffer>& buffer : registry.m_buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->m_mutex);
+        threads.emplace_back();
+        Thread_Spans& thread = threads.back();
+        thread.m_tid = buffer->m_tid;
+        thread.m_thread_name = buffer->m_thread_name;
+        
+        // Oldest first
+        thread.m_spans.reserve(buffer->m_spans.size());
+        thread.m_spans.insert(thread.m_spans.end(), 
+                buffer->m_spans.begin() + buffer->m_next, 
+                buffer->m_spans.end());
+        thread.m_spans.insert(thread.m_spans.end(), 
+                buffer->m_spans.begin(), 
+                buffer->m_spans.begin() + buffer->m_next);
+    }
+    return threads;
+}
+
+Json::Value to_chrome_json() {
+    Json::Value events(Json::arrayValue);
+    for (const Thread_Spans& thread : snapshot()) {
+        if (!thread.m_thread_name.empty()) {
+            Json::Value meta(Json::objectValue);
+            meta["name"] = "thread_name";
+            meta["ph"] = "M";
+            meta["pid"] = 0;
+            meta["tid"] = thread.m_tid;
+            meta["args"]["name"] = thread.m_thread_name;
+            events.append(meta);
+        }
+        for (const Span& span : thread.m_spans) {
+            Json::Value event(Json::objectValue);
+            event["name"] = span.m_name;
+            event["cat"] = span.m_category;
+            event["ph"] = "X";
+            event["ts"] = span.m_begin_ns / 1e3;
+            event["dur"] = (span.m_end_ns - span.m_begin_ns) / 1e3;
+            event["pid"] = 0;
+            event["tid"] = thread.m_tid;
+            if (span.m_arg != NO_ARG) {
+                event["args"]["arg"] = Json::UInt64(span.m_arg);
+            }
+            events.append(event);
+        }
+    }
+    Json::Value json(Json::objectValue);
+    json["traceEvents"] = events;
+    json["displayTimeUnit"] = "ns";
+    return json;
+}
+
+std::size_t dump(const boost::filesystem::path& file) {
+    Json::Value json = to_chrome_json();
+    std::size_t num_spans = 0;
+    for (const Json::Value& event : json["traceEvents"]) {
+        if (event["ph"].asString() == "X") {
+            ++num_spans;
+        }
+    }
+    Resour::Json_Util::write(file, json);
+    return num_spans;
+}
+
+void set_trigger(const char* name, double min_seconds, 
+        const boost::filesystem::path& file) {
+    std::lock_guard<std::mutex> lock(n_trigger_mutex);
+    n_trigger_name = name;
+    n_trigger_min_ns = static_cast<std::uint64_t>(min_seconds * 1e9);
+    n_trigger_file = file;
+    n_trigger_fired = false;
+    n_trigger_armed = true;
+}
+
+void clear_trigger() {
+    std::lock_guard<std::mutex> lock(n_trigger_mutex);
+    n_trigger_armed = false;
+    n_trigger_fired = false;
+}
+
+bool has_trigger_fired() {
+    return n_trigger_fired;
+}
+
+Scope::Scope(const char* category, const char* name, std::uint64_t arg)
+: m_category(nullptr)
+, m_name(nullptr)
+, m_begin_ns(0)
+, m_arg(arg) {
+    if (n_enabled) {
+        m_category = category;
+        m_name = name;
+        m_begin_ns = now_ns();
+    }
+}
+
+Scope::~Scope() {
+    if (m_name) {
+        record({m_category, m_name, m_begin_ns, now_ns(), m_arg});
+    }
+}
+
+} // namespace Trace
+} // namespace Debug
+} // namespace pegr
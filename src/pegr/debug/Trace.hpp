@@ -0,0 +1,190 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_DEBUG_TRACE_HPP
+#define PEGR_DEBUG_TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+
+/* Instrumentation only exists in builds with PEGR_TRACING defined (see the
+ * PGLOCAL_TRACING CMake option). Otherwise these expand to nothing and the
+ * functions below are never called by the engine.
+ */
+#ifdef PEGR_TRACING
+
+#define PEGR_TRACE_CONCAT_INNER(a, b) a ## b
+#define PEGR_TRACE_CONCAT(a, b) PEGR_TRACE_CONCAT_INNER(a, b)
+
+/**
+ * @brief Records a span from here until the end of the enclosing scope
+ * @param category String literal, such as "gensys"
+ * @param name String literal
+ */
+#define PEGR_TRACE_SCOPE(category, name) \
+        pegr::Debug::Trace::Scope \
+        PEGR_TRACE_CONCAT(_pegr_trace_scope_, __LINE__)(category, name)
+
+/**
+ * @brief As PEGR_TRACE_SCOPE(), with a number to tell apart spans that share
+ * a name (such as the index of an event listener)
+ */
+#define PEGR_TRACE_SCOPE_ARG(category, name, arg) \
+        pegr::Debug::Trace::Scope \
+        PEGR_TRACE_CONCAT(_pegr_trace_scope_, __LINE__)(category, name, arg)
+
+#define PEGR_TRACE_THREAD_NAME(name) \
+        pegr::Debug::Trace::set_thread_name(name)
+
+#else
+
+#define PEGR_TRACE_SCOPE(category, name) ((void) 0)
+#define PEGR_TRACE_SCOPE_ARG(category, name, arg) ((void) 0)
+#define PEGR_TRACE_THREAD_NAME(name) ((void) 0)
+
+#endif
+
+namespace pegr {
+namespace Debug {
+namespace Trace {
+
+extern const std::uint64_t NO_ARG;
+
+/**
+ * @brief A finished span. Names must be string literals (or otherwise live
+ * forever), since only the pointers are stored.
+ */
+struct Span {
+    const char* m_category;
+    const char* m_name;
+    
+    // Nanoseconds since the trace clock's epoch
+    std::uint64_t m_begin_ns;
+    std::uint64_t m_end_ns;
+    
+    // NO_ARG unless given to PEGR_TRACE_SCOPE_ARG()
+    std::uint64_t m_arg;
+};
+
+/**
+ * @brief Copy of one thread's buffer
+ */
+struct Thread_Spans {
+    std::uint32_t m_tid;
+    std::string m_thread_name;
+    
+    // Oldest first (by end time)
+    std::vector<Span> m_spans;
+};
+
+/**
+ * @brief Every thread records into its own ring buffer, so that recording
+ * needs no shared lock. When full, the oldest spans are overwritten, so the
+ * buffers always hold the most recent history.
+ */
+void set_enabled(bool enabled);
+bool is_enabled();
+
+/**
+ * @brief Changes the number of spans kept per thread. Throws away everything
+ * recorded so far.
+ */
+void set_buffer_capacity(std::size_t capacity);
+
+/**
+ * @brief Throws away everything recorded so far
+ */
+void clear();
+
+/**
+ * @return Nanoseconds since the trace clock's epoch
+ */
+std::uint64_t now_ns();
+
+/**
+ * @brief Adds a finished span to the calling thread's buffer, if enabled
+ */
+void record(const Span& span);
+
+/**
+ * @brief Shown instead of a number in the trace viewer
+ */
+void set_thread_name(const char* name);
+
+/**
+ * @return A copy of every thread's buffer. Threads are only locked while
+ * their own buffer is copied.
+ */
+std::vector<Thread_Spans> snapshot();
+
+/**
+ * @return Everything recorded, in Chrome's trace_event format (as read by
+ * chrome://tracing and Perfetto)
+ */
+Json::Value to_chrome_json();
+
+/**
+ * @brief Writes to_chrome_json() to the file. Can throw runtime errors.
+ * @return Number of spans written
+ */
+std::size_t dump(const boost::filesystem::path& file);
+
+/**
+ * @brief Arms a one-shot trigger: the first time a span with this name ends
+ * after taking at least min_seconds, the buffers are dumped to the file (so
+ * the history leading up to a slow tick is kept). Replaces any other trigger.
+ */
+void set_trigger(const char* name, double min_seconds, 
+        const boost::filesystem::path& file);
+void clear_trigger();
+
+/**
+ * @return If a trigger was armed and then fired
+ */
+bool has_trigger_fired();
+
+/**
+ * @class Scope
+ * @brief Records a span for its own lifetime. Use PEGR_TRACE_SCOPE() instead
+ * so that it can be compiled out.
+ */
+class Scope {
+public:
+    Scope(const char* category, const char* name, 
+            std::uint64_t arg = NO_ARG);
+    ~Scope();
+    
+    Scope(const Scope& rhs) = delete;
+    Scope& operator =(const Scope& rhs) = delete;
+    
+private:
+    // Null if tracing was disabled when this began
+    const char* m_category;
+    const char* m_name;
+    std::uint64_t m_begin_ns;
+    std::uint64_t m_arg;
+};
+
+} // namespace Trace
+} // namespace Debug
+} // namespace pegr
+
+#endif // PEGR_DEBUG_TRACE_HPP
@@ -19,21 +19,29 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <memory>
 #include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 
+#include "pegr/debug/Perf_Counters.hpp"
+#include "pegr/debug/Trace.hpp"
 #include "pegr/engine/App_State_Machine.hpp"
 #include "pegr/except/Except.hpp"
 #include "pegr/gensys/Gensys.hpp"
 #include "pegr/gensys/Lua_Interf.hpp"
 #include "pegr/logger/Logger.hpp"
 #include "pegr/resource/Resources.hpp"
+#include "pegr/resource/Watcher.hpp"
 #include "pegr/scheduler/Lua_Interf.hpp"
 #include "pegr/scheduler/Sched.hpp"
+#include "pegr/script/Gc_Scheduler.hpp"
 #include "pegr/script/Script.hpp"
+#include "pegr/text/Text.hpp"
+#ifndef PEGR_HEADLESS
 #include "pegr/winput/Winput.hpp"
+#endif
 
 namespace pegr {
 namespace Engine {
@@ -49,6 +57,10 @@ uint64_t n_tick_id = 0;
 double n_tick_lag = 0;
 double n_frame_delta = 0;
 
+// Only exists while counting is enabled
+std::unique_ptr<Debug::Perf_Counters> n_tick_counters;
+Debug::Counter_Values n_last_tick_counters;
+
 const uint16_t INIT_FLAG_LOGGER = 0x0001;
 const uint16_t INIT_FLAG_SCRIPT = 0x0002 | INIT_FLAG_LOGGER;
 const uint16_t INIT_FLAG_SCHEDU = 0x0008 | INIT_FLAG_SCRIPT;
@@ -73,7 +85,12 @@ bool schedu_used() {
     return (n_flags & INIT_FLAG_SCHEDU) == INIT_FLAG_SCHEDU;
 }
 bool winput_used() {
+#ifdef PEGR_HEADLESS
+    // Built without SDL or bgfx, such as for pegrBench
+    return false;
+#else
     return (n_flags & INIT_FLAG_WINPUT) == INIT_FLAG_WINPUT;
+#endif
 }
 bool resour_used() {
     return (n_flags & INIT_FLAG_RESOUR) == INIT_FLAG_RESOUR;
@@ -81,8 +98,26 @@ bool resour_used() {
 
 App_State_Machine n_asm;
 
+void forget_changed_resources(
+        const std::vector<Resour::Watcher::Change>& changes) {
+    for (const Resour::Watcher::Change& change : changes) {
+        switch (change.m_type) {
+            case Resour::Object::Type::SCRIPT: {
+                Script::forget_loaded_file(change.m_fname.string().c_str());
+                break;
+            }
+            case Resour::Object::Type::STRING: {
+                Text::forget_text_resource(change.m_oid);
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
 void initialize(uint16_t flags) {
     n_flags = flags;
+    PEGR_TRACE_THREAD_NAME("main");
     
     if (logger_used()) {
         Logger::initialize();
@@ -140,6 +175,18 @@ void initialize(uint16_t flags) {
         }
     }
     
+    if (resour_used()) {
+        // Hot reloading is optional, so failing to watch is not fatal
+        try {
+            Resour::Watcher::initialize();
+            Resour::Watcher::add_listener(forget_changed_resources);
+        } catch (Except::Runtime& e) {
+            Logger::log()->warn("Resources will not be reloaded: %v", 
+                    e.what());
+        }
+    }
+    
+#ifndef PEGR_HEADLESS
     if (winput_used()) {
         try {
             Winput::initialize();
@@ -150,6 +197,7 @@ void initialize(uint16_t flags) {
             throw Except::Runtime(sss.str());
         }
     }
+#endif
 }
 
 void push_state(std::unique_ptr<App_State>&& unique_state) {
@@ -197,9 +245,11 @@ void update_frame_delta() {
 void async_max_speed(const boost::system::error_code& asio_err,
         boost::asio::deadline_timer* timer) {
     update_lag_time();
+#ifndef PEGR_HEADLESS
     if (winput_used()) {
         Winput::pollEvents();
     }
+#endif
     
     if (is_main_loop_running()) {
         timer->async_wait(boost::bind(
@@ -210,8 +260,20 @@ void async_max_speed(const boost::system::error_code& asio_err,
 
 void async_tick(const boost::system::error_code& asio_err,
         boost::asio::deadline_timer* timer) {
+    PEGR_TRACE_SCOPE("engine", "Engine::async_tick");
     reset_lag_time();
-    n_asm->do_tick();
+    if (n_tick_counters) {
+        n_tick_counters->start();
+        n_asm->do_tick();
+        n_last_tick_counters = n_tick_counters->stop();
+    } else {
+        n_asm->do_tick();
+    }
+    if (script_used()) {
+        // Budgeted collection only happens after frames, which a long tick
+        // can hold off
+        Script::Gc_Scheduler::check_emergency();
+    }
     ++n_tick_id;
     if (is_main_loop_running()) {
         timer->expires_at(timer->expires_at() + 
@@ -224,20 +286,36 @@ void async_tick(const boost::system::error_code& asio_err,
 
 void async_render(const boost::system::error_code& asio_err,
         boost::asio::deadline_timer* timer) {
+    PEGR_TRACE_SCOPE("engine", "Engine::async_render");
     update_lag_time();
     update_frame_delta();
+    if (resour_used()) {
+        // Files changed since the last frame are reloaded all at once
+        Resour::Watcher::flush_changes();
+    }
+#ifndef PEGR_HEADLESS
     if (winput_used()) {
         Winput::pre_frame();
     }
+#endif
     n_asm->do_frame();
+#ifndef PEGR_HEADLESS
     if (winput_used()) {
         Winput::submit_frame();
     }
+#endif
+    if (script_used()) {
+        // Idle time until the next frame or tick
+        Script::Gc_Scheduler::step_frame();
+    }
     
     if (is_main_loop_running()) {
         timer->async_wait(boost::bind(
                 async_render, boost::asio::placeholders::error,
                 timer));
+    } else if (resour_used()) {
+        // Otherwise the io_service would never run out of work
+        Resour::Watcher::stop();
     }
 }
 
@@ -259,18 +337,28 @@ void run() {
             &max_speed_timer));
     n_last_tick_timestamp = std::chrono::steady_clock::now();
     n_last_frame_timestamp = std::chrono::steady_clock::now();
+    if (resour_used()) {
+        Resour::Watcher::start(n_io);
+    }
+    if (script_used()) {
+        Script::Gc_Scheduler::set_enabled(true);
+    }
     n_io.run();
 }
 
 void cleanup() {
     n_asm.clear_all();
     n_tick_id = 0;
+    set_tick_counters_enabled(false);
     
+#ifndef PEGR_HEADLESS
     if (winput_used()) {
         Winput::cleanup();
     }
+#endif
     
     if (resour_used()) {
+        Resour::Watcher::cleanup();
         Resour::cleanup();
     }
     
@@ -284,6 +372,7 @@ void cleanup() {
     }
     
     if (script_used()) {
+        Script::Gc_Scheduler::set_enabled(false);
         Script::cleanup();
     }
     
@@ -309,6 +398,24 @@ double get_frame_delta() {
     return n_frame_delta;
 }
 
+void set_tick_counters_enabled(bool enabled) {
+    n_last_tick_counters = Debug::Counter_Values();
+    if (!enabled) {
+        n_tick_counters.reset();
+    } else if (!n_tick_counters) {
+        n_tick_counters = std::make_unique<Debug::Perf_Counters>();
+        if (!n_tick_counters->is_available()) {
+            Logger::log()->warn("Hardware counters are unavailable");
+        }
+    }
+}
+bool are_tick_counters_enabled() {
+    return n_tick_counters != nullptr;
+}
+const Debug::Counter_Values& get_tick_counters() {
+    return n_last_tick_counters;
+}
+
 bool is_main_loop_running() {
     return n_asm.has_active();
 }
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <memory>
 
+#include "pegr/debug/Perf_Counters.hpp"
 #include "pegr/engine/App_State.hpp"
 
 namespace pegr {
@@ -54,6 +55,19 @@ uint64_t get_tick_id();
 double get_tick_lag();
 double get_frame_delta();
 
+/**
+ * @brief Counts hardware events during every tick, which is slightly slower.
+ * Ticks run on the main thread, so this must be called from there.
+ */
+void set_tick_counters_enabled(bool enabled);
+bool are_tick_counters_enabled();
+
+/**
+ * @return What was counted during the most recent tick, all invalid if
+ * counting is disabled
+ */
+const Debug::Counter_Values& get_tick_counters();
+
 bool is_main_loop_running();
 
 void on_window_resize(int32_t width, int32_t height);
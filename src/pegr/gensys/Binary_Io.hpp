@@ -0,0 +1,118 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PEGR_GENSYS_BINARYIO_HPP
+#define PEGR_GENSYS_BINARYIO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pegr/except/Except.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Binary_Io {
+
+/**
+ * @class Writer
+ * @brief Appends native-order values to a byte buffer
+ */
+class Writer {
+public:
+    Writer(std::vector<char>& buffer)
+    : m_buffer(buffer) {}
+    
+    void write_bytes(const void* data, std::size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    }
+    
+    template <typename T>
+    void write_value(T val) {
+        write_bytes(&val, sizeof(T));
+    }
+    
+    void write_string(const std::string& str) {
+        write_value<std::uint32_t>(str.size());
+        write_bytes(str.data(), str.size());
+    }
+    
+private:
+    std::vector<char>& m_buffer;
+};
+
+/**
+ * @class Reader
+ * @brief Reads native-order values from a byte buffer, throwing if the buffer
+ * ends too early
+ */
+class Reader {
+public:
+    /**
+     * @param data The buffer
+     * @param size Size of the buffer in bytes
+     * @param what What the buffer holds, for error messages
+     */
+    Reader(const char* data, std::size_t size, const char* what)
+    : m_data(data)
+    , m_size(size)
+    , m_pos(0)
+    , m_what(what) {}
+    
+    const char* read_bytes(std::size_t size) {
+        if (size > m_size - m_pos) {
+            std::stringstream sss;
+            sss << m_what << " is truncated";
+            throw Except::Runtime(sss.str());
+        }
+        const char* retval = m_data + m_pos;
+        m_pos += size;
+        return retval;
+    }
+    
+    template <typename T>
+    T read_value() {
+        T retval;
+        std::memcpy(&retval, read_bytes(sizeof(T)), sizeof(T));
+        return retval;
+    }
+    
+    std::string read_string() {
+        std::uint32_t size = read_value<std::uint32_t>();
+        return std::string(read_bytes(size), size);
+    }
+    
+    bool is_at_end() const {
+        return m_pos == m_size;
+    }
+    
+private:
+    const char* m_data;
+    std::size_t m_size;
+    std::size_t m_pos;
+    const char* m_what;
+};
+
+} // namespace Binary_Io
+} // namespace Gensys
+} // namespace pegr
+
+#endif // PEGR_GENSYS_BINARYIO_HPP
@@ -0,0 +1,555 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "pegr/gensys/Cache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "pegr/except/Except.hpp"
+#include "pegr/gensys/Binary_Io.hpp"
+#include "pegr/gensys/Gensys.hpp"
+#include "pegr/gensys/Interned_Strings.hpp"
+#include "pegr/gensys/Runtime.hpp"
+#include "pegr/logger/Logger.hpp"
+#include "pegr/resource/Oid.hpp"
+
+namespace pegr {
+namespace Gensys {
+
+// Forward declarations that let us access the runtime maps
+namespace Runtime {
+extern std::map<Resour::Oid, std::unique_ptr<Runtime::Comp> > n_runtime_comps;
+extern std::map<Resour::Oid, std::unique_ptr<Runtime::Arche> > n_runtime_arches;
+extern std::map<Resour::Oid, std::unique_ptr<Runtime::Genre> > n_runtime_genres;
+extern std::vector<Script::Unique_Regref> n_held_lua_values;
+} // namespace Runtime
+
+namespace Cache {
+
+const char CACHE_MAGIC[8] = {'P', 'E', 'G', 'R', 'D', 'E', 'F', 'S'};
+const std::uint32_t CACHE_VERSION = 1;
+
+void write_prim(Binary_Io::Writer& writer, const Runtime::Prim& prim) {
+    writer.write_value<std::uint32_t>(static_cast<std::uint32_t>(prim.m_type));
+    writer.write_value<std::uint8_t>(prim.m_shared);
+    writer.write_value<std::uint64_t>(prim.m_refer.m_index);
+}
+
+Runtime::Prim read_prim(Binary_Io::Reader& reader) {
+    std::uint32_t type = reader.read_value<std::uint32_t>();
+    if (type >= static_cast<std::uint32_t>(Runtime::Prim::Type::NULLPTR)) {
+        throw Except::Runtime("Cache contains an unknown member type");
+    }
+    Runtime::Prim prim;
+    prim.m_type = static_cast<Runtime::Prim::Type>(type);
+    prim.m_shared = reader.read_value<std::uint8_t>() != 0;
+    prim.m_refer.m_index = reader.read_value<std::uint64_t>();
+    return prim;
+}
+
+void write_chunk(Binary_Io::Writer& writer, Algs::Podc_Ptr chunk) {
+    writer.write_value<std::uint64_t>(chunk.get_size());
+    writer.write_bytes(chunk.get_raw(), chunk.get_size());
+}
+
+/**
+ * @return A new chunk, which the caller must take ownership of
+ */
+Algs::Podc_Ptr read_chunk(Binary_Io::Reader& reader) {
+    std::uint64_t size = reader.read_value<std::uint64_t>();
+    const char* bytes = reader.read_bytes(size);
+    Algs::Podc_Ptr chunk = Algs::Podc_Ptr::new_podc(size);
+    if (chunk.get_size() != size) {
+        Algs::Podc_Ptr::delete_podc(chunk);
+        throw Except::Runtime("Cache contains a misaligned chunk");
+    }
+    std::memcpy(chunk.get_raw(), bytes, size);
+    return chunk;
+}
+
+void write_strings(Binary_Io::Writer& writer, 
+        const std::vector<Runtime::Istr_Ptr>& strings) {
+    writer.write_value<std::uint64_t>(strings.size());
+    for (const Runtime::Istr_Ptr& str : strings) {
+        writer.write_string(str.get_string());
+    }
+}
+
+std::vector<Runtime::Istr_Ptr> read_strings(Binary_Io::Reader& reader) {
+    std::vector<Runtime::Istr_Ptr> strings;
+    std::uint64_t num_strings = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_strings; ++idx) {
+        strings.push_back(Runtime::intern_string(reader.read_string()));
+    }
+    return strings;
+}
+
+int write_bytecode(lua_State* l, const void* data, std::size_t size, 
+        void* buffer) {
+    const char* bytes = static_cast<const char*>(data);
+    std::vector<char>* bytecode = static_cast<std::vector<char>*>(buffer);
+    bytecode->insert(bytecode->end(), bytes, bytes + size);
+    return 0;
+}
+
+/**
+ * @return The bytecode of the Lua function. Can throw runtime errors if the
+ * function cannot be saved.
+ */
+std::vector<char> dump_function(Script::Regref func) {
+    lua_State* l = Script::get_lua_state();
+    Script::push_reference(func);
+    Script::Pop_Guard pop_guard(1);
+    if (!lua_isfunction(l, -1) || lua_iscfunction(l, -1)) {
+        throw Except::Runtime("Only Lua functions can be cached");
+    }
+    if (lua_getupvalue(l, -1, 1)) {
+        pop_guard.on_push(1);
+        throw Except::Runtime("Functions with upvalues cannot be cached");
+    }
+    std::vector<char> bytecode;
+    if (lua_dump(l, write_bytecode, &bytecode) != 0) {
+        throw Except::Runtime("Failed to dump function");
+    }
+    return bytecode;
+}
+
+std::vector<char> write_cache(std::uint64_t key) {
+    assert(get_global_state() == GlobalState::EXECUTABLE);
+    
+    std::vector<char> buffer;
+    Binary_Io::Writer writer(buffer);
+    writer.write_bytes(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    writer.write_value<std::uint32_t>(CACHE_VERSION);
+    writer.write_value<std::uint32_t>(0);
+    writer.write_value<std::uint64_t>(key);
+    
+    // Every function member is one of the held values
+    std::map<Script::Regref, std::uint64_t> func_indices;
+    writer.write_value<std::uint64_t>(Runtime::n_held_lua_values.size());
+    for (const Script::Unique_Regref& held : Runtime::n_held_lua_values) {
+        std::vector<char> bytecode = dump_function(held.get());
+        std::uint64_t func_idx = func_indices.size();
+        func_indices[held.get()] = func_idx;
+        writer.write_value<std::uint32_t>(bytecode.size());
+        writer.write_bytes(bytecode.data(), bytecode.size());
+    }
+    
+    std::map<const Runtime::Comp*, std::string> comp_reprs;
+    writer.write_value<std::uint64_t>(Runtime::n_runtime_comps.size());
+    for (const auto& comp_entry : Runtime::n_runtime_comps) {
+        const Runtime::Comp* comp = comp_entry.second.get();
+        comp_reprs[comp] = comp_entry.first.get_repr();
+        writer.write_string(comp_entry.first.get_repr());
+        writer.write_value<std::uint8_t>(comp->m_is_tag);
+        writer.write_value<std::uint64_t>(comp->m_member_offsets.size());
+        for (const auto& member : comp->m_member_offsets) {
+            writer.write_string(member.first);
+            write_prim(writer, member.second);
+        }
+    }
+    
+    writer.write_value<std::uint64_t>(Runtime::n_runtime_arches.size());
+    for (const auto& arche_entry : Runtime::n_runtime_arches) {
+        const Runtime::Arche* arche = arche_entry.second.get();
+        writer.write_string(arche_entry.first.get_repr());
+        writer.write_value<std::uint64_t>(arche->m_components.size());
+        for (const auto& comp_entry : arche->m_components) {
+            writer.write_string(comp_entry.first);
+            writer.write_string(comp_reprs.at(comp_entry.second));
+        }
+        writer.write_value<std::uint64_t>(arche->m_comp_offsets.size());
+        for (const auto& offset_entry : arche->m_comp_offsets) {
+            const Runtime::Arche::Aggindex& aggidx = offset_entry.second;
+            writer.write_string(comp_reprs.at(offset_entry.first));
+            writer.write_value<std::uint64_t>(aggidx.m_pod_idx);
+            writer.write_value<std::uint64_t>(aggidx.m_string_idx);
+            writer.write_value<std::uint64_t>(aggidx.m_func_idx);
+            writer.write_value<std::uint64_t>(aggidx.m_shared_pod_idx);
+            writer.write_value<std::uint64_t>(aggidx.m_shared_string_idx);
+        }
+        write_chunk(writer, arche->m_default_chunk.get());
+        write_strings(writer, arche->m_default_strings);
+        writer.write_value<std::uint64_t>(arche->m_static_funcs.size());
+        for (Script::Regref func : arche->m_static_funcs) {
+            writer.write_value<std::uint64_t>(func_indices.at(func));
+        }
+        write_chunk(writer, arche->m_shared_chunk.get());
+        write_strings(writer, arche->m_shared_strings);
+        writer.write_value<std::uint64_t>(
+                arche->m_entity_ref_offsets.size());
+        for (std::size_t byte_offset : arche->m_entity_ref_offsets) {
+            writer.write_value<std::uint64_t>(byte_offset);
+        }
+    }
+    
+    writer.write_value<std::uint64_t>(Runtime::n_runtime_genres.size());
+    for (const auto& genre_entry : Runtime::n_runtime_genres) {
+        const Runtime::Genre* genre = genre_entry.second.get();
+        writer.write_string(genre_entry.first.get_repr());
+        writer.write_value<std::uint64_t>(
+                genre->m_sorted_required_intersection.size());
+        for (const Runtime::Comp* comp : 
+                genre->m_sorted_required_intersection) {
+            writer.write_string(comp_reprs.at(comp));
+        }
+        writer.write_value<std::uint64_t>(genre->m_patterns.size());
+        for (const Runtime::Pattern& pattern : genre->m_patterns) {
+            writer.write_value<std::uint64_t>(
+                    pattern.m_sorted_required_comps_specific.size());
+            for (const Runtime::Comp* comp : 
+                    pattern.m_sorted_required_comps_specific) {
+                writer.write_string(comp_reprs.at(comp));
+            }
+            writer.write_value<std::uint64_t>(pattern.m_aliases.size());
+            for (const auto& alias_entry : pattern.m_aliases) {
+                writer.write_string(alias_entry.first);
+                writer.write_string(comp_reprs.at(alias_entry.second.m_comp));
+                write_prim(writer, alias_entry.second.m_prim_copy);
+            }
+        }
+    }
+    
+    return buffer;
+}
+
+/**
+ * @class Loaded
+ * @brief Everything read from a cache, before it replaces the runtime
+ */
+struct Loaded {
+    std::vector<Script::Unique_Regref> m_funcs;
+    std::map<Resour::Oid, std::unique_ptr<Runtime::Comp> > m_comps;
+    std::map<Resour::Oid, std::unique_ptr<Runtime::Arche> > m_arches;
+    std::map<Resour::Oid, std::unique_ptr<Runtime::Genre> > m_genres;
+    
+    Runtime::Comp* read_comp_ref(Binary_Io::Reader& reader) {
+        auto iter = m_comps.find(Resour::Oid(reader.read_string()));
+        if (iter == m_comps.end()) {
+            throw Except::Runtime("Cache refers to an unknown component");
+        }
+        return iter->second.get();
+    }
+};
+
+void read_functions(Binary_Io::Reader& reader, Loaded& loaded, 
+        Script::Regref env) {
+    lua_State* l = Script::get_lua_state();
+    std::uint64_t num_funcs = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_funcs; ++idx) {
+        std::uint32_t size = reader.read_value<std::uint32_t>();
+        const char* bytecode = reader.read_bytes(size);
+        if (luaL_loadbuffer(l, bytecode, size, "=gensys cache") != 0) {
+            lua_pop(l, 1);
+            throw Except::Runtime("Cache contains an invalid function");
+        }
+        Script::push_reference(env);
+        lua_setfenv(l, -2);
+        loaded.m_funcs.push_back(Script::grab_unique_reference());
+    }
+}
+
+/**
+ * @brief Checks that every member of every component in the archetype points
+ * inside the archetype's storage, since Entity::get_member() trusts this
+ */
+void check_arche_members(const Runtime::Arche* arche) {
+    for (Runtime::Comp* comp : arche->m_sorted_component_array) {
+        if (!comp->m_is_tag && arche->m_comp_offsets.find(comp) 
+                == arche->m_comp_offsets.end()) {
+            throw Except::Runtime("Cache is missing a component offset");
+        }
+    }
+    for (const auto& offset_entry : arche->m_comp_offsets) {
+        const Runtime::Arche::Aggindex& aggidx = offset_entry.second;
+        for (const auto& member : offset_entry.first->m_member_offsets) {
+            const Runtime::Prim& prim = member.second;
+            bool in_bounds;
+            switch (prim.m_type) {
+                case Runtime::Prim::Type::STR: {
+                    std::size_t base = prim.m_shared
+                            ? aggidx.m_shared_string_idx 
+                            : aggidx.m_string_idx;
+                    std::size_t size = prim.m_shared
+                            ? arche->m_shared_strings.size()
+                            : arche->m_default_strings.size();
+                    in_bounds = base < size 
+                            && prim.m_refer.m_index < size - base;
+                    break;
+                }
+                case Runtime::Prim::Type::FUNC: {
+                    std::size_t size = arche->m_static_funcs.size();
+                    in_bounds = aggidx.m_func_idx < size
+                            && prim.m_refer.m_index < size - aggidx.m_func_idx;
+                    break;
+                }
+                default: {
+                    std::size_t pod_size = Runtime::get_pod_size(prim.m_type);
+                    std::size_t base = prim.m_shared
+                            ? aggidx.m_shared_pod_idx
+                            : aggidx.m_pod_idx;
+                    std::size_t size = prim.m_shared
+                            ? arche->m_shared_chunk.get().get_size()
+                            : arche->m_default_chunk.get().get_size();
+                    in_bounds = pod_size > 0 
+                            && base <= size 
+                            && prim.m_refer.m_byte_offset <= size - base
+                            && pod_size <= size - base 
+                                    - prim.m_refer.m_byte_offset
+                            && (base + prim.m_refer.m_byte_offset) 
+                                    % pod_size == 0;
+                    break;
+                }
+            }
+            if (!in_bounds) {
+                std::stringstream sss;
+                sss << "Cache contains a misplaced member: " << member.first;
+                throw Except::Runtime(sss.str());
+            }
+        }
+    }
+}
+
+/**
+ * @brief Checks that the alias is a copy of a member of a component that the
+ * pattern requires, so that check_arche_members() also covers it
+ */
+void check_alias(const Runtime::Pattern& pattern, 
+        const Runtime::Pattern::Alias& alias) {
+    const std::vector<Runtime::Comp*>& required = 
+            pattern.m_sorted_required_comps_specific;
+    if (!std::binary_search(required.begin(), required.end(), alias.m_comp)) {
+        throw Except::Runtime("Cache contains an alias to a missing component");
+    }
+    for (const auto& member : alias.m_comp->m_member_offsets) {
+        const Runtime::Prim& prim = member.second;
+        if (prim.m_type == alias.m_prim_copy.m_type
+                && prim.m_shared == alias.m_prim_copy.m_shared
+                && prim.m_refer.m_index == alias.m_prim_copy.m_refer.m_index) {
+            return;
+        }
+    }
+    throw Except::Runtime("Cache contains an alias to an unknown member");
+}
+
+void read_comps(Binary_Io::Reader& reader, Loaded& loaded) {
+    std::uint64_t num_comps = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_comps; ++idx) {
+        Resour::Oid oid(reader.read_string());
+        std::unique_ptr<Runtime::Comp> comp = 
+                std::make_unique<Runtime::Comp>();
+        comp->m_is_tag = reader.read_value<std::uint8_t>() != 0;
+        std::uint64_t num_members = reader.read_value<std::uint64_t>();
+        for (std::uint64_t member = 0; member < num_members; ++member) {
+            Runtime::Symbol symbol = reader.read_string();
+            comp->m_member_offsets[symbol] = read_prim(reader);
+        }
+        loaded.m_comps[oid] = std::move(comp);
+    }
+}
+
+void read_arches(Binary_Io::Reader& reader, Loaded& loaded) {
+    std::uint64_t num_arches = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_arches; ++idx) {
+        Resour::Oid oid(reader.read_string());
+        std::unique_ptr<Runtime::Arche> arche = 
+                std::make_unique<Runtime::Arche>();
+        
+        std::uint64_t num_comps = reader.read_value<std::uint64_t>();
+        for (std::uint64_t comp = 0; comp < num_comps; ++comp) {
+            Runtime::Symbol symbol = reader.read_string();
+            arche->m_components[symbol] = loaded.read_comp_ref(reader);
+        }
+        std::uint64_t num_offsets = reader.read_value<std::uint64_t>();
+        for (std::uint64_t offset = 0; offset < num_offsets; ++offset) {
+            Runtime::Comp* comp = loaded.read_comp_ref(reader);
+            Runtime::Arche::Aggindex& aggidx = arche->m_comp_offsets[comp];
+            aggidx.m_pod_idx = reader.read_value<std::uint64_t>();
+            aggidx.m_string_idx = reader.read_value<std::uint64_t>();
+            aggidx.m_func_idx = reader.read_value<std::uint64_t>();
+            aggidx.m_shared_pod_idx = reader.read_value<std::uint64_t>();
+            aggidx.m_shared_string_idx = reader.read_value<std::uint64_t>();
+        }
+        arche->m_default_chunk.reset(read_chunk(reader));
+        arche->m_default_strings = read_strings(reader);
+        std::uint64_t num_funcs = reader.read_value<std::uint64_t>();
+        for (std::uint64_t func = 0; func < num_funcs; ++func) {
+            std::uint64_t func_idx = reader.read_value<std::uint64_t>();
+            if (func_idx >= loaded.m_funcs.size()) {
+                throw Except::Runtime("Cache refers to an unknown function");
+            }
+            arche->m_static_funcs.push_back(loaded.m_funcs[func_idx].get());
+        }
+        arche->m_shared_chunk.reset(read_chunk(reader));
+        arche->m_shared_strings = read_strings(reader);
+        std::uint64_t num_refs = reader.read_value<std::uint64_t>();
+        std::size_t chunk_size = Runtime::ENT_HEADER_SIZE 
+                + arche->m_default_chunk.get().get_size();
+        for (std::uint64_t ref = 0; ref < num_refs; ++ref) {
+            std::uint64_t byte_offset = reader.read_value<std::uint64_t>();
+            if (byte_offset > chunk_size - sizeof(Runtime::Entity_Ref)) {
+                throw Except::Runtime("Cache contains a misplaced reference");
+            }
+            arche->m_entity_ref_offsets.push_back(byte_offset);
+        }
+        
+        // Pointer order is different every time, so this is not saved
+        std::vector<Runtime::Comp*>& sorted_comps = 
+                arche->m_sorted_component_array;
+        for (const auto& comp_entry : arche->m_components) {
+            sorted_comps.push_back(comp_entry.second);
+        }
+        std::sort(sorted_comps.begin(), sorted_comps.end());
+        sorted_comps.erase(
+                std::unique(sorted_comps.begin(), sorted_comps.end()),
+                sorted_comps.end());
+        
+        check_arche_members(arche.get());
+        
+        loaded.m_arches[oid] = std::move(arche);
+    }
+}
+
+void read_genres(Binary_Io::Reader& reader, Loaded& loaded) {
+    std::uint64_t num_genres = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_genres; ++idx) {
+        Resour::Oid oid(reader.read_string());
+        std::unique_ptr<Runtime::Genre> genre = 
+                std::make_unique<Runtime::Genre>();
+        std::uint64_t num_required = reader.read_value<std::uint64_t>();
+        for (std::uint64_t comp = 0; comp < num_required; ++comp) {
+            genre->m_sorted_required_intersection.push_back(
+                    loaded.read_comp_ref(reader));
+        }
+        std::sort(genre->m_sorted_required_intersection.begin(),
+                genre->m_sorted_required_intersection.end());
+        
+        std::uint64_t num_patterns = reader.read_value<std::uint64_t>();
+        for (std::uint64_t pat = 0; pat < num_patterns; ++pat) {
+            Runtime::Pattern pattern;
+            std::uint64_t num_comps = reader.read_value<std::uint64_t>();
+            for (std::uint64_t comp = 0; comp < num_comps; ++comp) {
+                pattern.m_sorted_required_comps_specific.push_back(
+                        loaded.read_comp_ref(reader));
+            }
+            std::sort(pattern.m_sorted_required_comps_specific.begin(),
+                    pattern.m_sorted_required_comps_specific.end());
+            std::uint64_t num_aliases = reader.read_value<std::uint64_t>();
+            for (std::uint64_t alias = 0; alias < num_aliases; ++alias) {
+                Runtime::Symbol symbol = reader.read_string();
+                Runtime::Pattern::Alias& runtime_alias = 
+                        pattern.m_aliases[symbol];
+                runtime_alias.m_comp = loaded.read_comp_ref(reader);
+                runtime_alias.m_prim_copy = read_prim(reader);
+            }
+            for (const auto& alias_entry : pattern.m_aliases) {
+                check_alias(pattern, alias_entry.second);
+            }
+            genre->m_patterns.push_back(std::move(pattern));
+        }
+        loaded.m_genres[oid] = std::move(genre);
+    }
+}
+
+bool read_cache(const char* data, std::size_t size, std::uint64_t key,
+        Script::Regref env) {
+    assert(get_global_state() == GlobalState::MUTABLE);
+    
+    Binary_Io::Reader reader(data, size, "Cache");
+    if (std::memcmp(reader.read_bytes(sizeof(CACHE_MAGIC)), 
+            CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+        throw Except::Runtime("Not a gensys cache");
+    }
+    if (reader.read_value<std::uint32_t>() != CACHE_VERSION) {
+        return false;
+    }
+    reader.read_value<std::uint32_t>(); // Reserved
+    if (reader.read_value<std::uint64_t>() != key) {
+        return false;
+    }
+    
+    // Read everything before replacing anything
+    Loaded loaded;
+    read_functions(reader, loaded, env);
+    read_comps(reader, loaded);
+    read_arches(reader, loaded);
+    read_genres(reader, loaded);
+    if (!reader.is_at_end()) {
+        throw Except::Runtime("Cache has trailing data");
+    }
+    
+    Runtime::cleanup();
+    Runtime::n_runtime_comps = std::move(loaded.m_comps);
+    Runtime::n_runtime_arches = std::move(loaded.m_arches);
+    Runtime::n_runtime_genres = std::move(loaded.m_genres);
+    Runtime::n_held_lua_values = std::move(loaded.m_funcs);
+    return true;
+}
+
+void save_cache(const boost::filesystem::path& file, std::uint64_t key) {
+    std::vector<char> buffer = write_cache(key);
+    std::ofstream os(file.string().c_str(), 
+            std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os) {
+        std::stringstream sss;
+        sss << "Failed to open file for writing: " << file;
+        throw Except::Runtime(sss.str());
+    }
+    os.write(buffer.data(), buffer.size());
+    if (!os) {
+        std::stringstream sss;
+        sss << "Failed to write cache: " << file;
+        throw Except::Runtime(sss.str());
+    }
+}
+
+bool load_cache(const boost::filesystem::path& file, std::uint64_t key,
+        Script::Regref env) {
+    if (!boost::filesystem::exists(file)) {
+        return false;
+    }
+    std::ifstream is(file.string().c_str(), std::ios::in | std::ios::binary);
+    if (!is) {
+        std::stringstream sss;
+        sss << "Failed to open file: " << file;
+        throw Except::Runtime(sss.str());
+    }
+    
+    // Read everything at once
+    is.seekg(0, std::ios::end);
+    std::vector<char> buffer(is.tellg());
+    is.seekg(0, std::ios::beg);
+    is.read(buffer.data(), buffer.size());
+    if (!is) {
+        std::stringstream sss;
+        sss << "Failed to read cache: " << file;
+        throw Except::Runtime(sss.str());
+    }
+    
+    return read_cache(buffer.data(), buffer.size(), key, env);
+}
+
+} // namespace Cache
+} // namespace Gensys
+} // namespace pegr
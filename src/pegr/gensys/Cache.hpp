@@ -0,0 +1,107 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PEGR_GENSYS_CACHE_HPP
+#define PEGR_GENSYS_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "pegr/script/Script.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Cache {
+
+/* Cache of the compiled components, archetypes and genres, so that startup
+ * can skip running the scripts that define them, staging, and compiling.
+ * The format is:
+ * 
+ * Header:
+ *      "PEGRDEFS", u32 version, u32 reserved, u64 key
+ * Function table: u64 #functions, then for each: u32 length, Lua bytecode
+ * Components: u64 #comps, then for each:
+ *      Oid, u8 is tag, u64 #members, members (symbol, prim)
+ * Archetypes: u64 #arches, then for each:
+ *      Oid, u64 #components (symbol, component Oid),
+ *      u64 #offsets (component Oid, aggregate index),
+ *      default chunk, default strings, u64 #funcs (function table index),
+ *      shared chunk, shared strings, u64 #refs (entity ref offset)
+ * Genres: u64 #genres, then for each:
+ *      Oid, u64 #required components (component Oid),
+ *      u64 #patterns (u64 #comps (Oid), u64 #aliases (symbol, Oid, prim))
+ * 
+ * Oids are stored as Resour::Oid::get_repr(), chunks as u64 size then bytes,
+ * strings as u32 length then bytes. Values are in native byte order.
+ * 
+ * The key identifies the inputs (see Resour::hash_scripts_and_packages()).
+ * A cache with a different key or version is simply not used.
+ * 
+ * Function members are saved as Lua bytecode, and so only functions without
+ * upvalues can be cached. Loaded functions use the given environment, which
+ * should be equivalent to the one that the defining scripts ran in. Anything
+ * else that those scripts did (besides defining gensys objects) is not
+ * redone when the cache is used.
+ */
+
+extern const std::uint32_t CACHE_VERSION;
+
+/**
+ * @brief Saves the result of the last compilation.
+ * Can throw runtime errors, such as if a function member has upvalues.
+ * @param key Identifies the inputs that were compiled
+ * @return The cache
+ */
+std::vector<char> write_cache(std::uint64_t key);
+
+/**
+ * @brief Replaces the compiled components, archetypes and genres (and all
+ * entities) with the ones in the cache, if the key matches. You likely want
+ * Gensys::compile_cached() instead, which also changes the global state.
+ * Can throw runtime errors if the cache is corrupt, in which case nothing is
+ * changed.
+ * @param data The cache
+ * @param size Size of the cache in bytes
+ * @param key Must match the key that the cache was written with
+ * @param env Environment for the loaded functions
+ * @return If the cache was used
+ */
+bool read_cache(const char* data, std::size_t size, std::uint64_t key,
+        Script::Regref env);
+
+/**
+ * @brief Same as write_cache(), but writes to a file.
+ * Can throw runtime errors.
+ */
+void save_cache(const boost::filesystem::path& file, std::uint64_t key);
+
+/**
+ * @brief Same as read_cache(), but reads from a file. Missing files are not
+ * an error, but are not used either.
+ * Can throw runtime errors.
+ */
+bool load_cache(const boost::filesystem::path& file, std::uint64_t key,
+        Script::Regref env);
+
+} // namespace Cache
+} // namespace Gensys
+} // namespace pegr
+
+#endif // PEGR_GENSYS_CACHE_HPP
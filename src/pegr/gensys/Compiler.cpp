@@ -18,14 +18,20 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <sstream>
 #include <vector>
 
 #include "pegr/Script/Script_Util.hpp"
+#include "pegr/algs/Parallel.hpp"
+#include "pegr/debug/Lua_Profiler.hpp"
+#include "pegr/debug/Trace.hpp"
+#include "pegr/gensys/Binary_Io.hpp"
 #include "pegr/gensys/Gensys.hpp"
 #include "pegr/gensys/Util.hpp"
+#include "pegr/gensys/World.hpp"
 #include "pegr/logger/Logger.hpp"
 #include "pegr/resource/Oid.hpp"
 
@@ -56,6 +62,31 @@ struct Comp {
     Algs::Unique_Chunk_Ptr m_compiled_chunk;
     std::vector<std::string> m_strings;
     std::vector<Script::Regref> m_funcs;
+    
+    // Names for the Lua profiler, one for each of m_funcs
+    std::vector<std::string> m_func_labels;
+    
+    // Same as above, but for members with the "shared" qualifier
+    std::map<Interm::Symbol, std::size_t> m_shared_symbol_to_offset;
+    Algs::Unique_Chunk_Ptr m_compiled_shared_chunk;
+    std::vector<std::string> m_shared_strings;
+    
+    bool is_shared(const Interm::Symbol& symbol) const {
+        return m_interm->m_shared_members.find(symbol)
+                != m_interm->m_shared_members.end();
+    }
+    
+    /**
+     * @brief Finds the offset of the member in whichever of the two offset
+     * maps it was recorded in.
+     */
+    std::size_t get_offset(const Interm::Symbol& symbol) const {
+        const std::map<Interm::Symbol, std::size_t>& sto = is_shared(symbol) ?
+                m_shared_symbol_to_offset : m_symbol_to_offset;
+        const auto& iter = sto.find(symbol);
+        assert(iter != sto.end());
+        return iter->second;
+    }
 };
 struct Arche {
     Arche(std::unique_ptr<Interm::Arche>&& interm)
@@ -65,6 +96,14 @@ struct Arche {
     
     std::unique_ptr<Interm::Arche> m_interm;
     std::unique_ptr<Runtime::Arche> m_runtime;
+    
+    // Default strings, which are only interned when committing
+    std::vector<std::string> m_default_strings;
+    std::vector<std::string> m_shared_strings;
+    
+    // Names for the Lua profiler, one for each of Runtime::Arche's
+    // m_static_funcs, which are only given to the profiler when committing
+    std::vector<std::string> m_static_func_labels;
 };
 struct Genre {
     Genre(std::unique_ptr<Interm::Genre>&& interm)
@@ -101,7 +140,7 @@ private:
     
 public:
     Script::Regref add_lua_value(Script::Regref val_ref) {
-        m_unique_regrefs.add_lua_value(val_ref);
+        return m_unique_regrefs.add_lua_value(val_ref);
     }
     
     const std::vector<Script::Unique_Regref>& get_lua_uniques() const {
@@ -179,6 +218,10 @@ std::map<Resour::Oid, std::unique_ptr<Interm::Comp> > n_staged_comps;
 std::map<Resour::Oid, std::unique_ptr<Interm::Arche> > n_staged_arches;
 std::map<Resour::Oid, std::unique_ptr<Interm::Genre> > n_staged_genres;
 
+// Signatures of everything that was last compiled, see make_signatures()
+std::map<Resour::Oid, std::vector<char> > n_compiled_signatures;
+Compile_Stats n_compile_stats;
+
 void initialize() {
     assert(get_global_state() == GlobalState::UNINITIALIZED);
 }
@@ -188,6 +231,200 @@ void cleanup() {
     n_staged_comps.clear();
     n_staged_arches.clear();
     n_staged_genres.clear();
+    n_compiled_signatures.clear();
+    n_compile_stats = Compile_Stats();
+}
+
+const Compile_Stats& get_compile_stats() {
+    return n_compile_stats;
+}
+
+int write_signature_bytecode(lua_State* l, const void* data, std::size_t size,
+        void* buffer) {
+    const char* bytes = static_cast<const char*>(data);
+    std::vector<char>* bytecode = static_cast<std::vector<char>*>(buffer);
+    bytecode->insert(bytecode->end(), bytes, bytes + size);
+    return 0;
+}
+
+/**
+ * @brief Functions are compared by bytecode and environment, so that running
+ * an unchanged script again does not count as a change. Closures with
+ * upvalues can only be compared by identity.
+ */
+void write_function_signature(Binary_Io::Writer& writer, Script::Regref func) {
+    lua_State* l = Script::get_lua_state();
+    Script::push_reference(func);
+    Script::Pop_Guard pop_guard(1);
+    int func_idx = lua_gettop(l);
+    bool by_identity = !lua_isfunction(l, func_idx) 
+            || lua_iscfunction(l, func_idx);
+    if (!by_identity && lua_getupvalue(l, func_idx, 1)) {
+        pop_guard.on_push(1);
+        by_identity = true;
+    }
+    if (by_identity) {
+        writer.write_value<std::uint8_t>(0);
+        writer.write_value<std::uint64_t>(reinterpret_cast<std::uintptr_t>(
+                lua_topointer(l, func_idx)));
+        return;
+    }
+    lua_getfenv(l, func_idx);
+    pop_guard.on_push(1);
+    writer.write_value<std::uint8_t>(1);
+    writer.write_value<std::uint64_t>(
+            reinterpret_cast<std::uintptr_t>(lua_topointer(l, -1)));
+    lua_pushvalue(l, func_idx);
+    pop_guard.on_push(1);
+    std::vector<char> bytecode;
+    lua_dump(l, write_signature_bytecode, &bytecode);
+    writer.write_value<std::uint64_t>(bytecode.size());
+    writer.write_bytes(bytecode.data(), bytecode.size());
+}
+
+void write_prim_signature(Binary_Io::Writer& writer, const Interm::Prim& prim) {
+    writer.write_value<std::uint32_t>(
+            static_cast<std::uint32_t>(prim.get_type()));
+    writer.write_value<std::uint8_t>(prim.is_empty());
+    if (prim.is_empty()) {
+        return;
+    }
+    switch (prim.get_type()) {
+        case Interm::Prim::Type::STR: {
+            writer.write_string(prim.get_string());
+            break;
+        }
+        case Interm::Prim::Type::FUNC: {
+            write_function_signature(writer, prim.get_function()->get());
+            break;
+        }
+        case Interm::Prim::Type::F32: {
+            writer.write_value<float>(prim.get_f32());
+            break;
+        }
+        case Interm::Prim::Type::F64: {
+            writer.write_value<double>(prim.get_f64());
+            break;
+        }
+        case Interm::Prim::Type::I32: {
+            writer.write_value<std::int32_t>(prim.get_i32());
+            break;
+        }
+        case Interm::Prim::Type::I64: {
+            writer.write_value<std::int64_t>(prim.get_i64());
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+void write_named_prims_signature(Binary_Io::Writer& writer, 
+        const std::map<Interm::Symbol, Interm::Prim>& prims) {
+    writer.write_value<std::uint64_t>(prims.size());
+    for (const auto& entry : prims) {
+        writer.write_string(entry.first);
+        write_prim_signature(writer, entry.second);
+    }
+}
+
+/**
+ * @brief Describes every staged object, such that an object only needs to be
+ * compiled again if its signature changed. The signatures of archetypes and
+ * genres include those of the components that they use.
+ * @return The signatures
+ */
+std::map<Resour::Oid, std::vector<char> > make_signatures() {
+    PEGR_TRACE_SCOPE("gensys", "make_signatures");
+    std::map<Resour::Oid, std::vector<char> > signatures;
+    
+    std::map<const Interm::Comp*, Resour::Oid> comp_ids;
+    for (const auto& entry : n_staged_comps) {
+        const Interm::Comp* comp = entry.second.get();
+        comp_ids[comp] = entry.first;
+        Binary_Io::Writer writer(signatures[entry.first]);
+        write_named_prims_signature(writer, comp->m_members);
+        writer.write_value<std::uint64_t>(comp->m_shared_members.size());
+        for (const Interm::Symbol& symbol : comp->m_shared_members) {
+            writer.write_string(symbol);
+        }
+    }
+    auto write_comp = [&](Binary_Io::Writer& writer, 
+            const Interm::Comp* comp) {
+        const Resour::Oid& comp_id = comp_ids.at(comp);
+        const std::vector<char>& comp_signature = signatures.at(comp_id);
+        writer.write_string(comp_id.get_repr());
+        writer.write_value<std::uint64_t>(comp_signature.size());
+        writer.write_bytes(comp_signature.data(), comp_signature.size());
+    };
+    
+    for (const auto& entry : n_staged_arches) {
+        const Interm::Arche* arche = entry.second.get();
+        Binary_Io::Writer writer(signatures[entry.first]);
+        writer.write_value<std::uint64_t>(arche->m_implements.size());
+        for (const auto& implem_entry : arche->m_implements) {
+            writer.write_string(implem_entry.first);
+            write_comp(writer, implem_entry.second.m_component);
+            write_named_prims_signature(writer, implem_entry.second.m_values);
+        }
+    }
+    
+    for (const auto& entry : n_staged_genres) {
+        const Interm::Genre* genre = entry.second.get();
+        Binary_Io::Writer writer(signatures[entry.first]);
+        write_named_prims_signature(writer, genre->m_interface);
+        writer.write_value<std::uint64_t>(genre->m_patterns.size());
+        for (const Interm::Genre::Pattern& pattern : genre->m_patterns) {
+            writer.write_value<std::uint64_t>(pattern.m_matching.size());
+            for (const auto& matching_entry : pattern.m_matching) {
+                writer.write_string(matching_entry.first);
+                write_comp(writer, matching_entry.second);
+            }
+            writer.write_value<std::uint64_t>(pattern.m_aliases.size());
+            for (const auto& alias_entry : pattern.m_aliases) {
+                writer.write_string(alias_entry.first);
+                write_comp(writer, alias_entry.second.m_comp);
+                writer.write_string(alias_entry.second.m_member);
+            }
+            write_named_prims_signature(writer, pattern.m_static_redefine);
+        }
+    }
+    
+    return signatures;
+}
+
+/**
+ * @brief Objects that were compiled before keep their address, so that
+ * everything pointing to them (entities, Lua userdata, event listeners) stays
+ * valid. Unchanged objects are kept as they are. Changed objects are given
+ * the newly compiled contents, but keep their Lua userdata.
+ * @param fresh The newly compiled object, which is replaced by the old one
+ * @param runtime_map The previously compiled objects. The old object is
+ * removed from this map.
+ * @param id The id of the object
+ * @param unchanged If the object's signature did not change
+ */
+template <typename T>
+void reuse_runtime(std::unique_ptr<T>& fresh, 
+        std::map<Resour::Oid, std::unique_ptr<T> >& runtime_map,
+        const Resour::Oid& id, bool unchanged) {
+    auto iter = runtime_map.find(id);
+    if (iter == runtime_map.end()) {
+        ++n_compile_stats.m_num_rebuilt;
+        return;
+    }
+    std::unique_ptr<T> old = std::move(iter->second);
+    runtime_map.erase(iter);
+    if (unchanged) {
+        ++n_compile_stats.m_num_kept;
+    } else {
+        Script::Unique_Regref userdata = std::move(old->m_lua_userdata);
+        *old = std::move(*fresh);
+        old->m_lua_userdata = std::move(userdata);
+        ++n_compile_stats.m_num_rebuilt;
+    }
+    fresh = std::move(old);
 }
 
 Runtime::Prim::Type prim_type_convert(Interm::Prim::Type it) {
@@ -198,6 +435,7 @@ Runtime::Prim::Type prim_type_convert(Interm::Prim::Type it) {
         case Interm::Prim::Type::F64: return Runtime::Prim::Type::F64;
         case Interm::Prim::Type::FUNC: return Runtime::Prim::Type::FUNC;
         case Interm::Prim::Type::STR: return Runtime::Prim::Type::STR;
+        case Interm::Prim::Type::ENTITY: return Runtime::Prim::Type::ENTITY;
         default: {
             assert(false);
             break;
@@ -207,15 +445,31 @@ Runtime::Prim::Type prim_type_convert(Interm::Prim::Type it) {
 
 void compile_component_store_pod(Work::Space& workspace, 
         std::unique_ptr<Work::Comp>& comp) {
+    // Shared members are packed into a separate chunk
+    std::map<Interm::Symbol, Interm::Prim> instance_members;
+    std::map<Interm::Symbol, Interm::Prim> shared_members;
+    for (const auto& member : comp->m_interm->m_members) {
+        if (comp->is_shared(member.first)) {
+            shared_members.insert(member);
+        } else {
+            instance_members.insert(member);
+        }
+    }
     comp->m_compiled_chunk.reset(
             Util::new_pod_chunk_from_interm_prims(
-                    comp->m_interm->m_members,
+                    instance_members,
                     comp->m_symbol_to_offset));
+    comp->m_compiled_shared_chunk.reset(
+            Util::new_pod_chunk_from_interm_prims(
+                    shared_members,
+                    comp->m_shared_symbol_to_offset));
 }
 
 void compile_component_store_non_pod(Work::Space& workspace, 
         std::unique_ptr<Work::Comp>& comp) {
     comp->m_strings.clear();
+    comp->m_shared_strings.clear();
+    comp->m_func_labels.clear();
     for (const auto& member : comp->m_interm->m_members) {
         //
         const Interm::Symbol& symbol = member.first;
@@ -223,13 +477,23 @@ void compile_component_store_non_pod(Work::Space& workspace,
         
         switch (prim.get_type()) {
             case Interm::Prim::Type::STR: {
+                if (comp->is_shared(symbol)) {
+                    comp->m_shared_symbol_to_offset[symbol] = 
+                            comp->m_shared_strings.size();
+                    comp->m_shared_strings.push_back(prim.get_string());
+                    break;
+                }
                 comp->m_symbol_to_offset[symbol] = comp->m_strings.size();
                 comp->m_strings.push_back(prim.get_string());
                 break;
             }
+            // Functions are always stored once per archetype, regardless of
+            // whether or not they are qualified as shared
             case Interm::Prim::Type::FUNC: {
                 comp->m_symbol_to_offset[symbol] = comp->m_funcs.size();
                 comp->m_funcs.push_back(prim.get_function()->get());
+                comp->m_func_labels.push_back(
+                        comp->m_interm->m_error_msg_name + "." + symbol);
                 break;
             }
             default: {
@@ -240,9 +504,11 @@ void compile_component_store_non_pod(Work::Space& workspace,
 }
  
 void compile_component_record_offsets(Work::Space& workspace, 
-        std::unique_ptr<Work::Comp>& comp) {
+        std::unique_ptr<Work::Comp>& comp,
+        const std::map<Interm::Symbol, std::size_t>& symbol_to_offset,
+        bool shared) {
     // Record the member offsets in the runtime data
-    for (const auto& sto_entry : comp->m_symbol_to_offset) {
+    for (const auto& sto_entry : symbol_to_offset) {
         // Get the symbol and offset
         const Interm::Symbol& symbol = sto_entry.first;
         std::size_t offset = sto_entry.second;
@@ -255,17 +521,23 @@ void compile_component_record_offsets(Work::Space& workspace,
         // Runtime primitive setup
         Runtime::Prim runtime_prim;
         runtime_prim.m_type = prim_type_convert(prim_type);
+        runtime_prim.m_shared = shared;
         switch (runtime_prim.m_type) {
             case Runtime::Prim::Type::I32:
             case Runtime::Prim::Type::I64:
             case Runtime::Prim::Type::F32:
-            case Runtime::Prim::Type::F64: {
+            case Runtime::Prim::Type::F64:
+            case Runtime::Prim::Type::ENTITY: {
                 runtime_prim.m_refer.m_byte_offset = offset;
                 break;
             }
-            case Runtime::Prim::Type::STR:
+            case Runtime::Prim::Type::STR: {
+                runtime_prim.m_refer.m_index = offset;
+                break;
+            }
             case Runtime::Prim::Type::FUNC: {
                 runtime_prim.m_refer.m_index = offset;
+                runtime_prim.m_shared = true;
                 break;
             }
             default: {
@@ -279,20 +551,40 @@ void compile_component_record_offsets(Work::Space& workspace,
     }
 }
 
-std::unique_ptr<Work::Comp> compile_component(Work::Space& workspace, 
-        std::unique_ptr<Interm::Comp>&& interm) {
-    // Make the working component
-    std::unique_ptr<Work::Comp> comp = 
-            std::make_unique<Work::Comp>(std::move(interm));
+void compile_component(Work::Space& workspace, 
+        std::unique_ptr<Work::Comp>& comp) {
+    PEGR_TRACE_SCOPE("gensys", "compile_component");
+    // Components without any members are tags, which have no storage at all
+    if (comp->m_interm->m_members.empty()) {
+        comp->m_runtime->m_is_tag = true;
+        return;
+    }
     
     // Pack data and record where each member was placed
     compile_component_store_pod(workspace, comp);
     compile_component_store_non_pod(workspace, comp);
     
     // Record the member offsets in the runtime data
-    compile_component_record_offsets(workspace, comp);
-    
-    return comp;
+    compile_component_record_offsets(workspace, comp, 
+            comp->m_symbol_to_offset, false);
+    compile_component_record_offsets(workspace, comp, 
+            comp->m_shared_symbol_to_offset, true);
+}
+
+/**
+ * @brief Record the symbol for every implementation, including tags
+ */
+void compile_archetype_record_components(Work::Space& workspace,
+        std::unique_ptr<Work::Arche>& arche) {
+    for (const auto& implem_pair : arche->m_interm->m_implements) {
+        const Interm::Arche::Implement& implem = implem_pair.second;
+        const auto& comp_iter = 
+                workspace.get_comps_by_interm().find(implem.m_component);
+        assert(comp_iter != workspace.get_comps_by_interm().end());
+        const Work::Comp* comp = comp_iter->second;
+        const Runtime::Symbol symb = implem_pair.first;
+        arche->m_runtime->m_components[symb] = comp->m_runtime.get();
+    }
 }
 
 /**
@@ -303,15 +595,22 @@ void compile_archetype_resize_pod(Work::Space& workspace,
         std::unique_ptr<Work::Arche>& arche) {
     // Find the total size, which is the sum of the component POD chunk
     std::size_t total_size = 0;
+    std::size_t total_shared_size = 0;
     for (const auto& implem_pair : arche->m_interm->m_implements) {
         const Interm::Arche::Implement& implem = implem_pair.second;
         const auto& comp_iter = 
                 workspace.get_comps_by_interm().find(implem.m_component);
         assert(comp_iter != workspace.get_comps_by_interm().end());
         const Work::Comp* comp = comp_iter->second;
+        if (comp->m_runtime->m_is_tag) {
+            continue;
+        }
         total_size += comp->m_compiled_chunk.get().get_size();
+        total_shared_size += comp->m_compiled_shared_chunk.get().get_size();
     }
     arche->m_runtime->m_default_chunk.reset(Algs::Podc_Ptr::new_podc(total_size));
+    arche->m_runtime->m_shared_chunk.reset(
+            Algs::Podc_Ptr::new_podc(total_shared_size));
 }
 
 /**
@@ -320,14 +619,14 @@ void compile_archetype_resize_pod(Work::Space& workspace,
 void compile_archetype_fill_pod(Work::Space& workspace,
         std::unique_ptr<Work::Arche>& arche) {
 
-    // Stores how many bytes have already been used up in the POD chunk
+    // Stores how many bytes have already been used up in the POD chunks
     std::size_t accumulated = 0;
+    std::size_t shared_accumulated = 0;
     
     // For every implementation
     for (const auto& implem_pair : arche->m_interm->m_implements) {
         // Get the implementation
         const Interm::Arche::Implement& implem = implem_pair.second;
-        Logger::log()->info("    %v", implem.m_error_msg_name);
 
         const auto& comp_iter = 
                 workspace.get_comps_by_interm().find(implem.m_component);
@@ -335,6 +634,11 @@ void compile_archetype_fill_pod(Work::Space& workspace,
         assert(comp_iter != workspace.get_comps_by_interm().end());
         
         const Work::Comp* comp = comp_iter->second;
+        
+        // Tags have no pod data
+        if (comp->m_runtime->m_is_tag) {
+            continue;
+        }
 
         // Copy the pod chunk
         Algs::Podc_Ptr::copy_podc(
@@ -351,31 +655,46 @@ void compile_archetype_fill_pod(Work::Space& workspace,
                 arche->m_runtime->m_default_chunk.get(),
                 accumulated);
         
-        // Also record the symbol for this implementation
-        const Runtime::Symbol symb = implem_pair.first;
-        Runtime::Comp* run_comp = comp->m_runtime.get();
-        arche->m_runtime->m_components[symb] = run_comp;
+        // Same for the shared values
+        Algs::Podc_Ptr::copy_podc(
+                comp->m_compiled_shared_chunk.get(),
+                0,
+                arche->m_runtime->m_shared_chunk.get(),
+                shared_accumulated,
+                comp->m_compiled_shared_chunk.get().get_size());
+        Util::copy_named_prims_into_pod_chunk(
+                implem.m_values,
+                comp->m_shared_symbol_to_offset,
+                arche->m_runtime->m_shared_chunk.get(),
+                shared_accumulated);
         
         // Remember how to find this data later
-        arche->m_runtime->m_comp_offsets[run_comp].m_pod_idx = accumulated;
+        Runtime::Arche::Aggindex& aggidx = 
+                arche->m_runtime->m_comp_offsets[comp->m_runtime.get()];
+        aggidx.m_pod_idx = accumulated;
+        aggidx.m_shared_pod_idx = shared_accumulated;
 
         // Keep track of how much space has been used
         accumulated += comp->m_compiled_chunk.get().get_size();
+        shared_accumulated += comp->m_compiled_shared_chunk.get().get_size();
     }
 
-    // This should have exactly filled the POD chunk (guaranteed earlier)
+    // This should have exactly filled the POD chunks (guaranteed earlier)
     assert(accumulated == arche->m_runtime->m_default_chunk.get().get_size());
+    assert(shared_accumulated 
+            == arche->m_runtime->m_shared_chunk.get().get_size());
 }
 
 /**
  * @brief Copy strings from the component primitives, overwrite with new 
- * defaults.
+ * defaults. These are interned later, in commit_archetype().
  */
 void compile_archetype_store_strings(Work::Space& workspace,
         std::unique_ptr<Work::Arche>& arche) {
 
-    // Stores the running index for strings in the vector
+    // Stores the running index for strings in the vectors
     std::size_t accumulated = 0;
+    std::size_t shared_accumulated = 0;
 
     // For every implementation
     for (const auto& implem_pair : arche->m_interm->m_implements) {
@@ -391,9 +710,16 @@ void compile_archetype_store_strings(Work::Space& workspace,
         // This should be const, since we shouldn't modify anything else
         const Work::Comp* comp = comp_iter->second;
         
+        // Tags have no non-pod data either
+        if (comp->m_runtime->m_is_tag) {
+            continue;
+        }
+        
         // Copy the default strings
-        std::copy(comp->m_strings.begin(), comp->m_strings.end(), 
-                std::back_inserter(arche->m_runtime->m_default_strings));
+        arche->m_default_strings.insert(arche->m_default_strings.end(),
+                comp->m_strings.begin(), comp->m_strings.end());
+        arche->m_shared_strings.insert(arche->m_shared_strings.end(),
+                comp->m_shared_strings.begin(), comp->m_shared_strings.end());
         
         // Set new defaults by overwriting existing strings
         for (const auto& member : implem.m_values) {
@@ -405,30 +731,36 @@ void compile_archetype_store_strings(Work::Space& workspace,
                 continue;
             }
             
-            const auto& iter = comp->m_symbol_to_offset.find(symbol);
-            
-            assert(iter != comp->m_symbol_to_offset.end());
-            
-            std::size_t offset = iter->second;
+            std::size_t offset = comp->get_offset(symbol);
             
-            arche->m_runtime->m_default_strings[accumulated + offset]
-                    = prim.get_string();
+            if (comp->is_shared(symbol)) {
+                arche->m_shared_strings[shared_accumulated + offset]
+                        = prim.get_string();
+            } else {
+                arche->m_default_strings[accumulated + offset]
+                        = prim.get_string();
+            }
         }
 
         // Remember how to find this data later
-        arche->m_runtime->m_comp_offsets[comp->m_runtime.get()].m_string_idx 
-                = accumulated;
+        Runtime::Arche::Aggindex& aggidx = 
+                arche->m_runtime->m_comp_offsets[comp->m_runtime.get()];
+        aggidx.m_string_idx = accumulated;
+        aggidx.m_shared_string_idx = shared_accumulated;
 
         // Keep track of how much space has been used
         accumulated += comp->m_strings.size();
+        shared_accumulated += comp->m_shared_strings.size();
     }
 
     // Every string should have been copied
-    assert(accumulated == arche->m_runtime->m_default_strings.size());
+    assert(accumulated == arche->m_default_strings.size());
+    assert(shared_accumulated == arche->m_shared_strings.size());
 }
 
 /**
- * @brief Store any static lua values into the global Gensys Lua value table
+ * @brief Collect the static lua values. These are stored into the global
+ * Gensys Lua value table later, in commit_archetype().
  * @param workspace
  * @param arche
  */
@@ -451,9 +783,16 @@ void compile_archetype_store_static_lua_values(Work::Space& workspace,
         // This should be const, since we shouldn't modify anything else
         const Work::Comp* comp = comp_iter->second;
         
+        // Tags have no non-pod data either
+        if (comp->m_runtime->m_is_tag) {
+            continue;
+        }
+        
         // Copy the defaults
         std::copy(comp->m_funcs.begin(), comp->m_funcs.end(), 
                 std::back_inserter(arche->m_runtime->m_static_funcs));
+        std::copy(comp->m_func_labels.begin(), comp->m_func_labels.end(), 
+                std::back_inserter(arche->m_static_func_labels));
         
         // Set new defaults by overwriting existing funcs
         for (const auto& member : implem.m_values) {
@@ -473,6 +812,9 @@ void compile_archetype_store_static_lua_values(Work::Space& workspace,
             
             arche->m_runtime->m_static_funcs[accumulated + offset]
                     = prim.get_function()->get();
+            arche->m_static_func_labels[accumulated + offset] = 
+                    arche->m_interm->m_error_msg_name + "/" 
+                    + comp->m_interm->m_error_msg_name + "." + symbol;
         }
 
         // Remember how to find this data later
@@ -485,13 +827,6 @@ void compile_archetype_store_static_lua_values(Work::Space& workspace,
 
     // Every function should have been collected
     assert(accumulated == arche->m_runtime->m_static_funcs.size());
-    
-    // Upload every saved function
-    for (std::size_t idx = 0; 
-            idx < arche->m_runtime->m_static_funcs.size(); ++idx) {
-        arche->m_runtime->m_static_funcs[idx] = 
-                workspace.add_lua_value(arche->m_runtime->m_static_funcs[idx]);
-    }
 }
 
 /**
@@ -500,39 +835,87 @@ void compile_archetype_store_static_lua_values(Work::Space& workspace,
  */
 void compile_archetype_make_redundant_copies(Work::Space& workspace,
         std::unique_ptr<Work::Arche>& arche) {
-    arche->m_runtime->m_sorted_component_array.reserve(
-            arche->m_runtime->m_comp_offsets.size());
-    for (auto iter : arche->m_runtime->m_comp_offsets) {
-        arche->m_runtime->m_sorted_component_array.push_back(iter.first);
+    // Tags are not in m_comp_offsets, so use the component map instead
+    std::vector<Runtime::Comp*>& sorted_comps = 
+            arche->m_runtime->m_sorted_component_array;
+    sorted_comps.reserve(arche->m_runtime->m_components.size());
+    for (auto iter : arche->m_runtime->m_components) {
+        sorted_comps.push_back(iter.second);
     }
-    assert(std::is_sorted(arche->m_runtime->m_sorted_component_array.begin(),
-                        arche->m_runtime->m_sorted_component_array.end()));
-}
-
-std::unique_ptr<Work::Arche> compile_archetype(Work::Space& workspace, 
-        std::unique_ptr<Interm::Arche>&& interm) {
+    std::sort(sorted_comps.begin(), sorted_comps.end());
+    sorted_comps.erase(std::unique(sorted_comps.begin(), sorted_comps.end()),
+            sorted_comps.end());
     
-    // Make the working archetype
-    std::unique_ptr<Work::Arche> arche = 
-            std::make_unique<Work::Arche>(std::move(interm));
+    // Locate every per-entity reference to another entity
+    std::vector<std::size_t>& ref_offsets = 
+            arche->m_runtime->m_entity_ref_offsets;
+    for (const auto& comp_offset : arche->m_runtime->m_comp_offsets) {
+        const Runtime::Comp* comp = comp_offset.first;
+        const Runtime::Arche::Aggindex& aggidx = comp_offset.second;
+        for (const auto& member : comp->m_member_offsets) {
+            const Runtime::Prim& prim = member.second;
+            if (prim.m_type != Runtime::Prim::Type::ENTITY || prim.m_shared) {
+                continue;
+            }
+            ref_offsets.push_back(Runtime::ENT_HEADER_SIZE 
+                    + aggidx.m_pod_idx 
+                    + prim.m_refer.m_byte_offset);
+        }
+    }
+    std::sort(ref_offsets.begin(), ref_offsets.end());
+}
 
+/**
+ * @brief Compiles everything that does not touch Lua, and so can be done for
+ * many archetypes in parallel. Must be followed by commit_archetype().
+ */
+void compile_archetype(Work::Space& workspace, 
+        std::unique_ptr<Work::Arche>& arche) {
+    PEGR_TRACE_SCOPE("gensys", "compile_archetype");
     // Find the total size of the pod data and make a chunk for the archetype
+    compile_archetype_record_components(workspace, arche);
     compile_archetype_resize_pod(workspace, arche);
     compile_archetype_fill_pod(workspace, arche);
     compile_archetype_store_strings(workspace, arche);
     compile_archetype_store_static_lua_values(workspace, arche);
     compile_archetype_make_redundant_copies(workspace, arche);
-    
-    return arche;
 }
 
-std::unique_ptr<Work::Genre> compile_genre(Work::Space& workspace, 
-        std::unique_ptr<Interm::Genre>&& interm) {
+/**
+ * @brief Finishes compile_archetype() by doing everything that touches Lua,
+ * which can only be done on one thread: interns the default strings and 
+ * uploads the static functions.
+ */
+void commit_archetype(Work::Space& workspace,
+        std::unique_ptr<Work::Arche>& arche) {
+    PEGR_TRACE_SCOPE("gensys", "commit_archetype");
+    for (const auto& implem_pair : arche->m_interm->m_implements) {
+        Logger::log()->info("    %v", implem_pair.second.m_error_msg_name);
+    }
     
-    // Make the working genre
-    std::unique_ptr<Work::Genre> genre = 
-            std::make_unique<Work::Genre>(std::move(interm));
+    for (const std::string& str : arche->m_default_strings) {
+        arche->m_runtime->m_default_strings.push_back(
+                Runtime::intern_string(str));
+    }
+    for (const std::string& str : arche->m_shared_strings) {
+        arche->m_runtime->m_shared_strings.push_back(
+                Runtime::intern_string(str));
+    }
     
+    // Upload every saved function
+    for (std::size_t idx = 0; 
+            idx < arche->m_runtime->m_static_funcs.size(); ++idx) {
+        arche->m_runtime->m_static_funcs[idx] = 
+                workspace.add_lua_value(arche->m_runtime->m_static_funcs[idx]);
+        Debug::Lua_Profiler::set_function_label(
+                arche->m_runtime->m_static_funcs[idx], 
+                arche->m_static_func_labels[idx]);
+    }
+}
+
+void compile_genre(Work::Space& workspace, 
+        std::unique_ptr<Work::Genre>& genre) {
+    PEGR_TRACE_SCOPE("gensys", "compile_genre");
     for (const Interm::Genre::Pattern& interm_pattern : 
             genre->m_interm->m_patterns) {
         
@@ -586,38 +969,150 @@ std::unique_ptr<Work::Genre> compile_genre(Work::Space& workspace,
     }
     
     // TODO: remove the intersection of all patterns
-    
-    return genre;
 }
 
 void compile() {
+    PEGR_TRACE_SCOPE("gensys", "Compiler::compile");
     Logger::log()->info("Gensys compilation starting...");
     assert(get_global_state() == GlobalState::MUTABLE);
     
+    Logger::log()->info("Comparing with previous compilation...");
+    n_compile_stats = Compile_Stats();
+    std::map<Resour::Oid, std::vector<char> > signatures = make_signatures();
+    auto is_unchanged = [&](const Resour::Oid& id, bool compiled) -> bool {
+        auto iter = n_compiled_signatures.find(id);
+        return compiled && iter != n_compiled_signatures.end() 
+                && iter->second == signatures.at(id);
+    };
+    
+    // Changed archetypes are replaced in place, so save the old layouts now
+    std::map<Runtime::Arche*, Runtime::Arche_Layout> old_layouts;
+    for (const auto& entry : n_staged_arches) {
+        auto iter = Runtime::n_runtime_arches.find(entry.first);
+        if (iter != Runtime::n_runtime_arches.end() 
+                && !is_unchanged(entry.first, true)) {
+            old_layouts[iter->second.get()] = 
+                    Runtime::Arche_Layout::save(iter->second.get());
+        }
+    }
+    
     Logger::log()->info("Creating workspace...");
     Work::Space workspace;
 
+    // Each kind of object is compiled in two phases: first every object is
+    // compiled in parallel, without touching Lua, then the results are
+    // committed one at a time. Archetypes and genres need every component's
+    // working data (changed or not) and final address, so components go first.
     Logger::log()->info("Compiling components...");
+    std::vector<Resour::Oid> comp_ids;
+    std::vector<std::unique_ptr<Work::Comp> > comps;
     for (auto& entry : n_staged_comps) {
-        Logger::log()->info("-> %v", entry.first);
-        auto comp = compile_component(workspace, std::move(entry.second));
-        workspace.add_comp(std::move(comp), entry.first);
+        comp_ids.push_back(entry.first);
+        comps.emplace_back(
+                std::make_unique<Work::Comp>(std::move(entry.second)));
+    }
+    Algs::parallel_for(comps.size(), [&](std::size_t idx) {
+        compile_component(workspace, comps[idx]);
+    });
+    for (std::size_t idx = 0; idx < comps.size(); ++idx) {
+        const Resour::Oid& id = comp_ids[idx];
+        Logger::log()->info("-> %v", id);
+        if (comps[idx]->m_runtime->m_is_tag) {
+            Logger::log()->info("    (tag)");
+        }
+        bool unchanged = is_unchanged(id, 
+                Runtime::n_runtime_comps.count(id) > 0);
+        reuse_runtime(comps[idx]->m_runtime, Runtime::n_runtime_comps, 
+                id, unchanged);
+        workspace.add_comp(std::move(comps[idx]), id);
     }
 
     Logger::log()->info("Processing archetypes...");
+    std::vector<Resour::Oid> arche_ids;
+    std::vector<std::unique_ptr<Work::Arche> > arches;
+    std::vector<bool> arches_unchanged;
     for (auto& entry : n_staged_arches) {
-        Logger::log()->info("-> %v", entry.first);
-        auto arche = compile_archetype(workspace, std::move(entry.second));
-        workspace.add_arche(std::move(arche), entry.first);
+        arche_ids.push_back(entry.first);
+        arches.emplace_back(
+                std::make_unique<Work::Arche>(std::move(entry.second)));
+        arches_unchanged.push_back(is_unchanged(entry.first, 
+                Runtime::n_runtime_arches.count(entry.first) > 0));
+    }
+    Algs::parallel_for(arches.size(), [&](std::size_t idx) {
+        if (!arches_unchanged[idx]) {
+            compile_archetype(workspace, arches[idx]);
+        }
+    });
+    for (std::size_t idx = 0; idx < arches.size(); ++idx) {
+        const Resour::Oid& id = arche_ids[idx];
+        std::unique_ptr<Work::Arche>& arche = arches[idx];
+        if (arches_unchanged[idx]) {
+            Logger::log()->info("-> %v (unchanged)", id);
+            reuse_runtime(arche->m_runtime, Runtime::n_runtime_arches, 
+                    id, true);
+            for (Script::Regref& func : arche->m_runtime->m_static_funcs) {
+                func = workspace.add_lua_value(func);
+            }
+        } else {
+            Logger::log()->info("-> %v", id);
+            commit_archetype(workspace, arche);
+            reuse_runtime(arche->m_runtime, Runtime::n_runtime_arches, 
+                    id, false);
+        }
+        workspace.add_arche(std::move(arche), id);
     }
 
     Logger::log()->info("Processing genres...");
+    std::vector<Resour::Oid> genre_ids;
+    std::vector<std::unique_ptr<Work::Genre> > genres;
+    std::vector<bool> genres_unchanged;
     for (auto& entry : n_staged_genres) {
-        auto genre = compile_genre(workspace, std::move(entry.second));
-        workspace.add_genre(std::move(genre), entry.first);
+        genre_ids.push_back(entry.first);
+        genres.emplace_back(
+                std::make_unique<Work::Genre>(std::move(entry.second)));
+        genres_unchanged.push_back(is_unchanged(entry.first, 
+                Runtime::n_runtime_genres.count(entry.first) > 0));
+    }
+    Algs::parallel_for(genres.size(), [&](std::size_t idx) {
+        if (!genres_unchanged[idx]) {
+            compile_genre(workspace, genres[idx]);
+        }
+    });
+    for (std::size_t idx = 0; idx < genres.size(); ++idx) {
+        const Resour::Oid& id = genre_ids[idx];
+        reuse_runtime(genres[idx]->m_runtime, Runtime::n_runtime_genres, 
+                id, genres_unchanged[idx]);
+        workspace.add_genre(std::move(genres[idx]), id);
     }
     
-    Runtime::cleanup();
+    // Anything still in the runtime maps was not staged again
+    Logger::log()->info("Removing old definitions...");
+    std::vector<std::unique_ptr<Runtime::Comp> > removed_comps;
+    std::vector<std::unique_ptr<Runtime::Arche> > removed_arches;
+    std::vector<std::unique_ptr<Runtime::Genre> > removed_genres;
+    for (auto& entry : Runtime::n_runtime_comps) {
+        removed_comps.emplace_back(std::move(entry.second));
+    }
+    for (auto& entry : Runtime::n_runtime_arches) {
+        Runtime::Arche* arche = entry.second.get();
+        Runtime::World::for_each([&](Runtime::World* world) {
+            std::size_t num_erased = 
+                    world->get_entities().erase_entities_of(arche);
+            if (num_erased > 0) {
+                Logger::log()->warn("Erased %v entities of removed [%v]", 
+                        num_erased, entry.first);
+            }
+        });
+        removed_arches.emplace_back(std::move(entry.second));
+    }
+    for (auto& entry : Runtime::n_runtime_genres) {
+        removed_genres.emplace_back(std::move(entry.second));
+    }
+    n_compile_stats.m_num_removed = removed_comps.size() 
+            + removed_arches.size() + removed_genres.size();
+    Runtime::n_runtime_comps.clear();
+    Runtime::n_runtime_arches.clear();
+    Runtime::n_runtime_genres.clear();
     
     Logger::log()->info("Moving components...");
     for (const auto& entry : workspace.get_comps_by_id()) {
@@ -640,7 +1135,35 @@ void compile() {
     Logger::log()->info("Moving Lua registry references...");
     Runtime::n_held_lua_values = std::move(workspace.release_lua_uniques());
     
-    Logger::log()->info("Compilation complete");
+    // Removed objects are deleted only after this, so that a new object
+    // cannot have the same address as an old one that is still in a layout
+    Logger::log()->info("Migrating entities...");
+    bool any_changed = 
+            n_compile_stats.m_num_rebuilt + n_compile_stats.m_num_removed > 0;
+    Runtime::World::for_each([&](Runtime::World* world) {
+        for (const auto& entry : old_layouts) {
+            n_compile_stats.m_num_migrated += world->get_entities()
+                    .migrate_entities(entry.first, entry.second);
+        }
+        if (any_changed) {
+            world->get_entities().free_weak_tables();
+        }
+    });
+    
+    // Views that Lua still holds may point into what was just replaced
+    if (any_changed) {
+        Runtime::next_compile_generation();
+    }
+    
+    n_compiled_signatures = std::move(signatures);
+    n_staged_comps.clear();
+    n_staged_arches.clear();
+    n_staged_genres.clear();
+    
+    Logger::log()->info("Compilation complete (%v rebuilt, %v kept, "
+            "%v removed, %v entities migrated)", 
+            n_compile_stats.m_num_rebuilt, n_compile_stats.m_num_kept,
+            n_compile_stats.m_num_removed, n_compile_stats.m_num_migrated);
 }
 
 void overwrite(Resour::Oid id_str, const char* attacker) {
@@ -17,6 +17,8 @@
 #ifndef PEGR_GENSYS_COMPILER_HPP
 #define PEGR_GENSYS_COMPILER_HPP
 
+#include <cstddef>
+
 #include "pegr/gensys/Interm_Types.hpp"
 #include "pegr/gensys/Runtime.hpp"
 
@@ -34,10 +36,38 @@ void cleanup();
 
 /**
  * @brief Transitions to executable mode, turning all of the staged intermediate
- * elements into their post-process types
+ * elements into their post-process types. 
+ * 
+ * If there was a previous compilation (see Gensys::reopen()), then only the
+ * definitions that changed since then are compiled again. Components,
+ * archetypes and genres keep their addresses, and entities of changed
+ * archetypes are migrated to the new layout, keeping their handles. Previous
+ * definitions that were not staged again are removed, along with any entities
+ * of removed archetypes. Views into entities that were made before
+ * recompiling must not be used afterwards.
  */
 void compile();
 
+/**
+ * @brief What the last call to compile() did, counting components,
+ * archetypes and genres together
+ */
+struct Compile_Stats {
+    // New or changed definitions
+    std::size_t m_num_rebuilt = 0;
+    
+    // Definitions identical to the previous compilation
+    std::size_t m_num_kept = 0;
+    
+    // Definitions from the previous compilation that were not staged again
+    std::size_t m_num_removed = 0;
+    
+    // Entities moved to the new layout of a changed archetype
+    std::size_t m_num_migrated = 0;
+};
+
+const Compile_Stats& get_compile_stats();
+
 /**
  * @brief Stages an intermediate component definition for compilation. 
  * This also hands off deletion responsibility to Gensys.
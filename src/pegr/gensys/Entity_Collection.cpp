@@ -16,6 +16,7 @@
 
 #include "pegr/gensys/Entity_Collection.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 #include "pegr/except/Except.hpp"
@@ -23,6 +24,25 @@
 namespace pegr {
 namespace Gensys {
 namespace Runtime {
+
+/**
+ * @return The Entity_Ref stored at the given byte offset of the entity's chunk
+ */
+Entity_Ref* get_ref_in_chunk(Entity* ent, std::size_t byte_offset) {
+    return static_cast<Entity_Ref*>(
+            ent->get_chunk().get_aligned<std::uint64_t>(byte_offset));
+}
+
+/**
+ * @return The byte offset of the Entity_Ref within the entity's chunk
+ */
+std::size_t get_ref_offset_in_chunk(Entity* ent, const Entity_Ref& ref) {
+    std::size_t byte_offset = 
+            reinterpret_cast<const char*>(&ref) 
+            - static_cast<const char*>(ent->get_chunk().get_raw());
+    assert(byte_offset < ent->get_chunk().get_size());
+    return byte_offset;
+}
     
 Entity* Entity_Collection::get_entity(Entity_Handle handle) {
     // Check special case
@@ -39,22 +59,47 @@ Entity* Entity_Collection::get_entity(Entity_Handle handle) {
                 m_queued_handle_to_index, m_queued_vector);
     }
     
+    // Forks copy entities from the parent as they are needed
+    if (!retval && m_parent) {
+        retval = pull_from_parent(handle.get_id());
+    }
+    
     return retval;
 }
 
 void Entity_Collection::clear() {
     assert(!m_deferred_mode);
     
-    m_next_handle = 0;
-    
+    pull_all_from_parent();
+    detach_forks();
     for (Entity& ent : m_vector) {
         if (ent.is_alive()) {
             ent.kill();
         }
     }
+    release();
+}
+
+void Entity_Collection::release() {
+    assert(!m_deferred_mode);
+    
+    detach_from_parent();
+    detach_forks();
+    
+    m_next_handle = m_first_handle;
+    
     m_vector.clear();
     // Very important: otherwise entity handles may wrongly report existence.
     m_handle_to_index.clear();
+    
+    m_backrefs.clear();
+    m_num_backrefs = 0;
+    
+    reset_change_tracking();
+}
+
+std::size_t Entity_Collection::get_num_stored() const {
+    return m_vector.size() + m_queued_vector.size();
 }
 
 Entity_Handle Entity_Collection::new_entity(Arche* arche) {
@@ -65,6 +110,95 @@ Entity_Handle Entity_Collection::new_entity(Arche* arche) {
     }
 }
 
+Entity* Entity_Collection::restore_entity(Arche* arche, Entity_Handle handle) {
+    assert(!m_deferred_mode);
+    assert(m_handle_to_index.find(handle) == m_handle_to_index.end());
+    assert(owns_handle(handle));
+    
+    reserve_for_pulls();
+    m_handle_to_index[handle] = m_vector.size();
+    m_vector.emplace_back(arche, handle);
+    if (handle.get_id() >= m_next_handle) {
+        m_next_handle = handle.get_id() + 1;
+    }
+    
+    Entity& ent = m_vector.back();
+    ent.m_collection = this;
+    
+    // The entity did not exist when the forks were made
+    ent.m_fork_epoch = m_fork_epoch;
+    for (Entity_Collection* fork : m_forks) {
+        std::uint64_t id = 
+                handle.get_id() - m_first_handle + fork->m_first_handle;
+        if (fork->can_pull(id)) {
+            fork->m_hidden.insert(id);
+        }
+    }
+    
+    if (m_tracking_enabled) {
+        // A deleted entity coming back is just a modification
+        if (m_tracked.m_deleted.erase(handle) == 0) {
+            m_tracked.m_created.insert(handle);
+        }
+        ent.m_dirty_epoch = m_dirty_epoch;
+    }
+    return &ent;
+}
+
+std::uint64_t Entity_Collection::get_next_handle() const {
+    return m_next_handle;
+}
+
+void Entity_Collection::set_next_handle(std::uint64_t next_handle) {
+    m_next_handle = next_handle;
+}
+
+void Entity_Collection::set_handle_range(std::uint64_t first_handle, 
+        std::uint64_t end_handle) {
+    assert(first_handle < end_handle);
+    m_first_handle = first_handle;
+    m_end_handle = end_handle;
+    if (m_next_handle < m_first_handle || m_next_handle >= m_end_handle) {
+        m_next_handle = m_first_handle;
+    }
+}
+
+bool Entity_Collection::owns_handle(Entity_Handle handle) const {
+    return handle.get_id() >= m_first_handle 
+            && handle.get_id() < m_end_handle;
+}
+
+void Entity_Collection::fork_from(Entity_Collection& parent) {
+    assert(this != &parent);
+    assert(m_vector.empty() && !m_deferred_mode && !m_parent);
+    if (parent.m_deferred_mode) {
+        throw Except::Runtime(
+                "Cannot fork a world while iterating over its entities");
+    }
+    
+    m_parent = &parent;
+    m_parent_end = parent.m_next_handle - parent.m_first_handle 
+            + m_first_handle;
+    m_next_handle = std::max(m_next_handle, m_parent_end);
+    assert(m_next_handle <= m_end_handle);
+    
+    m_max_pulls = parent.m_vector.size() + parent.m_max_pulls;
+    m_vector.reserve(m_max_pulls);
+    
+    // Built from our own entities once needed
+    m_backrefs_pending = parent.are_backrefs_enabled();
+    
+    // Every entity in the parent must be preserved again before changing
+    parent.m_forks.push_back(this);
+    parent.m_fork_epoch = ++parent.m_last_fork_epoch;
+}
+
+void Entity_Collection::reserve(std::size_t num_entities) {
+    assert(!m_deferred_mode);
+    m_vector.reserve(num_entities);
+    m_handle_to_index.reserve(num_entities);
+}
+
 void Entity_Collection::delete_entity(Entity_Handle handle) {
     if (handle->is_alive()) {
         handle->kill();
@@ -72,6 +206,36 @@ void Entity_Collection::delete_entity(Entity_Handle handle) {
     
     assert(handle->can_be_spawned() || handle->has_been_killed());
     
+    erase_entity(handle);
+}
+
+void Entity_Collection::erase_entity(Entity_Handle handle) {
+    build_pending_backrefs();
+    Entity* ent = get_entity(handle);
+    if (!ent) {
+        return;
+    }
+    if (ent->m_fork_epoch != m_fork_epoch) {
+        preserve_in_forks(ent);
+    }
+    
+    // Otherwise the parent's entity would be copied again
+    if (m_parent && handle.get_id() < m_parent_end) {
+        m_hidden.insert(handle.get_id());
+    }
+    
+    if (m_tracking_enabled) {
+        if (m_tracked.m_created.erase(handle) == 0) {
+            handle->mark_dirty();
+            m_tracked.m_deleted.insert(handle);
+        }
+    }
+    
+    if (m_backrefs_enabled) {
+        forget_refs_from(handle.get_volatile_entity_ptr());
+        clear_refs_to(handle);
+    }
+    
     if (m_deferred_mode) {
         if (!remove_from(handle, m_queued_handle_to_index, m_queued_vector)) {
             /* In deferred mode, we can't remove an entity just yet, since we 
@@ -90,7 +254,7 @@ bool Entity_Collection::does_exist(Entity_Handle handle) {
         return false;
     }
     if (m_handle_to_index.find(handle) == m_handle_to_index.end()) {
-        return false;
+        return m_parent && pull_from_parent(handle.get_id());
     }
     if (m_deferred_mode 
             && m_queued_removals.find(handle) != m_queued_removals.end()) {
@@ -102,6 +266,7 @@ bool Entity_Collection::does_exist(Entity_Handle handle) {
 void Entity_Collection::for_each(std::function<void(Entity*)> for_body) {
     assert(!m_deferred_mode && "Cannot run for_each recursively.");
     
+    pull_all_from_parent();
     enable_deferred();
     for (Entity& ent : m_vector) {
         try {
@@ -114,6 +279,459 @@ void Entity_Collection::for_each(std::function<void(Entity*)> for_body) {
     disable_deferred();
 }
 
+Entity* Entity_Collection::resolve_ref(Entity_Ref& ref) {
+    if (ref.m_packed_id == 0) {
+        return nullptr;
+    }
+    std::uint64_t id = unpack_ref_id(ref.m_packed_id);
+    
+    // Fast path: the entity has not moved since the hint was recorded
+    if (ref.m_slot_hint < m_vector.size()) {
+        Entity& ent = m_vector[ref.m_slot_hint];
+        if (ent.get_handle().get_id() == id && !is_queued_for_removal(id)) {
+            return &ent;
+        }
+    }
+    
+    // Slow path, remember where the entity is for next time
+    auto iter = m_handle_to_index.find(id);
+    if (iter != m_handle_to_index.end()) {
+        if (is_queued_for_removal(id)) {
+            return nullptr;
+        }
+        ref.m_slot_hint = iter->second;
+        return &(m_vector[iter->second]);
+    }
+    
+    // Entities created while deferred have no stable slot yet
+    if (m_deferred_mode) {
+        return get_entity_inside(Entity_Handle(id), 
+                m_queued_handle_to_index, m_queued_vector);
+    }
+    Entity* ent = pull_from_parent(id);
+    if (ent) {
+        ref.m_slot_hint = m_vector.size() - 1;
+    }
+    return ent;
+}
+
+void Entity_Collection::write_ref(Entity* referrer, Entity_Ref& ref, 
+        Entity_Handle target) {
+    build_pending_backrefs();
+    std::uint64_t packed_id = 0;
+    std::uint64_t slot_hint = 0;
+    if (target.get_id() != -1 && !is_queued_for_removal(target.get_id())) {
+        auto iter = m_handle_to_index.find(target);
+        if (iter != m_handle_to_index.end()) {
+            packed_id = pack_ref_id(target.get_id());
+            slot_hint = iter->second;
+        } else if (get_entity(target)) {
+            // Created while deferred, the hint will be fixed on resolution
+            packed_id = pack_ref_id(target.get_id());
+        }
+    }
+    
+    if (m_backrefs_enabled && referrer && ref.m_packed_id != packed_id) {
+        Backref backref;
+        backref.m_referrer = referrer->get_handle().get_id();
+        backref.m_byte_offset = get_ref_offset_in_chunk(referrer, ref);
+        if (ref.m_packed_id != 0) {
+            remove_backref(unpack_ref_id(ref.m_packed_id), backref);
+        }
+        if (packed_id != 0) {
+            add_backref(target.get_id(), backref);
+        }
+    }
+    
+    ref.m_packed_id = packed_id;
+    ref.m_slot_hint = slot_hint;
+}
+
+Entity_Handle Entity_Collection::get_ref_target(const Entity_Ref& ref) const {
+    if (ref.m_packed_id == 0) {
+        return Entity_Handle();
+    }
+    return Entity_Handle(unpack_ref_id(ref.m_packed_id));
+}
+
+std::size_t Entity_Collection::migrate_entities(Arche* arche, 
+        const Arche_Layout& old_layout) {
+    if (m_deferred_mode) {
+        throw Except::Runtime(
+                "Cannot migrate entities while iterating over them");
+    }
+    
+    // Entities still shared with the parent or forks would be missed
+    pull_all_from_parent();
+    detach_forks();
+        std::size_t num_migrated = 0;
+    for (Entity& ent : m_vector) {
+        if (ent.get_arche() != arche) {
+            continue;
+        }
+        ent.migrate(old_layout);
+        ent.free_weak_table();
+        ++num_migrated;
+    }
+    if (num_migrated == 0) {
+        return 0;
+    }
+    
+    // Both of these record offsets into the old chunks
+    if (m_backrefs_enabled) {
+        set_backrefs_enabled(false);
+        set_backrefs_enabled(true);
+    }
+    reset_change_tracking();
+    return num_migrated;
+}
+
+std::size_t Entity_Collection::erase_entities_of(Arche* arche) {
+    if (m_deferred_mode) {
+        throw Except::Runtime(
+                "Cannot erase entities while iterating over them");
+    }
+    pull_all_from_parent();
+    detach_forks();
+    std::vector<Entity_Handle> handles;
+    for (Entity& ent : m_vector) {
+        if (ent.get_arche() == arche) {
+            handles.push_back(ent.get_handle());
+        }
+    }
+    for (Entity_Handle handle : handles) {
+        erase_entity(handle);
+    }
+    return handles.size();
+}
+
+void Entity_Collection::free_weak_tables() {
+    for (Entity& ent : m_vector) {
+        ent.free_weak_table();
+    }
+    for (Entity& ent : m_queued_vector) {
+        ent.free_weak_table();
+    }
+}
+
+void Entity_Collection::set_backrefs_enabled(bool enabled) {
+    m_backrefs_pending = false;
+    if (enabled == m_backrefs_enabled) {
+        return;
+    }
+    m_backrefs.clear();
+    m_num_backrefs = 0;
+    m_backrefs_enabled = enabled;
+    if (enabled) {
+        pull_all_from_parent();
+        for (Entity& ent : m_vector) {
+            if (is_queued_for_removal(ent.get_handle().get_id())) {
+                continue;
+            }
+            index_refs_from(&ent);
+        }
+        for (Entity& ent : m_queued_vector) {
+            index_refs_from(&ent);
+        }
+    }
+}
+
+bool Entity_Collection::are_backrefs_enabled() const {
+    return m_backrefs_enabled || m_backrefs_pending;
+}
+
+std::size_t Entity_Collection::get_num_backrefs() {
+    build_pending_backrefs();
+    return m_num_backrefs;
+}
+
+std::size_t Entity_Collection::clear_refs_to(Entity_Handle target) {
+    build_pending_backrefs();
+    std::uint64_t packed_id = pack_ref_id(target.get_id());
+    std::size_t num_cleared = 0;
+    
+    if (m_backrefs_enabled) {
+        auto iter = m_backrefs.find(target.get_id());
+        if (iter == m_backrefs.end()) {
+            return 0;
+        }
+        for (const Backref& backref : iter->second) {
+            Entity* referrer = get_entity(Entity_Handle(backref.m_referrer));
+            assert(referrer);
+            referrer->mark_dirty();
+            Entity_Ref* ref = get_ref_in_chunk(referrer, backref.m_byte_offset);
+            assert(ref->m_packed_id == packed_id);
+            ref->m_packed_id = 0;
+            ++num_cleared;
+        }
+        m_num_backrefs -= iter->second.size();
+        m_backrefs.erase(iter);
+        return num_cleared;
+    }
+    
+    // No index, so every entity must be checked
+    pull_all_from_parent();
+    auto clear_in = [&](std::vector<Entity>& vec) {
+        for (Entity& ent : vec) {
+            for (std::size_t byte_offset : 
+                    ent.get_arche()->m_entity_ref_offsets) {
+                if (get_ref_in_chunk(&ent, byte_offset)->m_packed_id 
+                        == packed_id) {
+                    ent.mark_dirty();
+                    get_ref_in_chunk(&ent, byte_offset)->m_packed_id = 0;
+                    ++num_cleared;
+                }
+            }
+        }
+    };
+    clear_in(m_vector);
+    clear_in(m_queued_vector);
+    return num_cleared;
+}
+
+void Entity_Collection::add_backref(std::uint64_t target, Backref backref) {
+    m_backrefs[target].push_back(backref);
+    ++m_num_backrefs;
+}
+
+void Entity_Collection::remove_backref(std::uint64_t target, 
+        Backref backref) {
+    auto iter = m_backrefs.find(target);
+    assert(iter != m_backrefs.end());
+    std::vector<Backref>& backrefs = iter->second;
+    for (std::size_t idx = 0; idx < backrefs.size(); ++idx) {
+        if (backrefs[idx].m_referrer == backref.m_referrer
+                && backrefs[idx].m_byte_offset == backref.m_byte_offset) {
+            // Order does not matter
+            backrefs[idx] = backrefs.back();
+            backrefs.pop_back();
+            --m_num_backrefs;
+            break;
+        }
+    }
+    if (backrefs.empty()) {
+        m_backrefs.erase(iter);
+    }
+}
+
+void Entity_Collection::forget_refs_from(Entity* referrer) {
+    Backref backref;
+    backref.m_referrer = referrer->get_handle().get_id();
+    for (std::size_t byte_offset : referrer->get_arche()->m_entity_ref_offsets) {
+        Entity_Ref* ref = get_ref_in_chunk(referrer, byte_offset);
+        if (ref->m_packed_id != 0) {
+            backref.m_byte_offset = byte_offset;
+            remove_backref(unpack_ref_id(ref->m_packed_id), backref);
+        }
+    }
+}
+
+void Entity_Collection::index_refs_from(Entity* referrer) {
+    Backref backref;
+    backref.m_referrer = referrer->get_handle().get_id();
+    for (std::size_t byte_offset : referrer->get_arche()->m_entity_ref_offsets) {
+        Entity_Ref* ref = get_ref_in_chunk(referrer, byte_offset);
+        if (ref->m_packed_id == 0) {
+            continue;
+        }
+        // Stale references to deleted entities are dropped while we are here
+        std::uint64_t target = unpack_ref_id(ref->m_packed_id);
+        if (!get_entity(Entity_Handle(target)) 
+                || is_queued_for_removal(target)) {
+            referrer->mark_dirty();
+            get_ref_in_chunk(referrer, byte_offset)->m_packed_id = 0;
+            continue;
+        }
+        backref.m_byte_offset = byte_offset;
+        add_backref(target, backref);
+    }
+}
+
+void Entity_Collection::set_change_tracking_enabled(bool enabled) {
+    m_tracking_enabled = enabled;
+    reset_change_tracking();
+}
+
+bool Entity_Collection::is_change_tracking_enabled() const {
+    return m_tracking_enabled;
+}
+
+Tracked_Changes Entity_Collection::restart_change_tracking() {
+    assert(m_tracking_enabled);
+    Tracked_Changes retval = std::move(m_tracked);
+    reset_change_tracking();
+    return retval;
+}
+
+std::uint64_t Entity_Collection::get_dirty_epoch() const {
+    return m_dirty_epoch;
+}
+
+void Entity_Collection::record_pre_image(Entity* ent) {
+    assert(m_tracking_enabled);
+    assert(ent->m_dirty_epoch != m_dirty_epoch);
+    ent->m_dirty_epoch = m_dirty_epoch;
+    m_tracked.m_pre_images[ent->get_handle()] = make_image(ent);
+}
+
+Entity_Image Entity_Collection::make_image(const Entity* ent) {
+    Entity_Image image;
+    image.m_id = ent->get_handle().get_id();
+    image.m_arche = ent->get_arche();
+    const char* chunk = static_cast<const char*>(ent->get_chunk().get_raw());
+    image.m_chunk.assign(chunk, chunk + ent->get_chunk().get_size());
+    image.m_string_overrides = ent->get_string_overrides();
+    return image;
+}
+
+void Entity_Collection::reset_change_tracking() {
+    m_tracked.m_next_handle = m_next_handle;
+    m_tracked.m_pre_images.clear();
+    m_tracked.m_created.clear();
+    m_tracked.m_deleted.clear();
+    
+    // Epochs are never reused, so that no entity can be wrongly seen as dirty
+    if (m_tracking_enabled) {
+        m_dirty_epoch = ++m_last_dirty_epoch;
+    } else {
+        m_dirty_epoch = 0;
+    }
+}
+
+std::uint64_t Entity_Collection::get_fork_epoch() const {
+    return m_fork_epoch;
+}
+
+void Entity_Collection::preserve_in_forks(Entity* ent) {
+    ent->m_fork_epoch = m_fork_epoch;
+    for (Entity_Collection* fork : m_forks) {
+        std::uint64_t id = 
+                ent->get_handle().get_id() - m_first_handle 
+                + fork->m_first_handle;
+        if (!fork->can_pull(id)) {
+            continue;
+        }
+        if (ent->is_lua_owned()) {
+            fork->m_hidden.insert(id);
+        } else {
+            fork->copy_from_parent(*ent, id);
+        }
+    }
+}
+
+bool Entity_Collection::can_pull(std::uint64_t id) const {
+    return m_parent
+            && id >= m_first_handle && id < m_parent_end
+            && m_handle_to_index.find(id) == m_handle_to_index.end()
+            && m_hidden.find(id) == m_hidden.end();
+}
+
+Entity* Entity_Collection::pull_from_parent(std::uint64_t id) {
+    if (!can_pull(id)) {
+        return nullptr;
+    }
+    Entity* parent_ent = m_parent->get_entity(
+            Entity_Handle(id - m_first_handle + m_parent->m_first_handle));
+    
+    // Nothing in Lua could refer to the copy, so it could not be deleted
+    if (!parent_ent || parent_ent->is_lua_owned()) {
+        m_hidden.insert(id);
+        return nullptr;
+    }
+    return copy_from_parent(*parent_ent, id);
+}
+
+void Entity_Collection::pull_all_from_parent() {
+    if (!m_parent) {
+        return;
+    }
+    m_parent->pull_all_from_parent();
+    
+    // The parent's queue only has entities created after the fork
+    for (Entity& parent_ent : m_parent->m_vector) {
+        std::uint64_t id = 
+                parent_ent.get_handle().get_id() - m_parent->m_first_handle 
+                + m_first_handle;
+        if (!can_pull(id)) {
+            continue;
+        }
+        if (parent_ent.is_lua_owned()) {
+            m_hidden.insert(id);
+        } else {
+            copy_from_parent(parent_ent, id);
+        }
+    }
+    detach_from_parent();
+}
+
+Entity* Entity_Collection::copy_from_parent(const Entity& parent_ent, 
+        std::uint64_t id) {
+    assert(!m_deferred_mode);
+    assert(m_max_pulls > 0);
+    assert(m_vector.size() < m_vector.capacity());
+    --m_max_pulls;
+    
+    Entity_Handle handle(id);
+    m_handle_to_index[handle] = m_vector.size();
+    m_vector.push_back(Entity(parent_ent, handle));
+    Entity& ent = m_vector.back();
+    ent.m_collection = this;
+    return &ent;
+}
+
+void Entity_Collection::detach_from_parent() {
+    if (!m_parent) {
+        return;
+    }
+    std::vector<Entity_Collection*>& siblings = m_parent->m_forks;
+    siblings.erase(std::remove(siblings.begin(), siblings.end(), this), 
+            siblings.end());
+    if (siblings.empty()) {
+        m_parent->m_fork_epoch = 0;
+    }
+    m_parent = nullptr;
+    m_parent_end = 0;
+    m_hidden.clear();
+    m_max_pulls = 0;
+}
+
+void Entity_Collection::detach_forks() {
+    // Each fork removes itself from the list
+    while (!m_forks.empty()) {
+        m_forks.back()->pull_all_from_parent();
+    }
+}
+
+void Entity_Collection::reserve_for_pulls() {
+    if (!m_parent) {
+        return;
+    }
+    std::size_t needed = m_vector.size() + 1 + m_max_pulls;
+    if (needed > m_vector.capacity()) {
+        m_vector.reserve(std::max(needed, m_vector.capacity() * 2));
+    }
+}
+
+void Entity_Collection::build_pending_backrefs() {
+    if (m_backrefs_pending) {
+        set_backrefs_enabled(true);
+    }
+}
+
+bool Entity_Collection::is_queued_for_removal(std::uint64_t id) const {
+    return m_deferred_mode 
+            && m_queued_removals.find(id) != m_queued_removals.end();
+}
+
+std::uint64_t Entity_Collection::pack_ref_id(std::uint64_t id) const {
+    return id - m_first_handle + 1;
+}
+
+std::uint64_t Entity_Collection::unpack_ref_id(std::uint64_t packed_id) const {
+    assert(packed_id != 0);
+    return packed_id - 1 + m_first_handle;
+}
+
 void Entity_Collection::enable_deferred() {
     assert(!m_deferred_mode);
     m_deferred_mode = true;
@@ -124,9 +742,13 @@ void Entity_Collection::disable_deferred() {
     // Must disable deferred mode right now in order to use the usual methods
     m_deferred_mode = false;
     
+    /* Everything else was already done when the removal was queued (and
+     * doing it again would record the deletion twice)
+     */
     for (std::uint64_t hand : m_queued_removals) {
-        delete_entity(Entity_Handle(hand));
+        remove_from(Entity_Handle(hand), m_handle_to_index, m_vector);
     }
+    m_queued_removals.clear();
     
     std::size_t bottom = m_vector.size();
     if (bottom == 0) {
@@ -159,8 +781,15 @@ Entity_Handle Entity_Collection::emplace_into(Arche* arche,
     // Record what the entity's index in the vector will be
     std::size_t index = vec.size();
     
+    if (m_next_handle >= m_end_handle) {
+        throw Except::Runtime("Out of entity handles");
+    }
     Entity_Handle hand(m_next_handle);
     
+    if (&vec == &m_vector) {
+        reserve_for_pulls();
+    }
+    
     // Emplace-back a new entity
     vec.emplace_back(arche, hand);
     
@@ -169,6 +798,16 @@ Entity_Handle Entity_Collection::emplace_into(Arche* arche,
     
     // Get the entity we just created by reference
     Entity& ent = vec.back();
+    ent.m_collection = this;
+    
+    // Forks cannot see entities made after them
+    ent.m_fork_epoch = m_fork_epoch;
+    
+    // Nothing to record for new entities, they are saved entirely
+    if (m_tracking_enabled) {
+        m_tracked.m_created.insert(hand);
+        ent.m_dirty_epoch = m_dirty_epoch;
+    }
     
     // Map the entity handle to that index in the vector
     hti[hand] = index;
@@ -181,8 +820,6 @@ bool Entity_Collection::remove_from(Entity_Handle handle_a,
         std::unordered_map<std::uint64_t, std::size_t>& hti,
         std::vector<Entity>& vec) {
     
-    assert(handle_a->can_be_spawned() || handle_a->has_been_killed());
-    
     /* Delete the entity given by the handle (entity "A") by swapping it with
      * the last entity in the vector (entity "B"), then popping off the last
      * entity (A). Must also update B's index (set B's index to A's old index).
@@ -29,6 +29,37 @@ namespace pegr {
 namespace Gensys {
 namespace Runtime {
 
+/**
+ * @class Entity_Image
+ * @brief A copy of all of an entity's saved data at some point in time
+ */
+struct Entity_Image {
+    std::uint64_t m_id;
+    Arche* m_arche;
+    std::vector<char> m_chunk;
+    std::vector<Entity::String_Override> m_string_overrides;
+};
+
+/**
+ * @class Tracked_Changes
+ * @brief Everything that happened to the collection since change tracking
+ * last (re)started.
+ */
+struct Tracked_Changes {
+    // The next handle when tracking started
+    std::uint64_t m_next_handle;
+    
+    // State before the first modification of any entity that existed when
+    // tracking started (this includes the deleted entities)
+    std::unordered_map<std::uint64_t, Entity_Image> m_pre_images;
+    
+    // Entities that did not exist when tracking started and still exist
+    std::unordered_set<std::uint64_t> m_created;
+    
+    // Entities that existed when tracking started and no longer exist
+    std::unordered_set<std::uint64_t> m_deleted;
+};
+
 class Entity_Collection {
 public:
     
@@ -53,13 +84,214 @@ public:
      * @param handle The handle of the entity
      */
     void delete_entity(Entity_Handle handle);
+    
+    /**
+     * @brief Removes the entity in any state without killing it first, and
+     * therefore without triggering any events. Used when restoring saved
+     * state. Does nothing if we do not contain that handle.
+     * @param handle The handle of the entity
+     */
+    void erase_entity(Entity_Handle handle);
 
     bool does_exist(Entity_Handle handle);
     void for_each(std::function<void(Entity*)> for_body);
     
+    /**
+     * @brief Create a new entity using a specific handle, which must not be in
+     * use and must be within this collection's range (see owns_handle()).
+     * Used when restoring the collection from a snapshot. The entity starts
+     * with the archetype defaults, as with new_entity().
+     * @param arche The archetype to use
+     * @param handle The handle that the entity previously had
+     * @return Pointer to the entity (volatile)
+     */
+    Entity* restore_entity(Arche* arche, Entity_Handle handle);
+    
+    /**
+     * @brief The handle that the next new entity will receive. Handles are
+     * never reused, so this must be saved and restored along with entities.
+     */
+    std::uint64_t get_next_handle() const;
+    void set_next_handle(std::uint64_t next_handle);
+    
+    /**
+     * @brief Sets the range of entity ids that this collection hands out (see
+     * World). Clearing the collection starts again from the first id.
+     * @param first_handle The first id
+     * @param end_handle One past the last id
+     */
+    void set_handle_range(std::uint64_t first_handle, 
+            std::uint64_t end_handle);
+    
+    /**
+     * @return If the handle's id is within this collection's range, whether
+     * or not the entity exists
+     */
+    bool owns_handle(Entity_Handle handle) const;
+    
+    /**
+     * @brief Makes this empty collection a fork of the parent, which then
+     * appears to contain a copy of every entity in the parent (except
+     * Lua-owned ones). Entity ids are moved from the parent's range to ours.
+     * 
+     * Nothing is copied yet: an entity is copied from the parent when it is
+     * first used here, or by the parent just before the parent changes or
+     * erases it (see preserve_in_forks()). Chunks are shared by both copies
+     * until either is written to (see Entity::mark_dirty()). Iterating over
+     * the fork, building its back-reference index (which is enabled if the
+     * parent's is, and built the first time it is needed) or migrating its
+     * entities copies everything that is left. Change tracking is not copied.
+     * 
+     * The parent must not be used from another thread until the fork has
+     * copied everything or has been released.
+     * Can throw runtime errors if the parent is iterating over its entities.
+     * @param parent The collection to fork from
+     */
+    void fork_from(Entity_Collection& parent);
+    
+    /**
+     * @brief Removes every entity without killing any of them, and so without
+     * triggering any events. Used to discard forks. Forks of this collection
+     * copy all of their entities first.
+     */
+    void release();
+    
+    /**
+     * @return The number of entities actually stored here, which for a fork
+     * leaves out the entities that have not been copied from the parent yet
+     */
+    std::size_t get_num_stored() const;
+    
+    /**
+     * @return Entities with this value in m_fork_epoch do not need to be
+     * copied into forks before being changed. Zero if there are no forks.
+     */
+    std::uint64_t get_fork_epoch() const;
+    
+    /**
+     * @brief Copies the entity into every fork that has not copied it yet,
+     * so that the forks do not see the changes about to be made to it. Use
+     * Entity::mark_dirty() instead.
+     */
+    void preserve_in_forks(Entity* ent);
+    
+    /**
+     * @brief Updates every entity of the archetype after it was recompiled
+     * (see Entity::migrate()). Handles are kept. The back-reference index is
+     * rebuilt and change tracking restarts, since both depend on the layout.
+     * Can throw runtime errors if iterating over the entities.
+     * @param arche The recompiled archetype
+     * @param old_layout What the archetype looked like before
+     * @return The number of entities that were migrated
+     */
+    std::size_t migrate_entities(Arche* arche, const Arche_Layout& old_layout);
+    
+    /**
+     * @brief Erases every entity of the archetype (see erase_entity()), for
+     * when the archetype itself is about to be deleted.
+     * Can throw runtime errors if iterating over the entities.
+     * @param arche The archetype
+     * @return The number of entities that were erased
+     */
+    std::size_t erase_entities_of(Arche* arche);
+    
+    /**
+     * @brief Drops every entity's weak table, which may hold views into
+     * archetypes and genres that have since been recompiled
+     */
+    void free_weak_tables();
+    
+    /**
+     * @brief Reserves space for the given number of entities
+     */
+    void reserve(std::size_t num_entities);
+    
+    /**
+     * @brief Finds the entity referred to by an Entity_Ref. If the slot hint
+     * is still correct, this is only an array access. Otherwise, the hint is
+     * updated using the usual handle lookup.
+     * @param ref The reference (slot hint may be modified)
+     * @return The entity or nullptr if the entity does not exist
+     */
+    Entity* resolve_ref(Entity_Ref& ref);
+    
+    /**
+     * @brief Points an Entity_Ref at a new entity, maintaining the
+     * back-reference index (if enabled). Non-existent entities are stored as
+     * null references.
+     * @param referrer The entity whose chunk holds the reference, or nullptr
+     * if the reference lives elsewhere (e.g. shared members). References
+     * without a referrer are not tracked by the back-reference index.
+     * @param ref The reference to overwrite
+     * @param target The entity to point to
+     */
+    void write_ref(Entity* referrer, Entity_Ref& ref, Entity_Handle target);
+    
+    /**
+     * @return The entity that the reference points to, which may no longer
+     * exist, or a null handle
+     */
+    Entity_Handle get_ref_target(const Entity_Ref& ref) const;
+    
+    /**
+     * @brief Enables or disables the back-reference index. Enabling indexes
+     * all references in existing entities. While enabled, deleting an entity
+     * also nulls all references to it.
+     */
+    void set_backrefs_enabled(bool enabled);
+    bool are_backrefs_enabled() const;
+    
+    /**
+     * @return The number of references recorded in the back-reference index
+     */
+    std::size_t get_num_backrefs();
+    
+    /**
+     * @brief Sets all per-entity references to the target to null. Uses the
+     * back-reference index if enabled, otherwise scans every entity.
+     * @param target The entity to forget
+     * @return The number of references that were cleared
+     */
+    std::size_t clear_refs_to(Entity_Handle target);
+    
+    /**
+     * @brief Enables or disables change tracking. While enabled, the first
+     * write to any entity copies that entity's prior state (see
+     * Entity::mark_dirty()), and creations and deletions are recorded.
+     * Clearing the collection restarts tracking.
+     */
+    void set_change_tracking_enabled(bool enabled);
+    bool is_change_tracking_enabled() const;
+    
+    /**
+     * @brief Returns everything that changed since tracking last restarted,
+     * and then restarts tracking from the current state.
+     * Change tracking must be enabled.
+     */
+    Tracked_Changes restart_change_tracking();
+    
+    /**
+     * @return Entities with this value in m_dirty_epoch have already been
+     * recorded. Zero if not tracking changes.
+     */
+    std::uint64_t get_dirty_epoch() const;
+    
+    /**
+     * @brief Records the state of an entity before it is modified. Use
+     * Entity::mark_dirty() instead.
+     */
+    void record_pre_image(Entity* ent);
+    
+    /**
+     * @return A copy of the entity's chunk and strings
+     */
+    static Entity_Image make_image(const Entity* ent);
+    
 private:
 
     std::uint64_t m_next_handle = 0;
+    std::uint64_t m_first_handle = 0;
+    std::uint64_t m_end_handle = -1;
     std::unordered_map<std::uint64_t, std::size_t> m_handle_to_index;
     std::vector<Entity> m_vector;
     
@@ -75,6 +307,116 @@ private:
     std::unordered_map<std::uint64_t, std::size_t> m_queued_handle_to_index;
     std::vector<Entity> m_queued_vector;
     
+    /* Back-reference index, maps the id of a referenced entity to the
+     * locations of all per-entity references to it. Only maintained while
+     * m_backrefs_enabled is set.
+     */
+    struct Backref {
+        std::uint64_t m_referrer;
+        std::size_t m_byte_offset;
+    };
+    bool m_backrefs_enabled = false;
+    std::unordered_map<std::uint64_t, std::vector<Backref> > m_backrefs;
+    std::size_t m_num_backrefs = 0;
+    
+    void add_backref(std::uint64_t target, Backref backref);
+    void remove_backref(std::uint64_t target, Backref backref);
+    
+    /**
+     * @brief Removes all of the references held by the entity from the
+     * back-reference index
+     */
+    void forget_refs_from(Entity* referrer);
+    
+    /**
+     * @brief Adds all of the references held by the entity to the
+     * back-reference index
+     */
+    void index_refs_from(Entity* referrer);
+    
+    bool is_queued_for_removal(std::uint64_t id) const;
+    
+    /**
+     * @brief Converts between entity ids and the relative ids stored in
+     * Entity_Refs. Zero is the null reference.
+     */
+    std::uint64_t pack_ref_id(std::uint64_t id) const;
+    std::uint64_t unpack_ref_id(std::uint64_t packed_id) const;
+    
+    /* Change tracking, see set_change_tracking_enabled(). The epoch is
+     * incremented whenever tracking restarts, which implicitly makes every
+     * entity clean again.
+     */
+    bool m_tracking_enabled = false;
+    std::uint64_t m_dirty_epoch = 0;
+    std::uint64_t m_last_dirty_epoch = 0;
+    Tracked_Changes m_tracked;
+    
+    void reset_change_tracking();
+    
+    /* Forks, see fork_from(). Until a fork is detached from its parent, ids
+     * in the fork below m_parent_end that are not stored or hidden refer to
+     * entities that are still only in the parent. Those entities are
+     * unchanged since the fork was made. Forks are never in deferred mode
+     * while attached, since for_each() copies everything first.
+     */
+    Entity_Collection* m_parent = nullptr;
+    std::uint64_t m_parent_end = 0;
+    std::unordered_set<std::uint64_t> m_hidden;
+    
+    /* The most entities that may still be copied from the parent. Space for
+     * them is reserved so that copying (which can happen on any lookup) never
+     * moves the entities that are already stored.
+     */
+    std::size_t m_max_pulls = 0;
+    
+    // Set if the back-reference index is enabled but has not been built yet
+    bool m_backrefs_pending = false;
+    
+    std::vector<Entity_Collection*> m_forks;
+    std::uint64_t m_fork_epoch = 0;
+    std::uint64_t m_last_fork_epoch = 0;
+    
+    /**
+     * @return Whether the id refers to an entity that might still be only in
+     * the parent
+     */
+    bool can_pull(std::uint64_t id) const;
+    
+    /**
+     * @brief Copies the entity with the given id from the parent, if it is
+     * still only there
+     * @return The copy, or nullptr if the entity is not in this fork
+     */
+    Entity* pull_from_parent(std::uint64_t id);
+    
+    /**
+     * @brief Copies every remaining entity from the parent and then detaches
+     * from the parent. Does nothing if not attached to a parent.
+     */
+    void pull_all_from_parent();
+    
+    Entity* copy_from_parent(const Entity& parent_ent, std::uint64_t id);
+    
+    /**
+     * @brief Stops reading from the parent, whether or not every entity was
+     * copied
+     */
+    void detach_from_parent();
+    
+    /**
+     * @brief Makes every fork copy its remaining entities from us
+     */
+    void detach_forks();
+    
+    /**
+     * @brief Makes room for a new entity and every entity that may still be
+     * copied from the parent
+     */
+    void reserve_for_pulls();
+    
+    void build_pending_backrefs();
+    
     void enable_deferred();
     void disable_deferred();
     
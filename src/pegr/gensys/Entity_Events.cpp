@@ -16,7 +16,11 @@
 
 #include "pegr/gensys/Entity_Events.hpp"
 
+#include <cstdint>
+
+#include "pegr/debug/Trace.hpp"
 #include "pegr/gensys/Runtime.hpp"
+#include "pegr/gensys/World.hpp"
 
 namespace pegr {
 namespace Gensys {
@@ -25,13 +29,24 @@ namespace Event {
 const Listener_Handle EMPTY_HANDLE = 
         Algs::QIFU_Map<Listener_Handle, void*>::EMPTY_HANDLE;
 
+void set_replaying(bool replaying) {
+    Runtime::get_current_world()->set_replaying(replaying);
+}
+bool is_replaying() {
+    return Runtime::get_current_world()->is_replaying();
+}
+
 Entity_Listener::Entity_Listener(
-        std::function<void(Runtime::Entity*)> func)
-: m_func(func) {}
+        std::function<void(Runtime::Entity*)> func, bool replayable)
+: m_func(func)
+, m_replayable(replayable) {}
 
 void Entity_Listener::call(Runtime::Entity* ent) {
     m_func(ent);
 }
+bool Entity_Listener::is_replayable() const {
+    return m_replayable;
+}
 
 Entity_Tick_Event::Entity_Tick_Event()
 : Schedu::Event() {}
@@ -58,17 +73,24 @@ Schedu::Event::Type Entity_Tick_Event::get_type() const {
 }
 
 void Entity_Tick_Event::trigger() {
+    PEGR_TRACE_SCOPE("gensys", "Entity_Tick_Event::trigger");
     m_arche_listeners.for_each([](Arche_Entity_Listener* listener) {
+        PEGR_TRACE_SCOPE_ARG("gensys", "Arche_Entity_Listener", 
+                reinterpret_cast<std::uintptr_t>(listener));
         Runtime::get_entities().for_each([&](Runtime::Entity* ent) {
             if (ent->is_alive()) listener->call(ent);
         });
     });
     m_comp_listeners.for_each([](Comp_Entity_Listener* listener) {
+        PEGR_TRACE_SCOPE_ARG("gensys", "Comp_Entity_Listener", 
+                reinterpret_cast<std::uintptr_t>(listener));
         Runtime::get_entities().for_each([&](Runtime::Entity* ent) {
             if (ent->is_alive()) listener->call(ent);
         });
     });
     m_genre_listeners.for_each([](Genre_Entity_Listener* listener) {
+        PEGR_TRACE_SCOPE_ARG("gensys", "Genre_Entity_Listener", 
+                reinterpret_cast<std::uintptr_t>(listener));
         Runtime::get_entities().for_each([&](Runtime::Entity* ent) {
             if (ent->is_alive()) listener->call(ent);
         });
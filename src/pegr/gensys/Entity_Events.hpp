@@ -32,14 +32,30 @@ typedef std::uint64_t Listener_Handle;
 
 extern const Listener_Handle EMPTY_HANDLE;
 
+/**
+ * @brief Set while ticks are being simulated again after a rollback (see
+ * Rollback::Rollback_Buffer::replay()). Listeners with side-effects outside of
+ * the entity collection (sounds, network messages, etc.) should not run twice.
+ * Applies to the current world.
+ */
+void set_replaying(bool replaying);
+bool is_replaying();
+
 class Entity_Listener {
 public:
-    Entity_Listener(std::function<void(Runtime::Entity*)> func);
+    /**
+     * @param func The function to call
+     * @param replayable If false, the listener is skipped while replaying
+     */
+    Entity_Listener(std::function<void(Runtime::Entity*)> func, 
+            bool replayable = true);
     
     void call(Runtime::Entity* ent);
+    bool is_replayable() const;
     
 private:
     std::function<void(Runtime::Entity*)> m_func;
+    bool m_replayable;
 };
 
 template<typename Select_T>
@@ -122,8 +138,11 @@ public:
         return s_event_type;
     }
     void trigger(Runtime::Entity* ent) {
-        m_listeners.for_each([ent](Entity_Listener* listener) {
-            listener->call(ent);
+        bool replaying = is_replaying();
+        m_listeners.for_each([ent, replaying](Entity_Listener* listener) {
+            if (!replaying || listener->is_replayable()) {
+                listener->call(ent);
+            }
         });
     }
     
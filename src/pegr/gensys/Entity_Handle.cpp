@@ -16,13 +16,11 @@
 
 #include "pegr/gensys/Entity_Handle.hpp"
 
-#include "pegr/gensys/Entity_Collection.hpp"
+#include "pegr/gensys/World.hpp"
 
 namespace pegr {
 namespace Gensys {
 namespace Runtime {
-    
-extern Entity_Collection n_ent_collection;
 
 Entity_Handle::Entity_Handle(uint64_t id)
 : m_entity_id(id) {}
@@ -34,7 +32,8 @@ uint64_t Entity_Handle::get_id() const {
     return m_entity_id;
 }
 bool Entity_Handle::does_exist() const {
-    return n_ent_collection.does_exist(*this);
+    World* world = World::find(m_entity_id);
+    return world && world->get_entities().does_exist(*this);
 }
 Entity* Entity_Handle::operator ->() const {
     return get_entity();
@@ -51,7 +50,11 @@ Entity* Entity_Handle::get_volatile_entity_ptr() const {
 }
 
 Entity* Entity_Handle::get_entity() const {
-    return n_ent_collection.get_entity(*this);
+    World* world = World::find(m_entity_id);
+    if (!world) {
+        return nullptr;
+    }
+    return world->get_entities().get_entity(*this);
 }
 
 } // namespace Runtime
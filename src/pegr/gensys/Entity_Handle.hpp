@@ -38,6 +38,9 @@ class Entity;
  * converting them into 64-bit floats), the bottom 52 bits are also guaranteed
  * to be unique. (2^53 is the smallest positive value that, when stored in a 
  * 64-bit IEEE 754 double, cannot be incremented by one).
+ * 
+ * The top bits of those 52 are the index of the World that the entity belongs
+ * to (see WORLD_ID_SHIFT), which is how a handle finds its entity.
  */
 class Entity_Handle {
 public:
@@ -17,23 +17,20 @@
 #include "pegr/gensys/Events.hpp"
 
 #include "pegr/engine/Engine.hpp"
+#include "pegr/gensys/World.hpp"
 
 namespace pegr {
 namespace Gensys {
 namespace Event {
     
-Entity_Spawned_Event* n_spawned;
-Entity_Tick_Event* n_tick;
-Entity_Killed_Event* n_killed;
-
 Entity_Spawned_Event* get_entity_spawned_event() {
-    return n_spawned;
+    return Runtime::get_current_world()->get_spawned_event();
 }
 Entity_Tick_Event* get_entity_tick_event() {
-    return n_tick;
+    return Runtime::get_current_world()->get_tick_event();
 }
 Entity_Killed_Event* get_entity_killed_event() {
-    return n_killed;
+    return Runtime::get_current_world()->get_killed_event();
 }
 
 template<typename Event_T>
@@ -43,15 +40,15 @@ Event_T* reg_event(const char* name) {
 }
 
 void initialize() {
-    n_spawned = reg_event<Entity_Spawned_Event>("entity_spawned.ev");
-    n_tick = reg_event<Entity_Tick_Event>("entity_tick.ev");
-    n_killed = reg_event<Entity_Killed_Event>("entity_killed.ev");
+    // The default world's events are the ones that scripts can find
+    Runtime::get_default_world().use_events(
+            reg_event<Entity_Spawned_Event>("entity_spawned.ev"),
+            reg_event<Entity_Tick_Event>("entity_tick.ev"),
+            reg_event<Entity_Killed_Event>("entity_killed.ev"));
 }
 
 void cleanup() {
-    Entity_Spawned_Event* n_spawned = nullptr;
-    Entity_Tick_Event* n_tick = nullptr;
-    Entity_Killed_Event* n_killed = nullptr;
+    Runtime::get_default_world().use_events(nullptr, nullptr, nullptr);
 }
 
 } // namespace Events
@@ -23,6 +23,8 @@ namespace pegr {
 namespace Gensys {
 namespace Event {
 
+/* These return the events of the current world, see Runtime::World
+ */
 Entity_Spawned_Event* get_entity_spawned_event();
 Entity_Tick_Event* get_entity_tick_event();
 Entity_Killed_Event* get_entity_killed_event();
@@ -16,6 +16,7 @@
 
 #include "pegr/gensys/Gensys.hpp"
 
+#include "pegr/gensys/Cache.hpp"
 #include "pegr/gensys/Compiler.hpp"
 #include "pegr/gensys/Events.hpp"
 #include "pegr/gensys/Runtime.hpp"
@@ -42,6 +43,19 @@ void compile() {
     Compiler::compile();
     m_global_state = GlobalState::EXECUTABLE;
 }
+void reopen() {
+    assert(m_global_state == GlobalState::EXECUTABLE);
+    m_global_state = GlobalState::MUTABLE;
+}
+bool compile_cached(const boost::filesystem::path& file, std::uint64_t key,
+        Script::Regref env) {
+    assert(m_global_state == GlobalState::MUTABLE);
+    if (!Cache::load_cache(file, key, env)) {
+        return false;
+    }
+    m_global_state = GlobalState::EXECUTABLE;
+    return true;
+}
 void cleanup() {
     assert(m_global_state != GlobalState::UNINITIALIZED);
     Event::cleanup();
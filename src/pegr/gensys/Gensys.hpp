@@ -17,6 +17,12 @@
 #ifndef PEGR_GENSYS_GENSYS_HPP
 #define PEGR_GENSYS_GENSYS_HPP
 
+#include <cstdint>
+
+#include <boost/filesystem.hpp>
+
+#include "pegr/script/Script.hpp"
+
 namespace pegr {
 namespace Gensys {
 
@@ -37,6 +43,27 @@ GlobalState get_global_state();
 
 void initialize();
 void compile();
+
+/**
+ * @brief Returns from the executable stage to the mutable stage without
+ * destroying anything, so that changed definitions can be staged and
+ * compiled again (see Compiler::compile()). Entities cannot be used from Lua
+ * until then.
+ */
+void reopen();
+
+/**
+ * @brief Alternative to compile(). Replaces the runtime with the contents of
+ * a cache file written by Cache::save_cache(), skipping compilation. Staged
+ * objects are ignored.
+ * @param file The cache file
+ * @param key Hash of the inputs that the cache must have been saved with
+ * @param env The environment given to the cached functions
+ * @return If the cache was used. If false, nothing is changed and compile()
+ * must be called instead.
+ */
+bool compile_cached(const boost::filesystem::path& file, std::uint64_t key,
+        Script::Regref env);
 void cleanup();
     
 } // namespace Gensys
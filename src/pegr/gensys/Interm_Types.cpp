@@ -227,6 +227,8 @@ const char* prim_type_to_debug_str(Prim::Type t) {
             return "STR";
         case Prim::Type::FUNC:
             return "FUNC";
+        case Prim::Type::ENTITY:
+            return "ENTITY";
         case Prim::Type::UNKNOWN:
             return "UNKNOWN";
         default:
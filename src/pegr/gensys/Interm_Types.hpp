@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <map>
+#include <set>
 #include <vector>
 
 #include "pegr/algs/Pod_Chunk.hpp"
@@ -35,6 +36,7 @@ public:
         FUNC,
         F32, F64,
         I32, I64,
+        ENTITY,
         UNKNOWN,
         ENUM_SIZE
     };
@@ -102,6 +104,9 @@ struct Comp {
 
     // Named members with primitive values
     std::map<Symbol, Prim> m_members;
+    
+    // Members that are stored once per archetype rather than per entity
+    std::set<Symbol> m_shared_members;
 };
 
 struct Arche {
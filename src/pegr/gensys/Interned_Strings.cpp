@@ -0,0 +1,216 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/gensys/Interned_Strings.hpp"
+
+#include <cassert>
+#include <memory>
+#include <unordered_map>
+
+#include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/except/Except.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Runtime {
+
+// Owns every entry, keyed by contents
+std::unordered_map<std::string, std::unique_ptr<Interned_String> > 
+        n_interned_strings;
+
+// Same entries, keyed by the address of the Lua string's data
+std::unordered_map<const char*, Interned_String*> n_interned_by_lua_data;
+
+Istr_Ptr::Istr_Ptr()
+: m_entry(nullptr) {}
+
+Istr_Ptr::Istr_Ptr(Interned_String* entry)
+: m_entry(entry) {
+    if (m_entry) {
+        ++m_entry->m_refcount;
+    }
+}
+
+Istr_Ptr::Istr_Ptr(const Istr_Ptr& rhs)
+: Istr_Ptr(rhs.m_entry) {}
+
+Istr_Ptr::Istr_Ptr(Istr_Ptr&& rhs)
+: m_entry(rhs.m_entry) {
+    rhs.m_entry = nullptr;
+}
+
+Istr_Ptr& Istr_Ptr::operator =(const Istr_Ptr& rhs) {
+    if (rhs.m_entry) {
+        ++rhs.m_entry->m_refcount;
+    }
+    release();
+    m_entry = rhs.m_entry;
+    return *this;
+}
+
+Istr_Ptr& Istr_Ptr::operator =(Istr_Ptr&& rhs) {
+    if (this != &rhs) {
+        release();
+        m_entry = rhs.m_entry;
+        rhs.m_entry = nullptr;
+    }
+    return *this;
+}
+
+Istr_Ptr::~Istr_Ptr() {
+    release();
+}
+
+const std::string& Istr_Ptr::get_string() const {
+    static const std::string empty_string;
+    if (!m_entry) {
+        return empty_string;
+    }
+    return m_entry->m_str;
+}
+
+Script::Regref Istr_Ptr::get_lua_ref() const {
+    if (!m_entry) {
+        return LUA_REFNIL;
+    }
+    return m_entry->m_lua_str;
+}
+
+bool Istr_Ptr::is_nullptr() const {
+    return m_entry == nullptr;
+}
+
+bool Istr_Ptr::operator ==(const Istr_Ptr& rhs) const {
+    return m_entry == rhs.m_entry;
+}
+bool Istr_Ptr::operator !=(const Istr_Ptr& rhs) const {
+    return m_entry != rhs.m_entry;
+}
+
+void Istr_Ptr::release() {
+    if (!m_entry) {
+        return;
+    }
+    assert(m_entry->m_refcount > 0);
+    --m_entry->m_refcount;
+    if (m_entry->m_refcount == 0) {
+        Script::drop_reference(m_entry->m_lua_str);
+        n_interned_by_lua_data.erase(m_entry->m_lua_data);
+        auto iter = n_interned_strings.find(m_entry->m_str);
+        assert(iter != n_interned_strings.end());
+        n_interned_strings.erase(iter); // Deletes the entry
+    }
+    m_entry = nullptr;
+}
+
+/**
+ * @brief Adds a new entry for the Lua string at the top of the stack
+ * [BALANCED]
+ */
+Interned_String* new_interned_string(std::string&& str) {
+    assert_balance(0);
+    lua_State* l = Script::get_lua_state();
+    assert(lua_type(l, -1) == LUA_TSTRING);
+    
+    std::unique_ptr<Interned_String> entry = 
+            std::make_unique<Interned_String>();
+    entry->m_lua_data = lua_tostring(l, -1);
+    entry->m_refcount = 0;
+    lua_pushvalue(l, -1);
+    entry->m_lua_str = Script::grab_reference();
+    entry->m_str = std::move(str);
+    
+    Interned_String* retval = entry.get();
+    n_interned_by_lua_data[retval->m_lua_data] = retval;
+    n_interned_strings[retval->m_str] = std::move(entry);
+    return retval;
+}
+
+Istr_Ptr intern_string(const std::string& str) {
+    auto iter = n_interned_strings.find(str);
+    if (iter != n_interned_strings.end()) {
+        return Istr_Ptr(iter->second.get());
+    }
+    assert_balance(0);
+    lua_State* l = Script::get_lua_state();
+    lua_pushlstring(l, str.c_str(), str.size());
+    Script::Pop_Guard pop_guard(1);
+    return Istr_Ptr(new_interned_string(std::string(str)));
+}
+
+Istr_Ptr intern_lua_string(int idx) {
+    assert_balance(0);
+    lua_State* l = Script::get_lua_state();
+    idx = Script::absolute_idx(idx);
+    
+    // Copy, since lua_tolstring may convert numbers in-place
+    lua_pushvalue(l, idx);
+    Script::Pop_Guard pop_guard(1);
+    std::size_t strlen;
+    const char* strdata = lua_tolstring(l, -1, &strlen);
+    if (!strdata) {
+        throw Except::Runtime("Value is not a string");
+    }
+    
+    // Fast path, the exact same Lua string is already interned
+    auto iter = n_interned_by_lua_data.find(strdata);
+    if (iter != n_interned_by_lua_data.end()) {
+        return Istr_Ptr(iter->second);
+    }
+    
+    std::string str(strdata, strlen);
+    auto content_iter = n_interned_strings.find(str);
+    if (content_iter != n_interned_strings.end()) {
+        return Istr_Ptr(content_iter->second.get());
+    }
+    return Istr_Ptr(new_interned_string(std::move(str)));
+}
+
+std::size_t get_num_interned_strings() {
+    return n_interned_strings.size();
+}
+
+std::size_t get_string_heap_bytes(const std::string& str) {
+    // Empty strings always use the inline buffer, if there is one
+    static const std::size_t inline_capacity = std::string().capacity();
+    if (str.capacity() <= inline_capacity) {
+        return 0;
+    }
+    return str.capacity() + 1;
+}
+
+void get_interned_string_bytes(std::size_t& heap_bytes, 
+        std::size_t& inline_bytes) {
+    heap_bytes = 0;
+    inline_bytes = 0;
+    auto add_string = [&](const std::string& str) {
+        std::size_t str_heap_bytes = get_string_heap_bytes(str);
+        if (str_heap_bytes > 0) {
+            heap_bytes += str_heap_bytes;
+        } else {
+            inline_bytes += str.size();
+        }
+    };
+    for (const auto& entry : n_interned_strings) {
+        // The key is a second copy of the contents
+        add_string(entry.first);
+        add_string(entry.second->m_str);
+    }
+}
+
+} // namespace Runtime
+} // namespace Gensys
+} // namespace pegr
@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_GENSYS_INTERNEDSTRINGS_HPP
+#define PEGR_GENSYS_INTERNEDSTRINGS_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "pegr/script/Script.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Runtime {
+
+/**
+ * @class Interned_String
+ * @brief An entry in the interned string table. Every unique string value
+ * stored in an entity is kept here exactly once, along with a registry
+ * reference to the equivalent Lua string. This means that pushing a string
+ * member onto the Lua stack does not require hashing the string again.
+ */
+struct Interned_String {
+    std::string m_str;
+    
+    // Reference to the Lua string with the same contents
+    Script::Regref m_lua_str;
+    
+    /* Lua strings are themselves interned, and so as long as m_lua_str is
+     * held, this pointer uniquely identifies the string's contents. Used as a
+     * key to find entries without rehashing on writes from Lua.
+     */
+    const char* m_lua_data;
+    
+    // Number of Istr_Ptr instances referring to this entry
+    std::size_t m_refcount;
+};
+
+/**
+ * @class Istr_Ptr
+ * @brief Reference-counted pointer into the interned string table. When no
+ * Istr_Ptr refers to an entry anymore, the entry is removed from the table.
+ */
+class Istr_Ptr {
+public:
+    /**
+     * @brief Constructs a nullptr
+     */
+    Istr_Ptr();
+    explicit Istr_Ptr(Interned_String* entry);
+    
+    Istr_Ptr(const Istr_Ptr& rhs);
+    Istr_Ptr(Istr_Ptr&& rhs);
+    Istr_Ptr& operator =(const Istr_Ptr& rhs);
+    Istr_Ptr& operator =(Istr_Ptr&& rhs);
+    ~Istr_Ptr();
+    
+    /**
+     * @return The string value. Empty if this is nullptr.
+     */
+    const std::string& get_string() const;
+    
+    /**
+     * @return Registry reference to the Lua string. Nil if this is nullptr.
+     */
+    Script::Regref get_lua_ref() const;
+    
+    bool is_nullptr() const;
+    
+    // Interned strings are equal iff they point to the same entry
+    bool operator ==(const Istr_Ptr& rhs) const;
+    bool operator !=(const Istr_Ptr& rhs) const;
+    
+private:
+    Interned_String* m_entry;
+    
+    void release();
+};
+
+/**
+ * @brief Finds or creates the interned string with the given contents
+ * @param str The string
+ * @return Pointer to the interned string
+ */
+Istr_Ptr intern_string(const std::string& str);
+
+/**
+ * @brief Finds or creates the interned string for the Lua string (or number)
+ * at the given index on the main Lua stack. If the string is already
+ * interned, then this does not copy or hash the string's contents.
+ * [BALANCED]
+ * @param idx The index on the main Lua stack
+ * @return Pointer to the interned string
+ */
+Istr_Ptr intern_lua_string(int idx);
+
+/**
+ * @return The number of unique strings currently interned
+ */
+std::size_t get_num_interned_strings();
+
+/**
+ * @brief Bytes used by the contents of every interned string
+ * @param heap_bytes Set to the bytes allocated on the heap, for strings too
+ * long to be stored inside the std::string itself
+ * @param inline_bytes Set to the bytes of strings short enough to be stored
+ * inside the std::string (small string optimization)
+ */
+void get_interned_string_bytes(std::size_t& heap_bytes, 
+        std::size_t& inline_bytes);
+
+/**
+ * @return How many bytes a std::string allocates on the heap for the
+ * string's contents, zero if the contents are stored inline
+ */
+std::size_t get_string_heap_bytes(const std::string& str);
+
+} // namespace Runtime
+} // namespace Gensys
+} // namespace pegr
+
+#endif // PEGR_GENSYS_INTERNEDSTRINGS_HPP
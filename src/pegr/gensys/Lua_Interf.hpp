@@ -17,6 +17,7 @@
 #ifndef PEGR_GENSYS_LUAINTERF_HPP
 #define PEGR_GENSYS_LUAINTERF_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <string>
@@ -61,6 +62,16 @@ void cleanup();
 Interm::Prim parse_primitive(int table_idx, 
         Interm::Prim::Type required_t = Interm::Prim::Type::UNKNOWN);
 
+/**
+ * @brief Reads the optional qualifier which follows the default value of a
+ * component member, e.g. {'f64', 5, 'shared'}
+ * Can throw runtime errors.
+ * [BALANCED]
+ * @param table_idx the index of the primitive constructor table
+ * @return true if the member is qualified as "shared"
+ */
+bool parse_member_qualifier_shared(int table_idx);
+
 /**
  * @brief Make a new component definition from the table at the given index.
  * Can throw runtime errors. Guaranteed to return a valid Comp_Def pointer.
@@ -156,6 +167,21 @@ void push_gensys_obj(lua_State* l, Runtime::Entity_Handle ent);
 void push_gensys_obj(lua_State* l, Runtime::Cview ent);
 void push_gensys_obj(lua_State* l, Runtime::Genview ent);
 
+/**
+ * @brief Checks whether the value on the main stack is a userdata made by
+ * push_gensys_obj(). Does not raise errors.
+ * [BALANCED]
+ */
+bool is_cview_userdata(int idx);
+bool is_genview_userdata(int idx);
+
+/**
+ * @return The number of cview (or genview) userdata that Lua has not
+ * collected yet, whether or not they are still reachable
+ */
+std::size_t get_num_cview_userdata();
+std::size_t get_num_genview_userdata();
+
 /**
  * @brief Attempts to get a component view for the provided entity. If this is
  * impossible, return nil.
@@ -338,6 +364,13 @@ int li_kill_entity(lua_State* l);
  */
 int li_delete_entity(lua_State* l);
 
+/**
+ * @brief Memory accounting for the current world (see 
+ * Runtime::get_memory_stats()). Returns a table with the totals, and a table
+ * of the same numbers for each archetype in "archetypes", keyed by name.
+ */
+int li_debug_memory(lua_State* l);
+
 } // namespace LI
 } // namespace Gensys
 } // namespace pegr
@@ -29,7 +29,9 @@
 #include "pegr/except/Except.hpp"
 #include "pegr/gensys/Compiler.hpp"
 #include "pegr/gensys/Gensys.hpp"
+#include "pegr/gensys/Memory.hpp"
 #include "pegr/gensys/Runtime.hpp"
+#include "pegr/gensys/World.hpp"
 #include "pegr/logger/Logger.hpp"
 #include "pegr/script/Script_Util.hpp"
 
@@ -44,6 +46,10 @@ Script::Unique_Regref n_entity_metatable;
 Script::Unique_Regref n_cview_metatable;
 Script::Unique_Regref n_genview_metatable;
 
+// Incremented when pushed, decremented when collected
+std::size_t n_num_cview_userdata = 0;
+std::size_t n_num_genview_userdata = 0;
+
 lua_Number entity_handle_to_lua_number(uint64_t data) {
     // Shave off the bottom 52 bits and cast to number
     return static_cast<lua_Number>(Runtime::bottom_52(data));
@@ -271,9 +277,27 @@ void push_gensys_obj(lua_State* l, Runtime::Entity_Handle ent) {
 }
 void push_gensys_obj(lua_State* l, Runtime::Cview cview) {
     push_any_value<Runtime::Cview>(l, cview, n_cview_metatable.get());
+    ++n_num_cview_userdata;
 }
 void push_gensys_obj(lua_State* l, Runtime::Genview genview) {
     push_any_value<Runtime::Genview>(l, genview, n_genview_metatable.get());
+    ++n_num_genview_userdata;
+}
+
+bool is_cview_userdata(int idx) {
+    return to_mt_userdata(Script::get_lua_state(), idx, 
+            n_cview_metatable.get()) != nullptr;
+}
+bool is_genview_userdata(int idx) {
+    return to_mt_userdata(Script::get_lua_state(), idx, 
+            n_genview_metatable.get()) != nullptr;
+}
+
+std::size_t get_num_cview_userdata() {
+    return n_num_cview_userdata;
+}
+std::size_t get_num_genview_userdata() {
+    return n_num_genview_userdata;
 }
 
 /**
@@ -338,13 +362,23 @@ int push_member_of_entity(lua_State* l, const Runtime::Member_Ptr& mem_ptr) {
             return 1;
         }
         case Runtime::Prim::Type::STR: {
-            lua_pushstring(l, mem_ptr.get_value_str().c_str());
+            // Interned strings hold onto the Lua string, no need to rehash
+            Script::push_reference(mem_ptr.get_value_istr().get_lua_ref());
             return 1;
         }
         case Runtime::Prim::Type::FUNC: {
             Script::push_reference(mem_ptr.get_value_func());
             return 1;
         }
+        case Runtime::Prim::Type::ENTITY: {
+            Runtime::Entity* ent_ptr = mem_ptr.resolve_value_entity();
+            if (ent_ptr) {
+                push_gensys_obj(l, ent_ptr->get_handle());
+            } else {
+                lua_pushnil(l);
+            }
+            return 1;
+        }
         case Runtime::Prim::Type::NULLPTR: {
             return 0;
         }
@@ -379,9 +413,8 @@ int write_to_member_of_entity(lua_State* l, const Runtime::Member_Ptr& mem_ptr,
         }
         case Runtime::Prim::Type::STR: {
             arg_require_write_compat(l, lua_isstring(l, idx), idx, ty);
-            std::size_t data_strlen;
-            const char* data_str = lua_tolstring(l, idx, &data_strlen);
-            mem_ptr.set_value_str(std::string(data_str, data_strlen));
+            // Only a pointer store if the string is already interned
+            mem_ptr.set_value_istr(Runtime::intern_lua_string(idx));
             return 0;
         }
         case Runtime::Prim::Type::FUNC: {
@@ -390,6 +423,24 @@ int write_to_member_of_entity(lua_State* l, const Runtime::Member_Ptr& mem_ptr,
             // Just you wait, this line will give future me a headache ^
             return 0;
         }
+        case Runtime::Prim::Type::ENTITY: {
+            if (lua_isnil(l, idx)) {
+                mem_ptr.set_value_entity(Runtime::Entity_Handle());
+                return 0;
+            }
+            Runtime::Entity_Handle* ent = static_cast<Runtime::Entity_Handle*>(
+                    to_mt_userdata(l, idx, n_entity_metatable.get()));
+            arg_require_write_compat(l, ent != nullptr, idx, ty);
+            /* Reading the member makes a new userdata, which would delete the
+             * entity when collected if Lua still owned it
+             */
+            if (ent->does_exist() && (*ent)->is_lua_owned()) {
+                luaL_argerror(l, idx, 
+                        "cannot refer to an entity owned by Lua (spawn it)");
+            }
+            mem_ptr.set_value_entity(*ent);
+            return 0;
+        }
         case Runtime::Prim::Type::NULLPTR: {
             assert(false && "Cannot write to nullptr, check beforehand!");
         }
@@ -508,7 +559,7 @@ int li_entity_mt_gc(lua_State* l) {
      */
     if (ent.does_exist() && ent->is_lua_owned()) {
         assert(!ent->has_been_spawned());
-        Runtime::get_entities().delete_entity(ent);
+        ent->get_world()->get_entities().delete_entity(ent);
     }
     
     ent.Runtime::Entity_Handle::~Entity_Handle();
@@ -617,6 +668,7 @@ int li_cview_mt_gc(lua_State* l) {
     Runtime::Cview& cview = 
             *(static_cast<Runtime::Cview*>(lua_touserdata(l, 1)));
     cview.Runtime::Cview::~Cview();
+    --n_num_cview_userdata;
     return 0;
 }
 int li_cview_mt_index(lua_State* l) {
@@ -640,6 +692,13 @@ int li_cview_mt_newindex(lua_State* l) {
     const char* keystr = luaL_checklstring(l, ARG_MEMBER, &keystrlen);
     Runtime::Member_Ptr mem_ptr = 
             cview.get_member_ptr(Runtime::Symbol(keystr, keystrlen));
+    if (cview.is_stale()) {
+        std::stringstream sss;
+        sss << "Tried to write to component member \""
+            << keystr
+            << "\" through a view from before recompiling";
+        luaL_error(l, sss.str().c_str());
+    }
     if (mem_ptr.is_nullptr()) {
         std::stringstream sss;
         sss << "Tried to write to nonexistent component member \""
@@ -684,6 +743,7 @@ int li_genview_mt_gc(lua_State* l) {
     Runtime::Genview& genview = 
             *(static_cast<Runtime::Genview*>(lua_touserdata(l, 1)));
     genview.Runtime::Genview::~Genview();
+    --n_num_genview_userdata;
     return 0;
 }
 int li_genview_mt_index(lua_State* l) {
@@ -707,6 +767,13 @@ int li_genview_mt_newindex(lua_State* l) {
     const char* keystr = luaL_checklstring(l, ARG_MEMBER, &keystrlen);
     Runtime::Member_Ptr mem_ptr = 
             genview.get_member_ptr(Runtime::Symbol(keystr, keystrlen));
+    if (genview.is_stale()) {
+        std::stringstream sss;
+        sss << "Tried to write to genre member \""
+            << keystr
+            << "\" through a view from before recompiling";
+        luaL_error(l, sss.str().c_str());
+    }
     if (mem_ptr.is_nullptr()) {
         std::stringstream sss;
         sss << "Tried to write to nonexistent genre member \""
@@ -862,7 +929,7 @@ int li_kill_entity(lua_State* l) {
     }
     
     ent->kill();
-    Runtime::get_entities().delete_entity(ent);
+    ent->get_world()->get_entities().delete_entity(ent);
     
     lua_pushboolean(l , true);
     return 1;
@@ -880,12 +947,62 @@ int li_delete_entity(lua_State* l) {
         return 1;
     }
 
-    Runtime::get_entities().delete_entity(ent);
+    ent->get_world()->get_entities().delete_entity(ent);
     
     lua_pushboolean(l , true);
     return 1;
 }
 
+/**
+ * @brief Sets a numeric field of the table at the top of the stack
+ */
+void set_number_field(lua_State* l, const char* key, std::size_t value) {
+    lua_pushnumber(l, static_cast<lua_Number>(value));
+    lua_setfield(l, -2, key);
+}
+
+/**
+ * @brief Pushes a new table with the fields of the Arche_Memory
+ */
+void push_arche_memory(lua_State* l, const Runtime::Arche_Memory& memory) {
+    assert_balance(1);
+    lua_newtable(l);
+    set_number_field(l, "entities", memory.m_num_entities);
+    set_number_field(l, "pod_bytes", memory.m_pod_bytes);
+    set_number_field(l, "padding_bytes", memory.m_padding_bytes);
+    set_number_field(l, "strings", memory.m_num_strings);
+    set_number_field(l, "string_heap_bytes", memory.m_string_heap_bytes);
+    set_number_field(l, "string_inline_bytes", memory.m_string_inline_bytes);
+    set_number_field(l, "tables", memory.m_num_tables);
+    set_number_field(l, "table_entries", memory.m_num_table_entries);
+    set_number_field(l, "weak_tables", memory.m_num_weak_tables);
+    set_number_field(l, "weak_table_entries", 
+            memory.m_num_weak_table_entries);
+    set_number_field(l, "table_bytes", memory.m_table_bytes);
+    set_number_field(l, "cached_cviews", memory.m_num_cached_cviews);
+    set_number_field(l, "total_bytes", memory.get_total_bytes());
+}
+
+int li_debug_memory(lua_State* l) {
+    Runtime::Memory_Stats stats = Runtime::get_memory_stats();
+    push_arche_memory(l, stats.m_total);
+    
+    lua_newtable(l);
+    for (const auto& entry : stats.m_arches) {
+        push_arche_memory(l, entry.second);
+        lua_setfield(l, -2, entry.first.get_repr().c_str());
+    }
+    lua_setfield(l, -2, "archetypes");
+    
+    set_number_field(l, "interned_strings", stats.m_num_interned_strings);
+    set_number_field(l, "interned_heap_bytes", stats.m_interned_heap_bytes);
+    set_number_field(l, "interned_inline_bytes", 
+            stats.m_interned_inline_bytes);
+    set_number_field(l, "cview_userdata", stats.m_num_cview_userdata);
+    set_number_field(l, "genview_userdata", stats.m_num_genview_userdata);
+    set_number_field(l, "lua_bytes", stats.m_lua_bytes);
+    return 1;
+}
 
 } // namespace LI
 } // namespace Gensys
@@ -27,6 +27,7 @@
 
 #include "pegr/algs/Algs.hpp"
 #include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/debug/Trace.hpp"
 #include "pegr/except/Except.hpp"
 #include "pegr/gensys/Compiler.hpp"
 #include "pegr/gensys/Gensys.hpp"
@@ -79,6 +80,8 @@ const luaL_Reg n_setup_api_safe[] = {
     {"kill_entity", li_kill_entity},
     {"delete_entity", li_delete_entity},
     
+    {"debug_memory", li_debug_memory},
+    
     // End of the list
     {nullptr, nullptr}
 };
@@ -179,6 +182,8 @@ Interm::Prim parse_primitive(int idx, Interm::Prim::Type required_t) {
         ret_val.set_type(Interm::Prim::Type::STR);
     } else if (type_name == "func") {
         ret_val.set_type(Interm::Prim::Type::FUNC);
+    } else if (type_name == "entity") {
+        ret_val.set_type(Interm::Prim::Type::ENTITY);
     } else {
         std::stringstream sss;
         sss << "Unknown type: " << type_name;
@@ -284,6 +289,15 @@ Interm::Prim parse_primitive(int idx, Interm::Prim::Type required_t) {
                         Script::make_shared(Script::grab_reference()));
                 break;
             }
+            // No entities exist during setup, so null is the only default
+            case Interm::Prim::Type::ENTITY: {
+                std::stringstream sss;
+                sss << "Entity primitive value must be nil, (\""
+                    << Script::Util::to_string(-1, 
+                                Script::Util::GENERIC_TO_STRING_DEFAULT)
+                    << "\")";
+                throw Except::Runtime(sss.str());
+            }
             default: {
                 assert(false && "Unhandled primitive type");
             }
@@ -293,6 +307,34 @@ Interm::Prim parse_primitive(int idx, Interm::Prim::Type required_t) {
     return ret_val;
 }
 
+bool parse_member_qualifier_shared(int table_idx) {
+    assert_balance(0);
+    lua_State* l = Script::get_lua_state();
+    table_idx = Script::absolute_idx(table_idx);
+    
+    lua_rawgeti(l, table_idx, 3); // Third member is the optional qualifier
+    Script::Pop_Guard pop_guard(1);
+    if (lua_isnil(l, -1)) {
+        return false;
+    }
+    
+    std::string qualifier;
+    try {
+        qualifier = Script::Util::to_string(-1);
+    } catch (Except::Runtime& e) {
+        std::stringstream sss;
+        sss << "Cannot convert qualifier to string: " << e.what();
+        throw Except::Runtime(sss.str());
+    }
+    
+    if (qualifier == "shared") {
+        return true;
+    }
+    std::stringstream sss;
+    sss << "Unknown member qualifier: " << qualifier;
+    throw Except::Runtime(sss.str());
+}
+
 std::unique_ptr<Interm::Comp> parse_component_definition(int table_idx) {
     assert_balance(0);
     lua_State* l = Script::get_lua_state();
@@ -306,8 +348,10 @@ std::unique_ptr<Interm::Comp> parse_component_definition(int table_idx) {
                 assert_table_key_to_string(-2, 
                         "Invalid key in component table");
         Interm::Prim value;
+        bool shared;
         try {
             value = parse_primitive(-1);
+            shared = parse_member_qualifier_shared(-1);
         }
         catch (Except::Runtime& e) {
             std::stringstream sss;
@@ -323,6 +367,9 @@ std::unique_ptr<Interm::Comp> parse_component_definition(int table_idx) {
             throw Except::Runtime(sss.str());
         }
         comp_def->m_members[symbol] = std::move(value);
+        if (shared) {
+            comp_def->m_shared_members.insert(symbol);
+        }
         return true;
     }, false);
     
@@ -876,6 +923,7 @@ std::unique_ptr<Interm::Genre> parse_genre(int table_idx) {
 }
 
 void stage_all() {
+    PEGR_TRACE_SCOPE("gensys", "LI::stage_all");
     assert_balance(0);
     Logger::log()->info("Parsing gensys data...");
     lua_State* l = Script::get_lua_state();
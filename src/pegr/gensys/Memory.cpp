@@ -0,0 +1,221 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "pegr/gensys/Memory.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+#include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/gensys/Interned_Strings.hpp"
+#include "pegr/gensys/Lua_Interf.hpp"
+#include "pegr/gensys/Runtime.hpp"
+#include "pegr/logger/Logger.hpp"
+#include "pegr/script/Script.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Runtime {
+
+// (These are defined in Runtime.cpp)
+extern std::map<Resour::Oid, std::unique_ptr<Runtime::Arche> > 
+        n_runtime_arches;
+
+/* Sizes in LuaJIT on 64-bit platforms. The array part of entity tables is
+ * assumed to be empty, since they are keyed by strings and userdata.
+ */
+const std::size_t LUA_TABLE_BYTES = 64;
+const std::size_t LUA_TABLE_NODE_BYTES = 24;
+
+Arche_Memory& Arche_Memory::operator +=(const Arche_Memory& rhs) {
+    m_num_entities += rhs.m_num_entities;
+    m_pod_bytes += rhs.m_pod_bytes;
+    m_padding_bytes += rhs.m_padding_bytes;
+    m_num_strings += rhs.m_num_strings;
+    m_string_heap_bytes += rhs.m_string_heap_bytes;
+    m_string_inline_bytes += rhs.m_string_inline_bytes;
+    m_num_tables += rhs.m_num_tables;
+    m_num_table_entries += rhs.m_num_table_entries;
+    m_num_weak_tables += rhs.m_num_weak_tables;
+    m_num_weak_table_entries += rhs.m_num_weak_table_entries;
+    m_table_bytes += rhs.m_table_bytes;
+    m_num_cached_cviews += rhs.m_num_cached_cviews;
+    return *this;
+}
+
+std::size_t Arche_Memory::get_total_bytes() const {
+    return m_pod_bytes + m_string_heap_bytes + m_table_bytes;
+}
+
+/**
+ * @return Bytes in the entity chunk used by the header and members
+ */
+std::size_t get_used_pod_bytes(Arche* arche) {
+    std::size_t used = ENT_HEADER_SIZE;
+    for (const auto& comp_entry : arche->m_comp_offsets) {
+        for (const auto& member : comp_entry.first->m_member_offsets) {
+            if (!member.second.m_shared) {
+                used += get_pod_size(member.second.m_type);
+            }
+        }
+    }
+    return used;
+}
+
+/**
+ * @brief Estimates the size of a table with the given number of entries in
+ * its hash part, which always has a power of two number of nodes
+ */
+std::size_t estimate_table_bytes(std::size_t num_entries) {
+    std::size_t num_nodes = 0;
+    if (num_entries > 0) {
+        num_nodes = 1;
+        while (num_nodes < num_entries) {
+            num_nodes *= 2;
+        }
+    }
+    return LUA_TABLE_BYTES + num_nodes * LUA_TABLE_NODE_BYTES;
+}
+
+/**
+ * @brief Counts the entries of the table, and how many of the values are
+ * cviews
+ * [BALANCED]
+ */
+void count_table_entries(Script::Regref table, std::size_t& num_entries, 
+        std::size_t& num_cviews) {
+    assert_balance(0);
+    lua_State* l = Script::get_lua_state();
+    Script::push_reference(table); // +1
+    int table_idx = lua_gettop(l);
+    lua_pushnil(l); // +1
+    while (lua_next(l, table_idx)) { // -1 +2
+        ++num_entries;
+        if (LI::is_cview_userdata(-1)) {
+            ++num_cviews;
+        }
+        lua_pop(l, 1); // -1
+    }
+    lua_pop(l, 1); // -1
+}
+
+void account_entity(Entity* ent, std::size_t used_pod_bytes, 
+        Arche_Memory& memory) {
+    ++memory.m_num_entities;
+    
+    // Killed entities may not have a chunk anymore
+    Algs::Podc_Ptr chunk = ent->get_chunk();
+    if (!chunk.is_nullptr()) {
+        memory.m_pod_bytes += chunk.get_size();
+        if (chunk.get_size() > used_pod_bytes) {
+            memory.m_padding_bytes += chunk.get_size() - used_pod_bytes;
+        }
+    }
+    
+    for (const Entity::String_Override& over : ent->get_string_overrides()) {
+        const std::string& str = over.m_str.get_string();
+        ++memory.m_num_strings;
+        std::size_t heap_bytes = get_string_heap_bytes(str);
+        if (heap_bytes > 0) {
+            memory.m_string_heap_bytes += heap_bytes;
+        } else {
+            memory.m_string_inline_bytes += str.size();
+        }
+    }
+    
+    Script::Regref table = ent->peek_table();
+    if (table != LUA_REFNIL) {
+        std::size_t num_entries = 0;
+        std::size_t num_cviews = 0;
+        count_table_entries(table, num_entries, num_cviews);
+        ++memory.m_num_tables;
+        memory.m_num_table_entries += num_entries;
+        memory.m_table_bytes += estimate_table_bytes(num_entries);
+    }
+    Script::Regref weak_table = ent->peek_weak_table();
+    if (weak_table != LUA_REFNIL) {
+        std::size_t num_entries = 0;
+        count_table_entries(weak_table, num_entries, 
+                memory.m_num_cached_cviews);
+        ++memory.m_num_weak_tables;
+        memory.m_num_weak_table_entries += num_entries;
+        memory.m_table_bytes += estimate_table_bytes(num_entries);
+    }
+}
+
+Memory_Stats get_memory_stats() {
+    Memory_Stats stats;
+    
+    struct Arche_Entry {
+        std::size_t m_used_pod_bytes;
+        Arche_Memory* m_memory;
+    };
+    std::unordered_map<Arche*, Arche_Entry> arches;
+    for (auto& entry : n_runtime_arches) {
+        arches[entry.second.get()] = {
+            get_used_pod_bytes(entry.second.get()), 
+            &stats.m_arches[entry.first]
+        };
+    }
+    
+    get_entities().for_each([&](Entity* ent) {
+        auto iter = arches.find(ent->get_arche());
+        if (iter == arches.end()) {
+            return;
+        }
+        account_entity(ent, iter->second.m_used_pod_bytes, 
+                *iter->second.m_memory);
+    });
+    for (const auto& entry : stats.m_arches) {
+        stats.m_total += entry.second;
+    }
+    
+    stats.m_num_interned_strings = get_num_interned_strings();
+    get_interned_string_bytes(stats.m_interned_heap_bytes, 
+            stats.m_interned_inline_bytes);
+    stats.m_num_cview_userdata = LI::get_num_cview_userdata();
+    stats.m_num_genview_userdata = LI::get_num_genview_userdata();
+    lua_State* l = Script::get_lua_state();
+    stats.m_lua_bytes = lua_gc(l, LUA_GCCOUNT, 0) * 1024 
+            + lua_gc(l, LUA_GCCOUNTB, 0);
+    return stats;
+}
+
+void log_memory_stats(const Memory_Stats& stats) {
+    const Arche_Memory& total = stats.m_total;
+    Logger::log()->info("Memory: %v entities, %v bytes (%v pod, %v padding, "
+            "%v string heap, %v tables), %v interned strings, "
+            "%v cviews, %v Lua bytes", 
+            total.m_num_entities, total.get_total_bytes(), 
+            total.m_pod_bytes, total.m_padding_bytes, 
+            total.m_string_heap_bytes, total.m_table_bytes, 
+            stats.m_num_interned_strings, stats.m_num_cview_userdata, 
+            stats.m_lua_bytes);
+    for (const auto& entry : stats.m_arches) {
+        const Arche_Memory& memory = entry.second;
+        if (memory.m_num_entities == 0) {
+            continue;
+        }
+        Logger::log()->info("\t%v: %v entities, %v bytes", 
+                entry.first, memory.m_num_entities, 
+                memory.get_total_bytes());
+    }
+}
+
+} // namespace Runtime
+} // namespace Gensys
+} // namespace pegr
@@ -0,0 +1,118 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PEGR_GENSYS_MEMORY_HPP
+#define PEGR_GENSYS_MEMORY_HPP
+
+#include <cstddef>
+#include <map>
+
+#include "pegr/resource/Oid.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Runtime {
+
+/**
+ * @class Arche_Memory
+ * @brief What the entities of one archetype use, for capacity planning
+ */
+struct Arche_Memory {
+    std::size_t m_num_entities = 0;
+    
+    /* Size of every entity's pod chunk. Chunks that are shared with a forked
+     * world are counted in both worlds.
+     */
+    std::size_t m_pod_bytes = 0;
+    
+    // Part of m_pod_bytes not used by the header or any member
+    std::size_t m_padding_bytes = 0;
+    
+    /* Strings that entities override (see Entity::get_string_overrides()).
+     * Strings are interned, and so one string can be counted under many
+     * archetypes. Short strings are stored inside the std::string, and so
+     * only longer strings use the heap.
+     */
+    std::size_t m_num_strings = 0;
+    std::size_t m_string_heap_bytes = 0;
+    std::size_t m_string_inline_bytes = 0;
+    
+    // Entity::get_table()
+    std::size_t m_num_tables = 0;
+    std::size_t m_num_table_entries = 0;
+    
+    // Entity::get_weak_table()
+    std::size_t m_num_weak_tables = 0;
+    std::size_t m_num_weak_table_entries = 0;
+    
+    /* Estimated from the number of entries, since Lua does not say how large
+     * a table is
+     */
+    std::size_t m_table_bytes = 0;
+    
+    // Component views cached in the weak tables
+    std::size_t m_num_cached_cviews = 0;
+    
+    Arche_Memory& operator +=(const Arche_Memory& rhs);
+    
+    /**
+     * @return Pod chunks, heap strings and tables together
+     */
+    std::size_t get_total_bytes() const;
+};
+
+/**
+ * @class Memory_Stats
+ * @brief Per-archetype accounting for the current world, and whatever is
+ * shared by all worlds
+ */
+struct Memory_Stats {
+    std::map<Resour::Oid, Arche_Memory> m_arches;
+    
+    // Sum of m_arches
+    Arche_Memory m_total;
+    
+    // Every interned string once (see get_interned_string_bytes())
+    std::size_t m_num_interned_strings = 0;
+    std::size_t m_interned_heap_bytes = 0;
+    std::size_t m_interned_inline_bytes = 0;
+    
+    // All userdata that Lua has not collected yet, cached or not
+    std::size_t m_num_cview_userdata = 0;
+    std::size_t m_num_genview_userdata = 0;
+    
+    // Everything allocated by Lua
+    std::size_t m_lua_bytes = 0;
+};
+
+/**
+ * @return Accounting for the current world. Goes through every entity and
+ * every entity's Lua tables.
+ */
+Memory_Stats get_memory_stats();
+
+/**
+ * @brief Logs the totals on one line, and then one line per archetype that
+ * has entities
+ */
+void log_memory_stats(const Memory_Stats& stats);
+
+} // namespace Runtime
+} // namespace Gensys
+} // namespace pegr
+
+#endif // PEGR_GENSYS_MEMORY_HPP
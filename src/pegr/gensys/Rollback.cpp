@@ -0,0 +1,365 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "pegr/gensys/Rollback.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <sstream>
+
+#include "pegr/engine/Engine.hpp"
+#include "pegr/except/Except.hpp"
+#include "pegr/gensys/Entity_Collection.hpp"
+#include "pegr/gensys/Entity_Events.hpp"
+#include "pegr/gensys/Runtime.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Rollback {
+
+void Arche_Table::clear() {
+    m_chunk_size = 0;
+    m_ids.clear();
+    m_chunks.clear();
+    m_overrides.clear();
+    m_override_ends.clear();
+}
+
+/**
+ * @class Replay_Guard
+ * @brief Marks the events as replaying for as long as this exists
+ */
+class Replay_Guard {
+public:
+    Replay_Guard()
+    : m_was_replaying(Event::is_replaying()) {
+        Event::set_replaying(true);
+    }
+    ~Replay_Guard() {
+        Event::set_replaying(m_was_replaying);
+    }
+private:
+    bool m_was_replaying;
+};
+
+Rollback_Buffer::Rollback_Buffer(std::size_t depth)
+: m_world(Runtime::get_current_world())
+, m_ring(depth) {
+    assert(depth > 0);
+    Runtime::Entity_Collection& ents = m_world->get_entities();
+    if (!ents.is_change_tracking_enabled()) {
+        ents.set_change_tracking_enabled(true);
+        m_owns_tracking = true;
+    }
+}
+
+Rollback_Buffer::~Rollback_Buffer() {
+    clear();
+    if (m_owns_tracking) {
+        m_world->get_entities().set_change_tracking_enabled(false);
+    }
+}
+
+void Rollback_Buffer::save() {
+    save(Engine::get_tick_id());
+}
+
+void Rollback_Buffer::save(std::uint64_t tick_id) {
+    Runtime::Entity_Collection& ents = m_world->get_entities();
+    
+    // Discard the future
+    while (m_num_saved > 0 
+            && get_state(m_num_saved - 1).m_tick_id >= tick_id) {
+        pop_last();
+    }
+    
+    /* Find which archetypes need a new table. Archetypes without any changes
+     * keep sharing their current table.
+     */
+    std::vector<Runtime::Arche*> changed = take_changed_arches();
+    bool copy_all = !m_current_valid;
+    if (copy_all) {
+        release_tables(m_current);
+    }
+    std::map<Runtime::Arche*, std::vector<Runtime::Entity*> > by_arche;
+    for (Runtime::Arche* arche : changed) {
+        by_arche[arche];
+    }
+    if (copy_all || !by_arche.empty()) {
+        ents.for_each([&](Runtime::Entity* ent) {
+            if (ent->is_lua_owned()) {
+                return;
+            }
+            if (copy_all) {
+                by_arche[ent->get_arche()].push_back(ent);
+                return;
+            }
+            auto iter = by_arche.find(ent->get_arche());
+            if (iter != by_arche.end()) {
+                iter->second.push_back(ent);
+            }
+        });
+    }
+    
+    for (auto& bucket_entry : by_arche) {
+        auto current_iter = m_current.find(bucket_entry.first);
+        if (current_iter != m_current.end()) {
+            release_table(current_iter->second);
+            m_current.erase(current_iter);
+        }
+        const std::vector<Runtime::Entity*>& bucket = bucket_entry.second;
+        if (bucket.empty()) {
+            continue;
+        }
+        
+        std::shared_ptr<Arche_Table> table = acquire_table();
+        table->m_chunk_size = bucket.front()->get_chunk().get_size();
+        table->m_ids.reserve(bucket.size());
+        table->m_chunks.resize(bucket.size() * table->m_chunk_size);
+        table->m_override_ends.reserve(bucket.size());
+        char* dest = table->m_chunks.data();
+        for (const Runtime::Entity* ent : bucket) {
+            assert(ent->get_chunk().get_size() == table->m_chunk_size);
+            table->m_ids.push_back(ent->get_handle().get_id());
+            std::memcpy(dest, ent->get_chunk().get_raw(), 
+                    table->m_chunk_size);
+            dest += table->m_chunk_size;
+            const auto& overrides = ent->get_string_overrides();
+            table->m_overrides.insert(table->m_overrides.end(), 
+                    overrides.begin(), overrides.end());
+            table->m_override_ends.push_back(table->m_overrides.size());
+        }
+        ++m_num_tables_copied;
+        m_current[bucket_entry.first] = std::move(table);
+    }
+    m_current_valid = true;
+    
+    if (m_num_saved == m_ring.size()) {
+        pop_first();
+    }
+    ++m_num_saved;
+    State& state = get_state(m_num_saved - 1);
+    state.m_tick_id = tick_id;
+    state.m_next_handle = ents.get_next_handle();
+    state.m_tables = m_current;
+}
+
+bool Rollback_Buffer::has_tick(std::uint64_t tick_id) const {
+    for (std::size_t idx = 0; idx < m_num_saved; ++idx) {
+        if (get_state(idx).m_tick_id == tick_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Rollback_Buffer::restore(std::uint64_t tick_id) {
+    Runtime::Entity_Collection& ents = m_world->get_entities();
+    
+    const State* state = nullptr;
+    for (std::size_t idx = 0; idx < m_num_saved; ++idx) {
+        if (get_state(idx).m_tick_id == tick_id) {
+            state = &get_state(idx);
+            break;
+        }
+    }
+    if (!state) {
+        std::stringstream sss;
+        sss << "Tick " << tick_id << " is not in the rollback buffer";
+        throw Except::Runtime(sss.str());
+    }
+    assert(m_current_valid);
+    
+    /* Only archetypes that changed since the last save, or that had changed
+     * between then and the restored tick need to be rewritten
+     */
+    std::vector<Runtime::Arche*> changed = take_changed_arches();
+    std::set<Runtime::Arche*> rewrite(changed.begin(), changed.end());
+    for (const auto& current_entry : m_current) {
+        auto iter = state->m_tables.find(current_entry.first);
+        if (iter == state->m_tables.end() 
+                || iter->second != current_entry.second) {
+            rewrite.insert(current_entry.first);
+        }
+    }
+    for (const auto& saved_entry : state->m_tables) {
+        auto iter = m_current.find(saved_entry.first);
+        if (iter == m_current.end() || iter->second != saved_entry.second) {
+            rewrite.insert(saved_entry.first);
+        }
+    }
+    
+    if (!rewrite.empty()) {
+        // The index is rebuilt afterwards, rather than updated for every entity
+        bool backrefs_enabled = ents.are_backrefs_enabled();
+        ents.set_backrefs_enabled(false);
+        
+        std::vector<Runtime::Entity_Handle> removals;
+        ents.for_each([&](Runtime::Entity* ent) {
+            if (!ent->is_lua_owned() 
+                    && rewrite.find(ent->get_arche()) != rewrite.end()) {
+                removals.push_back(ent->get_handle());
+            }
+        });
+        for (Runtime::Entity_Handle handle : removals) {
+            ents.erase_entity(handle);
+        }
+        
+        for (Runtime::Arche* arche : rewrite) {
+            auto iter = state->m_tables.find(arche);
+            if (iter == state->m_tables.end()) {
+                continue;
+            }
+            const Arche_Table& table = *(iter->second);
+            const char* src = table.m_chunks.data();
+            std::size_t override_begin = 0;
+            for (std::size_t row = 0; row < table.m_ids.size(); ++row) {
+                Runtime::Entity_Handle handle(table.m_ids[row]);
+                
+                // In case the entity is now owned by Lua (so not removed yet)
+                ents.erase_entity(handle);
+                
+                Runtime::Entity* ent = ents.restore_entity(arche, handle);
+                std::memcpy(ent->get_chunk().get_raw(), src, 
+                        table.m_chunk_size);
+                src += table.m_chunk_size;
+                
+                std::size_t override_end = table.m_override_ends[row];
+                if (override_end != override_begin) {
+                    ent->set_string_overrides(
+                            std::vector<Runtime::Entity::String_Override>(
+                                table.m_overrides.begin() + override_begin,
+                                table.m_overrides.begin() + override_end));
+                }
+                override_begin = override_end;
+            }
+        }
+        
+        ents.set_backrefs_enabled(backrefs_enabled);
+    }
+    ents.set_next_handle(state->m_next_handle);
+    
+    // The collection now matches the restored state exactly
+    Table_Map tables = state->m_tables;
+    release_tables(m_current);
+    m_current = std::move(tables);
+    take_changed_arches();
+}
+
+void Rollback_Buffer::replay(std::uint64_t tick_id, 
+        std::uint64_t last_tick_id, 
+        std::function<void(std::uint64_t)> simulate) {
+    restore(tick_id);
+    Runtime::World::Scope scope(m_world);
+    Replay_Guard guard;
+    for (std::uint64_t tick = tick_id + 1; tick <= last_tick_id; ++tick) {
+        simulate(tick);
+        save(tick);
+    }
+}
+
+void Rollback_Buffer::clear() {
+    while (m_num_saved > 0) {
+        pop_last();
+    }
+    release_tables(m_current);
+    m_current_valid = false;
+}
+
+std::size_t Rollback_Buffer::get_depth() const {
+    return m_ring.size();
+}
+
+std::size_t Rollback_Buffer::get_num_saved() const {
+    return m_num_saved;
+}
+
+std::size_t Rollback_Buffer::get_num_tables_copied() const {
+    return m_num_tables_copied;
+}
+
+Rollback_Buffer::State& Rollback_Buffer::get_state(std::size_t idx) {
+    assert(idx < m_ring.size());
+    return m_ring[(m_first + idx) % m_ring.size()];
+}
+
+const Rollback_Buffer::State& Rollback_Buffer::get_state(
+        std::size_t idx) const {
+    assert(idx < m_ring.size());
+    return m_ring[(m_first + idx) % m_ring.size()];
+}
+
+void Rollback_Buffer::pop_first() {
+    assert(m_num_saved > 0);
+    release_tables(get_state(0).m_tables);
+    m_first = (m_first + 1) % m_ring.size();
+    --m_num_saved;
+}
+
+void Rollback_Buffer::pop_last() {
+    assert(m_num_saved > 0);
+    release_tables(get_state(m_num_saved - 1).m_tables);
+    --m_num_saved;
+}
+
+std::vector<Runtime::Arche*> Rollback_Buffer::take_changed_arches() {
+    Runtime::Entity_Collection& ents = m_world->get_entities();
+    Runtime::Tracked_Changes changes = ents.restart_change_tracking();
+    
+    std::set<Runtime::Arche*> arches;
+    for (const auto& pre_entry : changes.m_pre_images) {
+        arches.insert(pre_entry.second.m_arche);
+    }
+    for (std::uint64_t id : changes.m_created) {
+        Runtime::Entity* ent = ents.get_entity(Runtime::Entity_Handle(id));
+        assert(ent);
+        arches.insert(ent->get_arche());
+    }
+    return std::vector<Runtime::Arche*>(arches.begin(), arches.end());
+}
+
+std::shared_ptr<Arche_Table> Rollback_Buffer::acquire_table() {
+    if (m_pool.empty()) {
+        return std::make_shared<Arche_Table>();
+    }
+    
+    // Moving keeps the capacity of the buffers
+    std::shared_ptr<Arche_Table> table = 
+            std::make_shared<Arche_Table>(std::move(m_pool.back()));
+    m_pool.pop_back();
+    table->clear();
+    return table;
+}
+
+void Rollback_Buffer::release_table(std::shared_ptr<Arche_Table>& table) {
+    if (table.use_count() == 1 && m_pool.size() < m_ring.size()) {
+        m_pool.push_back(std::move(*table));
+    }
+    table.reset();
+}
+
+void Rollback_Buffer::release_tables(Table_Map& tables) {
+    for (auto& table_entry : tables) {
+        release_table(table_entry.second);
+    }
+    tables.clear();
+}
+
+} // namespace Rollback
+} // namespace Gensys
+} // namespace pegr
@@ -0,0 +1,193 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PEGR_GENSYS_ROLLBACK_HPP
+#define PEGR_GENSYS_ROLLBACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "pegr/gensys/Runtime_Types.hpp"
+#include "pegr/gensys/World.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Rollback {
+
+/**
+ * @class Arche_Table
+ * @brief Saved copy of every entity of one archetype. Tables are never
+ * modified after being saved, so many saved states can share the same table.
+ */
+struct Arche_Table {
+    std::size_t m_chunk_size;
+    std::vector<std::uint64_t> m_ids;
+    
+    // The POD chunk (header included) of every entity, in m_ids order
+    std::vector<char> m_chunks;
+    
+    // String overrides of all entities, in m_ids order. Entity i's overrides
+    // end at m_override_ends[i].
+    std::vector<Runtime::Entity::String_Override> m_overrides;
+    std::vector<std::size_t> m_override_ends;
+    
+    void clear();
+};
+
+/**
+ * @class Rollback_Buffer
+ * @brief Keeps the states of the entity collection for the last few ticks, so
+ * that the world can be rolled back and simulated again (e.g. when late input
+ * arrives for client-side prediction).
+ * 
+ * Saving only copies the archetypes that had any entity change since the
+ * last save or restore, other archetypes share the previous copy. Similarly,
+ * restoring only rewrites archetypes that differ. Evicted copies are kept in
+ * a pool so that their memory is reused.
+ * 
+ * Uses the collection's change tracking, and so cannot be used at the same
+ * time as Snapshot::take_delta(). Like snapshots, entities owned by Lua and
+ * shared members are not saved.
+ * 
+ * Belongs to the world that is current when it is created, and must be
+ * destroyed before that world is (or before the runtime is cleared).
+ */
+class Rollback_Buffer {
+public:
+    /**
+     * @param depth The number of ticks to keep (must be at least one)
+     */
+    Rollback_Buffer(std::size_t depth);
+    ~Rollback_Buffer();
+    
+    Rollback_Buffer(const Rollback_Buffer& rhs) = delete;
+    Rollback_Buffer& operator =(const Rollback_Buffer& rhs) = delete;
+    
+    /**
+     * @brief Saves the current state as the state after the current tick
+     * (Engine::get_tick_id()) was simulated.
+     */
+    void save();
+    
+    /**
+     * @brief Saves the current state as the state after the given tick was
+     * simulated. States of this tick or later are discarded first, since they
+     * belong to a future that did not happen. If the buffer is full, the
+     * oldest state is evicted.
+     * Must not be called during Entity_Collection::for_each().
+     * @param tick_id The tick
+     */
+    void save(std::uint64_t tick_id);
+    
+    /**
+     * @return If the state of the given tick is in the buffer
+     */
+    bool has_tick(std::uint64_t tick_id) const;
+    
+    /**
+     * @brief Returns the entity collection to the saved state. Spawn and kill
+     * events are not triggered. States of later ticks are kept. 
+     * Can throw runtime errors if the tick is not in the buffer.
+     * Must not be called during Entity_Collection::for_each().
+     * @param tick_id The tick
+     */
+    void restore(std::uint64_t tick_id);
+    
+    /**
+     * @brief Restores the given tick, then simulates and saves each tick up to
+     * and including the last tick. While simulating, spawn and kill listeners
+     * that are not replayable are skipped (see Event::is_replaying()).
+     * @param tick_id The tick to restore
+     * @param last_tick_id The last tick to simulate
+     * @param simulate Called to simulate a single tick
+     */
+    void replay(std::uint64_t tick_id, std::uint64_t last_tick_id,
+            std::function<void(std::uint64_t)> simulate);
+    
+    /**
+     * @brief Discards all saved states
+     */
+    void clear();
+    
+    std::size_t get_depth() const;
+    std::size_t get_num_saved() const;
+    
+    /**
+     * @return How many archetype tables have been copied in total. Used to
+     * check that unchanged archetypes are being shared.
+     */
+    std::size_t get_num_tables_copied() const;
+    
+private:
+    typedef std::map<Runtime::Arche*, std::shared_ptr<Arche_Table> > 
+            Table_Map;
+    
+    struct State {
+        std::uint64_t m_tick_id;
+        std::uint64_t m_next_handle;
+        Table_Map m_tables;
+    };
+    
+    Runtime::World* m_world;
+    
+    // Ring buffer of states, ordered by tick
+    std::vector<State> m_ring;
+    std::size_t m_first = 0;
+    std::size_t m_num_saved = 0;
+    
+    /* Tables that match the collection, except for the archetypes changed
+     * since the last save or restore.
+     */
+    Table_Map m_current;
+    bool m_current_valid = false;
+    
+    // Unused tables, whose buffers are reused
+    std::vector<Arche_Table> m_pool;
+    
+    bool m_owns_tracking = false;
+    std::size_t m_num_tables_copied = 0;
+    
+    State& get_state(std::size_t idx);
+    const State& get_state(std::size_t idx) const;
+    void pop_first();
+    void pop_last();
+    
+    /**
+     * @brief Restarts change tracking
+     * @return All archetypes that changed since the last restart
+     */
+    std::vector<Runtime::Arche*> take_changed_arches();
+    
+    std::shared_ptr<Arche_Table> acquire_table();
+    
+    /**
+     * @brief Drops the reference, returning the table to the pool if it was
+     * the last one
+     */
+    void release_table(std::shared_ptr<Arche_Table>& table);
+    void release_tables(Table_Map& tables);
+};
+
+} // namespace Rollback
+} // namespace Gensys
+} // namespace pegr
+
+#endif // PEGR_GENSYS_ROLLBACK_HPP
@@ -29,6 +29,7 @@
 #include "pegr/gensys/Entity_Collection.hpp"
 #include "pegr/gensys/Events.hpp"
 #include "pegr/gensys/Util.hpp"
+#include "pegr/gensys/World.hpp"
 #include "pegr/logger/Logger.hpp"
 #include "pegr/script/Script_Util.hpp"
 
@@ -49,10 +50,8 @@ const std::uint64_t ENT_FLAG_KILLED =            1 << 1;
 const std::uint64_t ENT_FLAG_LUA_OWNED =         1 << 2;
 const std::uint64_t ENT_FLAGS_DEFAULT =          0;
 
-Entity_Collection n_ent_collection;
-
 Entity_Collection& get_entities() {
-    return n_ent_collection;
+    return get_current_world()->get_entities();
 }
 
 const char* prim_to_dbg_string(Prim::Type ty) {
@@ -63,11 +62,23 @@ const char* prim_to_dbg_string(Prim::Type ty) {
         case Prim::Type::F64: return "f64";
         case Prim::Type::FUNC: return "func";
         case Prim::Type::STR: return "str";
+        case Prim::Type::ENTITY: return "entity";
         case Prim::Type::NULLPTR: return "nullptr";
         default: return "unknown";
     }
 }
 
+std::size_t get_pod_size(Prim::Type type) {
+    switch (type) {
+        case Prim::Type::I32: return sizeof(std::int32_t);
+        case Prim::Type::I64: return sizeof(std::int64_t);
+        case Prim::Type::F32: return sizeof(float);
+        case Prim::Type::F64: return sizeof(double);
+        case Prim::Type::ENTITY: return sizeof(Entity_Ref);
+        default: return 0;
+    }
+}
+
 std::string to_string_comp(Runtime::Comp* comp) {
     std::stringstream sss;
     sss << "<Component @"
@@ -106,7 +117,9 @@ std::string to_string_cview(Runtime::Cview cview) {
     std::stringstream sss;
     sss << "<Entity #"
         << bottom_52(cview.m_ent.get_id());
-    if (cview.m_ent.does_exist()) {
+    if (cview.is_stale()) {
+        sss << " (recompiled)";
+    } else if (cview.m_ent.does_exist()) {
         sss << " thru Comp @"
             << cview.m_comp;
     } else {
@@ -119,7 +132,9 @@ std::string to_string_genview(Runtime::Genview genview) {
     std::stringstream sss;
     sss << "<Entity #"
         << bottom_52(genview.m_ent.get_id());
-    if (genview.m_ent.does_exist()) {
+    if (genview.is_stale()) {
+        sss << " (recompiled)";
+    } else if (genview.m_ent.does_exist()) {
         sss << " thru G-Pattern @"
             << genview.m_pattern;
     } else {
@@ -150,6 +165,18 @@ Member_Ptr::Member_Ptr(Prim::Type typ, void* ptr)
 : m_type(typ)
 , m_ptr(ptr) {}
 
+Member_Ptr::Member_Ptr(Entity* ent, std::size_t string_idx)
+: m_type(Prim::Type::STR)
+, m_ptr(ent)
+, m_ent(ent)
+, m_string_idx(string_idx) {}
+
+Member_Ptr::Member_Ptr(Entity* ent, Prim::Type typ, std::size_t byte_offset)
+: m_type(typ)
+, m_ptr(static_cast<char*>(ent->get_chunk().get_raw()) + byte_offset)
+, m_ent(ent)
+, m_byte_offset(byte_offset) {}
+
 Member_Ptr::Member_Ptr()
 : m_type(Prim::Type::NULLPTR)
 , m_ptr(nullptr) {}
@@ -158,85 +185,139 @@ Prim::Type Member_Ptr::get_type() const {
     return m_type;
 }
 
+void* Member_Ptr::get_writable_ptr() const {
+    if (!m_ent) {
+        throw Except::Runtime("Cannot assign to shared value");
+    }
+    m_ent->mark_dirty();
+    return static_cast<char*>(m_ent->get_chunk().get_raw()) + m_byte_offset;
+}
+
+void* Member_Ptr::get_readable_ptr() const {
+    if (m_ent) {
+        return static_cast<char*>(m_ent->get_chunk().get_raw()) 
+                + m_byte_offset;
+    }
+    return m_ptr;
+}
+
 void Member_Ptr::set_value_i32(std::int32_t val) const {
     //Logger::log()->info("Set i32 %v", val);
     verify_equal_type(Prim::Type::I32, m_type);
-    *(static_cast<std::int32_t*>(m_ptr)) = val;
+    *(static_cast<std::int32_t*>(get_writable_ptr())) = val;
 }
 void Member_Ptr::set_value_i64(std::int64_t val) const {
     //Logger::log()->info("Set i64 %v", val);
     verify_equal_type(Prim::Type::I64, m_type);
-    *(static_cast<std::int64_t*>(m_ptr)) = val;
+    *(static_cast<std::int64_t*>(get_writable_ptr())) = val;
 }
 void Member_Ptr::set_value_f32(float val) const {
     //Logger::log()->info("Set f32 %v", val);
     verify_equal_type(Prim::Type::F32, m_type);
-    *(static_cast<float*>(m_ptr)) = val;
+    *(static_cast<float*>(get_writable_ptr())) = val;
 }
 void Member_Ptr::set_value_f64(double val) const {
     //Logger::log()->info("Set f64 %v", val);
     verify_equal_type(Prim::Type::F64, m_type);
-    *(static_cast<double*>(m_ptr)) = val;
+    *(static_cast<double*>(get_writable_ptr())) = val;
 }
 void Member_Ptr::set_value_str(const std::string& val) const {
     //Logger::log()->info("Set str %v", val);
     verify_equal_type(Prim::Type::STR, m_type);
-    *(static_cast<std::string*>(m_ptr)) = val;
+    set_value_istr(intern_string(val));
+}
+void Member_Ptr::set_value_istr(const Istr_Ptr& val) const {
+    verify_equal_type(Prim::Type::STR, m_type);
+    if (!m_ent) {
+        throw Except::Runtime("Cannot assign to shared value");
+    }
+    m_ent->set_istr(m_string_idx, val);
 }
 void Member_Ptr::set_value_func(Script::Regref val) const {
     //Logger::log()->info("Set func %v", val);
     verify_equal_type(Prim::Type::FUNC, m_type);
     throw Except::Runtime("Cannot assign to static value");
 }
+void Member_Ptr::set_value_entity(Entity_Handle val) const {
+    verify_equal_type(Prim::Type::ENTITY, m_type);
+    Entity_Ref* ref = static_cast<Entity_Ref*>(get_writable_ptr());
+    m_ent->get_collection().write_ref(m_ent, *ref, val);
+}
 
 std::int32_t Member_Ptr::get_value_i32() const {
     //Logger::log()->info("Get i32");
     verify_equal_type(Prim::Type::I32, m_type);
-    return *(static_cast<std::int32_t*>(m_ptr));
+    return *(static_cast<std::int32_t*>(get_readable_ptr()));
 }
 std::int64_t Member_Ptr::get_value_i64() const {
     //Logger::log()->info("Get i64");
     verify_equal_type(Prim::Type::I64, m_type);
-    return *(static_cast<std::int64_t*>(m_ptr));
+    return *(static_cast<std::int64_t*>(get_readable_ptr()));
 }
 float Member_Ptr::get_value_f32() const {
     //Logger::log()->info("Get f32");
     verify_equal_type(Prim::Type::F32, m_type);
-    return *(static_cast<float*>(m_ptr));
+    return *(static_cast<float*>(get_readable_ptr()));
 }
 double Member_Ptr::get_value_f64() const {
     //Logger::log()->info("Get f64");
     verify_equal_type(Prim::Type::F64, m_type);
-    return *(static_cast<double*>(m_ptr));
+    return *(static_cast<double*>(get_readable_ptr()));
 }
 const std::string& Member_Ptr::get_value_str() const {
     //Logger::log()->info("Get str");
+    return get_value_istr().get_string();
+}
+const Istr_Ptr& Member_Ptr::get_value_istr() const {
     verify_equal_type(Prim::Type::STR, m_type);
-    return *(static_cast<std::string*>(m_ptr));
+    if (m_ent) {
+        return m_ent->get_istr(m_string_idx);
+    }
+    return *(static_cast<Istr_Ptr*>(m_ptr));
 }
 Script::Regref Member_Ptr::get_value_func() const {
     //Logger::log()->info("Get func");
     verify_equal_type(Prim::Type::FUNC, m_type);
     return *(static_cast<Script::Regref*>(m_ptr));
 }
+Entity_Handle Member_Ptr::get_value_entity() const {
+    verify_equal_type(Prim::Type::ENTITY, m_type);
+    const Entity_Ref& ref = *(static_cast<Entity_Ref*>(get_readable_ptr()));
+    Entity_Collection& ents = m_ent 
+            ? m_ent->get_collection() : get_entities();
+    return ents.get_ref_target(ref);
+}
+Entity* Member_Ptr::resolve_value_entity() const {
+    verify_equal_type(Prim::Type::ENTITY, m_type);
+    Entity_Ref& ref = *(static_cast<Entity_Ref*>(get_readable_ptr()));
+    if (!m_ent) {
+        return get_entities().resolve_ref(ref);
+    }
+    // Updating the slot hint would write to the other world's chunk
+    if (m_ent->is_chunk_shared()) {
+        Entity_Ref copy = ref;
+        return m_ent->get_collection().resolve_ref(copy);
+    }
+    return m_ent->get_collection().resolve_ref(ref);
+}
 
 void Member_Ptr::set_value_any_number(double val) const {
     //Logger::log()->info("Set any num %v", val);
     switch (m_type) {
         case Prim::Type::I32: {
-            *(static_cast<std::int32_t*>(m_ptr)) = val;
+            *(static_cast<std::int32_t*>(get_writable_ptr())) = val;
             break;
         }
         case Prim::Type::I64: {
-            *(static_cast<std::int64_t*>(m_ptr)) = val;
+            *(static_cast<std::int64_t*>(get_writable_ptr())) = val;
             break;
         }
         case Prim::Type::F32: {
-            *(static_cast<float*>(m_ptr)) = val;
+            *(static_cast<float*>(get_writable_ptr())) = val;
             break;
         }
         case Prim::Type::F64: {
-            *(static_cast<double*>(m_ptr)) = val;
+            *(static_cast<double*>(get_writable_ptr())) = val;
             break;
         }
         default: {
@@ -248,16 +329,16 @@ double Member_Ptr::get_value_any_number() const {
     //Logger::log()->info("Get any num");
     switch (m_type) {
         case Prim::Type::I32: {
-            return *(static_cast<std::int32_t*>(m_ptr));
+            return *(static_cast<std::int32_t*>(get_readable_ptr()));
         }
         case Prim::Type::I64: {
-            return *(static_cast<std::int64_t*>(m_ptr));
+            return *(static_cast<std::int64_t*>(get_readable_ptr()));
         }
         case Prim::Type::F32: {
-            return *(static_cast<float*>(m_ptr));
+            return *(static_cast<float*>(get_readable_ptr()));
         }
         case Prim::Type::F64: {
-            return *(static_cast<double*>(m_ptr));
+            return *(static_cast<double*>(get_readable_ptr()));
         }
         default: {
             throw_mismatch_error("(any number)", prim_to_dbg_string(m_type));
@@ -270,6 +351,11 @@ bool Member_Ptr::is_nullptr() const {
     return m_type == Prim::Type::NULLPTR;
 }
 
+bool Arche::has_comp(Comp* comp) const {
+    return std::binary_search(m_sorted_component_array.begin(),
+            m_sorted_component_array.end(), comp);
+}
+
 bool Arche::matches(Entity* ent_unsafe) {
     return ent_unsafe->get_arche() == this;
 }
@@ -281,14 +367,18 @@ Entity* Arche::match(Entity* ent_unsafe) {
     return nullptr;
 }
 
+bool Cview::is_stale() const {
+    return m_generation != get_compile_generation();
+}
+
 bool Cview::is_nullptr() const {
-    return !m_ent.does_exist();
+    return is_stale() || !m_ent.does_exist();
 }
 
 Member_Ptr Cview::get_member_ptr(const Symbol& member_symb) const {
     //Logger::log()->info("Access %v thru cview", member_symb);
     Entity* ent_ptr = m_ent.get_volatile_entity_ptr();
-    if (!ent_ptr) {
+    if (!ent_ptr || is_stale()) {
         return Member_Ptr();
     }
     // Find where the member is stored within the component
@@ -313,6 +403,19 @@ Cview::operator bool() const {
 
 Cview Comp::match(Entity* ent_unsafe) {
     Cview retval;
+    // Tags have no aggregate index, only check for their presence
+    if (m_is_tag) {
+        if (!ent_unsafe->get_arche()->has_comp(this)) {
+            assert(retval.is_nullptr());
+            return retval;
+        }
+        retval.m_cached_aggidx = Arche::Aggindex();
+        retval.m_ent = ent_unsafe->get_handle();
+        retval.m_comp = this;
+        retval.m_generation = get_compile_generation();
+        assert(!retval.is_nullptr());
+        return retval;
+    }
     // Try find the aggregate index
     auto aggidx_iter = ent_unsafe->get_arche()
             ->m_comp_offsets.find(this);
@@ -325,6 +428,7 @@ Cview Comp::match(Entity* ent_unsafe) {
     retval.m_cached_aggidx = aggidx_iter->second;
     retval.m_ent = ent_unsafe->get_handle();
     retval.m_comp = this;
+    retval.m_generation = get_compile_generation();
     assert(!retval.is_nullptr());
     return retval;
 }
@@ -333,8 +437,12 @@ Member_Key::Member_Key(Arche::Aggindex aggidx, Prim prim)
 : m_aggidx(aggidx)
 , m_prim(prim) {}
 
+bool Genview::is_stale() const {
+    return m_generation != get_compile_generation();
+}
+
 bool Genview::is_nullptr() const {
-    return !m_ent.does_exist();
+    return is_stale() || !m_ent.does_exist();
 }
 Genview::operator bool() const {
     return !is_nullptr();
@@ -342,7 +450,7 @@ Genview::operator bool() const {
 
 Member_Ptr Genview::get_member_ptr(const Symbol& member_symb) const {
     Entity* ent_ptr = m_ent.get_volatile_entity_ptr();
-    if (!ent_ptr) {
+    if (!ent_ptr || is_stale()) {
         return Member_Ptr();
     }
     // Extract the aggidx and primitive
@@ -382,6 +490,7 @@ Genview Genre::match(Entity* ent_unsafe) {
                 arche->m_sorted_component_array)) {
             retval.m_ent = ent_unsafe->get_handle();
             retval.m_pattern = &pattern;
+            retval.m_generation = get_compile_generation();
             assert(!retval.is_nullptr());
             return retval;
         }
@@ -391,34 +500,73 @@ Genview Genre::match(Entity* ent_unsafe) {
     return retval;
 }
 
+Arche_Layout Arche_Layout::save(const Arche* arche) {
+    Arche_Layout layout;
+    layout.m_components = arche->m_components;
+    layout.m_comp_offsets = arche->m_comp_offsets;
+    for (const auto& comp_entry : arche->m_components) {
+        layout.m_member_offsets[comp_entry.second] = 
+                comp_entry.second->m_member_offsets;
+    }
+    layout.m_default_strings = arche->m_default_strings;
+    return layout;
+}
+
+/**
+ * @return Shared ownership of the chunk, which deletes it when the last entity
+ * using it is gone
+ */
+std::shared_ptr<void> own_chunk(Algs::Podc_Ptr chunk) {
+    return std::shared_ptr<void>(chunk.get_raw(), [chunk](void* raw) {
+        Algs::Podc_Ptr::delete_podc(chunk);
+    });
+}
+
 Entity::Entity(Arche* arche, Entity_Handle handle)
 : m_arche(arche)
 , m_handle(handle) {
     
-    m_chunk.reset(Algs::Podc_Ptr::new_podc(
-            ENT_HEADER_SIZE + m_arche->m_default_chunk.get().get_size()));
+    m_chunk = Algs::Podc_Ptr::new_podc(
+            ENT_HEADER_SIZE + m_arche->m_default_chunk.get().get_size());
+    m_chunk_owner = own_chunk(m_chunk);
     
     Algs::Podc_Ptr::copy_podc(
             m_arche->m_default_chunk.get(), 0, 
-            m_chunk.get(), ENT_HEADER_SIZE,
+            m_chunk, ENT_HEADER_SIZE,
             m_arche->m_default_chunk.get().get_size());
     
-    m_chunk.get().set_value<std::uint64_t>(ENT_HEADER_FLAGS, ENT_FLAGS_DEFAULT);
-    m_strings = m_arche->m_default_strings;
+    m_chunk.set_value<std::uint64_t>(ENT_HEADER_FLAGS, ENT_FLAGS_DEFAULT);
     
     assert(get_flags() == ENT_FLAGS_DEFAULT);
     assert(!has_been_spawned());
 }
 
+Entity::Entity(const Entity& parent, Entity_Handle handle)
+: m_arche(parent.m_arche)
+, m_chunk(parent.m_chunk)
+, m_chunk_owner(parent.m_chunk_owner)
+, m_string_overrides(parent.m_string_overrides)
+, m_string_override_bits(parent.m_string_override_bits)
+, m_handle(handle) {}
+
 Arche* Entity::get_arche() const {
     return m_arche;
 }
 Algs::Podc_Ptr Entity::get_chunk() const {
-    return m_chunk.get();
+    return m_chunk;
 }
 Entity_Handle Entity::get_handle() const {
     return m_handle;
 }
+World* Entity::get_world() const {
+    World* world = World::find(m_handle.get_id());
+    assert(world);
+    return world;
+}
+Entity_Collection& Entity::get_collection() const {
+    assert(m_collection);
+    return *m_collection;
+}
 
 Script::Regref Entity::get_table() {
     if (m_generic_table.is_nil()) {
@@ -447,16 +595,197 @@ void Entity::free_weak_table() {
     m_generic_weak_table.reset();
 }
 
-std::string Entity::get_string(std::size_t idx) const {
-    assert(idx >= 0 && idx < m_strings.size());
-    return m_strings[idx];
+Script::Regref Entity::peek_table() const {
+    return m_generic_table.get();
+}
+
+Script::Regref Entity::peek_weak_table() const {
+    return m_generic_weak_table.get();
+}
+
+const std::string& Entity::get_string(std::size_t idx) const {
+    return get_istr(idx).get_string();
+}
+const Istr_Ptr& Entity::get_istr(std::size_t idx) const {
+    assert(idx >= 0 && idx < m_arche->m_default_strings.size());
+    if (m_string_override_bits & (std::uint64_t(1) << (idx % 64))) {
+        auto iter = std::lower_bound(
+                m_string_overrides.begin(), m_string_overrides.end(), idx,
+                [](const String_Override& ovr, std::size_t idx) -> bool {
+                    return ovr.m_idx < idx;
+                });
+        if (iter != m_string_overrides.end() && iter->m_idx == idx) {
+            return iter->m_str;
+        }
+    }
+    return m_arche->m_default_strings[idx];
+}
+void Entity::set_string(std::size_t idx, const std::string& val) {
+    set_istr(idx, intern_string(val));
+}
+void Entity::set_istr(std::size_t idx, const Istr_Ptr& val) {
+    assert(idx >= 0 && idx < m_arche->m_default_strings.size());
+    mark_dirty();
+    auto iter = std::lower_bound(
+            m_string_overrides.begin(), m_string_overrides.end(), idx,
+            [](const String_Override& ovr, std::size_t idx) -> bool {
+                return ovr.m_idx < idx;
+            });
+    bool found = iter != m_string_overrides.end() && iter->m_idx == idx;
+    
+    // Writing the default value back removes the override
+    if (val == m_arche->m_default_strings[idx]) {
+        if (found) {
+            m_string_overrides.erase(iter);
+            m_string_override_bits = 0;
+            for (const String_Override& ovr : m_string_overrides) {
+                m_string_override_bits |= std::uint64_t(1) << (ovr.m_idx % 64);
+            }
+        }
+        return;
+    }
+    
+    if (found) {
+        iter->m_str = val;
+    } else {
+        m_string_overrides.insert(iter, String_Override{idx, val});
+        m_string_override_bits |= std::uint64_t(1) << (idx % 64);
+    }
+}
+const std::vector<Entity::String_Override>& 
+        Entity::get_string_overrides() const {
+    return m_string_overrides;
+}
+void Entity::set_string_overrides(
+        const std::vector<String_Override>& overrides) {
+    mark_dirty();
+    m_string_overrides = overrides;
+    m_string_override_bits = 0;
+    for (const String_Override& ovr : m_string_overrides) {
+        assert(ovr.m_idx < m_arche->m_default_strings.size());
+        m_string_override_bits |= std::uint64_t(1) << (ovr.m_idx % 64);
+    }
+}
+void Entity::mark_dirty() {
+    Entity_Collection& ents = get_collection();
+    
+    // Forks still need the entity as it was, sharing the chunk for now
+    if (m_fork_epoch != ents.get_fork_epoch()) {
+        ents.preserve_in_forks(this);
+    }
+    if (is_chunk_shared()) {
+        unshare_chunk();
+    }
+    
+    // Epoch zero means that changes are not being tracked
+    std::uint64_t epoch = ents.get_dirty_epoch();
+    if (epoch != 0 && m_dirty_epoch != epoch) {
+        ents.record_pre_image(this);
+    }
+}
+bool Entity::is_chunk_shared() const {
+    return m_chunk_owner.use_count() > 1;
+}
+void Entity::unshare_chunk() {
+    Algs::Podc_Ptr copy = Algs::Podc_Ptr::new_podc(m_chunk.get_size());
+    std::shared_ptr<void> copy_owner = own_chunk(copy);
+    Algs::Podc_Ptr::copy_podc(m_chunk, 0, copy, 0, m_chunk.get_size());
+    m_chunk = copy;
+    m_chunk_owner = std::move(copy_owner);
+}
+void Entity::migrate(const Arche_Layout& old_layout) {
+    std::size_t chunk_size = 
+            ENT_HEADER_SIZE + m_arche->m_default_chunk.get().get_size();
+    Algs::Podc_Ptr chunk = Algs::Podc_Ptr::new_podc(chunk_size);
+    std::shared_ptr<void> chunk_owner = own_chunk(chunk);
+    Algs::Podc_Ptr::copy_podc(m_chunk, 0, chunk, 0, ENT_HEADER_SIZE);
+    Algs::Podc_Ptr::copy_podc(
+            m_arche->m_default_chunk.get(), 0, 
+            chunk, ENT_HEADER_SIZE,
+            m_arche->m_default_chunk.get().get_size());
+    
+    std::vector<String_Override> overrides;
+    for (const auto& comp_entry : old_layout.m_components) {
+        // Components are only the same if they have the same name too
+        Comp* comp = comp_entry.second;
+        auto new_comp_iter = m_arche->m_components.find(comp_entry.first);
+        if (new_comp_iter == m_arche->m_components.end()
+                || new_comp_iter->second != comp) {
+            continue;
+        }
+        
+        // Tags have no offsets, and have nothing to copy either
+        auto old_aggidx_iter = old_layout.m_comp_offsets.find(comp);
+        auto new_aggidx_iter = m_arche->m_comp_offsets.find(comp);
+        if (old_aggidx_iter == old_layout.m_comp_offsets.end()
+                || new_aggidx_iter == m_arche->m_comp_offsets.end()) {
+            continue;
+        }
+        const Arche::Aggindex& old_aggidx = old_aggidx_iter->second;
+        const Arche::Aggindex& new_aggidx = new_aggidx_iter->second;
+        
+        for (const auto& member : old_layout.m_member_offsets.at(comp)) {
+            const Prim& old_prim = member.second;
+            auto new_prim_iter = comp->m_member_offsets.find(member.first);
+            if (old_prim.m_shared
+                    || new_prim_iter == comp->m_member_offsets.end()
+                    || new_prim_iter->second.m_shared
+                    || new_prim_iter->second.m_type != old_prim.m_type) {
+                continue;
+            }
+            const Prim& new_prim = new_prim_iter->second;
+            
+            if (old_prim.m_type == Prim::Type::STR) {
+                std::size_t old_idx = 
+                        old_aggidx.m_string_idx + old_prim.m_refer.m_index;
+                Istr_Ptr str = old_layout.m_default_strings[old_idx];
+                for (const String_Override& ovr : m_string_overrides) {
+                    if (ovr.m_idx == old_idx) {
+                        str = ovr.m_str;
+                    }
+                }
+                std::size_t idx = 
+                        new_aggidx.m_string_idx + new_prim.m_refer.m_index;
+                if (str != m_arche->m_default_strings[idx]) {
+                    overrides.push_back(String_Override{idx, str});
+                }
+                continue;
+            }
+            
+            std::size_t size = get_pod_size(old_prim.m_type);
+            if (size == 0) {
+                continue;
+            }
+            std::memcpy(
+                    static_cast<char*>(chunk.get_raw()) + ENT_HEADER_SIZE 
+                            + new_aggidx.m_pod_idx 
+                            + new_prim.m_refer.m_byte_offset,
+                    static_cast<const char*>(m_chunk.get_raw()) 
+                            + ENT_HEADER_SIZE 
+                            + old_aggidx.m_pod_idx 
+                            + old_prim.m_refer.m_byte_offset,
+                    size);
+        }
+    }
+    std::sort(overrides.begin(), overrides.end(), 
+            [](const String_Override& a, const String_Override& b) -> bool {
+                return a.m_idx < b.m_idx;
+            });
+    
+    m_chunk = chunk;
+    m_chunk_owner = std::move(chunk_owner);
+    m_string_overrides = std::move(overrides);
+    m_string_override_bits = 0;
+    for (const String_Override& ovr : m_string_overrides) {
+        m_string_override_bits |= std::uint64_t(1) << (ovr.m_idx % 64);
+    }
 }
 Script::Regref Entity::get_func(std::size_t idx) const {
     assert(idx >= 0 && idx < m_arche->m_static_funcs.size());
     return m_arche->m_static_funcs[idx];
 }
 std::uint64_t Entity::get_flags() const {
-    return m_chunk.get().get_value<std::uint64_t>(ENT_HEADER_FLAGS);
+    return m_chunk.get_value<std::uint64_t>(ENT_HEADER_FLAGS);
 }
 
 bool Entity::has_been_spawned() const {
@@ -481,14 +810,14 @@ bool Entity::is_lua_owned() const {
 void Entity::spawn() {
     assert(can_be_spawned());
     set_flag_spawned(true);
-    Event::get_entity_spawned_event()->trigger(this);
+    get_world()->get_spawned_event()->trigger(this);
     assert(has_been_spawned());
 }
 
 void Entity::kill() {
     assert(has_been_spawned());
     set_flag_killed(true);
-    Event::get_entity_killed_event()->trigger(this);
+    get_world()->get_killed_event()->trigger(this);
     assert(has_been_killed());
 }
 
@@ -506,48 +835,76 @@ Member_Ptr Entity::get_member(const Member_Key& member_key) {
         case Runtime::Prim::Type::I32:
         case Runtime::Prim::Type::I64:
         case Runtime::Prim::Type::F32:
-        case Runtime::Prim::Type::F64: {
-            std::size_t pod_offset = Runtime::ENT_HEADER_SIZE
-                                    + aggidx.m_pod_idx 
-                                    + prim.m_refer.m_byte_offset;
+        case Runtime::Prim::Type::F64:
+        case Runtime::Prim::Type::ENTITY: {
+            // Shared values are stored in the archetype instead
+            Algs::Podc_Ptr chunk;
+            std::size_t pod_offset;
+            if (prim.m_shared) {
+                chunk = m_arche->m_shared_chunk.get();
+                pod_offset = aggidx.m_shared_pod_idx
+                            + prim.m_refer.m_byte_offset;
+            } else {
+                chunk = m_chunk;
+                pod_offset = Runtime::ENT_HEADER_SIZE
+                            + aggidx.m_pod_idx 
+                            + prim.m_refer.m_byte_offset;
+            }
             //Logger::log()->info("Access pod");
-            assert(pod_offset < m_chunk.get().get_size());
+            assert(pod_offset < chunk.get_size());
             assert(pod_offset >= 0);
             switch(prim.m_type) {
                 case Runtime::Prim::Type::I32: {
                     //Logger::log()->info("i32");
-                    vptr = m_chunk.get().get_aligned<std::int32_t>(pod_offset);
+                    vptr = chunk.get_aligned<std::int32_t>(pod_offset);
                     break;
                 }
                 case Runtime::Prim::Type::I64: {
                     //Logger::log()->info("i64");
-                    vptr = m_chunk.get().get_aligned<std::int64_t>(pod_offset);
+                    vptr = chunk.get_aligned<std::int64_t>(pod_offset);
                     break;
                 }
                 case Runtime::Prim::Type::F32: {
                     //Logger::log()->info("f32");
-                    vptr = m_chunk.get().get_aligned<float>(pod_offset);
+                    vptr = chunk.get_aligned<float>(pod_offset);
                     break;
                 }
                 case Runtime::Prim::Type::F64: {
                     //Logger::log()->info("f64");
-                    vptr = m_chunk.get().get_aligned<double>(pod_offset);
+                    vptr = chunk.get_aligned<double>(pod_offset);
+                    break;
+                }
+                case Runtime::Prim::Type::ENTITY: {
+                    //Logger::log()->info("entity");
+                    vptr = chunk.get_aligned<std::uint64_t>(pod_offset);
+                    
                     break;
                 }
                 default: {
                     assert(false && "Should not have got here!");
                 }
             }
+            // Writes must go through the entity, see Member_Ptr
+            if (!prim.m_shared) {
+                return Member_Ptr(this, prim.m_type, pod_offset);
+            }
             break;
         }
         case Runtime::Prim::Type::STR: {
+            if (prim.m_shared) {
+                std::size_t string_idx = aggidx.m_shared_string_idx
+                                        + prim.m_refer.m_index;
+                assert(string_idx < m_arche->m_shared_strings.size());
+                vptr = &(m_arche->m_shared_strings[string_idx]);
+                break;
+            }
             std::size_t string_idx = aggidx.m_string_idx
                                     + prim.m_refer.m_index;
             //Logger::log()->info("Access str %v", string_idx);
-            assert(string_idx < m_strings.size());
+            assert(string_idx < m_arche->m_default_strings.size());
             assert(string_idx >= 0);
-            vptr = &(m_strings[string_idx]);
-            break;
+            // Copy-on-write, so the entity must handle the writing
+            return Member_Ptr(this, string_idx);
         }
         case Runtime::Prim::Type::FUNC: {
             std::size_t func_idx = aggidx.m_func_idx
@@ -576,12 +933,19 @@ Cview Entity::make_cview(const Symbol& comp_symb) {
     }
     // Get the component ptr
     retval.m_comp = comp_iter->second;
+    retval.m_ent = get_handle();
+    retval.m_generation = get_compile_generation();
+    // Tags have no data, and therefore no aggregate index
+    if (retval.m_comp->m_is_tag) {
+        retval.m_cached_aggidx = Arche::Aggindex();
+        assert(!retval.is_nullptr());
+        return retval;
+    }
     // Get the aggregate index (which should definitely be there)
     auto aggidx_iter = m_arche->m_comp_offsets.find(retval.m_comp);
     assert(aggidx_iter != m_arche->m_comp_offsets.end());
     retval.m_cached_aggidx = aggidx_iter->second;
     
-    retval.m_ent = get_handle();
     assert(!retval.is_nullptr());
     return retval;
 }
@@ -590,8 +954,9 @@ Entity::Entity()
 : m_arche(nullptr) {}
 
 void Entity::set_flags(std::uint64_t arg_flags, bool set) {
+    mark_dirty();
     std::uint64_t flags = 
-            m_chunk.get().get_value<std::uint64_t>(ENT_HEADER_FLAGS);
+            m_chunk.get_value<std::uint64_t>(ENT_HEADER_FLAGS);
     if (set) {
         flags |= arg_flags;
         assert((flags & arg_flags) == arg_flags);
@@ -599,7 +964,7 @@ void Entity::set_flags(std::uint64_t arg_flags, bool set) {
         flags &= ~arg_flags;
         assert((flags & arg_flags) == 0);
     }
-    m_chunk.get().set_value<std::uint64_t>(ENT_HEADER_FLAGS, flags);
+    m_chunk.set_value<std::uint64_t>(ENT_HEADER_FLAGS, flags);
 }
     
 void Entity::set_flag_spawned(bool flag) {
@@ -618,11 +983,12 @@ void Entity::set_flag_killed(bool flag) {
 void initialize() {
 }
 void cleanup() {
-    n_ent_collection.clear();
+    get_default_world().get_entities().clear();
     n_runtime_comps.clear();
     n_runtime_arches.clear();
     n_runtime_genres.clear();
     n_held_lua_values.clear();
+    next_compile_generation();
 }
 
 std::uint64_t bottom_52(std::uint64_t num) {
@@ -630,6 +996,15 @@ std::uint64_t bottom_52(std::uint64_t num) {
     return num & 0x001FFFFFFFFFFFFF;
 }
 
+std::uint64_t n_compile_generation = 0;
+
+std::uint64_t get_compile_generation() {
+    return n_compile_generation;
+}
+void next_compile_generation() {
+    ++n_compile_generation;
+}
+
 Runtime::Comp* find_comp(Resour::Oid id_str) {
     return Util::find_something(n_runtime_comps, id_str, 
             "Could not find component: %v");
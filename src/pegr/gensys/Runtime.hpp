@@ -45,8 +45,21 @@ Comp* find_comp(Resour::Oid oid);
 Arche* find_arche(Resour::Oid oid);
 Genre* find_genre(Resour::Oid oid);
 
+/**
+ * @return A number that changes whenever compiled components, archetypes or
+ * genres are rebuilt or deleted. Cviews and Genviews remember the generation
+ * they were made in, and become null once it changes.
+ */
+std::uint64_t get_compile_generation();
+void next_compile_generation();
+
 const char* prim_to_dbg_string(Prim::Type ty);
 
+/**
+ * @return Size of a per-entity pod member, or zero for non-pod members
+ */
+std::size_t get_pod_size(Prim::Type type);
+
 /* The to_string_X convert various objects into human-readable strings. Used
  * mainly for tostring(...) in Lua
  */
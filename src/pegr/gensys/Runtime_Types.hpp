@@ -20,10 +20,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "pegr/gensys/Entity_Handle.hpp"
+#include "pegr/gensys/Interned_Strings.hpp"
 #include "pegr/algs/Pod_Chunk.hpp"
 #include "pegr/script/Script.hpp"
 
@@ -48,6 +50,9 @@ struct Prim {
         // Uses size_t, goes into byte chunk
         F32, F64,
         I32, I64,
+        
+        // Uses size_t, goes into byte chunk as an Entity_Ref
+        ENTITY,
 
         // Uses Arridx, goes into the Gensys table
         FUNC,
@@ -68,7 +73,7 @@ struct Prim {
         /**
          * @brief This is a location within the entity chunk. Measured in bytes.
          * This member is a part of a union.
-         * Used for pod data types, [F32, F64, I32, I64]
+         * Used for pod data types, [F32, F64, I32, I64, ENTITY]
          */
         std::size_t m_byte_offset;
         
@@ -81,16 +86,50 @@ struct Prim {
     };
     
     Refer m_refer;
+    
+    // If true, then the data lives in the archetype's shared storage rather
+    // than the entity's. (Always true for FUNC)
+    bool m_shared = false;
+};
+
+class Entity;
+class World;
+class Entity_Collection;
+
+/**
+ * @class Entity_Ref
+ * @brief How a reference to another entity is packed into the POD chunk.
+ * A zero-filled Entity_Ref is a null reference, hence the id is stored plus
+ * one. The id is relative to the first id of the world holding the reference
+ * (see Entity_Collection::get_ref_target()), so that forked worlds can share
+ * chunks with their parent without rewriting any references. The slot hint
+ * is where the entity was last found inside of the Entity_Collection, which
+ * lets resolution skip the hash map lookup so long as the entity has not
+ * moved since.
+ */
+struct Entity_Ref {
+    std::uint64_t m_packed_id;
+    std::uint64_t m_slot_hint;
 };
 
 /**
  * @class Member_Ptr
  * @brief Rather than return a bare void ptr, we return a Member_Ptr to make
  * runtime read/write checks easier.
+ * 
+ * Per-entity strings are copy-on-write, and so such a Member_Ptr refers to
+ * the entity and string index instead. This is only valid for as long as the
+ * entity is not moved (i.e. do not hold onto Member_Ptrs). The same applies to
+ * all other per-entity members, so that writes can mark the entity as dirty
+ * (see Entity::mark_dirty()) and keep the back-reference index up to date.
+ * Members stored in the archetype (shared and function members) cannot be
+ * written to; the setters throw runtime errors instead.
  */
 class Member_Ptr {
 public:
     Member_Ptr(Prim::Type typ, void* ptr);
+    Member_Ptr(Entity* ent, std::size_t string_idx); // Per-entity string
+    Member_Ptr(Entity* ent, Prim::Type typ, std::size_t byte_offset); // Pod
     Member_Ptr(); // nullptr
     
     Prim::Type get_type() const;
@@ -102,14 +141,25 @@ public:
     void set_value_f32(float val) const;
     void set_value_f64(double val) const;
     void set_value_str(const std::string& val) const;
+    void set_value_istr(const Istr_Ptr& val) const;
     void set_value_func(Script::Regref val) const;
+    void set_value_entity(Entity_Handle val) const;
     
     std::int32_t get_value_i32() const;
     std::int64_t get_value_i64() const;
     float get_value_f32() const;
     double get_value_f64() const;
     const std::string& get_value_str() const;
+    const Istr_Ptr& get_value_istr() const;
     Script::Regref get_value_func() const;
+    Entity_Handle get_value_entity() const;
+    
+    /**
+     * @brief Resolves an entity reference using the cached slot hint. 
+     * @return The referenced entity, or nullptr if it no longer exists. This
+     * pointer is volatile, see Entity_Handle::get_volatile_entity_ptr()
+     */
+    Entity* resolve_value_entity() const;
     
     void set_value_any_number(double val) const;
     double get_value_any_number() const;
@@ -119,10 +169,28 @@ public:
 private:
     Prim::Type m_type;
     void* m_ptr;
+    
+    // Only used for per-entity members
+    Entity* m_ent = nullptr;
+    std::size_t m_string_idx = 0;
+    std::size_t m_byte_offset = 0;
+    
+    /**
+     * @brief Marks the entity as dirty before a write.
+     * Throws a runtime error if the member is stored in the archetype.
+     * @return Where to write to, which can differ from m_ptr if the entity's
+     * chunk was shared with a forked world
+     */
+    void* get_writable_ptr() const;
+    
+    /**
+     * @return Where to read from. For per-entity members, this is found again
+     * from the entity, since the entity's chunk is replaced by the first
+     * write after forking (even through another Member_Ptr).
+     */
+    void* get_readable_ptr() const;
 };
 
-class Entity;
-
 struct Comp;
 
 /**
@@ -151,14 +219,31 @@ struct Arche {
          * array.
          */
         std::size_t m_func_idx;
+        
+        /**
+         * @brief Index for the first byte of the archetype shared pod chunk.
+         */
+        std::size_t m_shared_pod_idx;
+        
+        /**
+         * @brief Index for the first string in the archetype shared string
+         * array.
+         */
+        std::size_t m_shared_string_idx;
     };
     
     /* Merely an array of all of the components that this Archetype uses. To
      * quickly check if an Archetype has every component in some set. (Genre
-     * matching, namely.)
+     * matching, namely.) Unlike m_comp_offsets, this includes tags.
      */
     std::vector<Comp*> m_sorted_component_array;
     
+    /* Byte offsets of every per-entity Entity_Ref within the entity chunk
+     * (including the header). Used to find references without knowing which
+     * components they belong to, e.g. when clearing references to an entity.
+     */
+    std::vector<std::size_t> m_entity_ref_offsets;
+    
     /* Archetypes are composed of components. This maps the internal name to
      * the actual component.
      */
@@ -172,6 +257,12 @@ struct Arche {
      */
     std::map<Comp*, Aggindex> m_comp_offsets;
 
+    /**
+     * @brief Checks if this archetype has the component (including tags).
+     * Uses a binary search in m_sorted_component_array.
+     */
+    bool has_comp(Comp* comp) const;
+
     /* Default chunk which is fast-copied into the entity's chunk. These chunks
      * only contain POD types.
      */
@@ -179,12 +270,19 @@ struct Arche {
 
     /* Default collection of default strings
      */
-    std::vector<std::string> m_default_strings;
+    std::vector<Istr_Ptr> m_default_strings;
     
     /* Vector of static lua references
      */
     std::vector<Script::Regref> m_static_funcs;
     
+    /* Values of "shared" members, which are stored only once per archetype
+     * instead of being copied into every entity. These are read-only at
+     * runtime, since all worlds (and forks) read the same bytes.
+     */
+    Algs::Unique_Chunk_Ptr m_shared_chunk;
+    std::vector<Istr_Ptr> m_shared_strings;
+    
     /* Cached Lua value to provide when accessed in a Lua script. The compiler
      * does not populate this field automatically. A Lua userdata value is
      * created and handed to the Arche upon the first access.
@@ -207,6 +305,14 @@ struct Cview {
     Arche::Aggindex m_cached_aggidx;
     Comp* m_comp;
     
+    // See get_compile_generation()
+    std::uint64_t m_generation = 0;
+    
+    /**
+     * @return If the component was recompiled since this view was made, in
+     * which case the cached index and component may no longer be valid
+     */
+    bool is_stale() const;
     bool is_nullptr() const;
     
 public:
@@ -228,6 +334,12 @@ struct Comp {
      */
     std::map<Symbol, Prim> m_member_offsets;
     
+    /* Tag components have no members and therefore no storage. They are not
+     * given an entry in any archetype's m_comp_offsets and exist only in
+     * m_components and m_sorted_component_array (for matching).
+     */
+    bool m_is_tag = false;
+    
     /* Cached Lua value to provide when accessed in a Lua script. The compiler
      * does not populate this field automatically. A Lua userdata value is
      * created and handed to the Comp upon the first access.
@@ -263,6 +375,14 @@ struct Genview {
     Entity_Handle m_ent;
     Pattern* m_pattern;
     
+    // See get_compile_generation()
+    std::uint64_t m_generation = 0;
+    
+    /**
+     * @return If the genre was recompiled since this view was made, in which
+     * case the pattern may no longer exist
+     */
+    bool is_stale() const;
     bool is_nullptr() const;
     
 public:
@@ -314,6 +434,24 @@ struct Genre {
     Genview match(Entity* ent_unsafe);
 };
 
+/**
+ * @class Arche_Layout
+ * @brief Where an archetype stored each member before it was recompiled. The
+ * archetype and components are recompiled in place, so this is a copy of
+ * everything needed to find the old members in an entity.
+ */
+struct Arche_Layout {
+    std::map<Symbol, Comp*> m_components;
+    std::map<Comp*, Arche::Aggindex> m_comp_offsets;
+    std::map<Comp*, std::map<Symbol, Prim> > m_member_offsets;
+    std::vector<Istr_Ptr> m_default_strings;
+    
+    /**
+     * @brief Makes a copy of the archetype's current layout
+     */
+    static Arche_Layout save(const Arche* arche);
+};
+
 extern const uint64_t ENT_HEADER_FLAGS;
 extern const uint64_t ENT_HEADER_SIZE;
 
@@ -413,6 +551,17 @@ public:
      */
     Entity_Handle get_handle() const;
     
+    /**
+     * @return The world that the entity belongs to
+     */
+    World* get_world() const;
+    
+    /**
+     * @return The collection that the entity belongs to, without having to
+     * find the world first
+     */
+    Entity_Collection& get_collection() const;
+    
     /**
      * @return m_generic_table The extra Lua data associated with this
      * entity. If no table exists, generate one.
@@ -435,11 +584,71 @@ public:
      * @brief Drops the reference to the internal Lua table
      */
     void free_weak_table();
+    
+    /**
+     * @return Same as get_table() and get_weak_table(), but nil instead of
+     * generating a table that does not exist yet
+     */
+    Script::Regref peek_table() const;
+    Script::Regref peek_weak_table() const;
 
     /**
-     * @return m_strings, the array of strings for replacement instance data
+     * @return The string with the given index, which is either the override
+     * stored in m_string_overrides or the archetype default
+     */
+    const std::string& get_string(std::size_t idx) const;
+    
+    /**
+     * @return Same as get_string(), but as the interned string
+     */
+    const Istr_Ptr& get_istr(std::size_t idx) const;
+    
+    /**
+     * @brief Sets the string with the given index. Only stores an override if
+     * the value differs from the archetype default.
+     */
+    void set_string(std::size_t idx, const std::string& val);
+    
+    /**
+     * @brief Same as set_string(), but with an already-interned string. This
+     * is only a pointer store.
      */
-    std::string get_string(std::size_t idx) const;
+    void set_istr(std::size_t idx, const Istr_Ptr& val);
+    
+    /**
+     * @brief A string which replaces the archetype default
+     */
+    struct String_Override {
+        std::size_t m_idx;
+        Istr_Ptr m_str;
+    };
+    
+    /**
+     * @return All of the strings which differ from the archetype defaults,
+     * sorted by index
+     */
+    const std::vector<String_Override>& get_string_overrides() const;
+    
+    /**
+     * @brief Replaces all of the string overrides at once
+     * @param overrides Sorted by index, none equal to the archetype default
+     */
+    void set_string_overrides(const std::vector<String_Override>& overrides);
+    
+    /**
+     * @brief Must be called before any modification to the entity's chunk or
+     * strings. If the Entity_Collection is tracking changes, this records the
+     * state of the entity before its first modification. If the chunk is
+     * shared with another world, then the entity gets its own copy first,
+     * so get_chunk() can return a different chunk afterwards.
+     */
+    void mark_dirty();
+    
+    /**
+     * @return If the chunk is also used by an entity in another world (see
+     * World::fork()). Such chunks must not be written to.
+     */
+    bool is_chunk_shared() const;
     
     /**
      * @return static function in archetype
@@ -544,13 +753,39 @@ private:
      *
      * The instance data comprises the remainder of the memory block. Only
      * constant-size data is stored here.
+     * 
+     * The chunk is copy-on-write between forked worlds, and so it is owned
+     * through m_chunk_owner rather than by the entity alone.
      */
-    Algs::Unique_Chunk_Ptr m_chunk;
+    Algs::Podc_Ptr m_chunk;
+    std::shared_ptr<void> m_chunk_owner;
 
-    // Array of strings that replace the archetype defaults.
-    // TODO: a bitfield for checking if the strings are actually different
-    // from the defaults (save space)
-    std::vector<std::string> m_strings;
+    /* Strings that replace the archetype defaults, sorted by index. Strings
+     * are copy-on-write: until a string is written to, the entity only refers
+     * to Arche::m_default_strings, and so spawning allocates nothing here.
+     */
+    std::vector<String_Override> m_string_overrides;
+    
+    /* Bit (idx % 64) is set if any string with such an index is overridden.
+     * Used to skip searching m_string_overrides for most reads.
+     */
+    std::uint64_t m_string_override_bits = 0;
+    
+    /* If this matches the Entity_Collection's dirty epoch, then this entity
+     * has already been marked dirty (or was created) since change tracking
+     * last restarted. Zero is never a tracking epoch.
+     */
+    std::uint64_t m_dirty_epoch = 0;
+    
+    /* If this does not match the Entity_Collection's fork epoch, then the
+     * entity must be copied into the collection's forks before it changes.
+     */
+    std::uint64_t m_fork_epoch = 0;
+    
+    // Set by the collection, which outlives all of its entities
+    Entity_Collection* m_collection = nullptr;
+    
+    friend class Entity_Collection;
     
     Entity_Handle m_handle;
     
@@ -565,7 +800,29 @@ private:
      * @brief Same as m_generic_table, except the values are weak.
      */
     Script::Unique_Regref m_generic_weak_table;
+
+    /**
+     * @brief Makes an entity for a forked world. The chunk and strings are
+     * shared with the parent entity, but the Lua tables are not copied.
+     * @param parent The entity in the parent world
+     * @param handle The handle for the entity in the forked world
+     */
+    Entity(const Entity& parent, Entity_Handle handle);
+
+    /**
+     * @brief Replaces a shared chunk with a copy owned by this entity only
+     */
+    void unshare_chunk();
     
+    /**
+     * @brief Rebuilds the chunk and strings after the archetype has been
+     * recompiled. Starts from the new defaults, then copies every member that
+     * still exists with the same type in the same component. The flags are
+     * kept, and so is the handle.
+     * @param old_layout The layout that the chunk and strings were made for
+     */
+    void migrate(const Arche_Layout& old_layout);
+
     /**
      * @brief Changes the state of multiple flags at once. Sets all of the flags
      * specified in "flags" to the state specified in "set". Note that this does
@@ -0,0 +1,918 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/gensys/Snapshot.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "pegr/algs/Algs.hpp"
+#include "pegr/except/Except.hpp"
+#include "pegr/gensys/Binary_Io.hpp"
+#include "pegr/gensys/Interned_Strings.hpp"
+#include "pegr/logger/Logger.hpp"
+#include "pegr/resource/Oid.hpp"
+
+namespace pegr {
+namespace Gensys {
+
+// Forward declaration that lets us find the Oid of each archetype
+namespace Runtime {
+extern std::map<Resour::Oid, std::unique_ptr<Runtime::Arche> > n_runtime_arches;
+} // namespace Runtime
+
+namespace Snapshot {
+
+const char SNAPSHOT_MAGIC[8] = {'P', 'E', 'G', 'R', 'S', 'N', 'A', 'P'};
+const std::uint32_t SNAPSHOT_VERSION = 1;
+
+/**
+ * @return Size of the POD chunk of every entity of this archetype
+ */
+std::size_t get_chunk_size(const Runtime::Arche* arche) {
+    return Runtime::ENT_HEADER_SIZE 
+            + arche->m_default_chunk.get().get_size();
+}
+
+void write_layout(Binary_Io::Writer& writer, 
+        const std::vector<Layout_Member>& layout) {
+    writer.write_value<std::uint64_t>(layout.size());
+    for (const Layout_Member& member : layout) {
+        writer.write_string(member.m_comp_symbol);
+        writer.write_string(member.m_member_symbol);
+        writer.write_value<std::uint32_t>(
+                static_cast<std::uint32_t>(member.m_type));
+        writer.write_value<std::uint64_t>(member.m_location);
+    }
+}
+
+std::vector<Layout_Member> read_layout(Binary_Io::Reader& reader) {
+    std::vector<Layout_Member> layout;
+    std::uint64_t num_members = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_members; ++idx) {
+        Layout_Member member;
+        member.m_comp_symbol = reader.read_string();
+        member.m_member_symbol = reader.read_string();
+        member.m_type = static_cast<Runtime::Prim::Type>(
+                reader.read_value<std::uint32_t>());
+        member.m_location = reader.read_value<std::uint64_t>();
+        layout.push_back(member);
+    }
+    return layout;
+}
+
+std::vector<Layout_Member> get_layout(const Runtime::Arche* arche) {
+    std::vector<Layout_Member> layout;
+    // (m_components is sorted by symbol, and so is m_member_offsets)
+    for (const auto& comp_entry : arche->m_components) {
+        const Runtime::Comp* comp = comp_entry.second;
+        if (comp->m_is_tag) {
+            continue;
+        }
+        auto aggidx_iter = arche->m_comp_offsets.find(comp_entry.second);
+        assert(aggidx_iter != arche->m_comp_offsets.end());
+        const Runtime::Arche::Aggindex& aggidx = aggidx_iter->second;
+        for (const auto& member_entry : comp->m_member_offsets) {
+            const Runtime::Prim& prim = member_entry.second;
+            if (prim.m_shared) {
+                continue;
+            }
+            Layout_Member member;
+            member.m_comp_symbol = comp_entry.first;
+            member.m_member_symbol = member_entry.first;
+            member.m_type = prim.m_type;
+            if (prim.m_type == Runtime::Prim::Type::STR) {
+                member.m_location = aggidx.m_string_idx + prim.m_refer.m_index;
+            } else {
+                assert(Runtime::get_pod_size(prim.m_type) > 0);
+                member.m_location = Runtime::ENT_HEADER_SIZE 
+                        + aggidx.m_pod_idx + prim.m_refer.m_byte_offset;
+            }
+            layout.push_back(member);
+        }
+    }
+    return layout;
+}
+
+std::uint64_t get_layout_fingerprint(const Runtime::Arche* arche) {
+    std::vector<char> buffer;
+    Binary_Io::Writer writer(buffer);
+    writer.write_value<std::uint64_t>(get_chunk_size(arche));
+    writer.write_value<std::uint64_t>(arche->m_default_strings.size());
+    write_layout(writer, get_layout(arche));
+    return Algs::hash_bytes(buffer.data(), buffer.size());
+}
+
+std::vector<char> write_snapshot() {
+    Runtime::Entity_Collection& ents = Runtime::get_entities();
+    
+    // Group the entities by archetype
+    std::map<const Runtime::Arche*, std::vector<Runtime::Entity*> > by_arche;
+    ents.for_each([&](Runtime::Entity* ent) {
+        if (ent->is_lua_owned()) {
+            return;
+        }
+        by_arche[ent->get_arche()].push_back(ent);
+    });
+    
+    std::vector<char> buffer;
+    Binary_Io::Writer writer(buffer);
+    writer.write_bytes(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    writer.write_value<std::uint32_t>(SNAPSHOT_VERSION);
+    writer.write_value<std::uint32_t>(0);
+    writer.write_value<std::uint64_t>(ents.get_next_handle());
+    writer.write_value<std::uint64_t>(by_arche.size());
+    
+    // Sections are ordered by Oid so that equal worlds give equal snapshots
+    std::size_t num_sections = 0;
+    for (const auto& arche_entry : Runtime::n_runtime_arches) {
+        const Runtime::Arche* arche = arche_entry.second.get();
+        auto bucket_iter = by_arche.find(arche);
+        if (bucket_iter == by_arche.end()) {
+            continue;
+        }
+        const std::vector<Runtime::Entity*>& bucket = bucket_iter->second;
+        ++num_sections;
+        
+        std::size_t num_overrides = 0;
+        for (const Runtime::Entity* ent : bucket) {
+            num_overrides += ent->get_string_overrides().size();
+        }
+        std::size_t chunk_size = get_chunk_size(arche);
+        
+        writer.write_string(arche_entry.first.get_repr());
+        writer.write_value<std::uint64_t>(get_layout_fingerprint(arche));
+        writer.write_value<std::uint64_t>(chunk_size);
+        writer.write_value<std::uint64_t>(bucket.size());
+        writer.write_value<std::uint64_t>(num_overrides);
+        write_layout(writer, get_layout(arche));
+        
+        // Handle table
+        for (const Runtime::Entity* ent : bucket) {
+            writer.write_value<std::uint64_t>(ent->get_handle().get_id());
+        }
+        
+        // Chunk block
+        buffer.reserve(buffer.size() + bucket.size() * chunk_size);
+        for (const Runtime::Entity* ent : bucket) {
+            assert(ent->get_chunk().get_size() == chunk_size);
+            writer.write_bytes(ent->get_chunk().get_raw(), chunk_size);
+        }
+        
+        // String overrides
+        for (std::size_t row = 0; row < bucket.size(); ++row) {
+            for (const auto& ovr : bucket[row]->get_string_overrides()) {
+                writer.write_value<std::uint64_t>(row);
+                writer.write_value<std::uint64_t>(ovr.m_idx);
+                writer.write_string(ovr.m_str.get_string());
+            }
+        }
+    }
+    assert(num_sections == by_arche.size());
+    
+    return buffer;
+}
+
+/**
+ * @brief An archetype section that has been read and checked, but not yet
+ * applied to the collection
+ */
+struct Parsed_Section {
+    struct Pod_Move {
+        std::size_t m_from;
+        std::size_t m_to;
+        std::size_t m_size;
+    };
+    struct String_Override {
+        std::size_t m_row;
+        std::size_t m_idx;
+        std::string m_str;
+    };
+    
+    Runtime::Arche* m_arche;
+    std::size_t m_chunk_size;
+    
+    // Same layout, so the whole chunk can be copied
+    bool m_verbatim;
+    
+    // Otherwise, which bytes go where
+    std::vector<Pod_Move> m_pod_moves;
+    
+    std::vector<Runtime::Entity_Handle> m_handles;
+    const char* m_chunk_block;
+    std::vector<String_Override> m_overrides;
+};
+
+/**
+ * @brief Reads a single archetype section without changing the collection
+ * @param reader Reader positioned at the start of the section
+ * @param seen_ids Ids from previous sections, to reject duplicates
+ * @return The section
+ */
+Parsed_Section parse_section(Binary_Io::Reader& reader, 
+        std::set<std::uint64_t>& seen_ids) {
+    Runtime::Entity_Collection& ents = Runtime::get_entities();
+    Parsed_Section section;
+    
+    Resour::Oid oid(reader.read_string());
+    std::uint64_t fingerprint = reader.read_value<std::uint64_t>();
+    std::uint64_t chunk_size = reader.read_value<std::uint64_t>();
+    std::uint64_t num_entities = reader.read_value<std::uint64_t>();
+    std::uint64_t num_overrides = reader.read_value<std::uint64_t>();
+    std::vector<Layout_Member> saved_layout = read_layout(reader);
+    const char* handle_table = 
+            reader.read_bytes(num_entities * sizeof(std::uint64_t));
+    section.m_chunk_block = reader.read_bytes(num_entities * chunk_size);
+    section.m_chunk_size = chunk_size;
+    
+    section.m_arche = Runtime::find_arche(oid);
+    if (!section.m_arche) {
+        std::stringstream sss;
+        sss << "Snapshot contains unknown archetype " << oid;
+        throw Except::Runtime(sss.str());
+    }
+    
+    section.m_verbatim = fingerprint == get_layout_fingerprint(section.m_arche)
+            && chunk_size == get_chunk_size(section.m_arche);
+    
+    /* Otherwise, plan which bytes and strings go where by matching component
+     * symbol, member symbol, and type.
+     */
+    std::map<std::size_t, std::size_t> string_moves;
+    if (!section.m_verbatim) {
+        if (chunk_size < Runtime::ENT_HEADER_SIZE) {
+            throw Except::Runtime("Snapshot has malformed layout");
+        }
+        std::vector<Layout_Member> layout = get_layout(section.m_arche);
+        for (const Layout_Member& saved : saved_layout) {
+            auto iter = std::find_if(layout.begin(), layout.end(),
+                    [&](const Layout_Member& member) -> bool {
+                        return member.m_comp_symbol == saved.m_comp_symbol
+                            && member.m_member_symbol == saved.m_member_symbol
+                            && member.m_type == saved.m_type;
+                    });
+            if (iter == layout.end()) {
+                continue;
+            }
+            if (saved.m_type == Runtime::Prim::Type::STR) {
+                string_moves[saved.m_location] = iter->m_location;
+                continue;
+            }
+            std::size_t size = Runtime::get_pod_size(saved.m_type);
+            if (size == 0 || saved.m_location + size > chunk_size) {
+                throw Except::Runtime("Snapshot has malformed layout");
+            }
+            section.m_pod_moves.push_back(Parsed_Section::Pod_Move{
+                    saved.m_location, iter->m_location, size});
+        }
+    }
+    
+    section.m_handles.reserve(num_entities);
+    for (std::uint64_t row = 0; row < num_entities; ++row) {
+        std::uint64_t id;
+        std::memcpy(&id, handle_table + row * sizeof(std::uint64_t), 
+                sizeof(std::uint64_t));
+        Runtime::Entity_Handle handle(id);
+        if (!ents.owns_handle(handle)) {
+            throw Except::Runtime("Snapshot belongs to another world");
+        }
+        if (!seen_ids.insert(id).second) {
+            throw Except::Runtime("Snapshot contains duplicate entities");
+        }
+        section.m_handles.push_back(handle);
+    }
+    
+    section.m_overrides.reserve(num_overrides);
+    for (std::uint64_t idx = 0; idx < num_overrides; ++idx) {
+        std::uint64_t row = reader.read_value<std::uint64_t>();
+        std::size_t string_idx = reader.read_value<std::uint64_t>();
+        std::string str = reader.read_string();
+        if (row >= num_entities) {
+            throw Except::Runtime("Snapshot has malformed string override");
+        }
+        if (!section.m_verbatim) {
+            auto iter = string_moves.find(string_idx);
+            if (iter == string_moves.end()) {
+                continue;
+            }
+            string_idx = iter->second;
+        }
+        if (string_idx >= section.m_arche->m_default_strings.size()) {
+            throw Except::Runtime("Snapshot has malformed string override");
+        }
+        section.m_overrides.push_back(Parsed_Section::String_Override{
+                row, string_idx, std::move(str)});
+    }
+    
+    if (!section.m_verbatim && !section.m_handles.empty()) {
+        Logger::log()->info("Migrating entities of %v to new layout", oid);
+    }
+    return section;
+}
+
+/**
+ * @brief Restores the entities of a section that was checked by 
+ * parse_section(). Cannot fail.
+ */
+void apply_section(const Parsed_Section& section) {
+    Runtime::Entity_Collection& ents = Runtime::get_entities();
+    for (std::size_t row = 0; row < section.m_handles.size(); ++row) {
+        Runtime::Entity* ent = 
+                ents.restore_entity(section.m_arche, section.m_handles[row]);
+        char* dest = static_cast<char*>(ent->get_chunk().get_raw());
+        const char* src = section.m_chunk_block + row * section.m_chunk_size;
+        if (section.m_verbatim) {
+            std::memcpy(dest, src, section.m_chunk_size);
+        } else {
+            std::memcpy(dest, src, Runtime::ENT_HEADER_SIZE);
+            for (const Parsed_Section::Pod_Move& move : section.m_pod_moves) {
+                std::memcpy(dest + move.m_to, src + move.m_from, move.m_size);
+            }
+        }
+    }
+    for (const Parsed_Section::String_Override& ovr : section.m_overrides) {
+        ents.get_entity(section.m_handles[ovr.m_row])
+                ->set_string(ovr.m_idx, ovr.m_str);
+    }
+}
+
+void read_snapshot(const char* data, std::size_t size) {
+    Binary_Io::Reader reader(data, size, "Snapshot");
+    if (std::memcmp(reader.read_bytes(sizeof(SNAPSHOT_MAGIC)), 
+            SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        throw Except::Runtime("Not a snapshot");
+    }
+    std::uint32_t version = reader.read_value<std::uint32_t>();
+    if (version != SNAPSHOT_VERSION) {
+        std::stringstream sss;
+        sss << "Unsupported snapshot version " << version;
+        throw Except::Runtime(sss.str());
+    }
+    reader.read_value<std::uint32_t>(); // Reserved
+    std::uint64_t next_handle = reader.read_value<std::uint64_t>();
+    std::uint64_t num_sections = reader.read_value<std::uint64_t>();
+    
+    // Everything is checked before the collection is touched
+    std::set<std::uint64_t> seen_ids;
+    std::vector<Parsed_Section> sections;
+    for (std::uint64_t idx = 0; idx < num_sections; ++idx) {
+        sections.push_back(parse_section(reader, seen_ids));
+    }
+    
+    Runtime::Entity_Collection& ents = Runtime::get_entities();
+    
+    // Ids handed out since the save must not be reused by later entities
+    std::uint64_t old_next_handle = ents.get_next_handle();
+    
+    // The index is rebuilt afterwards, rather than updated for every entity
+    bool backrefs_enabled = ents.are_backrefs_enabled();
+    ents.set_backrefs_enabled(false);
+    
+    // Erased rather than killed, so that no events are triggered
+    std::vector<Runtime::Entity_Handle> old_handles;
+    ents.for_each([&](Runtime::Entity* ent) {
+        old_handles.push_back(ent->get_handle());
+    });
+    for (Runtime::Entity_Handle handle : old_handles) {
+        ents.erase_entity(handle);
+    }
+    
+    for (const Parsed_Section& section : sections) {
+        apply_section(section);
+    }
+    ents.set_next_handle(std::max({next_handle, old_next_handle, 
+            ents.get_next_handle()}));
+    ents.set_backrefs_enabled(backrefs_enabled);
+    
+    // Deltas cannot span a load
+    if (ents.is_change_tracking_enabled()) {
+        ents.restart_change_tracking();
+    }
+}
+
+void save_snapshot(const boost::filesystem::path& file) {
+    std::vector<char> buffer = write_snapshot();
+    std::ofstream os(file.string().c_str(), 
+            std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os) {
+        std::stringstream sss;
+        sss << "Failed to open file for writing: " << file;
+        throw Except::Runtime(sss.str());
+    }
+    os.write(buffer.data(), buffer.size());
+    if (!os) {
+        std::stringstream sss;
+        sss << "Failed to write snapshot: " << file;
+        throw Except::Runtime(sss.str());
+    }
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Reads the snapshot straight from a read-only mapping of the file,
+ * which avoids copying the whole file into a buffer first
+ * @return False if the file could not be mapped (nothing was read)
+ */
+bool load_mapped_snapshot(const boost::filesystem::path& file) {
+    int fd = open(file.string().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    std::size_t size = info.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    
+    // The mapping stays valid after the file is closed
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    std::shared_ptr<void> mapping(data, [size](void* ptr) {
+        munmap(ptr, size);
+    });
+    
+    // Every section is read, so start reading all of them in now
+    madvise(data, size, MADV_WILLNEED);
+    read_snapshot(static_cast<const char*>(data), size);
+    return true;
+}
+
+#endif // __linux__
+
+void load_snapshot(const boost::filesystem::path& file) {
+#ifdef __linux__
+    if (load_mapped_snapshot(file)) {
+        return;
+    }
+#endif
+    
+    // Otherwise read everything into a buffer
+    std::ifstream is(file.string().c_str(), std::ios::in | std::ios::binary);
+    if (!is) {
+        std::stringstream sss;
+        sss << "Failed to open file: " << file;
+        throw Except::Runtime(sss.str());
+    }
+    
+    is.seekg(0, std::ios::end);
+    std::vector<char> buffer(is.tellg());
+    is.seekg(0, std::ios::beg);
+    is.read(buffer.data(), buffer.size());
+    if (!is) {
+        std::stringstream sss;
+        sss << "Failed to read snapshot: " << file;
+        throw Except::Runtime(sss.str());
+    }
+    
+    read_snapshot(buffer.data(), buffer.size());
+}
+
+const char DELTA_MAGIC[8] = {'P', 'E', 'G', 'R', 'D', 'E', 'L', 'T'};
+
+// Unchanged gaps shorter than a run header are merged into the adjacent runs
+const std::size_t DELTA_RUN_MERGE_GAP = 2 * sizeof(std::uint32_t);
+
+/**
+ * @return If the entity image belongs to an entity owned by Lua
+ */
+bool is_image_lua_owned(const Runtime::Entity_Image& image) {
+    std::uint64_t flags;
+    assert(image.m_chunk.size() >= Runtime::ENT_HEADER_SIZE);
+    std::memcpy(&flags, image.m_chunk.data() + Runtime::ENT_HEADER_FLAGS, 
+            sizeof(flags));
+    return (flags & Runtime::ENT_FLAG_LUA_OWNED) 
+            == Runtime::ENT_FLAG_LUA_OWNED;
+}
+
+/**
+ * @brief Appends the XOR of all differing byte ranges to the output
+ * @return If there were any differences
+ */
+bool write_xor_runs(const char* before, const char* after, std::size_t size,
+        std::vector<char>& output) {
+    Binary_Io::Writer writer(output);
+    std::size_t pos = 0;
+    bool any = false;
+    while (pos < size) {
+        if (before[pos] == after[pos]) {
+            ++pos;
+            continue;
+        }
+        
+        // Extend the run until a long enough gap
+        std::size_t start = pos;
+        std::size_t end = pos + 1;
+        for (std::size_t scan = end; scan < size 
+                && scan - end < DELTA_RUN_MERGE_GAP; ++scan) {
+            if (before[scan] != after[scan]) {
+                end = scan + 1;
+            }
+        }
+        writer.write_value<std::uint32_t>(start);
+        writer.write_value<std::uint32_t>(end - start);
+        for (std::size_t idx = start; idx < end; ++idx) {
+            writer.write_value<char>(before[idx] ^ after[idx]);
+        }
+        any = true;
+        pos = end;
+    }
+    return any;
+}
+
+/**
+ * @return If the runs are well-formed for a chunk of the given size
+ */
+bool check_xor_runs(const std::vector<char>& runs, std::size_t size) {
+    Binary_Io::Reader reader(runs.data(), runs.size(), "Delta");
+    std::size_t remaining = runs.size();
+    while (remaining > 0) {
+        if (remaining < 2 * sizeof(std::uint32_t)) {
+            return false;
+        }
+        std::size_t offset = reader.read_value<std::uint32_t>();
+        std::size_t length = reader.read_value<std::uint32_t>();
+        remaining -= 2 * sizeof(std::uint32_t);
+        if (length > remaining || offset + length > size) {
+            return false;
+        }
+        reader.read_bytes(length);
+        remaining -= length;
+    }
+    return true;
+}
+
+void apply_xor_runs(const std::vector<char>& runs, char* chunk) {
+    Binary_Io::Reader reader(runs.data(), runs.size(), "Delta");
+    std::size_t remaining = runs.size();
+    while (remaining > 0) {
+        std::size_t offset = reader.read_value<std::uint32_t>();
+        std::size_t length = reader.read_value<std::uint32_t>();
+        const char* bytes = reader.read_bytes(length);
+        for (std::size_t idx = 0; idx < length; ++idx) {
+            chunk[offset + idx] ^= bytes[idx];
+        }
+        remaining -= 2 * sizeof(std::uint32_t) + length;
+    }
+}
+
+void set_delta_tracking_enabled(bool enabled) {
+    Runtime::get_entities().set_change_tracking_enabled(enabled);
+}
+
+Delta take_delta() {
+    Runtime::Entity_Collection& ents = Runtime::get_entities();
+    Runtime::Tracked_Changes changes = ents.restart_change_tracking();
+    
+    Delta delta;
+    delta.m_next_handle_before = changes.m_next_handle;
+    delta.m_next_handle_after = ents.get_next_handle();
+    
+    /* Entities owned by Lua are ignored, so an entity that Lua gives up
+     * ownership of is treated as created, and the other way around as
+     * deleted.
+     */
+    for (auto& pre_entry : changes.m_pre_images) {
+        Runtime::Entity_Image& before = pre_entry.second;
+        bool was_ignored = is_image_lua_owned(before);
+        const Runtime::Entity* ent = nullptr;
+        if (changes.m_deleted.find(pre_entry.first) 
+                == changes.m_deleted.end()) {
+            ent = ents.get_entity(Runtime::Entity_Handle(pre_entry.first));
+            assert(ent);
+        }
+        bool is_ignored = !ent || ent->is_lua_owned();
+        if (was_ignored) {
+            if (!is_ignored) {
+                delta.m_created.push_back(
+                        Runtime::Entity_Collection::make_image(ent));
+            }
+            continue;
+        }
+        if (is_ignored) {
+            delta.m_deleted.push_back(std::move(before));
+            continue;
+        }
+        assert(ent->get_chunk().get_size() == before.m_chunk.size());
+        
+        Delta::Modified modified;
+        modified.m_id = pre_entry.first;
+        bool pod_changed = write_xor_runs(before.m_chunk.data(), 
+                static_cast<const char*>(ent->get_chunk().get_raw()),
+                before.m_chunk.size(), modified.m_xor_runs);
+        const auto& strings_after = ent->get_string_overrides();
+        modified.m_strings_changed = 
+                before.m_string_overrides.size() != strings_after.size()
+                || !std::equal(strings_after.begin(), strings_after.end(),
+                    before.m_string_overrides.begin(),
+                    [](const Runtime::Entity::String_Override& a, 
+                            const Runtime::Entity::String_Override& b) {
+                        return a.m_idx == b.m_idx && a.m_str == b.m_str;
+                    });
+        
+        // Written to, but with the same values
+        if (!pod_changed && !modified.m_strings_changed) {
+            continue;
+        }
+        if (modified.m_strings_changed) {
+            modified.m_strings_before = std::move(before.m_string_overrides);
+            modified.m_strings_after = strings_after;
+        }
+        delta.m_modified.push_back(std::move(modified));
+    }
+    
+    // An entity may have been created and deleted with nothing to show for it
+    for (std::uint64_t id : changes.m_created) {
+        const Runtime::Entity* ent = 
+                ents.get_entity(Runtime::Entity_Handle(id));
+        assert(ent);
+        if (ent->is_lua_owned()) {
+            continue;
+        }
+        delta.m_created.push_back(Runtime::Entity_Collection::make_image(ent));
+    }
+    
+    auto by_id = [](const Runtime::Entity_Image& a, 
+            const Runtime::Entity_Image& b) {
+        return a.m_id < b.m_id;
+    };
+    std::sort(delta.m_modified.begin(), delta.m_modified.end(), 
+            [](const Delta::Modified& a, const Delta::Modified& b) {
+                return a.m_id < b.m_id;
+            });
+    std::sort(delta.m_created.begin(), delta.m_created.end(), by_id);
+    std::sort(delta.m_deleted.begin(), delta.m_deleted.end(), by_id);
+    return delta;
+}
+
+void apply_delta(const Delta& delta, bool reverse) {
+    Runtime::Entity_Collection& ents = Runtime::get_entities();
+    const std::vector<Runtime::Entity_Image>& removals = 
+            reverse ? delta.m_created : delta.m_deleted;
+    const std::vector<Runtime::Entity_Image>& additions = 
+            reverse ? delta.m_deleted : delta.m_created;
+    
+    // Check everything first, so that a mismatch does not leave us half-done
+    for (const Runtime::Entity_Image& image : removals) {
+        if (!ents.get_entity(Runtime::Entity_Handle(image.m_id))) {
+            throw Except::Runtime("Delta removes a nonexistent entity");
+        }
+    }
+    for (const Delta::Modified& modified : delta.m_modified) {
+        const Runtime::Entity* ent = 
+                ents.get_entity(Runtime::Entity_Handle(modified.m_id));
+        if (!ent) {
+            throw Except::Runtime("Delta modifies a nonexistent entity");
+        }
+        if (!check_xor_runs(modified.m_xor_runs, 
+                ent->get_chunk().get_size())) {
+            throw Except::Runtime("Delta does not fit entity");
+        }
+        const auto& strings = reverse 
+                ? modified.m_strings_before : modified.m_strings_after;
+        for (const auto& ovr : strings) {
+            if (ovr.m_idx >= ent->get_arche()->m_default_strings.size()) {
+                throw Except::Runtime("Delta does not fit entity");
+            }
+        }
+    }
+    for (const Runtime::Entity_Image& image : additions) {
+        if (!ents.owns_handle(Runtime::Entity_Handle(image.m_id))) {
+            throw Except::Runtime("Delta belongs to another world");
+        }
+        if (ents.get_entity(Runtime::Entity_Handle(image.m_id))) {
+            throw Except::Runtime("Delta adds an existing entity");
+        }
+        if (image.m_chunk.size() != get_chunk_size(image.m_arche)) {
+            throw Except::Runtime("Delta does not fit entity");
+        }
+        for (const auto& ovr : image.m_string_overrides) {
+            if (ovr.m_idx >= image.m_arche->m_default_strings.size()) {
+                throw Except::Runtime("Delta does not fit entity");
+            }
+        }
+    }
+    
+    // The index is rebuilt afterwards, rather than updated for every entity
+    bool backrefs_enabled = ents.are_backrefs_enabled();
+    ents.set_backrefs_enabled(false);
+    
+    for (const Runtime::Entity_Image& image : removals) {
+        ents.erase_entity(Runtime::Entity_Handle(image.m_id));
+    }
+    for (const Delta::Modified& modified : delta.m_modified) {
+        Runtime::Entity* ent = 
+                ents.get_entity(Runtime::Entity_Handle(modified.m_id));
+        ent->mark_dirty();
+        apply_xor_runs(modified.m_xor_runs, 
+                static_cast<char*>(ent->get_chunk().get_raw()));
+        if (modified.m_strings_changed) {
+            ent->set_string_overrides(reverse 
+                    ? modified.m_strings_before : modified.m_strings_after);
+        }
+    }
+    for (const Runtime::Entity_Image& image : additions) {
+        Runtime::Entity* ent = ents.restore_entity(image.m_arche, 
+                Runtime::Entity_Handle(image.m_id));
+        std::memcpy(ent->get_chunk().get_raw(), image.m_chunk.data(), 
+                image.m_chunk.size());
+        ent->set_string_overrides(image.m_string_overrides);
+    }
+    ents.set_next_handle(reverse 
+            ? delta.m_next_handle_before : delta.m_next_handle_after);
+    
+    ents.set_backrefs_enabled(backrefs_enabled);
+}
+
+void write_string_overrides(Binary_Io::Writer& writer, 
+        const std::vector<Runtime::Entity::String_Override>& overrides) {
+    writer.write_value<std::uint64_t>(overrides.size());
+    for (const auto& ovr : overrides) {
+        writer.write_value<std::uint64_t>(ovr.m_idx);
+        writer.write_string(ovr.m_str.get_string());
+    }
+}
+
+std::vector<Runtime::Entity::String_Override> read_string_overrides(
+        Binary_Io::Reader& reader) {
+    std::vector<Runtime::Entity::String_Override> overrides;
+    std::uint64_t num_overrides = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_overrides; ++idx) {
+        Runtime::Entity::String_Override ovr;
+        ovr.m_idx = reader.read_value<std::uint64_t>();
+        ovr.m_str = Runtime::intern_string(reader.read_string());
+        overrides.push_back(std::move(ovr));
+    }
+    return overrides;
+}
+
+/* Serialized deltas are:
+ * 
+ * Header:
+ *      "PEGRDELT", u32 version, u32 reserved, u64 next handle before,
+ *      u64 next handle after
+ * Archetype table:
+ *      u64 #archetypes, then for each: Oid, u64 layout fingerprint
+ * Modified entities:
+ *      u64 #entities, then for each: u64 id, u64 run bytes, runs,
+ *      u8 strings changed, (string overrides before, after)
+ * Created entities, then deleted entities:
+ *      u64 #entities, then for each: u64 id, u64 archetype table index,
+ *      chunk, string overrides
+ * 
+ * String overrides are: u64 #overrides, then u64 idx, u32 length, bytes
+ */
+
+std::vector<char> write_delta(const Delta& delta) {
+    // Archetypes are only referred to by their index in the table
+    std::map<const Runtime::Arche*, std::uint64_t> arche_indices;
+    for (const auto& arche_entry : Runtime::n_runtime_arches) {
+        std::uint64_t idx = arche_indices.size();
+        arche_indices[arche_entry.second.get()] = idx;
+    }
+    
+    std::vector<char> buffer;
+    Binary_Io::Writer writer(buffer);
+    writer.write_bytes(DELTA_MAGIC, sizeof(DELTA_MAGIC));
+    writer.write_value<std::uint32_t>(SNAPSHOT_VERSION);
+    writer.write_value<std::uint32_t>(0);
+    writer.write_value<std::uint64_t>(delta.m_next_handle_before);
+    writer.write_value<std::uint64_t>(delta.m_next_handle_after);
+    
+    writer.write_value<std::uint64_t>(Runtime::n_runtime_arches.size());
+    for (const auto& arche_entry : Runtime::n_runtime_arches) {
+        writer.write_string(arche_entry.first.get_repr());
+        writer.write_value<std::uint64_t>(
+                get_layout_fingerprint(arche_entry.second.get()));
+    }
+    
+    writer.write_value<std::uint64_t>(delta.m_modified.size());
+    for (const Delta::Modified& modified : delta.m_modified) {
+        writer.write_value<std::uint64_t>(modified.m_id);
+        writer.write_value<std::uint64_t>(modified.m_xor_runs.size());
+        writer.write_bytes(modified.m_xor_runs.data(), 
+                modified.m_xor_runs.size());
+        writer.write_value<std::uint8_t>(modified.m_strings_changed);
+        if (modified.m_strings_changed) {
+            write_string_overrides(writer, modified.m_strings_before);
+            write_string_overrides(writer, modified.m_strings_after);
+        }
+    }
+    
+    for (const auto* images : {&delta.m_created, &delta.m_deleted}) {
+        writer.write_value<std::uint64_t>(images->size());
+        for (const Runtime::Entity_Image& image : *images) {
+            auto index_iter = arche_indices.find(image.m_arche);
+            assert(index_iter != arche_indices.end());
+            writer.write_value<std::uint64_t>(image.m_id);
+            writer.write_value<std::uint64_t>(index_iter->second);
+            writer.write_bytes(image.m_chunk.data(), image.m_chunk.size());
+            write_string_overrides(writer, image.m_string_overrides);
+        }
+    }
+    
+    return buffer;
+}
+
+Delta read_delta(const char* data, std::size_t size) {
+    Binary_Io::Reader reader(data, size, "Delta");
+    if (std::memcmp(reader.read_bytes(sizeof(DELTA_MAGIC)), 
+            DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0) {
+        throw Except::Runtime("Not a delta");
+    }
+    std::uint32_t version = reader.read_value<std::uint32_t>();
+    if (version != SNAPSHOT_VERSION) {
+        std::stringstream sss;
+        sss << "Unsupported delta version " << version;
+        throw Except::Runtime(sss.str());
+    }
+    reader.read_value<std::uint32_t>(); // Reserved
+    
+    Delta delta;
+    delta.m_next_handle_before = reader.read_value<std::uint64_t>();
+    delta.m_next_handle_after = reader.read_value<std::uint64_t>();
+    
+    // Unknown archetypes are only an error if an entity uses them
+    std::vector<Runtime::Arche*> arche_table;
+    std::uint64_t num_arches = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_arches; ++idx) {
+        Resour::Oid oid(reader.read_string());
+        std::uint64_t fingerprint = reader.read_value<std::uint64_t>();
+        Runtime::Arche* arche = Runtime::find_arche(oid);
+        if (arche && get_layout_fingerprint(arche) != fingerprint) {
+            arche = nullptr;
+        }
+        arche_table.push_back(arche);
+    }
+    
+    std::uint64_t num_modified = reader.read_value<std::uint64_t>();
+    for (std::uint64_t idx = 0; idx < num_modified; ++idx) {
+        Delta::Modified modified;
+        modified.m_id = reader.read_value<std::uint64_t>();
+        std::uint64_t runs_size = reader.read_value<std::uint64_t>();
+        const char* runs = reader.read_bytes(runs_size);
+        modified.m_xor_runs.assign(runs, runs + runs_size);
+        modified.m_strings_changed = reader.read_value<std::uint8_t>() != 0;
+        if (modified.m_strings_changed) {
+            modified.m_strings_before = read_string_overrides(reader);
+            modified.m_strings_after = read_string_overrides(reader);
+        }
+        delta.m_modified.push_back(std::move(modified));
+    }
+    
+    for (auto* images : {&delta.m_created, &delta.m_deleted}) {
+        std::uint64_t num_images = reader.read_value<std::uint64_t>();
+        for (std::uint64_t idx = 0; idx < num_images; ++idx) {
+            Runtime::Entity_Image image;
+            image.m_id = reader.read_value<std::uint64_t>();
+            std::uint64_t arche_idx = reader.read_value<std::uint64_t>();
+            if (arche_idx >= arche_table.size() || !arche_table[arche_idx]) {
+                throw Except::Runtime(
+                        "Delta contains unknown or changed archetype");
+            }
+            image.m_arche = arche_table[arche_idx];
+            std::size_t chunk_size = get_chunk_size(image.m_arche);
+            const char* chunk = reader.read_bytes(chunk_size);
+            image.m_chunk.assign(chunk, chunk + chunk_size);
+            image.m_string_overrides = read_string_overrides(reader);
+            images->push_back(std::move(image));
+        }
+    }
+    
+    return delta;
+}
+
+} // namespace Snapshot
+} // namespace Gensys
+} // namespace pegr
@@ -0,0 +1,201 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_GENSYS_SNAPSHOT_HPP
+#define PEGR_GENSYS_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "pegr/gensys/Entity_Collection.hpp"
+#include "pegr/gensys/Runtime.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Snapshot {
+
+/* Binary snapshots of the entity collection. The format is:
+ * 
+ * Header:
+ *      "PEGRSNAP", u32 version, u32 reserved, u64 next handle, u64 #sections
+ * One section per archetype (that has entities):
+ *      u32 Oid length, Oid (as given by Resour::Oid::get_repr())
+ *      u64 layout fingerprint, u64 chunk size, u64 #entities, u64 #overrides
+ *      u64 #members, members (see Layout_Member)
+ *      Handle table: u64 entity id, for every entity
+ *      Chunk block: the entire POD chunk (header included) of every entity
+ *      String overrides: u64 entity row, u64 string idx, u32 length, bytes
+ * 
+ * Values are stored in native byte order. Snapshots are intended for saving
+ * and restoring on the same machine, not for transferring between machines.
+ * 
+ * If an archetype's layout fingerprint matches, the chunk block is copied in
+ * place with one memcpy per entity. Otherwise, members are migrated by
+ * matching component symbol, member symbol and type, using the member table
+ * in the section. New members keep their defaults and removed members are
+ * dropped.
+ * 
+ * Not saved: entities owned by Lua (which would otherwise never be collected),
+ * entities' Lua tables, shared members (these belong to the archetype).
+ * 
+ * Everything here works on the current world (see Runtime::World). Since
+ * entity ids encode their world, a snapshot can only be loaded into the world
+ * that it was saved from.
+ */
+
+extern const std::uint32_t SNAPSHOT_VERSION;
+
+/**
+ * @brief Describes where a single per-entity member lives within an archetype.
+ * Used for the fingerprint and for migrating between layouts.
+ */
+struct Layout_Member {
+    Runtime::Symbol m_comp_symbol;
+    Runtime::Symbol m_member_symbol;
+    Runtime::Prim::Type m_type;
+    
+    // Byte offset within the entity chunk for pod types, otherwise the index
+    // into the entity strings
+    std::size_t m_location;
+};
+
+/**
+ * @return All per-entity members of the archetype, sorted by component symbol
+ * then by member symbol.
+ */
+std::vector<Layout_Member> get_layout(const Runtime::Arche* arche);
+
+/**
+ * @return A hash of the layout of the entity data for this archetype. Two
+ * archetypes with the same fingerprint can share entity chunks verbatim.
+ */
+std::uint64_t get_layout_fingerprint(const Runtime::Arche* arche);
+
+/**
+ * @brief Writes all entities into a new snapshot.
+ * Must not be called during Entity_Collection::for_each().
+ * @return The snapshot
+ */
+std::vector<char> write_snapshot();
+
+/**
+ * @brief Replaces all entities with the ones saved in the snapshot. Any
+ * existing handles to saved entities become valid again. The spawned/killed
+ * state of each entity is restored without triggering any events.
+ * The whole snapshot is checked first, so if this throws a runtime error, the
+ * collection is left unchanged.
+ * Must not be called during Entity_Collection::for_each().
+ * @param data The snapshot
+ * @param size Size of the snapshot in bytes
+ */
+void read_snapshot(const char* data, std::size_t size);
+
+/**
+ * @brief Same as write_snapshot(), but writes to a file
+ * Can throw runtime errors.
+ */
+void save_snapshot(const boost::filesystem::path& file);
+
+/**
+ * @brief Same as read_snapshot(), but reads from a file. On Linux, the file
+ * is mapped into memory and read in place. Otherwise, or if the file cannot
+ * be mapped, it is read with a single bulk read.
+ * Can throw runtime errors.
+ */
+void load_snapshot(const boost::filesystem::path& file);
+
+/**
+ * @class Delta
+ * @brief The difference between two states of the entity collection, as
+ * recorded by the collection's change tracking. Deltas can be applied in
+ * either direction, but only to the exact state they were taken from (or
+ * produced, in reverse).
+ * 
+ * Like snapshots, deltas ignore entities owned by Lua and shared members.
+ */
+struct Delta {
+    /**
+     * @class Modified
+     * @brief An entity that existed before and after
+     */
+    struct Modified {
+        std::uint64_t m_id;
+        
+        /* Changed byte ranges in the entity chunk, stored as:
+         *      u32 offset, u32 length, (before XOR after) bytes
+         * XOR makes the same runs usable in both directions.
+         */
+        std::vector<char> m_xor_runs;
+        
+        bool m_strings_changed;
+        std::vector<Runtime::Entity::String_Override> m_strings_before;
+        std::vector<Runtime::Entity::String_Override> m_strings_after;
+    };
+    
+    std::uint64_t m_next_handle_before;
+    std::uint64_t m_next_handle_after;
+    
+    // Each list is sorted by entity id
+    std::vector<Modified> m_modified;
+    std::vector<Runtime::Entity_Image> m_created; // State after
+    std::vector<Runtime::Entity_Image> m_deleted; // State before
+};
+
+/**
+ * @brief Starts (or stops) recording changes to the entity collection for
+ * take_delta(). Restarting discards all changes recorded so far.
+ */
+void set_delta_tracking_enabled(bool enabled);
+
+/**
+ * @brief Returns all changes since tracking started or since the last call to
+ * take_delta(), whichever is more recent. Delta tracking must be enabled.
+ * Must not be called during Entity_Collection::for_each().
+ */
+Delta take_delta();
+
+/**
+ * @brief Applies the delta to the entity collection. Spawn and kill events
+ * are not triggered. Can throw runtime errors if the collection is not in the
+ * state that the delta expects, in which case nothing is modified.
+ * Must not be called during Entity_Collection::for_each().
+ * @param delta The delta
+ * @param reverse If true, undoes the delta instead
+ */
+void apply_delta(const Delta& delta, bool reverse = false);
+
+/**
+ * @brief Serializes a delta. Archetypes are stored by Oid, and each
+ * archetype's layout fingerprint is checked upon reading.
+ * @return The serialized delta
+ */
+std::vector<char> write_delta(const Delta& delta);
+
+/**
+ * @brief Deserializes a delta. Can throw runtime errors.
+ * @param data The serialized delta
+ * @param size Size in bytes
+ */
+Delta read_delta(const char* data, std::size_t size);
+
+} // namespace Snapshot
+} // namespace Gensys
+} // namespace pegr
+
+#endif // PEGR_GENSYS_SNAPSHOT_HPP
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "pegr/algs/Partition_Tracker.hpp"
+#include "pegr/gensys/Runtime_Types.hpp"
 
 namespace pegr {
 namespace Gensys {
@@ -53,6 +54,11 @@ Algs::Podc_Ptr new_pod_chunk_from_interm_prims(
                 symbols_by_size[sizeof(double)].push_back(symb);
                 break;
             }
+            // Always null by default, which is all zeroes
+            case Interm::Prim::Type::ENTITY: {
+                symbols_by_size[sizeof(Runtime::Entity_Ref)].push_back(symb);
+                break;
+            }
             default: {
                 break;
             }
@@ -83,9 +89,7 @@ Algs::Podc_Ptr new_pod_chunk_from_interm_prims(
                 alignment_interval = 8;
             }
             
-            std::size_t off = 0;
-            while (!ptrack.can_occupy(off, size)) off += alignment_interval;
-            
+            std::size_t off = ptrack.find_first_fit(size, alignment_interval);
             ptrack.occupy(off, size);
             symbol_to_offset[member_symbol] = off;
         }
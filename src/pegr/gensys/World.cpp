@@ -0,0 +1,220 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "pegr/gensys/World.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+
+#include "pegr/except/Except.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Runtime {
+
+const std::uint64_t WORLD_ID_SHIFT = 40;
+
+// The last index is left out, since the null handle has all bits set
+const std::size_t MAX_WORLDS = (1 << 12) - 1;
+
+/* Registry of all worlds, by index. Lookups do not lock, so that entity
+ * handles can be resolved from any thread.
+ */
+std::atomic<World*> n_worlds[MAX_WORLDS];
+
+/* Indices of destroyed worlds are reused, but not their entity ids, so that
+ * stale handles cannot refer to the new world's entities. Guarded by the
+ * mutex.
+ */
+std::uint64_t n_world_next_ids[MAX_WORLDS];
+std::mutex n_worlds_mutex;
+
+thread_local World* n_current_world = nullptr;
+
+World::World() {
+    std::size_t index;
+    {
+        std::lock_guard<std::mutex> lock(n_worlds_mutex);
+        
+        // Index zero always belongs to the default world
+        for (index = 1; index < MAX_WORLDS; ++index) {
+            if (!n_worlds[index].load()) {
+                break;
+            }
+        }
+        if (index == MAX_WORLDS) {
+            throw Except::Runtime("Too many worlds");
+        }
+        n_worlds[index].store(this);
+    }
+    initialize(index);
+}
+
+World::World(Default_Tag tag) {
+    assert(!n_worlds[0].load());
+    n_worlds[0].store(this);
+    initialize(0);
+}
+
+void World::initialize(std::size_t index) {
+    m_index = index;
+    
+    std::uint64_t first_id = std::uint64_t(index) << WORLD_ID_SHIFT;
+    std::uint64_t end_id = std::uint64_t(index + 1) << WORLD_ID_SHIFT;
+    m_entities.set_handle_range(first_id, end_id);
+    {
+        std::lock_guard<std::mutex> lock(n_worlds_mutex);
+        m_entities.set_next_handle(
+                std::max(first_id, n_world_next_ids[index]));
+    }
+    
+    use_events(nullptr, nullptr, nullptr);
+}
+
+World::~World() {
+    // Destroy the entities before making the index available again
+    std::uint64_t next_id = m_entities.get_next_handle();
+    if (m_forked) {
+        // Only drops the entities that were copied from the parent
+        m_entities.release();
+    } else {
+        m_entities.clear();
+    }
+    if (n_current_world == this) {
+        n_current_world = nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(n_worlds_mutex);
+    n_world_next_ids[m_index] = next_id;
+    n_worlds[m_index].store(nullptr);
+}
+
+std::size_t World::get_index() const {
+    return m_index;
+}
+
+Entity_Collection& World::get_entities() {
+    return m_entities;
+}
+
+Event::Entity_Spawned_Event* World::get_spawned_event() {
+    return m_spawned;
+}
+Event::Entity_Tick_Event* World::get_tick_event() {
+    return m_tick;
+}
+Event::Entity_Killed_Event* World::get_killed_event() {
+    return m_killed;
+}
+
+void World::use_events(Event::Entity_Spawned_Event* spawned, 
+        Event::Entity_Tick_Event* tick, 
+        Event::Entity_Killed_Event* killed) {
+    if (!spawned && !tick && !killed) {
+        if (!m_own_spawned) {
+            m_own_spawned = std::make_unique<Event::Entity_Spawned_Event>();
+            m_own_tick = std::make_unique<Event::Entity_Tick_Event>();
+            m_own_killed = std::make_unique<Event::Entity_Killed_Event>();
+        }
+        spawned = m_own_spawned.get();
+        tick = m_own_tick.get();
+        killed = m_own_killed.get();
+    }
+    assert(spawned && tick && killed);
+    m_spawned = spawned;
+    m_tick = tick;
+    m_killed = killed;
+}
+
+bool World::is_replaying() const {
+    return m_replaying;
+}
+
+void World::set_replaying(bool replaying) {
+    m_replaying = replaying;
+}
+
+void World::tick() {
+    Scope scope(this);
+    m_tick->trigger();
+}
+
+std::unique_ptr<World> World::fork() {
+    std::unique_ptr<World> child = std::make_unique<World>();
+    child->m_entities.fork_from(m_entities);
+    child->m_forked = true;
+    child->use_events(m_spawned, m_tick, m_killed);
+    return child;
+}
+
+Entity_Handle World::translate_handle(Entity_Handle handle) const {
+    if (handle.get_id() == -1) {
+        return handle;
+    }
+    std::uint64_t number = 
+            handle.get_id() & ((std::uint64_t(1) << WORLD_ID_SHIFT) - 1);
+    return Entity_Handle(number | (std::uint64_t(m_index) << WORLD_ID_SHIFT));
+}
+
+World* World::find(std::uint64_t entity_id) {
+    std::uint64_t index = entity_id >> WORLD_ID_SHIFT;
+    if (index >= MAX_WORLDS) {
+        return nullptr;
+    }
+    return n_worlds[index].load(std::memory_order_acquire);
+}
+
+void World::for_each(std::function<void(World*)> for_body) {
+    std::lock_guard<std::mutex> lock(n_worlds_mutex);
+    for (std::size_t index = 0; index < MAX_WORLDS; ++index) {
+        World* world = n_worlds[index].load();
+        if (world) {
+            for_body(world);
+        }
+    }
+}
+
+World::Scope::Scope(World* world)
+: m_prev_world(n_current_world) {
+    n_current_world = world;
+}
+
+World::Scope::~Scope() {
+    n_current_world = m_prev_world;
+}
+
+World& get_default_world() {
+    static World world((World::Default_Tag()));
+    return world;
+}
+
+World* get_current_world() {
+    if (n_current_world) {
+        return n_current_world;
+    }
+    return &get_default_world();
+}
+
+void set_current_world(World* world) {
+    n_current_world = world;
+}
+
+} // namespace Runtime
+} // namespace Gensys
+} // namespace pegr
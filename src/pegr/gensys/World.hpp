@@ -0,0 +1,197 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PEGR_GENSYS_WORLD_HPP
+#define PEGR_GENSYS_WORLD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "pegr/gensys/Entity_Collection.hpp"
+#include "pegr/gensys/Entity_Events.hpp"
+
+namespace pegr {
+namespace Gensys {
+namespace Runtime {
+
+/* Entity ids are split into the index of the world (top 12 of the 52 bits
+ * that Lua can represent) and the entity's number within that world. The
+ * default world has index zero, so its entity ids are just numbers.
+ */
+extern const std::uint64_t WORLD_ID_SHIFT;
+extern const std::size_t MAX_WORLDS;
+
+/**
+ * @class World
+ * @brief An independent simulation, with its own entities and entity events.
+ * Compiled components, archetypes and genres are shared by all worlds.
+ * 
+ * Entity handles encode the world that the entity belongs to, so they can be
+ * used from anywhere. Everything else that creates or finds entities without
+ * a handle (Lua functions, snapshots, tick events) uses the current world of
+ * the calling thread, see World::Scope.
+ * 
+ * Different worlds can be ticked concurrently on separate threads, so long as
+ * those threads do not call into Lua or modify string members (the Lua state
+ * and the interned string table are shared by all worlds), and so long as
+ * neither world is a fork of the other (see fork()). Shared members
+ * live in the archetype and are read-only, so they are safe to read from any
+ * world. Entity references between different worlds are always null.
+ */
+class World {
+public:
+    /**
+     * @brief Creates a new world with its own events. 
+     * Can throw runtime errors if there are too many worlds.
+     */
+    World();
+    ~World();
+    
+    World(const World& rhs) = delete;
+    World& operator =(const World& rhs) = delete;
+    
+    std::size_t get_index() const;
+    Entity_Collection& get_entities();
+    
+    Event::Entity_Spawned_Event* get_spawned_event();
+    Event::Entity_Tick_Event* get_tick_event();
+    Event::Entity_Killed_Event* get_killed_event();
+    
+    /**
+     * @brief Replaces the events with ones owned elsewhere. Used for the
+     * default world, whose events are registered with the scheduler. Passing
+     * nullptr for all three restores the world's own events.
+     */
+    void use_events(Event::Entity_Spawned_Event* spawned, 
+            Event::Entity_Tick_Event* tick, 
+            Event::Entity_Killed_Event* killed);
+    
+    /**
+     * @brief See Event::is_replaying()
+     */
+    bool is_replaying() const;
+    void set_replaying(bool replaying);
+    
+    /**
+     * @brief Triggers the tick event, with this as the current world
+     */
+    void tick();
+    
+    /**
+     * @brief Makes a new world with a copy of every entity in this one, for
+     * simulating ahead and then throwing the result away. Entities are only
+     * copied when first used in either world, and their chunks only when
+     * first written to, so forking and destroying the fork only costs as
+     * much as the entities that were touched since (see
+     * Entity_Collection::fork_from()). Ticking the fork touches every entity.
+     * Destroying the fork does not kill its entities. Lua-owned entities are
+     * not copied. Shared members belong to the archetype and are read-only,
+     * so they need no copy.
+     * 
+     * The fork uses this world's events (so the same listeners run when it
+     * is ticked), and so this world must outlive the fork. Until the fork has
+     * copied everything (e.g. by iterating over its entities), it reads
+     * entities from this world, so the two worlds must not be used from
+     * separate threads at the same time. Stale handles to entities in a
+     * previously destroyed fork may refer to entities in a new fork with the
+     * same index.
+     * 
+     * Can throw runtime errors if there are too many worlds, or if this world
+     * is iterating over its entities.
+     * @return The fork
+     */
+    std::unique_ptr<World> fork();
+    
+    /**
+     * @param handle An entity in any world
+     * @return The handle for the entity with the same number in this world,
+     * i.e. the copy of that entity if this world was forked from the entity's
+     * world. The entity might not exist.
+     */
+    Entity_Handle translate_handle(Entity_Handle handle) const;
+    
+    /**
+     * @return The world that the entity id belongs to, or nullptr if there is
+     * no such world. Thread-safe.
+     */
+    static World* find(std::uint64_t entity_id);
+    
+    /**
+     * @brief Calls the function with every world that exists, in order of
+     * index. Worlds must not be created or destroyed by the function.
+     */
+    static void for_each(std::function<void(World*)> for_body);
+    
+    /**
+     * @class Scope
+     * @brief Makes a world the current world of this thread until destroyed
+     */
+    class Scope {
+    public:
+        Scope(World* world);
+        ~Scope();
+        
+        Scope(const Scope& rhs) = delete;
+        Scope& operator =(const Scope& rhs) = delete;
+    private:
+        World* m_prev_world;
+    };
+    
+private:
+    struct Default_Tag {};
+    explicit World(Default_Tag tag);
+    friend World& get_default_world();
+    
+    std::size_t m_index;
+    Entity_Collection m_entities;
+    
+    std::unique_ptr<Event::Entity_Spawned_Event> m_own_spawned;
+    std::unique_ptr<Event::Entity_Tick_Event> m_own_tick;
+    std::unique_ptr<Event::Entity_Killed_Event> m_own_killed;
+    Event::Entity_Spawned_Event* m_spawned;
+    Event::Entity_Tick_Event* m_tick;
+    Event::Entity_Killed_Event* m_killed;
+    
+    bool m_replaying = false;
+    bool m_forked = false;
+    
+    void initialize(std::size_t index);
+};
+
+/**
+ * @return The world that exists for the entire lifetime of the program
+ */
+World& get_default_world();
+
+/**
+ * @return The current world of this thread, or the default world if none
+ */
+World* get_current_world();
+
+/**
+ * @brief Sets the current world of this thread. Prefer World::Scope.
+ * @param world The world, or nullptr for the default world
+ */
+void set_current_world(World* world);
+
+} // namespace Runtime
+} // namespace Gensys
+} // namespace pegr
+
+#endif // PEGR_GENSYS_WORLD_HPP
@@ -84,6 +84,19 @@ Unique_Program make_program(
     return program;
 }
 
+void forget_shader(const Resour::Oid& oid) {
+    std::string repr = oid.get_repr();
+    for (auto iter = n_cached_shaders.begin(); 
+            iter != n_cached_shaders.end(); ) {
+        if (iter->first.get_repr() == repr
+                || add_platform_subtype(iter->first).get_repr() == repr) {
+            iter = n_cached_shaders.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
 void clear_cached_shaders() {
     n_cached_shaders.clear();
 }
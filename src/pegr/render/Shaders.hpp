@@ -49,6 +49,13 @@ Shared_Shader find_shader(const Resour::Oid& oid);
 Unique_Program make_program(
         const Shared_Shader& vert_shader, const Shared_Shader& frag_shader);
 
+/**
+ * @brief Makes the next find_shader() load the shader again, such as after
+ * its file was changed. Already found shaders are unaffected.
+ * @param oid With or without the platform subtype
+ */
+void forget_shader(const Resour::Oid& oid);
+
 void clear_cached_shaders();
 void clear_cached_programs();
 
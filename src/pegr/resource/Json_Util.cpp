@@ -73,8 +73,13 @@ Json::Value read(boost::filesystem::path file) {
     return retval;
 }
 
-void write(std::string filename, Json::Value& value, bool compact) {
-    std::ofstream fs(filename.c_str());
+void write(boost::filesystem::path filename, const Json::Value& value) {
+    std::ofstream fs(filename.string().c_str());
+    if (!fs) {
+        std::stringstream ess;
+        ess << "Cannot open " << filename << " for writing";
+        throw Except::Runtime(ess.str());
+    }
     Json::FastWriter fast_writer;
     fs << fast_writer.write(value);
     fs.close();
@@ -17,10 +17,15 @@
 #include "pegr/resource/Resources.hpp"
 
 #include <cassert>
+#include <fstream>
+#include <iterator>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <json/json.h>
 
+#include "pegr/algs/Algs.hpp"
+#include "pegr/debug/Trace.hpp"
 #include "pegr/except/Except.hpp"
 #include "pegr/logger/Logger.hpp"
 #include "pegr/resource/Json_Util.hpp"
@@ -134,6 +139,9 @@ const boost::filesystem::path& Package::get_home() const {
 std::size_t Package::get_num_resources() const {
     return m_name_to_object.size();
 }
+const std::map<std::string, Object>& Package::get_objects() const {
+    return m_name_to_object;
+}
 
 void Package::merge(Package& opack) {
     m_name_to_object.insert(opack.m_name_to_object.begin(), 
@@ -233,6 +241,7 @@ void collapse_core_packages(Load_Workspace& wl) {
 }
 
 void load_core() {
+    PEGR_TRACE_SCOPE("resource", "Resour::load_core");
     Load_Workspace lw;
     try {
         read_core_load_order(lw);
@@ -308,5 +317,53 @@ const Object& find_object(const Oid& oid, Object::Type required_type) {
     return obj;
 }
 
+void for_each_object(std::function<void(const Oid&, const Object&)> func) {
+    for (const auto& entry : n_core_package.get_objects()) {
+        func(Oid(entry.first, ""), entry.second);
+    }
+    for (const auto& pack_entry : n_named_packages) {
+        for (const auto& entry : pack_entry.second.get_objects()) {
+            func(Oid(entry.first, pack_entry.first), entry.second);
+        }
+    }
+}
+
+std::uint64_t hash_package(const Package& pack, std::uint64_t hash) {
+    auto hash_string = [&hash](const std::string& str) {
+        // Include the terminator, so that "ab" + "c" differs from "a" + "bc"
+        hash = Algs::hash_bytes(str.c_str(), str.size() + 1, hash);
+    };
+    hash_string(pack.get_id());
+    for (const auto& entry : pack.get_objects()) {
+        const Object& obj = entry.second;
+        hash_string(entry.first);
+        hash_string(object_type_to_string(obj.m_type));
+        hash_string(obj.m_fname.string());
+        if (obj.m_type != Object::Type::SCRIPT) {
+            continue;
+        }
+        std::ifstream is(obj.m_fname.string().c_str(), 
+                std::ios::in | std::ios::binary);
+        if (!is) {
+            std::stringstream sss;
+            sss << "Failed to open script: " << obj.m_fname;
+            throw Except::Runtime(sss.str());
+        }
+        std::vector<char> contents((std::istreambuf_iterator<char>(is)),
+                std::istreambuf_iterator<char>());
+        hash = Algs::hash_bytes(contents.data(), contents.size(), hash);
+    }
+    return hash;
+}
+
+std::uint64_t hash_scripts_and_packages() {
+    std::uint64_t hash = hash_package(n_core_package, 
+            Algs::hash_bytes(nullptr, 0));
+    for (const auto& entry : n_named_packages) {
+        hash = hash_package(entry.second, hash);
+    }
+    return hash;
+}
+
 } // namespace Resour
 } // namespace pegr
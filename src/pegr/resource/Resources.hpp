@@ -17,6 +17,8 @@
 #ifndef PEGR_RESOURCE_RESOURCES_HPP
 #define PEGR_RESOURCE_RESOURCES_HPP
 
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <string>
 
@@ -79,6 +81,11 @@ public:
     
     std::size_t get_num_resources() const;
     
+    /**
+     * @return Every resource in this package, by name
+     */
+    const std::map<std::string, Object>& get_objects() const;
+    
     /**
      * @brief Becomes a co-owner of the resources stored in the other package.
      * If there are any ID conflicts, the this package's object overwrites the
@@ -112,6 +119,21 @@ void cleanup();
  */
 const Object& find_object(const Oid& oid,
         Object::Type required_type = Object::Type::UNKNOWN);
+
+/**
+ * @brief Calls the function on every loaded resource, core resources first
+ * @param func Given the id and object of each resource
+ */
+void for_each_object(std::function<void(const Oid&, const Object&)> func);
+
+/**
+ * @brief Hashes the name, type and file of every resource, along with the
+ * contents of every script. If this does not change, then neither do the
+ * scripts that would run, nor the resources that they could find.
+ * Can throw runtime errors if a script cannot be read.
+ * @return The hash
+ */
+std::uint64_t hash_scripts_and_packages();
     
 } // namespace Resour
 } // namespace pegr
@@ -0,0 +1,260 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/resource/Watcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+
+#include "pegr/except/Except.hpp"
+#include "pegr/logger/Logger.hpp"
+
+namespace pegr {
+namespace Resour {
+namespace Watcher {
+
+// Resources using each watched file
+std::map<boost::filesystem::path, std::vector<Change>> n_watched_files;
+
+std::set<boost::filesystem::path> n_batch;
+
+Listener_Handle n_next_handle = 0;
+std::map<Listener_Handle, Listener> n_listeners;
+
+/**
+ * @brief Makes the directory's path canonical, so that the same file is
+ * always found under the same path
+ */
+boost::filesystem::path canonical_file(const boost::filesystem::path& file) {
+    boost::system::error_code err;
+    boost::filesystem::path dir = 
+            boost::filesystem::canonical(file.parent_path(), err);
+    if (err) {
+        return file;
+    }
+    return dir / file.filename();
+}
+
+#ifdef __linux__
+
+const std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+int n_inotify_fd = -1;
+std::unique_ptr<boost::asio::posix::stream_descriptor> n_descriptor;
+
+// Watched directory for every watch descriptor
+std::map<int, boost::filesystem::path> n_watched_dirs;
+
+void watch_object(const Oid& oid, const Object& obj) {
+    boost::filesystem::path file = canonical_file(obj.m_fname);
+    auto iter = n_watched_files.find(file);
+    if (iter == n_watched_files.end()) {
+        int wd = inotify_add_watch(n_inotify_fd, 
+                file.parent_path().c_str(), WATCH_MASK);
+        if (wd < 0) {
+            Logger::log()->warn("Cannot watch %v: %v", 
+                    file, std::strerror(errno));
+            return;
+        }
+        n_watched_dirs[wd] = file.parent_path();
+        iter = n_watched_files.emplace(file, std::vector<Change>()).first;
+    }
+    Change change;
+    change.m_oid = oid;
+    change.m_type = obj.m_type;
+    change.m_fname = obj.m_fname;
+    iter->second.push_back(change);
+}
+
+void initialize() {
+    assert(n_inotify_fd < 0);
+    n_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (n_inotify_fd < 0) {
+        std::stringstream sss;
+        sss << "Cannot initialize inotify: "
+            << std::strerror(errno);
+        throw Except::Runtime(sss.str());
+    }
+    for_each_object(watch_object);
+    Logger::log()->info("Watching %v files in %v directories", 
+            n_watched_files.size(), n_watched_dirs.size());
+}
+
+void cleanup() {
+    stop();
+    if (n_inotify_fd >= 0) {
+        close(n_inotify_fd);
+        n_inotify_fd = -1;
+    }
+    n_watched_dirs.clear();
+    n_watched_files.clear();
+    n_batch.clear();
+    n_listeners.clear();
+}
+
+void async_wait_events() {
+    n_descriptor->async_read_some(boost::asio::null_buffers(),
+            [](const boost::system::error_code& asio_err, std::size_t) {
+        if (asio_err || !n_descriptor) {
+            return;
+        }
+        read_events();
+        async_wait_events();
+    });
+}
+
+void start(boost::asio::io_service& io) {
+    assert(!n_descriptor);
+    if (n_inotify_fd < 0) {
+        return;
+    }
+    n_descriptor = std::make_unique<boost::asio::posix::stream_descriptor>(
+            io, n_inotify_fd);
+    async_wait_events();
+}
+
+void stop() {
+    if (!n_descriptor) {
+        return;
+    }
+    // Keep the file descriptor open, since it is owned here and not by asio
+    n_descriptor->cancel();
+    n_descriptor->release();
+    n_descriptor.reset();
+}
+
+std::size_t read_events() {
+    std::size_t num_changed = 0;
+    if (n_inotify_fd < 0) {
+        return num_changed;
+    }
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t len = read(n_inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            break;
+        }
+        for (char* ptr = buffer; ptr < buffer + len; ) {
+            const inotify_event* event = 
+                    reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            
+            // Some events were lost, so every file might have changed
+            if (event->mask & IN_Q_OVERFLOW) {
+                Logger::log()->warn("inotify queue overflowed");
+                for (const auto& entry : n_watched_files) {
+                    n_batch.insert(entry.first);
+                }
+                num_changed += n_watched_files.size();
+                continue;
+            }
+            auto dir_iter = n_watched_dirs.find(event->wd);
+            if (dir_iter == n_watched_dirs.end() || event->len == 0) {
+                continue;
+            }
+            boost::filesystem::path file = dir_iter->second / event->name;
+            if (n_watched_files.find(file) != n_watched_files.end()) {
+                n_batch.insert(file);
+                ++num_changed;
+            }
+        }
+    }
+    return num_changed;
+}
+
+#else
+
+// Only inotify is supported, so elsewhere nothing is ever watched
+
+void initialize() {
+    throw Except::Runtime("Watching files needs inotify (Linux)");
+}
+
+void cleanup() {
+    n_watched_files.clear();
+    n_batch.clear();
+    n_listeners.clear();
+}
+
+void start(boost::asio::io_service& io) {}
+
+void stop() {}
+
+std::size_t read_events() {
+    return 0;
+}
+
+#endif // __linux__
+
+bool notify_changed(const boost::filesystem::path& file) {
+    boost::filesystem::path canon = canonical_file(file);
+    if (n_watched_files.find(canon) == n_watched_files.end()) {
+        return false;
+    }
+    n_batch.insert(canon);
+    return true;
+}
+
+std::size_t flush_changes() {
+    if (n_batch.empty()) {
+        return 0;
+    }
+    std::vector<Change> changes;
+    for (const boost::filesystem::path& file : n_batch) {
+        const std::vector<Change>& users = n_watched_files.at(file);
+        changes.insert(changes.end(), users.begin(), users.end());
+    }
+    n_batch.clear();
+    
+    Logger::log()->info("%v resources changed", changes.size());
+    
+    // Copy, since listeners may add or remove listeners
+    std::map<Listener_Handle, Listener> listeners = n_listeners;
+    for (const auto& entry : listeners) {
+        try {
+            entry.second(changes);
+        } catch (Except::Runtime& e) {
+            Logger::log()->warn("Error while reloading resources: %v", 
+                    e.what());
+        }
+    }
+    return changes.size();
+}
+
+Listener_Handle add_listener(Listener listener) {
+    Listener_Handle handle = n_next_handle++;
+    n_listeners.emplace(handle, listener);
+    return handle;
+}
+
+void remove_listener(Listener_Handle handle) {
+    n_listeners.erase(handle);
+}
+
+} // namespace Watcher
+} // namespace Resour
+} // namespace pegr
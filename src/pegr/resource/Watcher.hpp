@@ -0,0 +1,116 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_RESOURCE_WATCHER_HPP
+#define PEGR_RESOURCE_WATCHER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+
+#include "pegr/resource/Oid.hpp"
+#include "pegr/resource/Resources.hpp"
+
+namespace pegr {
+namespace Resour {
+namespace Watcher {
+
+/* Watches the files of every loaded resource for changes using inotify, so
+ * that caches of those resources can be invalidated while the game runs.
+ * 
+ * inotify's file descriptor is waited on by an asio io_service, and so no
+ * polling is done. Changes are not delivered as soon as they are read, but
+ * are instead batched until flush_changes() is called (once per frame). This
+ * way, an editor saving many files at once only causes one reload.
+ * 
+ * inotify is Linux-only. Elsewhere, initialize() throws and nothing is 
+ * watched.
+ */
+
+/**
+ * @brief A resource whose file was changed
+ */
+struct Change {
+    Oid m_oid;
+    Object::Type m_type;
+    boost::filesystem::path m_fname;
+};
+
+typedef std::function<void(const std::vector<Change>&)> Listener;
+typedef std::size_t Listener_Handle;
+
+/**
+ * @brief Starts watching the files of every currently loaded resource.
+ * Can throw runtime errors if inotify is not available (including on 
+ * platforms other than Linux).
+ */
+void initialize();
+
+void cleanup();
+
+/**
+ * @brief Begins waiting for changes on the given io_service. Changes are
+ * read when inotify has some, and then added to the current batch. Does
+ * nothing if initialize() failed.
+ * @param io
+ */
+void start(boost::asio::io_service& io);
+
+/**
+ * @brief Stops waiting for changes, so that the io_service can run out of
+ * work. Changes that happen while stopped are read on the next start().
+ */
+void stop();
+
+/**
+ * @brief Reads every change that inotify has queued, without blocking, and
+ * adds them to the current batch. Normally called by the io_service.
+ * @return How many watched files were changed
+ */
+std::size_t read_events();
+
+/**
+ * @brief Adds the resources using the given file to the current batch, as if
+ * inotify reported that it changed. Files that are not used by any resource
+ * are ignored.
+ * @param file
+ * @return If the file is used by any resource
+ */
+bool notify_changed(const boost::filesystem::path& file);
+
+/**
+ * @brief Delivers the current batch to every listener, in the order that they
+ * were added, then starts a new batch. Does nothing if the batch is empty.
+ * @return How many resources were in the batch
+ */
+std::size_t flush_changes();
+
+/**
+ * @param listener Called with every non-empty batch
+ * @return Handle for removing the listener
+ */
+Listener_Handle add_listener(Listener listener);
+
+void remove_listener(Listener_Handle handle);
+
+} // namespace Watcher
+} // namespace Resour
+} // namespace pegr
+
+#endif // PEGR_RESOURCE_WATCHER_HPP
@@ -0,0 +1,185 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "pegr/script/Gc_Scheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#include "pegr/debug/Trace.hpp"
+#include "pegr/script/Script.hpp"
+
+namespace pegr {
+namespace Script {
+namespace Gc_Scheduler {
+
+const std::int64_t DEFAULT_BUDGET_US = 1000;
+const double DEFAULT_PAUSE_RATIO = 1.5;
+const double DEFAULT_EMERGENCY_RATIO = 2.5;
+
+// Small heaps are not worth collecting often
+const std::size_t MIN_THRESHOLD_KB = 1024;
+
+bool n_enabled = false;
+std::int64_t n_budget_us = DEFAULT_BUDGET_US;
+double n_pause_ratio = DEFAULT_PAUSE_RATIO;
+double n_emergency_ratio = DEFAULT_EMERGENCY_RATIO;
+
+// Memory in use when the last cycle finished
+std::size_t n_baseline_kb = 0;
+
+// If the collector is partway through a cycle
+bool n_in_cycle = false;
+
+// Filled until the end of the next step_frame()
+Frame_Stats n_current;
+Frame_Stats n_last;
+
+std::int64_t Frame_Stats::get_total_ns() const {
+    return m_step_ns + m_emergency_ns;
+}
+
+std::size_t get_lua_kb() {
+    return lua_gc(get_lua_state(), LUA_GCCOUNT, 0);
+}
+
+std::int64_t get_ns_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Takes one incremental step
+ * @return True if that finished a cycle
+ */
+bool step_once() {
+    lua_State* l = get_lua_state();
+    bool finished = lua_gc(l, LUA_GCSTEP, 0) != 0;
+    
+    // Stepping sets a new allocation threshold, which would restart 
+    // automatic collection
+    lua_gc(l, LUA_GCSTOP, 0);
+    if (finished) {
+        n_in_cycle = false;
+        n_baseline_kb = get_lua_kb();
+        ++n_current.m_num_cycles;
+    } else {
+        n_in_cycle = true;
+    }
+    return finished;
+}
+
+void set_enabled(bool enabled) {
+    assert(is_initialized());
+    n_enabled = enabled;
+    n_in_cycle = false;
+    n_baseline_kb = get_lua_kb();
+    n_current = Frame_Stats();
+    n_last = Frame_Stats();
+    reapply();
+}
+
+bool is_enabled() {
+    return n_enabled;
+}
+
+void set_budget_us(std::int64_t budget_us) {
+    n_budget_us = std::max<std::int64_t>(0, budget_us);
+}
+std::int64_t get_budget_us() {
+    return n_budget_us;
+}
+
+void set_pause_ratio(double ratio) {
+    n_pause_ratio = ratio;
+}
+double get_pause_ratio() {
+    return n_pause_ratio;
+}
+
+void set_emergency_ratio(double ratio) {
+    n_emergency_ratio = ratio;
+}
+double get_emergency_ratio() {
+    return n_emergency_ratio;
+}
+
+std::size_t get_pause_threshold_kb() {
+    return std::max(MIN_THRESHOLD_KB, 
+            static_cast<std::size_t>(n_baseline_kb * n_pause_ratio));
+}
+
+std::size_t get_emergency_threshold_kb() {
+    return std::max(MIN_THRESHOLD_KB, 
+            static_cast<std::size_t>(n_baseline_kb * n_emergency_ratio));
+}
+
+void step_frame() {
+    if (!n_enabled) {
+        return;
+    }
+    PEGR_TRACE_SCOPE("gc", "Gc_Scheduler::step_frame");
+    if (n_in_cycle || get_lua_kb() >= get_pause_threshold_kb()) {
+        std::chrono::steady_clock::time_point start = 
+                std::chrono::steady_clock::now();
+        std::int64_t budget_ns = n_budget_us * 1000;
+        do {
+            ++n_current.m_num_steps;
+            if (step_once()) {
+                break;
+            }
+        } while (get_ns_since(start) < budget_ns);
+        n_current.m_step_ns += get_ns_since(start);
+    }
+    n_current.m_lua_kb = get_lua_kb();
+    n_last = n_current;
+    n_current = Frame_Stats();
+}
+
+bool check_emergency() {
+    if (!n_enabled || get_lua_kb() < get_emergency_threshold_kb()) {
+        return false;
+    }
+    PEGR_TRACE_SCOPE("gc", "Gc_Scheduler::check_emergency");
+    std::chrono::steady_clock::time_point start = 
+            std::chrono::steady_clock::now();
+    do {
+        ++n_current.m_num_emergency_steps;
+    } while (!step_once());
+    n_current.m_emergency_ns += get_ns_since(start);
+    return true;
+}
+
+void collect() {
+    PEGR_TRACE_SCOPE("gc", "Gc_Scheduler::collect");
+    lua_gc(get_lua_state(), LUA_GCCOLLECT, 0);
+    n_in_cycle = false;
+    n_baseline_kb = get_lua_kb();
+    reapply();
+}
+
+void reapply() {
+    lua_gc(get_lua_state(), n_enabled ? LUA_GCSTOP : LUA_GCRESTART, 0);
+}
+
+const Frame_Stats& get_last_frame_stats() {
+    return n_last;
+}
+
+} // namespace Gc_Scheduler
+} // namespace Script
+} // namespace pegr
@@ -0,0 +1,133 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PEGR_SCRIPT_GCSCHEDULER_HPP
+#define PEGR_SCRIPT_GCSCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/* Takes Lua garbage collection over from the allocator. While enabled, 
+ * automatic collection is stopped and the collector is instead stepped in 
+ * idle time after every frame, for at most a fixed time budget. A collection
+ * cycle starts once memory has grown enough since the previous cycle (like
+ * Lua's own "pause" setting). If memory grows too far before the budgeted
+ * steps catch up, such as during a long tick, the current cycle is finished
+ * right away without a budget.
+ */
+
+namespace pegr {
+namespace Script {
+namespace Gc_Scheduler {
+
+extern const std::int64_t DEFAULT_BUDGET_US;
+extern const double DEFAULT_PAUSE_RATIO;
+extern const double DEFAULT_EMERGENCY_RATIO;
+
+/**
+ * @brief What the collector did between the ends of two frames
+ */
+struct Frame_Stats {
+    // Budgeted steps after the frame
+    std::int64_t m_step_ns = 0;
+    std::size_t m_num_steps = 0;
+    
+    // Steps taken because memory passed the emergency threshold
+    std::int64_t m_emergency_ns = 0;
+    std::size_t m_num_emergency_steps = 0;
+    
+    // Number of collection cycles that finished
+    std::size_t m_num_cycles = 0;
+    
+    // Lua memory after stepping
+    std::size_t m_lua_kb = 0;
+    
+    std::int64_t get_total_ns() const;
+};
+
+/**
+ * @brief Stops (or restarts) Lua's automatic collection
+ */
+void set_enabled(bool enabled);
+bool is_enabled();
+
+/**
+ * @param budget_us Time that step_frame() may spend stepping, in 
+ * microseconds
+ */
+void set_budget_us(std::int64_t budget_us);
+std::int64_t get_budget_us();
+
+/**
+ * @param ratio A new cycle starts when Lua memory reaches this times what 
+ * was in use when the previous cycle finished
+ */
+void set_pause_ratio(double ratio);
+double get_pause_ratio();
+
+/**
+ * @param ratio The current cycle is finished without a budget when Lua 
+ * memory reaches this times what was in use when the previous cycle finished
+ */
+void set_emergency_ratio(double ratio);
+double get_emergency_ratio();
+
+/**
+ * @brief Steps the collector until the budget runs out or the cycle 
+ * finishes, taking at least one step if a cycle is due. Call once per 
+ * frame, after the frame's work is done. Does nothing while disabled.
+ */
+void step_frame();
+
+/**
+ * @brief Finishes the current cycle if memory passed the emergency 
+ * threshold. Cheap otherwise. Does nothing while disabled.
+ * @return If any steps were taken
+ */
+bool check_emergency();
+
+/**
+ * @brief Runs a full collection, without leaving automatic collection 
+ * running if it was stopped
+ */
+void collect();
+
+/**
+ * @brief Stops or restarts automatic collection again, after other code 
+ * (such as a benchmark) changed it
+ */
+void reapply();
+
+/**
+ * @return What happened during and after the most recent frame
+ */
+const Frame_Stats& get_last_frame_stats();
+
+/**
+ * @return Memory at which a new cycle starts, in kilobytes
+ */
+std::size_t get_pause_threshold_kb();
+
+/**
+ * @return Memory at which emergency steps are taken, in kilobytes
+ */
+std::size_t get_emergency_threshold_kb();
+
+} // namespace Gc_Scheduler
+} // namespace Script
+} // namespace pegr
+
+#endif // PEGR_SCRIPT_GCSCHEDULER_HPP
@@ -19,11 +19,13 @@
 #include <cassert>
 #include <cstddef>
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/debug/Trace.hpp"
 #include "pegr/except/Except.hpp"
 #include "pegr/logger/Logger.hpp"
 #include "pegr/script/Script_Util.hpp"
@@ -93,6 +95,14 @@ lua_State* m_l = nullptr;
 std::string m_lua_version;
 Regref m_pristine_sandbox;
 
+struct Loaded_File {
+    std::string m_chunkname;
+    std::string m_bytecode;
+};
+
+// Bytecode of files that were already loaded, by filename
+std::map<std::string, Loaded_File> n_loaded_files;
+
 Pop_Guard::Pop_Guard(int n, lua_State* l)
 : m_n(n)
 , m_lstate(l ? l : Script::get_lua_state()) {
@@ -386,6 +396,7 @@ void cleanup() {
     if (n_total_grab_delta != 0) {
         Logger::log()->warn("Non-zero grab delta: %v", n_total_grab_delta);
     }
+    n_loaded_files.clear();
     lua_close(m_l);
     m_l = nullptr;
     m_torndown = true;
@@ -420,11 +431,36 @@ const char* file_reader(lua_State* L, void* data, size_t* size) {
     return closure.m_block;
 }
 
-// TODO: check if this file has already been loaded ... ?
+int bytecode_writer(lua_State* L, const void* data, size_t size, void* ud) {
+    std::string& bytecode = *static_cast<std::string*>(ud);
+    bytecode.append(static_cast<const char*>(data), size);
+    return 0;
+}
+
 Unique_Regref load_lua_function(const char* filename, Regref environment,
                             const char* chunkname) {
     assert(is_initialized());
     if (!chunkname) { chunkname = filename; }
+    
+    // Bytecode also records the chunkname, so it must match too
+    auto loaded_iter = n_loaded_files.find(filename);
+    if (loaded_iter != n_loaded_files.end()
+            && loaded_iter->second.m_chunkname == chunkname) {
+        const std::string& bytecode = loaded_iter->second.m_bytecode;
+        if (luaL_loadbuffer(m_l, bytecode.data(), bytecode.size(), 
+                chunkname) != 0) {
+            const char* errmsg = lua_tostring(m_l, -1);
+            std::string copy = errmsg ? errmsg : "";
+            lua_pop(m_l, 1);
+            throw Except::Runtime(copy);
+        }
+        if (environment != NO_SANDBOX) {
+            push_reference(environment);
+            lua_setfenv(m_l, -2);
+        }
+        return grab_unique_reference();
+    }
+    
     /* Note: as far as I know, both Lua 5.1 and LuaJIT recognize bytecode
      * by checking if the first char is 0x1B (escape character '\033')*/
     std::ifstream file(filename, std::ios::binary | std::ios::in);
@@ -463,6 +499,10 @@ Unique_Regref load_lua_function(const char* filename, Regref environment,
         }
         default: break;
     }
+    Loaded_File& loaded = n_loaded_files[filename];
+    loaded.m_chunkname = chunkname;
+    loaded.m_bytecode.clear();
+    lua_dump(m_l, bytecode_writer, &loaded.m_bytecode);
     if (environment != NO_SANDBOX) {
         push_reference(environment);
         lua_setfenv(m_l, -2);
@@ -470,7 +510,12 @@ Unique_Regref load_lua_function(const char* filename, Regref environment,
     return grab_unique_reference();
 }
 
+void forget_loaded_file(const char* filename) {
+    n_loaded_files.erase(filename);
+}
+
 void run_function(int nargs, int nresults) {
+    PEGR_TRACE_SCOPE("script", "Script::run_function");
     assert(is_initialized());
     switch (lua_pcall(m_l, nargs, nresults, 0)) {
         case LUA_ERRRUN:
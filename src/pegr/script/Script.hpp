@@ -204,7 +204,9 @@ void cleanup();
 Unique_Regref load_c_function(lua_CFunction func, int closure_size = 0);
 
 /**
- * @brief Loads a function from a lua file
+ * @brief Loads a function from a lua file. The file is only read and parsed
+ * the first time, after which its bytecode is reused, until the file is
+ * forgotten.
  * @param filename The file to read
  * @param environment The environment (closure upvalue table) for this function
  * @param chunkname The name of the chunk used for debugging purposes
@@ -213,6 +215,13 @@ Unique_Regref load_c_function(lua_CFunction func, int closure_size = 0);
 Unique_Regref load_lua_function(const char* filename, Regref environment,
                             const char* chunkname = nullptr);
 
+/**
+ * @brief Makes the next load_lua_function() of this file read it again, such
+ * as after it was changed
+ * @param filename
+ */
+void forget_loaded_file(const char* filename);
+
 /**
  * @brief Runs the function on the stack. Behaves exactly like lua_pcall,
  * except Lua errors are turned into thrown runtime exceptions.
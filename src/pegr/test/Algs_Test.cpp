@@ -15,6 +15,10 @@
  */
 
 #include "pegr/algs/Algs.hpp"
+
+#include <atomic>
+
+#include "pegr/algs/Parallel.hpp"
 #include "pegr/test/Test_Util.hpp"
 
 namespace pegr {
@@ -63,5 +67,41 @@ void test_0000_algs() {
     }
 }
 
+//@Test Util parallel for
+void test_0000_parallel_for() {
+    {
+        std::vector<int> squares(1000, 0);
+        Algs::parallel_for(squares.size(), [&](std::size_t idx) {
+            squares[idx] = idx * idx;
+        });
+        for (std::size_t idx = 0; idx < squares.size(); ++idx) {
+            verify_equals(idx * idx, squares[idx]);
+        }
+    }
+    
+    {
+        std::atomic<int> calls(0);
+        Algs::parallel_for(0, [&](std::size_t idx) {
+            ++calls;
+        });
+        verify_equals(0, calls.load());
+    }
+    
+    {
+        bool thrown = false;
+        try {
+            Algs::parallel_for(100, [](std::size_t idx) {
+                if (idx == 50) {
+                    throw Except::Runtime("fifty");
+                }
+            });
+        } catch (Except::Runtime& e) {
+            verify_equals(std::string("fifty"), e.what());
+            thrown = true;
+        }
+        verify_equals(true, thrown, "Exception was not rethrown");
+    }
+}
+
 } // namespace Test
 } // namespace pegr
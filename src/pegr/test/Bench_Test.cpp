@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include "pegr/bench/Compare.hpp"
+#include "pegr/bench/Runner.hpp"
+#include "pegr/test/Test_Util.hpp"
+
+namespace pegr {
+namespace Test {
+
+//@Test Benchmark statistics
+void test_0000_bench_stats() {
+    std::vector<double> sorted;
+    for (int i = 1; i <= 100; ++i) {
+        sorted.push_back(i);
+    }
+    verify_equals(1.0, Bench::percentile(sorted, 0));
+    verify_equals(50.0, Bench::percentile(sorted, 0.5));
+    verify_equals(99.0, Bench::percentile(sorted, 0.99));
+    verify_equals(100.0, Bench::percentile(sorted, 1));
+    
+    Bench::Stats stats = Bench::compute_stats({4, 1, 3, 2});
+    verify_equals(1.0, stats.m_min);
+    verify_equals(2.5, stats.m_median);
+    verify_equals(4.0, stats.m_p99);
+    verify_equals(4.0, stats.m_max);
+    verify_equals(2.5, stats.m_mean);
+    
+    stats = Bench::compute_stats({});
+    verify_equals(0.0, stats.m_median);
+}
+
+//@Test Benchmark results JSON
+void test_0000_bench_results_json() {
+    Bench::Case bench_case;
+    bench_case.m_name = "count";
+    bench_case.m_params["b"] = 2;
+    bench_case.m_params["a"] = 1;
+    verify_equals(std::string("count/a=1/b=2"), bench_case.get_id());
+    
+    std::size_t total = 0;
+    bench_case.m_body = [&total](std::size_t iterations) {
+        total += iterations;
+    };
+    Bench::Settings settings;
+    settings.m_num_warmup = 1;
+    settings.m_num_samples = 3;
+    settings.m_min_sample_seconds = 0;
+    std::vector<Bench::Result> results = 
+            Bench::run_cases({bench_case}, settings);
+    verify_equals(std::size_t(1), results.size());
+    verify_equals(std::size_t(3), results[0].m_samples.size());
+    verify_equals(std::size_t(1), results[0].m_iterations);
+    
+    // Calibration, then warmup, then samples
+    verify_equals(std::size_t(5), total);
+    
+    settings.m_filter = "nothing";
+    verify_equals(true, Bench::run_cases({bench_case}, settings).empty());
+    
+    std::vector<Bench::Result> loaded = Bench::results_from_json(
+            Bench::results_to_json(results, "label", settings));
+    verify_equals(std::size_t(1), loaded.size());
+    verify_equals(results[0].m_id, loaded[0].m_id);
+    verify_equals(results[0].m_samples, loaded[0].m_samples);
+    verify_equals(2.0, loaded[0].m_params["b"]);
+    verify_equals(results[0].m_stats.m_median, loaded[0].m_stats.m_median);
+}
+
+//@Test Benchmark regression detection
+void test_0000_bench_compare() {
+    std::vector<double> noise = {100, 103, 98, 101, 99, 102, 97, 100, 104, 
+            96, 101, 99, 100, 102, 98, 103, 97, 100, 101, 99};
+    std::vector<double> shuffled(noise.rbegin(), noise.rend());
+    std::vector<double> slower;
+    for (double sample : noise) {
+        slower.push_back(sample * 1.2);
+    }
+    verify_equals(true, Bench::mann_whitney_p_value(noise, shuffled) > 0.5);
+    verify_equals(true, Bench::mann_whitney_p_value(noise, slower) < 0.001);
+    verify_equals(1.0, Bench::mann_whitney_p_value(noise, {}));
+    
+    auto make_result = [](const char* id, const std::vector<double>& samples) {
+        Bench::Result result;
+        result.m_id = id;
+        result.m_samples = samples;
+        result.m_stats = Bench::compute_stats(samples);
+        return result;
+    };
+    std::vector<Bench::Result> base = {
+        make_result("steady", noise),
+        make_result("regressed", noise),
+        make_result("improved", slower),
+        make_result("gone", noise)
+    };
+    std::vector<Bench::Result> current = {
+        make_result("steady", shuffled),
+        make_result("regressed", slower),
+        make_result("improved", noise),
+        make_result("new", noise)
+    };
+    Bench::Compare_Settings settings;
+    std::vector<Bench::Comparison> comps = 
+            Bench::compare_results(base, current, settings);
+    verify_equals(std::size_t(5), comps.size());
+    verify_equals(true, comps[0].m_verdict == Bench::Comparison::Verdict::SAME);
+    verify_equals(true, 
+            comps[1].m_verdict == Bench::Comparison::Verdict::SLOWER);
+    verify_equals(true, 
+            comps[2].m_verdict == Bench::Comparison::Verdict::FASTER);
+    verify_equals(true, 
+            comps[3].m_verdict == Bench::Comparison::Verdict::ADDED);
+    verify_equals(true, 
+            comps[4].m_verdict == Bench::Comparison::Verdict::REMOVED);
+    verify_equals(std::string("gone"), comps[4].m_id);
+    verify_equals(std::size_t(1), Bench::count_regressions(comps));
+    
+    // A significant change smaller than the threshold is not a regression
+    settings.m_min_change = 0.5;
+    comps = Bench::compare_results(base, current, settings);
+    verify_equals(std::size_t(0), Bench::count_regressions(comps));
+}
+
+} // namespace Test
+} // namespace pegr
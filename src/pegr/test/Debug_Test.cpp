@@ -14,7 +14,19 @@
  *  limitations under the License.
  */
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "pegr/algs/Parallel.hpp"
 #include "pegr/debug/Debug_Macros.hpp"
+#include "pegr/debug/Perf_Counters.hpp"
+#include "pegr/debug/Profiler.hpp"
+#include "pegr/debug/Trace.hpp"
+#include "pegr/resource/Json_Util.hpp"
+#include "pegr/test/Test_Util.hpp"
 
 namespace pegr {
 namespace Test {
@@ -25,5 +37,139 @@ void test_0005_assertion_test() {
     assert_balance(0);
 }
 
+//@Test Hardware performance counters
+void test_0005_perf_counters() {
+    Debug::Perf_Counters counters;
+    counters.start();
+    volatile std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < 100000; ++i) {
+        sum = sum + i;
+    }
+    Debug::Counter_Values values = counters.stop();
+    
+    // Counters are often unavailable (virtual machines, permissions), in
+    // which case nothing should be reported
+    for (std::size_t idx = 0; idx < Debug::NUM_COUNTERS; ++idx) {
+        if (!counters.is_available()) {
+            verify_equals(false, values.m_valid[idx]);
+        }
+        if (!values.m_valid[idx]) {
+            verify_equals(std::uint64_t(0), values.m_values[idx]);
+        }
+    }
+    if (values.is_valid(Debug::Counter::INSTRUCTIONS)) {
+        verify_equals(true, 
+                values.get(Debug::Counter::INSTRUCTIONS) > 100000);
+    }
+    
+    Debug::Counter_Values total;
+    total += values;
+    total += values;
+    verify_equals(values.get(Debug::Counter::CYCLES) * 2, 
+            total.get(Debug::Counter::CYCLES));
+}
+
+std::size_t count_trace_spans(const char* name) {
+    Json::Value json = Debug::Trace::to_chrome_json();
+    std::size_t count = 0;
+    for (const Json::Value& event : json["traceEvents"]) {
+        if (event["ph"].asString() == "X" && event["name"].asString() == name) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+//@Test Tracing spans
+void test_0005_trace() {
+    Debug::Trace::clear();
+    {
+        Debug::Trace::Scope ignored("test", "disabled");
+    }
+    verify_equals(std::size_t(0), count_trace_spans("disabled"));
+    
+    Debug::Trace::set_enabled(true);
+    {
+        Debug::Trace::Scope outer("test", "outer");
+        Debug::Trace::Scope inner("test", "inner");
+    }
+    verify_equals(std::size_t(1), count_trace_spans("outer"));
+    verify_equals(std::size_t(1), count_trace_spans("inner"));
+    
+    // Every thread gets its own buffer
+    Algs::parallel_for(64, [](std::size_t idx) {
+        Debug::Trace::Scope span("test", "parallel");
+    });
+    verify_equals(std::size_t(64), count_trace_spans("parallel"));
+    
+    // Only the most recent spans are kept
+    Debug::Trace::set_buffer_capacity(4);
+    for (int i = 0; i < 10; ++i) {
+        Debug::Trace::Scope span("test", "ring");
+    }
+    verify_equals(std::size_t(4), count_trace_spans("ring"));
+    
+    boost::filesystem::path file = 
+            boost::filesystem::temp_directory_path() / "pegr_test_trace.json";
+    Debug::Trace::set_trigger("slow", 1e-3, file);
+    {
+        Debug::Trace::Scope span("test", "slow");
+    }
+    verify_equals(false, Debug::Trace::has_trigger_fired());
+    Debug::Trace::record({"test", "slow", 0, std::uint64_t(2e6), 
+            Debug::Trace::NO_ARG});
+    verify_equals(true, Debug::Trace::has_trigger_fired());
+    Json::Value dumped = Resour::Json_Util::read(file);
+    verify_equals(true, dumped["traceEvents"].size() > 0);
+    boost::filesystem::remove(file);
+    
+    Debug::Trace::clear_trigger();
+    Debug::Trace::set_enabled(false);
+    Debug::Trace::set_buffer_capacity(1 << 16);
+}
+
+//@Test Profiler span summaries
+void test_0005_profiler() {
+    const std::uint64_t NO_ARG = Debug::Trace::NO_ARG;
+    std::vector<Debug::Trace::Thread_Spans> threads(2);
+    
+    // In the order that they end, as recorded
+    threads[0].m_spans = {
+        {"engine", "child", 10, 20, NO_ARG},
+        {"engine", "listener", 25, 30, 7},
+        {"engine", "tick", 0, 40, NO_ARG},
+        {"engine", "tick", 50, 60, NO_ARG},
+    };
+    threads[1].m_spans = {
+        {"engine", "listener", 12, 14, 7},
+        {"engine", "listener", 15, 35, 8},
+    };
+    
+    std::vector<Debug::Trace::Span> ticks = 
+            Debug::Profiler::find_spans(threads, "tick");
+    verify_equals(std::size_t(2), ticks.size());
+    verify_equals(std::uint64_t(0), ticks[0].m_begin_ns);
+    verify_equals(std::uint64_t(50), ticks[1].m_begin_ns);
+    
+    std::vector<Debug::Profiler::Span_Total> totals = 
+            Debug::Profiler::total_spans(threads, 0, 50);
+    verify_equals(std::size_t(4), totals.size());
+    verify_equals(std::string("tick"), std::string(totals[0].m_name));
+    verify_equals(std::uint64_t(40), totals[0].m_total_ns);
+    verify_equals(std::uint64_t(8), totals[1].m_arg);
+    verify_equals(std::uint64_t(7), totals[3].m_arg);
+    verify_equals(std::size_t(2), totals[3].m_count);
+    verify_equals(std::uint64_t(7), totals[3].m_total_ns);
+    verify_equals(std::uint64_t(5), totals[3].m_max_ns);
+    
+    std::vector<Debug::Profiler::Placed_Span> placed = 
+            Debug::Profiler::lay_out_spans(threads[0].m_spans, 15, 45);
+    verify_equals(std::size_t(3), placed.size());
+    verify_equals(std::string("tick"), std::string(placed[0].m_span.m_name));
+    verify_equals(std::size_t(0), placed[0].m_depth);
+    verify_equals(std::size_t(1), placed[1].m_depth);
+    verify_equals(std::size_t(1), placed[2].m_depth);
+}
+
 } // namespace Test
 } // namespace pegr
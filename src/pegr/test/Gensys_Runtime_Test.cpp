@@ -14,7 +14,18 @@
  *  limitations under the License.
  */
 
+#include <string>
+#include <vector>
+
+#include "pegr/except/Except.hpp"
+#include "pegr/gensys/Binary_Io.hpp"
+#include "pegr/gensys/Cache.hpp"
 #include "pegr/gensys/Gensys.hpp"
+#include "pegr/gensys/Interned_Strings.hpp"
+#include "pegr/gensys/Runtime.hpp"
+#include "pegr/resource/Oid.hpp"
+#include "pegr/script/Script.hpp"
+#include "pegr/test/Test_Util.hpp"
 
 namespace pegr {
 namespace Test {
@@ -25,5 +36,135 @@ void test_0099_gensys_runtime() {
     Gensys::initialize();
 }
 
+//@Test Gensys interned strings
+void test_0099_gensys_interned_strings() {
+    std::size_t orig_count = Gensys::Runtime::get_num_interned_strings();
+    {
+        Gensys::Runtime::Istr_Ptr hello = 
+                Gensys::Runtime::intern_string("hello world");
+        Gensys::Runtime::Istr_Ptr hello2 = 
+                Gensys::Runtime::intern_string("hello world");
+        verify_equals(true, hello == hello2, "Same string interned twice");
+        verify_equals(orig_count + 1, 
+                Gensys::Runtime::get_num_interned_strings());
+        verify_equals(std::string("hello world"), hello.get_string());
+        
+        // Interning the same string from Lua should find the same entry
+        lua_State* l = Script::get_lua_state();
+        Script::push_reference(hello.get_lua_ref());
+        Gensys::Runtime::Istr_Ptr hello3 = 
+                Gensys::Runtime::intern_lua_string(-1);
+        lua_pop(l, 1);
+        verify_equals(true, hello == hello3, "Same string interned from Lua");
+        
+        lua_pushstring(l, "goodbye world");
+        Gensys::Runtime::Istr_Ptr goodbye = 
+                Gensys::Runtime::intern_lua_string(-1);
+        lua_pop(l, 1);
+        verify_equals(false, hello == goodbye);
+        verify_equals(orig_count + 2, 
+                Gensys::Runtime::get_num_interned_strings());
+        
+        hello2 = goodbye;
+        verify_equals(orig_count + 2, 
+                Gensys::Runtime::get_num_interned_strings());
+    }
+    // Nothing refers to the strings anymore
+    verify_equals(orig_count, Gensys::Runtime::get_num_interned_strings());
+}
+
+/**
+ * @brief Writes a cache containing one archetype with one component, which has
+ * a single i32 member at the given byte offset within an 8 byte chunk
+ */
+std::vector<char> write_test_cache(std::uint64_t member_offset) {
+    std::string comp_repr = Resour::Oid("far.c").get_repr();
+    std::vector<char> buffer;
+    Gensys::Binary_Io::Writer writer(buffer);
+    writer.write_bytes("PEGRDEFS", 8);
+    writer.write_value<std::uint32_t>(Gensys::Cache::CACHE_VERSION);
+    writer.write_value<std::uint32_t>(0);
+    writer.write_value<std::uint64_t>(7);
+    
+    // No functions
+    writer.write_value<std::uint64_t>(0);
+    
+    // One component
+    writer.write_value<std::uint64_t>(1);
+    writer.write_string(comp_repr);
+    writer.write_value<std::uint8_t>(false);
+    writer.write_value<std::uint64_t>(1);
+    writer.write_string("hp");
+    writer.write_value<std::uint32_t>(
+            static_cast<std::uint32_t>(Gensys::Runtime::Prim::Type::I32));
+    writer.write_value<std::uint8_t>(false);
+    writer.write_value<std::uint64_t>(member_offset);
+    
+    // One archetype
+    writer.write_value<std::uint64_t>(1);
+    writer.write_string(Resour::Oid("far.at").get_repr());
+    writer.write_value<std::uint64_t>(1);
+    writer.write_string("far");
+    writer.write_string(comp_repr);
+    writer.write_value<std::uint64_t>(1);
+    writer.write_string(comp_repr);
+    for (int idx = 0; idx < 5; ++idx) {
+        writer.write_value<std::uint64_t>(0);
+    }
+    const char zeros[8] = {};
+    writer.write_value<std::uint64_t>(sizeof(zeros));
+    writer.write_bytes(zeros, sizeof(zeros));
+    writer.write_value<std::uint64_t>(0);
+    writer.write_value<std::uint64_t>(0);
+    writer.write_value<std::uint64_t>(sizeof(zeros));
+    writer.write_bytes(zeros, sizeof(zeros));
+    writer.write_value<std::uint64_t>(0);
+    writer.write_value<std::uint64_t>(0);
+    
+    // No genres
+    writer.write_value<std::uint64_t>(0);
+    return buffer;
+}
+
+//@Test Gensys cache member validation
+void test_0099_gensys_cache_validation() {
+    Gensys::cleanup();
+    Gensys::initialize();
+    
+    // A member that fits is accepted
+    std::vector<char> good = write_test_cache(4);
+    verify_equals(true, Gensys::Cache::read_cache(good.data(), good.size(), 
+            7, LUA_REFNIL));
+    verify_equals(true, Gensys::Runtime::find_arche(
+            Resour::Oid("far.at")) != nullptr);
+    
+    // One that does not is rejected before anything is replaced
+    std::vector<char> bad = write_test_cache(100);
+    bool thrown = false;
+    try {
+        Gensys::Cache::read_cache(bad.data(), bad.size(), 7, LUA_REFNIL);
+    } catch (Except::Runtime& e) {
+        thrown = true;
+    }
+    verify_equals(true, thrown, "Misplaced member was accepted");
+    verify_equals(true, Gensys::Runtime::find_arche(
+            Resour::Oid("far.at")) != nullptr);
+    
+    // Misaligned, or partially outside of the chunk
+    for (std::uint64_t offset : {2, 8}) {
+        std::vector<char> bad = write_test_cache(offset);
+        thrown = false;
+        try {
+            Gensys::Cache::read_cache(bad.data(), bad.size(), 7, LUA_REFNIL);
+        } catch (Except::Runtime& e) {
+            thrown = true;
+        }
+        verify_equals(true, thrown, "Misplaced member was accepted");
+    }
+    
+    Gensys::cleanup();
+    Gensys::initialize();
+}
+
 } // namespace Test
 } // namespace pegr
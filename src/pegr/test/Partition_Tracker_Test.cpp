@@ -0,0 +1,132 @@
+/*
+ *  Copyright 2017 James Fong
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "pegr/algs/Partition_Tracker.hpp"
+#include "pegr/gensys/Util.hpp"
+#include "pegr/test/Test_Util.hpp"
+
+namespace pegr {
+namespace Test {
+
+//@Test Partition tracker test
+void test_0085_01_partition_tracker_test() {
+    {
+        Algs::Partition_Tracker ptrack;
+        verify_equals(0, ptrack.get_minimum_size());
+        verify_equals(true, ptrack.can_occupy(0, 8));
+        verify_equals(0, ptrack.find_first_fit(8, 8));
+        
+        ptrack.occupy(0, 4);
+        verify_equals(4, ptrack.get_minimum_size());
+        verify_equals(false, ptrack.can_occupy(2, 4));
+        verify_equals(true, ptrack.can_occupy(4, 4));
+        verify_equals(4, ptrack.find_first_fit(4, 4));
+        verify_equals(8, ptrack.find_first_fit(8, 8));
+        
+        // Gaps are filled
+        ptrack.occupy(8, 8);
+        verify_equals(4, ptrack.find_first_fit(2, 2));
+        ptrack.occupy(4, 4);
+        verify_equals(16, ptrack.find_first_fit(2, 2));
+        verify_equals(16, ptrack.get_minimum_size());
+    }
+    
+    {
+        // Runs can cross from one word into the next
+        Algs::Partition_Tracker ptrack;
+        ptrack.occupy(0, 60);
+        verify_equals(60, ptrack.find_first_fit(8, 4));
+        verify_equals(64, ptrack.find_first_fit(8, 8));
+        ptrack.occupy(60, 8);
+        verify_equals(false, ptrack.can_occupy(63, 2));
+        verify_equals(68, ptrack.find_first_fit(1, 1));
+        
+        // Wider than a word
+        verify_equals(72, ptrack.find_first_fit(100, 8));
+    }
+    
+    {
+        // Same results as trying every offset on a plain byte array, with
+        // sizes in no particular order so that there are gaps to fill
+        Algs::Partition_Tracker ptrack;
+        std::vector<char> bytes;
+        std::uint32_t rand = 12345;
+        for (int i = 0; i < 1000; ++i) {
+            rand = rand * 1103515245 + 12345;
+            std::size_t size = std::size_t(1) << ((rand >> 16) % 4);
+            std::size_t expected = 0;
+            while (true) {
+                bool fits = true;
+                for (std::size_t b = expected; b < expected + size; ++b) {
+                    if (b < bytes.size() && bytes[b]) {
+                        fits = false;
+                        break;
+                    }
+                }
+                if (fits) {
+                    break;
+                }
+                expected += size;
+            }
+            if (bytes.size() < expected + size) {
+                bytes.resize(expected + size, 0);
+            }
+            std::fill(bytes.begin() + expected, 
+                    bytes.begin() + expected + size, 1);
+            
+            std::size_t got = ptrack.find_first_fit(size, size);
+            verify_equals(expected, got);
+            ptrack.occupy(got, size);
+        }
+        verify_equals(bytes.size(), ptrack.get_minimum_size());
+    }
+    
+    {
+        // A wide component is packed without any padding
+        std::map<Gensys::Interm::Symbol, Gensys::Interm::Prim> members;
+        std::size_t total_size = 0;
+        for (int i = 0; i < 1000; ++i) {
+            std::stringstream sss;
+            sss << "member" << i;
+            Gensys::Interm::Prim prim;
+            if (i % 3 == 0) {
+                prim.set_i32(i);
+                total_size += 4;
+            } else {
+                prim.set_f64(i);
+                total_size += 8;
+            }
+            members[sss.str()] = prim;
+        }
+        std::map<Gensys::Interm::Symbol, std::size_t> symbol_to_offset;
+        Algs::Podc_Ptr chunk = Gensys::Util::new_pod_chunk_from_interm_prims(
+                members, symbol_to_offset);
+        verify_equals((total_size + 7) / 8 * 8, chunk.get_size());
+        verify_equals(std::int32_t(999), chunk.get_value<std::int32_t>(
+                symbol_to_offset.at("member999")));
+        verify_equals(998.0, chunk.get_value<double>(
+                symbol_to_offset.at("member998")));
+        Algs::Podc_Ptr::delete_podc(chunk);
+    }
+}
+
+} // namespace Test
+} // namespace pegr
@@ -18,6 +18,7 @@
 
 #include "pegr/algs/Pod_Chunk.hpp"
 #include "pegr/except/Except.hpp"
+#include "pegr/test/Test_Util.hpp"
 
 namespace pegr {
 namespace Test {
@@ -71,5 +72,27 @@ void test_0085_00_podchunk_test() {
     Algs::Podc_Ptr::delete_podc(pcp);
 }
 
+//@Test PodChunk stats
+void test_0085_01_podchunk_stats() {
+    Algs::Podc_Stats before = Algs::get_podc_stats();
+    Algs::Podc_Ptr pcp = Algs::Podc_Ptr::new_podc(20);
+    Algs::Podc_Stats during = Algs::get_podc_stats();
+    if (!Algs::are_podc_stats_counted()) {
+        Algs::Podc_Ptr::delete_podc(pcp);
+        verify_equals(std::size_t(0), during.m_num_live);
+        verify_equals(std::size_t(0), during.m_live_bytes);
+        verify_equals(std::size_t(0), during.m_num_allocated);
+        return;
+    }
+    verify_equals(before.m_num_live + 1, during.m_num_live);
+    verify_equals(before.m_live_bytes + 24, during.m_live_bytes);
+    verify_equals(before.m_num_allocated + 1, during.m_num_allocated);
+    Algs::Podc_Ptr::delete_podc(pcp);
+    Algs::Podc_Stats after = Algs::get_podc_stats();
+    verify_equals(before.m_num_live, after.m_num_live);
+    verify_equals(before.m_live_bytes, after.m_live_bytes);
+    verify_equals(before.m_num_allocated + 1, after.m_num_allocated);
+}
+
 } // namespace Test
 } // namespace pegr
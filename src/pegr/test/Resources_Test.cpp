@@ -16,6 +16,9 @@
 
 #include "pegr/resource/Resources.hpp"
 
+#include <fstream>
+
+#include "pegr/resource/Watcher.hpp"
 #include "pegr/test/Test_Util.hpp"
 #include "pegr/text/Text.hpp"
 
@@ -30,5 +33,52 @@ void test_0101_resource_oid_test() {
     verify_equals(std::string("Hello, world!"), res->m_string);
 }
 
+//@Test Resource watcher test
+void test_0102_resource_watcher_test() {
+    const Resour::Object& obj = Resour::find_object("hello_world.txt");
+    Text::Text_Res_Cptr original = 
+            Text::find_text_resource("hello_world.txt");
+    verify_equals(original.get(), 
+            Text::find_text_resource("hello_world.txt").get(),
+            "Text was not cached");
+    
+    // Start from an empty batch
+    Resour::Watcher::read_events();
+    Resour::Watcher::flush_changes();
+    
+    std::vector<std::string> changed;
+    Resour::Watcher::Listener_Handle handle = 
+            Resour::Watcher::add_listener(
+            [&](const std::vector<Resour::Watcher::Change>& changes) {
+                for (const Resour::Watcher::Change& change : changes) {
+                    changed.push_back(change.m_oid.get_repr());
+                }
+            });
+    
+    // Rewrite the file with the same contents
+    {
+        std::ofstream os(obj.m_fname.string().c_str(), 
+                std::ios::out | std::ios::binary | std::ios::trunc);
+        os << original->m_string;
+    }
+    verify_equals(1, Resour::Watcher::read_events());
+    verify_equals(0, changed.size(), "Changes were not batched");
+    
+    // The same file twice in one batch is only delivered once
+    verify_equals(true, Resour::Watcher::notify_changed(obj.m_fname));
+    verify_equals(false, Resour::Watcher::notify_changed("not_a_resource"));
+    verify_equals(1, Resour::Watcher::flush_changes());
+    verify_equals(std::vector<std::string>{":hello_world.txt"}, changed);
+    verify_equals(0, Resour::Watcher::flush_changes());
+    
+    Resour::Watcher::remove_listener(handle);
+    
+    // The text was forgotten, and so is read again
+    Text::Text_Res_Cptr reloaded = 
+            Text::find_text_resource("hello_world.txt");
+    verify_not_equals(original.get(), reloaded.get(), "Text was not reloaded");
+    verify_equals(original->m_string, reloaded->m_string);
+}
+
 } // namespace Test
 } // namespace pegr
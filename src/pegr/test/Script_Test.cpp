@@ -14,10 +14,12 @@
  *  limitations under the License.
  */
 
+#include <cstddef>
 #include <vector>
 
 #include "pegr/except/Except.hpp"
 #include "pegr/logger/Logger.hpp"
+#include "pegr/script/Gc_Scheduler.hpp"
 #include "pegr/script/Script.hpp"
 #include "pegr/script/Script_Util.hpp"
 #include "pegr/test/Test_Util.hpp"
@@ -144,5 +146,66 @@ void test_0010_check_unique_regref() {
     
 }
 
+/**
+ * @brief Allocates Lua tables and drops them right away
+ */
+void make_lua_garbage(lua_State* l, int num_tables) {
+    for (int idx = 0; idx < num_tables; ++idx) {
+        lua_createtable(l, 64, 0);
+        lua_pop(l, 1);
+    }
+}
+
+//@Test Script budgeted garbage collection
+void test_0010_gc_scheduler() {
+    lua_State* l = Script::get_lua_state();
+    Script::Gc_Scheduler::collect();
+    Script::Gc_Scheduler::set_enabled(true);
+    std::size_t start_kb = lua_gc(l, LUA_GCCOUNT, 0);
+    
+    Logger::log()->info("Garbage is not collected automatically");
+    make_lua_garbage(l, 10000);
+    std::size_t garbage_kb = lua_gc(l, LUA_GCCOUNT, 0);
+    verify_equals(true, garbage_kb > start_kb + 4096);
+    
+    Logger::log()->info("Frames step the collector until a cycle finishes");
+    std::size_t num_steps = 0;
+    for (int frame = 0; frame < 10000; ++frame) {
+        Script::Gc_Scheduler::step_frame();
+        const Script::Gc_Scheduler::Frame_Stats& stats = 
+                Script::Gc_Scheduler::get_last_frame_stats();
+        num_steps += stats.m_num_steps;
+        if (stats.m_num_cycles > 0) {
+            break;
+        }
+    }
+    verify_equals(true, num_steps > 0);
+    verify_equals(true, Script::Gc_Scheduler::get_last_frame_stats()
+            .m_num_cycles > 0);
+    verify_equals(true, static_cast<std::size_t>(lua_gc(l, LUA_GCCOUNT, 0)) 
+            < garbage_kb);
+    
+    Logger::log()->info("Nothing to do until memory grows");
+    Script::Gc_Scheduler::step_frame();
+    verify_equals(std::size_t(0), 
+            Script::Gc_Scheduler::get_last_frame_stats().m_num_steps);
+    
+    Logger::log()->info("Emergency steps finish the cycle");
+    verify_equals(false, Script::Gc_Scheduler::check_emergency());
+    make_lua_garbage(l, 10000);
+    verify_equals(true, static_cast<std::size_t>(lua_gc(l, LUA_GCCOUNT, 0)) 
+            >= Script::Gc_Scheduler::get_emergency_threshold_kb());
+    verify_equals(true, Script::Gc_Scheduler::check_emergency());
+    Script::Gc_Scheduler::step_frame();
+    const Script::Gc_Scheduler::Frame_Stats& stats = 
+            Script::Gc_Scheduler::get_last_frame_stats();
+    verify_equals(true, stats.m_num_emergency_steps > 0);
+    verify_equals(true, stats.m_num_cycles > 0);
+    verify_equals(true, stats.m_lua_kb 
+            < Script::Gc_Scheduler::get_emergency_threshold_kb());
+    
+    Script::Gc_Scheduler::set_enabled(false);
+}
+
 } // namespace Test
 } // namespace pegr
@@ -30,7 +30,11 @@ namespace pegr {
 namespace Test {
 
 void test_0000_algs();
+void test_0000_bench_compare();
+void test_0000_bench_results_json();
+void test_0000_bench_stats();
 void test_0000_memory_test();
+void test_0000_parallel_for();
 void test_0000_ptr_cast();
 void test_0000_signed_unsigned();
 void test_0001_flags();
@@ -40,11 +44,15 @@ void test_0002_unique_ptr_test();
 void test_0003_lambda_closure();
 void test_0003_qifu_map_test();
 void test_0005_assertion_test();
+void test_0005_perf_counters();
+void test_0005_profiler();
+void test_0005_trace();
 void test_0010_check_guard_memory_leaks();
 void test_0010_check_guard_memory_leaks_shared();
 void test_0010_check_pop_guard();
 void test_0010_check_script_loading();
 void test_0010_check_unique_regref();
+void test_0010_gc_scheduler();
 void test_0028_for_pairs();
 void test_0028_for_pairs_exception();
 void test_0028_for_pairs_number_sorted();
@@ -58,10 +66,15 @@ void test_0030_gensys_primitive();
 void test_0030_gensys_primitive_multiple();
 void test_0080_00_gensys_primitive();
 void test_0085_00_podchunk_test();
+void test_0085_01_partition_tracker_test();
+void test_0085_01_podchunk_stats();
+void test_0099_gensys_cache_validation();
+void test_0099_gensys_interned_strings();
 void test_0099_gensys_runtime();
 void test_0100_unique_handle_validity();
 void test_0100_unique_render_handles();
 void test_0101_resource_oid_test();
+void test_0102_resource_watcher_test();
 
 struct NamedTest {
     const char* m_name;
@@ -73,7 +86,11 @@ const NamedTest n_tests[] = {
     {"Testing Framework", [](){}},
 
     {"Util algs test", test_0000_algs},
+    {"Benchmark regression detection", test_0000_bench_compare},
+    {"Benchmark results JSON", test_0000_bench_results_json},
+    {"Benchmark statistics", test_0000_bench_stats},
     {"Memory Test", test_0000_memory_test},
+    {"Util parallel for", test_0000_parallel_for},
     {"Pointer cast", test_0000_ptr_cast},
     {"Assigning negative to unsigned", test_0000_signed_unsigned},
     {"Flag test", test_0001_flags},
@@ -83,11 +100,15 @@ const NamedTest n_tests[] = {
     {"Lambda closure", test_0003_lambda_closure},
     {"QIFU_Map test", test_0003_qifu_map_test},
     {"Assertion test", test_0005_assertion_test},
+    {"Hardware performance counters", test_0005_perf_counters},
+    {"Profiler span summaries", test_0005_profiler},
+    {"Tracing spans", test_0005_trace},
     {"Script Unique_Regref memory leaks", test_0010_check_guard_memory_leaks},
     {"Script Shared_Regref memory leaks", test_0010_check_guard_memory_leaks_shared},
     {"Script Pop_Guard memory leaks", test_0010_check_pop_guard},
     {"Identifying syntax errors", test_0010_check_script_loading},
     {"More Unique_Regref tests", test_0010_check_unique_regref},
+    {"Script budgeted garbage collection", test_0010_gc_scheduler},
     {"Script Helper for_pairs", test_0028_for_pairs},
     {"Script Helper for_pairs with exception", test_0028_for_pairs_exception},
     {"Script Helper for_number_pairs_sorted", test_0028_for_pairs_number_sorted},
@@ -101,10 +122,15 @@ const NamedTest n_tests[] = {
     {"Reassignment of gensys primitives", test_0030_gensys_primitive_multiple},
     {"Gensys primitive from Lua values", test_0080_00_gensys_primitive},
     {"PodChunk test", test_0085_00_podchunk_test},
+    {"Partition tracker test", test_0085_01_partition_tracker_test},
+    {"PodChunk stats", test_0085_01_podchunk_stats},
+    {"Gensys cache member validation", test_0099_gensys_cache_validation},
+    {"Gensys interned strings", test_0099_gensys_interned_strings},
     {"Gensys Runtime Test", test_0099_gensys_runtime},
     {"Unique handle validity", test_0100_unique_handle_validity},
     {"Unique render handles templates", test_0100_unique_render_handles},
     {"Resource OID test", test_0101_resource_oid_test},
+    {"Resource watcher test", test_0102_resource_watcher_test},
     
     // Sentinel
     {nullptr, std::function<void()>()}
@@ -119,11 +145,25 @@ const NamedLuaTest n_lua_tests[] = {
     
     {"The simplest test possible", "0000_basic.lua"},
     {"Simple sandbox test", "0001_sandbox_test.lua"},
+    {"Lua micro-benchmarks", "0002_bench_test.lua"},
     {"Basic Gensys test", "0005_gensys_test.lua"},
+    {"Gensys compiled definitions cache", "0005_gensys_test_compiled_cache.lua"},
+    {"Gensys delta snapshots", "0005_gensys_test_delta.lua"},
+    {"Gensys entity references", "0005_gensys_test_entity_refs.lua"},
+    {"Gensys world forks", "0005_gensys_test_fork.lua"},
     {"Gensys test Lua garbage collection", "0005_gensys_test_gc.lua"},
     {"Gensys genre matching", "0005_gensys_test_genres.lua"},
+    {"Gensys LuaJIT trace diagnostics", "0005_gensys_test_jit_diag.lua"},
+    {"Gensys Lua sampling profiler", "0005_gensys_test_lua_profile.lua"},
     {"Gensys component matching", "0005_gensys_test_matching.lua"},
+    {"Gensys memory accounting", "0005_gensys_test_memory.lua"},
+    {"Gensys incremental recompilation", "0005_gensys_test_recompile.lua"},
+    {"Gensys rollback buffer", "0005_gensys_test_rollback.lua"},
+    {"Gensys shared members", "0005_gensys_test_shared.lua"},
+    {"Gensys snapshot save and load", "0005_gensys_test_snapshot.lua"},
     {"Gensys string test", "0005_gensys_test_strings.lua"},
+    {"Gensys tag components", "0005_gensys_test_tags.lua"},
+    {"Gensys multiple worlds", "0005_gensys_test_worlds.lua"},
     
     // Sentinel
     {nullptr, nullptr}
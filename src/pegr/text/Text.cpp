@@ -17,6 +17,7 @@
 #include "pegr/text/Text.hpp"
 
 #include <fstream>
+#include <map>
 #include <sstream>
 
 #include "pegr/except/Except.hpp"
@@ -24,16 +25,31 @@
 namespace pegr {
 namespace Text {
 
+std::map<Resour::Oid, Text_Res_Cptr> n_cached_text;
+
 Text_Res_Cptr find_text_resource(Resour::Oid oid) {
+    auto cache_iter = n_cached_text.find(oid);
+    if (cache_iter != n_cached_text.end()) {
+        return cache_iter->second;
+    }
     const Resour::Object& obj = Resour::find_object(oid, 
             Resour::Object::Type::STRING);
     
     Text_Res_Ptr text_res = std::make_shared<Text_Res>();
     text_res->m_string = read_file_as_string(obj.m_fname);
     
+    n_cached_text.emplace(oid, text_res);
     return text_res;
 }
 
+void forget_text_resource(const Resour::Oid& oid) {
+    n_cached_text.erase(oid);
+}
+
+void clear_cached_text() {
+    n_cached_text.clear();
+}
+
 std::string read_file_as_string(boost::filesystem::path file) {
     std::ifstream is(file.string().c_str(), std::ios::in | std::ios::binary);
     if (!is) {
@@ -33,8 +33,23 @@ struct Text_Res {
 typedef std::shared_ptr<Text_Res> Text_Res_Ptr;
 typedef std::shared_ptr<const Text_Res> Text_Res_Cptr;
 
+/**
+ * @brief Finds a string resource. Each resource is only read once, after which
+ * the same text is returned, until it is forgotten.
+ * @param oid
+ * @return The text
+ */
 Text_Res_Cptr find_text_resource(Resour::Oid oid);
 
+/**
+ * @brief Makes the next find_text_resource() read the file again, such as
+ * after it was changed. Already found text is unaffected.
+ * @param oid
+ */
+void forget_text_resource(const Resour::Oid& oid);
+
+void clear_cached_text();
+
 std::string read_file_as_string(boost::filesystem::path file);
 
 } // namespace Text
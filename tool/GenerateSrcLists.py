@@ -32,15 +32,17 @@ def generate(destination, sourceList):
     replacements[sourceListVector] = sourceList
     writeWithReplacements(boilerplateFilename, destination, replacements)
 
-def add_thirdparty(sourceList):
+def add_thirdparty(sourceList, only=None):
     thirdparty_sl, thirdparty_dl, _ = indexFiles( \
         '../src/thirdparty/', ['.cpp', '.c', '.cc'], [], False)
     for source in thirdparty_sl:
-        sourceList.append('../thirdparty/' + source)
+        if only is None or any(source.startswith(dir) for dir in only):
+            sourceList.append('../thirdparty/' + source)
     
 # Generate for main sources
 sourceList, dirList, _ = indexFiles( \
-        '../src/' + proj_name + '/', ['.cpp'], ['deprecated/', 'test/'], False)
+        '../src/' + proj_name + '/', ['.cpp'], \
+        ['deprecated/', 'test/', 'bench/'], False)
 sourceList.append('Main.cpp')
 add_thirdparty(sourceList)
 sourceList.sort()
@@ -57,3 +59,14 @@ sourceList.sort()
 print('Test Sources: ' + str(len(sourceList)))
 print('Test Directories: ' + str(len(dirList)))
 generate('../cmake/TestSrcList.cmake', sourceList)
+
+# Generate for benchmark sources (headless: no window, input or rendering)
+sourceList, dirList, _ = indexFiles( \
+        '../src/' + proj_name + '/', ['.cpp'], \
+        ['deprecated/', 'test/', 'app/', 'render/', 'winput/'], False)
+sourceList.append('Bench.cpp')
+add_thirdparty(sourceList, ['easyloggingpp/', 'jsoncpp/'])
+sourceList.sort()
+print('Bench Sources: ' + str(len(sourceList)))
+print('Bench Directories: ' + str(len(dirList)))
+generate('../cmake/BenchSrcList.cmake', sourceList)